@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Replay recorded GitHub webhook payloads against a local --webhook listener.
+# Each argument is EVENT=FILE, e.g. pull_request=payloads/pr-opened.json.
+
+if [ $# -lt 2 ] || [ -z "${AGPM_WEBHOOK_SECRET:-}" ]; then
+  echo "Usage: AGPM_WEBHOOK_SECRET=... $0 URL EVENT=FILE..." >&2
+  exit 1
+fi
+
+url="$1"
+shift
+for delivery in "$@"; do
+  event="${delivery%%=*}"
+  file="${delivery#*=}"
+  signature="sha256=$(openssl dgst -sha256 -hmac "$AGPM_WEBHOOK_SECRET" \
+    -r "$file" | cut -d' ' -f1)"
+  status=$(curl -s -o /dev/null -w '%{http_code}' -X POST "$url" \
+    -H "Content-Type: application/json" \
+    -H "X-GitHub-Event: $event" \
+    -H "X-GitHub-Delivery: replay-$(date +%s%N)-$RANDOM" \
+    -H "X-Hub-Signature-256: $signature" \
+    --data-binary "@$file")
+  echo "$event $file -> $status"
+done
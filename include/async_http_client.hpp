@@ -0,0 +1,277 @@
+/**
+ * @file async_http_client.hpp
+ * @brief Future-based HTTP client interface and curl-multi implementation.
+ *
+ * Declares the AsyncHttpClient interface, which returns futures instead of
+ * blocking, and CurlMultiHttpClient, which drives every transfer from a
+ * single `curl_multi` event loop so many requests can be in flight at once.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_ASYNC_HTTP_CLIENT_HPP
+#define AUTOGITHUBPULLMERGE_ASYNC_HTTP_CLIENT_HPP
+
+#include "github_client.hpp"
+#include <atomic>
+#include <cstddef>
+#include <curl/curl.h>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace agpm {
+
+/**
+ * HTTP client whose requests complete asynchronously.
+ *
+ * Futures resolve with the same contract as the blocking HttpClient methods:
+ * transport failures raise TransientNetworkError and non-2xx responses raise
+ * HttpStatusError, except GET responses with HTTP 403/429 which are returned
+ * so callers can apply rate limit handling. The synchronous HttpClient
+ * methods are implemented as thin blocking adapters over the futures.
+ */
+class AsyncHttpClient : public HttpClient {
+public:
+  /**
+   * Start a HTTP GET request.
+   *
+   * @param url Absolute request URL.
+   * @param headers Additional request headers expressed as `Header: value`
+   *        strings.
+   * @return Future resolving to the response body, headers, and status code.
+   */
+  virtual std::future<HttpResponse>
+  get_async(const std::string &url, const std::vector<std::string> &headers) = 0;
+
+  /**
+   * Start a HTTP PUT request.
+   *
+   * @param url Absolute request URL.
+   * @param data Request body payload encoded as UTF-8.
+   * @param headers Additional request headers.
+   * @return Future resolving to the response.
+   */
+  virtual std::future<HttpResponse>
+  put_async(const std::string &url, const std::string &data,
+            const std::vector<std::string> &headers) = 0;
+
+  /**
+   * Start a HTTP PATCH request.
+   *
+   * @param url Absolute request URL.
+   * @param data Request body payload encoded as UTF-8.
+   * @param headers Additional request headers.
+   * @return Future resolving to the response.
+   */
+  virtual std::future<HttpResponse>
+  patch_async(const std::string &url, const std::string &data,
+              const std::vector<std::string> &headers) = 0;
+
+  /**
+   * Start a HTTP POST request.
+   *
+   * The base implementation resolves with an error to signal unsupported
+   * transports.
+   *
+   * @param url Absolute request URL.
+   * @param data Request body payload encoded as UTF-8.
+   * @param headers Additional request headers.
+   * @return Future resolving to the response.
+   */
+  virtual std::future<HttpResponse>
+  post_async(const std::string &url, const std::string &data,
+             const std::vector<std::string> &headers) {
+    (void)url;
+    (void)data;
+    (void)headers;
+    std::promise<HttpResponse> promise;
+    promise.set_exception(
+        std::make_exception_ptr(std::runtime_error("POST not implemented")));
+    return promise.get_future();
+  }
+
+  /**
+   * Start a HTTP DELETE request.
+   *
+   * @param url Absolute request URL.
+   * @param headers Additional request headers.
+   * @return Future resolving to the response.
+   */
+  virtual std::future<HttpResponse>
+  del_async(const std::string &url, const std::vector<std::string> &headers) = 0;
+
+  /// @copydoc HttpClient::get()
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    return get_with_headers(url, headers).body;
+  }
+
+  /// @copydoc HttpClient::get_with_headers()
+  HttpResponse
+  get_with_headers(const std::string &url,
+                   const std::vector<std::string> &headers) override {
+    return get_async(url, headers).get();
+  }
+
+  /// @copydoc HttpClient::put()
+  std::string put(const std::string &url, const std::string &data,
+                  const std::vector<std::string> &headers) override {
+    return put_async(url, data, headers).get().body;
+  }
+
+  /// @copydoc HttpClient::patch()
+  std::string patch(const std::string &url, const std::string &data,
+                    const std::vector<std::string> &headers) override {
+    return patch_async(url, data, headers).get().body;
+  }
+
+  /// @copydoc HttpClient::post()
+  std::string post(const std::string &url, const std::string &data,
+                   const std::vector<std::string> &headers) override {
+    return post_async(url, data, headers).get().body;
+  }
+
+  /// @copydoc HttpClient::del()
+  std::string del(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    return del_async(url, headers).get().body;
+  }
+};
+
+/**
+ * AsyncHttpClient backed by one `curl_multi` handle and a dedicated event
+ * loop thread.
+ *
+ * Submitting a request only queues it and wakes the loop; the loop attaches
+ * queued transfers to the multi handle, drives all of them concurrently, and
+ * fulfils each promise as its transfer completes. The class is thread-safe.
+ */
+class CurlMultiHttpClient : public AsyncHttpClient {
+public:
+  /**
+   * Construct the client and start its event loop.
+   *
+   * @param timeout_ms Request timeout in milliseconds for each transfer.
+   * @param download_limit Maximum download rate in bytes per second per
+   *        transfer (0 = unlimited).
+   * @param upload_limit Maximum upload rate in bytes per second per transfer
+   *        (0 = unlimited).
+   * @param max_download Maximum cumulative download in bytes before refusing
+   *        further responses (0 = unlimited).
+   * @param max_upload Maximum cumulative upload in bytes before refusing
+   *        further responses (0 = unlimited).
+   * @param http_proxy Proxy URL for HTTP requests.
+   * @param https_proxy Proxy URL for HTTPS requests.
+   * @param max_in_flight Maximum transfers attached to the multi handle at
+   *        once; additional requests wait in the queue (0 = unlimited).
+   * @param http2 Negotiate HTTP/2 (ALPN for https, h2c upgrade for http) and
+   *        multiplex concurrent transfers over shared connections. Servers
+   *        that refuse HTTP/2 are served over HTTP/1.1 transparently.
+   * @param max_concurrent_streams Maximum concurrent HTTP/2 streams per
+   *        connection when @p http2 is enabled.
+   */
+  explicit CurlMultiHttpClient(long timeout_ms = 30000,
+                               curl_off_t download_limit = 0,
+                               curl_off_t upload_limit = 0,
+                               curl_off_t max_download = 0,
+                               curl_off_t max_upload = 0,
+                               std::string http_proxy = {},
+                               std::string https_proxy = {},
+                               std::size_t max_in_flight = 0,
+                               bool http2 = false,
+                               long max_concurrent_streams = 100);
+
+  /// Stop the event loop and fail any requests that have not completed.
+  ~CurlMultiHttpClient() override;
+
+  CurlMultiHttpClient(const CurlMultiHttpClient &) = delete;
+  CurlMultiHttpClient &operator=(const CurlMultiHttpClient &) = delete;
+
+  /// @copydoc AsyncHttpClient::get_async()
+  std::future<HttpResponse>
+  get_async(const std::string &url,
+            const std::vector<std::string> &headers) override;
+
+  /// @copydoc AsyncHttpClient::put_async()
+  std::future<HttpResponse>
+  put_async(const std::string &url, const std::string &data,
+            const std::vector<std::string> &headers) override;
+
+  /// @copydoc AsyncHttpClient::patch_async()
+  std::future<HttpResponse>
+  patch_async(const std::string &url, const std::string &data,
+              const std::vector<std::string> &headers) override;
+
+  /// @copydoc AsyncHttpClient::post_async()
+  std::future<HttpResponse>
+  post_async(const std::string &url, const std::string &data,
+             const std::vector<std::string> &headers) override;
+
+  /// @copydoc AsyncHttpClient::del_async()
+  std::future<HttpResponse>
+  del_async(const std::string &url,
+            const std::vector<std::string> &headers) override;
+
+  /// Number of transfers currently attached to the multi handle.
+  std::size_t in_flight() const { return in_flight_.load(); }
+
+  /// Largest number of transfers that were in flight simultaneously.
+  std::size_t peak_in_flight() const { return peak_in_flight_.load(); }
+
+  /// Whether HTTP/2 multiplexing is active for this client.
+  bool http2_enabled() const { return http2_; }
+
+  /// Completed transfers that were served over HTTP/2.
+  std::size_t http2_transfers() const { return http2_transfers_.load(); }
+
+  /// Completed transfers that were served over HTTP/1.x.
+  std::size_t http1_transfers() const { return http1_transfers_.load(); }
+
+  /// Total bytes downloaded so far.
+  curl_off_t total_downloaded() const { return total_downloaded_.load(); }
+
+  /// Total bytes uploaded so far.
+  curl_off_t total_uploaded() const { return total_uploaded_.load(); }
+
+private:
+  struct Transfer;
+
+  std::future<HttpResponse> submit(const char *verb, const std::string &url,
+                                   const std::string *data,
+                                   const std::vector<std::string> &headers);
+  void run();
+  void attach(std::unique_ptr<Transfer> transfer);
+  void complete(Transfer &transfer, CURLcode code);
+
+  long timeout_ms_;
+  curl_off_t download_limit_;
+  curl_off_t upload_limit_;
+  curl_off_t max_download_;
+  curl_off_t max_upload_;
+  std::string http_proxy_;
+  std::string https_proxy_;
+  std::size_t max_in_flight_;
+  bool http2_;
+  long max_concurrent_streams_;
+
+  CURLM *multi_{nullptr};
+  std::mutex queue_mutex_;
+  std::deque<std::unique_ptr<Transfer>> queue_;
+  std::unordered_map<CURL *, std::unique_ptr<Transfer>> active_;
+  std::atomic<bool> running_{false};
+  std::atomic<std::size_t> in_flight_{0};
+  std::atomic<std::size_t> peak_in_flight_{0};
+  std::atomic<std::size_t> http2_transfers_{0};
+  std::atomic<std::size_t> http1_transfers_{0};
+  std::atomic<curl_off_t> total_downloaded_{0};
+  std::atomic<curl_off_t> total_uploaded_{0};
+  std::thread loop_;
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_ASYNC_HTTP_CLIENT_HPP
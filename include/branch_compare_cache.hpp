@@ -0,0 +1,96 @@
+/**
+ * @file branch_compare_cache.hpp
+ * @brief Persistent cache of branch comparisons used by stray detection.
+ *
+ * Declares BranchCompareCache, which remembers the outcome of comparing a
+ * branch head against the default branch head. Both commits are identified
+ * by SHA, so an entry stays valid until either branch moves and never needs
+ * revalidation.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_BRANCH_COMPARE_CACHE_HPP
+#define AUTOGITHUBPULLMERGE_BRANCH_COMPARE_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace agpm {
+
+/**
+ * Thread-safe map from `(base SHA, head SHA)` to a comparison result,
+ * optionally persisted as JSON.
+ *
+ * Entries not used for longer than the retention period are dropped when
+ * the cache is saved, which bounds the file for repositories whose branches
+ * keep moving.
+ */
+class BranchCompareCache {
+public:
+  /// Outcome of comparing a branch head with the default branch head.
+  struct Comparison {
+    int ahead_by{0};             ///< Commits on the branch but not the base
+    int behind_by{0};            ///< Commits on the base but not the branch
+    std::string status;          ///< `ahead`, `behind`, `diverged`, ...
+    std::int64_t last_commit{0}; ///< Branch head commit time (Unix s, 0 = ?)
+  };
+
+  /// Entries unused for this many seconds are dropped on save (30 days).
+  static constexpr std::int64_t kRetentionSeconds = 30LL * 24 * 3600;
+
+  /**
+   * Look up the comparison of @p head_sha against @p base_sha.
+   *
+   * @return Cached comparison, or `std::nullopt` on a miss.
+   */
+  std::optional<Comparison> lookup(const std::string &base_sha,
+                                   const std::string &head_sha);
+
+  /// Remember the comparison of @p head_sha against @p base_sha.
+  void store(const std::string &base_sha, const std::string &head_sha,
+             Comparison comparison);
+
+  /**
+   * Replace the contents with the entries stored in @p path.
+   *
+   * @return True when the file existed and was parsed.
+   */
+  bool load(const std::string &path);
+
+  /**
+   * Write the entries to @p path through a temporary file when they changed
+   * since the last load or save.
+   *
+   * @return False when writing failed.
+   */
+  bool save(const std::string &path);
+
+  /// Number of cached comparisons.
+  std::size_t size() const;
+
+  /// Lookups answered from the cache.
+  std::uint64_t hits() const { return hits_.load(); }
+
+  /// Lookups that required a fresh comparison.
+  std::uint64_t misses() const { return misses_.load(); }
+
+private:
+  struct Slot {
+    Comparison comparison;
+    std::int64_t last_used{0};
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Slot> entries_;
+  bool dirty_{false};
+  std::atomic<std::uint64_t> hits_{0};
+  std::atomic<std::uint64_t> misses_{0};
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_BRANCH_COMPARE_CACHE_HPP
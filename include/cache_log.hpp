@@ -0,0 +1,88 @@
+/**
+ * @file cache_log.hpp
+ * @brief Append-only binary log persisting ETag cache entries.
+ *
+ * Declares CacheLog, an on-disk format for EtagCache where every changed
+ * entry is appended as a checksummed record. Later records for a URL
+ * supersede earlier ones; compaction rewrites the file with only the live
+ * entries once superseded records dominate it.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_CACHE_LOG_HPP
+#define AUTOGITHUBPULLMERGE_CACHE_LOG_HPP
+
+#include "etag_cache.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace agpm {
+
+/**
+ * Log-structured persistence for cached HTTP responses.
+ *
+ * The file starts with an 8 byte magic followed by records of the form
+ * `u32 length | u32 FNV-1a checksum | payload`, integers in host byte order.
+ * A torn or corrupt tail left by a crash is detected through the checksum
+ * and truncated on load so later appends stay readable. The class is not
+ * thread-safe; callers serialize access.
+ */
+class CacheLog {
+public:
+  /// Entry paired with the URL it caches.
+  using Record = std::pair<std::string, EtagCache::EntryPtr>;
+
+  /// Construct a log backed by @p path. The file is created on first write.
+  explicit CacheLog(std::string path);
+
+  /**
+   * Replay every record in the file, memory-mapping it where supported.
+   *
+   * @param visit Invoked for each record in file order.
+   * @return Number of records replayed; 0 when the file is missing or not a
+   *         cache log.
+   */
+  std::size_t load(
+      const std::function<void(std::string url, EtagCache::Entry entry)>
+          &visit);
+
+  /**
+   * Append @p records to the end of the log.
+   *
+   * A missing or empty file gets the magic first. A non-empty file without
+   * the magic is left untouched and the append fails.
+   *
+   * @return True when every record was written and flushed.
+   */
+  bool append(const std::vector<Record> &records);
+
+  /**
+   * Atomically replace the log with a file holding only @p live.
+   *
+   * @return True when the compacted file was written and renamed into place.
+   */
+  bool compact(const std::vector<Record> &live);
+
+  /**
+   * Whether superseded records make compaction worthwhile.
+   *
+   * @param live_entries Number of entries currently live in memory.
+   */
+  bool should_compact(std::size_t live_entries) const;
+
+  /// Number of records currently stored in the file.
+  std::size_t record_count() const { return records_; }
+
+  /// Whether the file at @p path starts with the cache log magic.
+  static bool is_cache_log(const std::string &path);
+
+private:
+  std::string path_;
+  std::size_t records_{0};
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_CACHE_LOG_HPP
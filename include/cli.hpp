@@ -111,6 +111,13 @@ struct CliOptions {
   int max_hourly_requests = 0;           ///< Max requests per hour (0 = auto)
   bool max_hourly_requests_explicit{false}; ///< True if CLI set hourly limit
   int workers = 0;                          ///< Number of worker threads
+  bool work_stealing{false}; ///< Per-worker deques with work stealing
+  bool stream_results{false}; ///< Per-repository schedules and publishing
+  bool adaptive_intervals{false}; ///< Adapt intervals to repository activity
+  int adaptive_min_interval{0};   ///< Shortest adaptive interval in seconds
+  int adaptive_max_interval{0};   ///< Longest adaptive interval in seconds
+  double priority_rate_reserve{0.1}; ///< Rate share kept for urgent jobs
+  bool priority_rate_reserve_explicit{false}; ///< True if CLI set the reserve
   int http_timeout = 30;                    ///< HTTP timeout in seconds
   int http_retries = 3;                     ///< Number of HTTP retries
   long long download_limit = 0;             ///< Download rate limit (bytes/sec)
@@ -119,17 +126,27 @@ struct CliOptions {
   long long max_upload = 0;                 ///< Max cumulative upload bytes
   std::string http_proxy;                   ///< Proxy URL for HTTP requests
   std::string https_proxy;                  ///< Proxy URL for HTTPS requests
+  bool async_http{false}; ///< Use the curl-multi asynchronous HTTP engine
+  bool http2{false};      ///< Negotiate HTTP/2 and multiplex requests
+  int http2_max_streams{100}; ///< Concurrent HTTP/2 streams per connection
+  std::string http_cache;      ///< Persistent HTTP cache file (empty = off)
+  long long http_cache_max_bytes = 64LL * 1024 * 1024; ///< Cache memory cap
+  int http_cache_flush_ms = 5000; ///< Cache flush interval in milliseconds
+  bool cache_stats{false};        ///< Print HTTP cache statistics on exit
   bool only_poll_prs = false;               ///< Only poll pull requests
   bool only_poll_stray = false;             ///< Only poll stray branches
   StrayDetectionMode stray_detection_mode{
       StrayDetectionMode::RuleBased}; ///< Selected stray detection engines
   bool stray_detection_mode_explicit{
       false};                ///< True if CLI explicitly set detection engines
+  std::string stray_cache;   ///< File persisting stray branch comparisons
+  bool local_analysis{false}; ///< Compare branches in discovered local clones
   bool reject_dirty = false; ///< Auto close dirty branches
   bool delete_stray{false};  ///< Delete stray branches automatically
   bool allow_delete_base_branch{
       false};                ///< Permit deleting base branches (dangerous)
   bool auto_merge{false};    ///< Automatically merge pull requests
+  int decision_cache_ttl{0}; ///< Seconds to reuse waiting merge decisions
   int required_approvals{0}; ///< Required approvals before merge
   bool require_status_success{false};  ///< Require status checks to succeed
   bool require_mergeable_state{false}; ///< Require PR to be mergeable
@@ -140,6 +157,9 @@ struct CliOptions {
       0};                  ///< Only list pull requests newer than this duration
   std::string sort;        ///< Sorting mode for pull requests
   bool use_graphql{false}; ///< Use GraphQL API for pull requests
+  int graphql_batch_size{0}; ///< Repositories per batched GraphQL query
+  bool incremental_prs{false}; ///< List only PRs updated since last poll
+  std::string pr_state_file;   ///< File persisting incremental PR watermarks
   bool hotkeys_enabled{true};   ///< Whether interactive hotkeys are enabled
   bool hotkeys_explicit{false}; ///< True if CLI explicitly toggled hotkeys
 
@@ -183,6 +203,12 @@ struct CliOptions {
   bool mcp_server_max_clients_explicit{false}; ///< True if CLI set max clients
   bool mcp_caddy_window{false};     ///< Enable MCP server event sidecar window
   bool mcp_caddy_explicit{false};   ///< True if CLI toggled MCP caddy window
+
+  bool webhook_enabled{false};      ///< Receive GitHub webhook deliveries
+  std::string webhook_bind_address; ///< Bind address for the webhook listener
+  int webhook_port{0};              ///< TCP port for the webhook listener
+  std::string webhook_secret;       ///< Shared secret verifying deliveries
+  int webhook_reconcile_interval{0}; ///< Seconds between full polls with webhooks
   bool request_caddy_window{false}; ///< Enable request queue sidecar window
   bool request_caddy_explicit{false}; ///< True if CLI toggled request caddy
 
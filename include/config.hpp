@@ -12,6 +12,7 @@
 #include "hook.hpp"
 #include "repo_discovery.hpp"
 #include "stray_detection_mode.hpp"
+#include <algorithm>
 #include <chrono>
 #include <nlohmann/json_fwd.hpp>
 #include <optional>
@@ -92,6 +93,48 @@ public:
   /// Set worker thread count (minimum 1).
   void set_workers(int w) { workers_ = w < 1 ? 1 : w; }
 
+  /// Whether workers use per-worker deques with work stealing.
+  bool work_stealing() const { return work_stealing_; }
+
+  /// Enable or disable the work-stealing scheduler.
+  void set_work_stealing(bool v) { work_stealing_ = v; }
+
+  /// Whether repositories are polled and published independently.
+  bool stream_results() const { return stream_results_; }
+
+  /// Enable or disable streaming per-repository results.
+  void set_stream_results(bool v) { stream_results_ = v; }
+
+  /// Whether poll intervals adapt to each repository's activity.
+  bool adaptive_intervals() const { return adaptive_intervals_; }
+
+  /// Enable or disable adaptive per-repository poll intervals.
+  void set_adaptive_intervals(bool v) { adaptive_intervals_ = v; }
+
+  /// Shortest adaptive poll interval in seconds.
+  int adaptive_min_interval() const { return adaptive_min_interval_; }
+
+  /// Set the shortest adaptive poll interval in seconds (minimum 1).
+  void set_adaptive_min_interval(int seconds) {
+    adaptive_min_interval_ = seconds < 1 ? 1 : seconds;
+  }
+
+  /// Longest adaptive poll interval in seconds.
+  int adaptive_max_interval() const { return adaptive_max_interval_; }
+
+  /// Set the longest adaptive poll interval in seconds (minimum 1).
+  void set_adaptive_max_interval(int seconds) {
+    adaptive_max_interval_ = seconds < 1 ? 1 : seconds;
+  }
+
+  /// Fraction of the request rate reserved for interactive and mutation jobs.
+  double priority_rate_reserve() const { return priority_rate_reserve_; }
+
+  /// Set the reserved rate fraction, clamped to [0, 0.9].
+  void set_priority_rate_reserve(double v) {
+    priority_rate_reserve_ = std::clamp(v, 0.0, 0.9);
+  }
+
   /// HTTP request timeout in seconds.
   int http_timeout() const { return http_timeout_; }
 
@@ -146,6 +189,48 @@ public:
   /// Set proxy URL for HTTPS requests.
   void set_https_proxy(const std::string &proxy) { https_proxy_ = proxy; }
 
+  /// Whether the curl-multi asynchronous HTTP engine should be used.
+  bool async_http() const { return async_http_; }
+
+  /// Enable or disable the asynchronous HTTP engine.
+  void set_async_http(bool v) { async_http_ = v; }
+
+  /// Whether requests should be multiplexed over HTTP/2.
+  bool http2() const { return http2_; }
+
+  /// Enable or disable HTTP/2 multiplexing.
+  void set_http2(bool v) { http2_ = v; }
+
+  /// Maximum concurrent HTTP/2 streams per connection.
+  int http2_max_streams() const { return http2_max_streams_; }
+
+  /// Set the maximum concurrent HTTP/2 streams per connection.
+  void set_http2_max_streams(int v) { http2_max_streams_ = v; }
+
+  /// Path of the persistent HTTP cache file (empty disables persistence).
+  const std::string &http_cache() const { return http_cache_; }
+
+  /// Set the persistent HTTP cache file.
+  void set_http_cache(const std::string &path) { http_cache_ = path; }
+
+  /// Memory cap for cached HTTP responses in bytes (0 = unlimited).
+  long long http_cache_max_bytes() const { return http_cache_max_bytes_; }
+
+  /// Set the memory cap for cached HTTP responses.
+  void set_http_cache_max_bytes(long long v) { http_cache_max_bytes_ = v; }
+
+  /// Interval between HTTP cache flushes in milliseconds.
+  int http_cache_flush_ms() const { return http_cache_flush_ms_; }
+
+  /// Set the interval between HTTP cache flushes.
+  void set_http_cache_flush_ms(int v) { http_cache_flush_ms_ = v; }
+
+  /// Whether HTTP cache statistics are printed on shutdown.
+  bool cache_stats() const { return cache_stats_; }
+
+  /// Enable or disable the shutdown HTTP cache report.
+  void set_cache_stats(bool v) { cache_stats_ = v; }
+
   /// Get logging verbosity level.
   const std::string &log_level() const { return log_level_; }
 
@@ -402,6 +487,14 @@ public:
   /// Set auto merge flag.
   void set_auto_merge(bool v) { auto_merge_ = v; }
 
+  /// Seconds an unchanged waiting pull request skips re-evaluation.
+  int decision_cache_ttl() const { return decision_cache_ttl_; }
+
+  /// Set the auto-merge decision cache TTL in seconds (0 disables).
+  void set_decision_cache_ttl(int seconds) {
+    decision_cache_ttl_ = seconds < 0 ? 0 : seconds;
+  }
+
   /// Merge rule configuration
   /// Required number of approvals before merging.
   int required_approvals() const { return required_approvals_; }
@@ -454,6 +547,18 @@ public:
     stray_detection_mode_ = mode;
   }
 
+  /// File persisting heuristic branch comparisons (empty = in memory).
+  const std::string &stray_cache() const { return stray_cache_; }
+
+  /// Set the file persisting heuristic branch comparisons.
+  void set_stray_cache(const std::string &path) { stray_cache_ = path; }
+
+  /// Whether branch comparisons use local clones under the discovery roots.
+  bool local_analysis() const { return local_analysis_; }
+
+  /// Enable or disable branch comparisons from local clones.
+  void set_local_analysis(bool v) { local_analysis_ = v; }
+
   /// Allow deleting base branches.
   bool allow_delete_base_branch() const { return allow_delete_base_branch_; }
 
@@ -484,6 +589,24 @@ public:
   /// Enable or disable GraphQL usage.
   void set_use_graphql(bool v) { use_graphql_ = v; }
 
+  /// Repositories per batched GraphQL listing query (0 = no batching).
+  int graphql_batch_size() const { return graphql_batch_size_; }
+
+  /// Set the number of repositories per batched GraphQL query.
+  void set_graphql_batch_size(int v) { graphql_batch_size_ = v; }
+
+  /// Whether REST pull request listings are fetched incrementally.
+  bool incremental_prs() const { return incremental_prs_; }
+
+  /// Enable or disable incremental pull request listing.
+  void set_incremental_prs(bool v) { incremental_prs_ = v; }
+
+  /// File persisting incremental listing watermarks (empty = in memory).
+  const std::string &pr_state_file() const { return pr_state_file_; }
+
+  /// Set the file persisting incremental listing watermarks.
+  void set_pr_state_file(const std::string &path) { pr_state_file_ = path; }
+
   /// Fraction of the hourly GitHub rate limit kept in reserve.
   double rate_limit_margin() const { return rate_limit_margin_; }
 
@@ -710,6 +833,46 @@ public:
     mcp_server_max_clients_ = clients < 0 ? 0 : clients;
   }
 
+  /// Whether the webhook listener is enabled.
+  bool webhook_enabled() const { return webhook_enabled_; }
+
+  /// Enable or disable the webhook listener.
+  void set_webhook_enabled(bool enabled) { webhook_enabled_ = enabled; }
+
+  /// Address used when binding the webhook listener socket.
+  const std::string &webhook_bind_address() const {
+    return webhook_bind_address_;
+  }
+
+  /// Update the webhook listener bind address.
+  void set_webhook_bind_address(const std::string &address) {
+    webhook_bind_address_ = address;
+  }
+
+  /// TCP port exposed by the webhook listener.
+  int webhook_port() const { return webhook_port_; }
+
+  /// Set the webhook listener port, clamping to the valid TCP range.
+  void set_webhook_port(int port) {
+    webhook_port_ = port < 1 ? 1 : (port > 65535 ? 65535 : port);
+  }
+
+  /// Shared secret verifying webhook signatures.
+  const std::string &webhook_secret() const { return webhook_secret_; }
+
+  /// Set the shared webhook secret.
+  void set_webhook_secret(const std::string &secret) {
+    webhook_secret_ = secret;
+  }
+
+  /// Seconds between full reconciliation polls while webhooks are enabled.
+  int webhook_reconcile_interval() const { return webhook_reconcile_interval_; }
+
+  /// Set the reconciliation poll interval in seconds (minimum one second).
+  void set_webhook_reconcile_interval(int seconds) {
+    webhook_reconcile_interval_ = seconds < 1 ? 1 : seconds;
+  }
+
   /// Whether the MCP activity sidecar window is enabled.
   bool mcp_server_caddy_window() const { return mcp_server_caddy_window_; }
 
@@ -725,6 +888,12 @@ private:
   int max_request_rate_ = 60;
   int max_hourly_requests_ = 0;
   int workers_ = 4; ///< Default number of worker threads
+  bool work_stealing_ = false;
+  bool stream_results_ = false;
+  bool adaptive_intervals_ = false;
+  int adaptive_min_interval_ = 15;
+  int adaptive_max_interval_ = 1800;
+  double priority_rate_reserve_ = 0.1;
   std::string log_level_ = "info";
   std::string log_pattern_;
   std::string log_file_;
@@ -757,6 +926,7 @@ private:
   bool purge_only_ = false;
   bool reject_dirty_ = false;
   bool auto_merge_ = false;
+  int decision_cache_ttl_ = 0;
   int required_approvals_ = 0;
   bool require_status_success_ = false;
   bool require_mergeable_state_ = false;
@@ -765,6 +935,9 @@ private:
   std::chrono::seconds pr_since_{0};
   std::string sort_mode_;
   bool use_graphql_ = false;
+  int graphql_batch_size_ = 0;
+  bool incremental_prs_ = false;
+  std::string pr_state_file_;
   bool hotkeys_enabled_ = true;
   std::unordered_map<std::string, std::string> hotkey_bindings_;
   int http_timeout_ = 30;
@@ -780,8 +953,17 @@ private:
   long long max_upload_ = 0;
   std::string http_proxy_;
   std::string https_proxy_;
+  bool async_http_ = false;
+  bool http2_ = false;
+  int http2_max_streams_ = 100;
+  std::string http_cache_;
+  long long http_cache_max_bytes_ = 64LL * 1024 * 1024;
+  int http_cache_flush_ms_ = 5000;
+  bool cache_stats_ = false;
   bool delete_stray_ = false;
   StrayDetectionMode stray_detection_mode_ = StrayDetectionMode::RuleBased;
+  std::string stray_cache_;
+  bool local_analysis_ = false;
   bool allow_delete_base_branch_ = false;
   bool open_pat_page_ = false;
   std::string pat_save_path_;
@@ -802,6 +984,11 @@ private:
   int mcp_server_backlog_{16};
   int mcp_server_max_clients_{4};
   bool mcp_server_caddy_window_{false};
+  bool webhook_enabled_{false};
+  std::string webhook_bind_address_{"127.0.0.1"};
+  int webhook_port_{7333};
+  std::string webhook_secret_;
+  int webhook_reconcile_interval_{900};
 };
 
 } // namespace agpm
@@ -0,0 +1,106 @@
+/**
+ * @file curl_share.hpp
+ * @brief Process-wide libcurl share pool and per-thread easy handle leases.
+ *
+ * Declares CurlSharePool, which owns a `CURLSH` object sharing the DNS cache
+ * and TLS session cache between every HTTP client in the process, and
+ * CurlHandleLease, which hands out long-lived easy handles cached per thread
+ * so their live connections are reused across requests.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_CURL_SHARE_HPP
+#define AUTOGITHUBPULLMERGE_CURL_SHARE_HPP
+
+#include "github_client.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <curl/curl.h>
+#include <memory>
+#include <mutex>
+
+namespace agpm {
+
+/**
+ * RAII lease of a per-thread CURL easy handle.
+ *
+ * The handle is returned to the calling thread's idle list on destruction,
+ * keeping its connection cache warm for the next request issued from the
+ * same thread. Leases must be released on the thread that acquired them.
+ */
+class CurlHandleLease {
+public:
+  explicit CurlHandleLease(std::unique_ptr<CurlHandle> handle);
+  ~CurlHandleLease();
+  CurlHandleLease(const CurlHandleLease &) = delete;
+  CurlHandleLease &operator=(const CurlHandleLease &) = delete;
+
+  /// Access the leased CURL easy handle.
+  CURL *get() const { return handle_->get(); }
+
+private:
+  std::unique_ptr<CurlHandle> handle_;
+};
+
+/**
+ * Process-wide pool sharing libcurl caches between all HTTP clients.
+ *
+ * DNS lookups and TLS sessions are shared through a single `CURLSH` guarded
+ * by per-data-type mutexes. libcurl does not support sharing the connection
+ * cache between concurrently running threads, so connection reuse comes from
+ * the per-thread easy handles handed out by checkout(), which keep their
+ * connections open between requests.
+ */
+class CurlSharePool {
+public:
+  /// Snapshot of connection reuse counters.
+  struct Stats {
+    std::uint64_t new_connections{0};    ///< Connections freshly opened
+    std::uint64_t reused_connections{0}; ///< Transfers on a live connection
+  };
+
+  /// Access the process-wide pool.
+  static CurlSharePool &instance();
+
+  ~CurlSharePool();
+  CurlSharePool(const CurlSharePool &) = delete;
+  CurlSharePool &operator=(const CurlSharePool &) = delete;
+
+  /**
+   * Check out the calling thread's easy handle, creating one on demand.
+   *
+   * The handle is reset to default options and already attached to the
+   * share object.
+   */
+  CurlHandleLease checkout();
+
+  /// Attach an externally owned easy handle to the share object.
+  void attach(CURL *curl);
+
+  /**
+   * Record whether a completed transfer opened new connections or reused an
+   * existing one.
+   */
+  void record_transfer(CURL *curl);
+
+  /// Current connection reuse counters.
+  Stats stats() const;
+
+  /// Reset the connection reuse counters to zero.
+  void reset_stats();
+
+private:
+  CurlSharePool();
+  static void lock(CURL *handle, curl_lock_data data, curl_lock_access access,
+                   void *userptr);
+  static void unlock(CURL *handle, curl_lock_data data, void *userptr);
+
+  CURLSH *share_{nullptr};
+  std::array<std::mutex, CURL_LOCK_DATA_LAST> locks_;
+  std::atomic<std::uint64_t> new_connections_{0};
+  std::atomic<std::uint64_t> reused_connections_{0};
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_CURL_SHARE_HPP
@@ -0,0 +1,133 @@
+/**
+ * @file etag_cache.hpp
+ * @brief Sharded, memory-bounded cache of conditional GET responses.
+ *
+ * Declares EtagCache, which stores response bodies keyed by URL together
+ * with their ETag so requests can be revalidated with `If-None-Match`.
+ * Entries are spread over independently locked shards, each with its own
+ * LRU list, and the total accounted size is capped.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_ETAG_CACHE_HPP
+#define AUTOGITHUBPULLMERGE_ETAG_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace agpm {
+
+/**
+ * Thread-safe LRU cache of ETag-validated HTTP responses.
+ *
+ * The memory cap is divided evenly between shards; inserting into a shard
+ * that exceeds its share evicts that shard's least recently used entries.
+ * Entries are immutable and handed out as shared pointers, so readers keep
+ * a consistent snapshot even if the entry is replaced or evicted meanwhile.
+ */
+class EtagCache {
+public:
+  /// Cached response for one URL.
+  struct Entry {
+    std::string etag;                 ///< Validator sent as `If-None-Match`
+    std::string body;                 ///< Response body
+    std::vector<std::string> headers; ///< Response headers
+  };
+  using EntryPtr = std::shared_ptr<const Entry>;
+
+  /// Counters and occupancy for a single shard.
+  struct ShardStats {
+    std::uint64_t hits{0};          ///< Lookups that found an entry
+    std::uint64_t misses{0};        ///< Lookups that found nothing
+    std::uint64_t revalidations{0}; ///< Entries confirmed by HTTP 304
+    std::uint64_t evictions{0};     ///< Entries dropped to honour the cap
+    std::size_t entries{0};         ///< Entries currently stored
+    std::size_t bytes{0};           ///< Accounted bytes currently stored
+  };
+
+  /// Default memory cap in bytes.
+  static constexpr std::size_t kDefaultMaxBytes = 64u * 1024u * 1024u;
+  /// Default number of shards.
+  static constexpr std::size_t kDefaultShards = 16;
+
+  /**
+   * Construct an empty cache.
+   *
+   * @param max_bytes Total memory cap across all shards (0 = unlimited).
+   * @param shards Number of independently locked shards (at least 1).
+   */
+  explicit EtagCache(std::size_t max_bytes = kDefaultMaxBytes,
+                     std::size_t shards = kDefaultShards);
+
+  EtagCache(const EtagCache &) = delete;
+  EtagCache &operator=(const EtagCache &) = delete;
+
+  /**
+   * Look up the entry for @p url and mark it most recently used.
+   *
+   * @return The cached entry or `nullptr` when absent.
+   */
+  EntryPtr lookup(const std::string &url);
+
+  /**
+   * Insert or replace the entry for @p url, evicting older entries from the
+   * same shard when its share of the cap is exceeded. Entries larger than a
+   * whole shard's share are not stored.
+   */
+  void put(const std::string &url, EntryPtr entry);
+
+  /// Record that the entry for @p url was confirmed unchanged by HTTP 304.
+  void record_revalidation(const std::string &url);
+
+  /// Remove every entry. Counters are preserved.
+  void clear();
+
+  /// Change the memory cap, evicting immediately if needed (0 = unlimited).
+  void set_max_bytes(std::size_t max_bytes);
+
+  /// Current memory cap in bytes.
+  std::size_t max_bytes() const;
+
+  /// Copy every entry, most recently used first within each shard.
+  std::vector<std::pair<std::string, EntryPtr>> snapshot() const;
+
+  /// Per-shard counters and occupancy.
+  std::vector<ShardStats> shard_stats() const;
+
+  /// Counters and occupancy summed over all shards.
+  ShardStats totals() const;
+
+  /// Approximate memory accounted to one entry stored under @p url.
+  static std::size_t entry_bytes(const std::string &url, const Entry &entry);
+
+private:
+  struct Shard {
+    using LruList = std::list<std::pair<std::string, EntryPtr>>;
+    mutable std::mutex mutex;
+    LruList lru; ///< Most recently used at the front
+    std::unordered_map<std::string, LruList::iterator> index;
+    std::size_t bytes{0};
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t revalidations{0};
+    std::uint64_t evictions{0};
+  };
+
+  Shard &shard_for(const std::string &url);
+  std::size_t shard_cap() const;
+  void evict_locked(Shard &shard, std::size_t cap);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<std::size_t> max_bytes_;
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_ETAG_CACHE_HPP
@@ -12,7 +12,12 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include "branch_compare_cache.hpp"
+#include "etag_cache.hpp"
 #include <curl/curl.h>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
@@ -27,6 +32,10 @@
 
 namespace agpm {
 
+class AsyncHttpClient;
+class LocalGitRepository;
+class CacheLog;
+
 /* Typed network errors used by HTTP clients so retry logic can be precise. */
 struct TransientNetworkError : public std::runtime_error {
   using std::runtime_error::runtime_error;
@@ -47,7 +56,12 @@ struct HttpResponse {
   long status_code = 0;             ///< HTTP status code
 };
 
-/** Interface for performing HTTP requests. */
+/**
+ * Interface for performing HTTP requests.
+ *
+ * Implementations handed to GitHubClient must tolerate concurrent calls from
+ * multiple threads since the client no longer serializes requests.
+ */
 class HttpClient {
 public:
   virtual ~HttpClient() = default;
@@ -106,6 +120,27 @@ public:
     throw std::runtime_error("PATCH not implemented");
   }
 
+  /**
+   * Perform a HTTP POST request.
+   *
+   * Used for GraphQL queries. The base implementation throws to signal
+   * unsupported transports.
+   *
+   * @param url Absolute request URL.
+   * @param data Request body payload encoded as UTF-8.
+   * @param headers Additional request headers expressed as `Header: value`
+   *        strings.
+   * @return Response body content as a UTF-8 string.
+   * @throws std::runtime_error On transport or protocol failures.
+   */
+  virtual std::string post(const std::string &url, const std::string &data,
+                           const std::vector<std::string> &headers) {
+    (void)url;
+    (void)data;
+    (void)headers;
+    throw std::runtime_error("POST not implemented");
+  }
+
   /**
    * Perform a HTTP DELETE request.
    *
@@ -119,12 +154,55 @@ public:
                           const std::vector<std::string> &headers) = 0;
 };
 
+/**
+ * HttpClient forwarding every request to a transport owned elsewhere.
+ *
+ * Lets a second API client issue requests through the same engine, and so
+ * the same connections, bandwidth caps and transfer limits. The target must
+ * outlive this object.
+ */
+class SharedHttpClient : public HttpClient {
+public:
+  explicit SharedHttpClient(HttpClient &target) : target_(target) {}
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    return target_.get(url, headers);
+  }
+  HttpResponse
+  get_with_headers(const std::string &url,
+                   const std::vector<std::string> &headers) override {
+    return target_.get_with_headers(url, headers);
+  }
+  std::string put(const std::string &url, const std::string &data,
+                  const std::vector<std::string> &headers) override {
+    return target_.put(url, data, headers);
+  }
+  std::string patch(const std::string &url, const std::string &data,
+                    const std::vector<std::string> &headers) override {
+    return target_.patch(url, data, headers);
+  }
+  std::string post(const std::string &url, const std::string &data,
+                   const std::vector<std::string> &headers) override {
+    return target_.post(url, data, headers);
+  }
+  std::string del(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    return target_.del(url, headers);
+  }
+
+private:
+  HttpClient &target_;
+};
+
 /**
  * RAII wrapper for a CURL easy handle ensuring global CURL initialization.
  */
 class CurlHandle {
 public:
   CurlHandle();
+  /// Perform process-wide libcurl initialization exactly once.
+  static void global_init();
   ~CurlHandle();
   CurlHandle(const CurlHandle &) = delete;
   CurlHandle &operator=(const CurlHandle &) = delete;
@@ -142,8 +220,10 @@ private:
 /**
  * CURL-based HTTP client implementation.
  *
- * @note This class is not thread-safe; use one instance per thread or provide
- *       external synchronization.
+ * Each request checks out the calling thread's easy handle from the
+ * process-wide CurlSharePool, so concurrent callers never share a handle,
+ * live connections are reused between requests on the same thread, and DNS
+ * and TLS session caches are shared process-wide.
  */
 class CurlHttpClient : public HttpClient {
 public:
@@ -188,6 +268,10 @@ public:
   std::string patch(const std::string &url, const std::string &data,
                     const std::vector<std::string> &headers) override;
 
+  /// @copydoc HttpClient::post()
+  std::string post(const std::string &url, const std::string &data,
+                   const std::vector<std::string> &headers) override;
+
   /// @copydoc HttpClient::del()
   std::string del(const std::string &url,
                   const std::vector<std::string> &headers) override;
@@ -217,8 +301,8 @@ public:
   const std::string &https_proxy() const { return https_proxy_; }
 
 private:
+  void record_transfer(CURL *curl);
   void apply_proxy(CURL *curl, const std::string &url);
-  CurlHandle curl_;
   long timeout_ms_;
   curl_off_t download_limit_;
   curl_off_t upload_limit_;
@@ -226,17 +310,8 @@ private:
   curl_off_t max_upload_;
   std::string http_proxy_;
   std::string https_proxy_;
-  curl_off_t total_downloaded_{0};
-  curl_off_t total_uploaded_{0};
-};
-
-/// Representation of a GitHub pull request.
-struct PullRequest {
-  int number;          ///< PR number
-  std::string title;   ///< PR title
-  bool merged{};       ///< Whether the PR has been merged
-  std::string owner{}; ///< Repository owner
-  std::string repo{};  ///< Repository name
+  std::atomic<curl_off_t> total_downloaded_{0};
+  std::atomic<curl_off_t> total_uploaded_{0};
 };
 
 /// Enumeration describing the CI check result for a pull request.
@@ -257,6 +332,32 @@ struct PullRequestMetadata {
                                     PullRequestCheckState::Unknown};
 };
 
+/// Representation of a GitHub pull request.
+struct PullRequest {
+  int number;          ///< PR number
+  std::string title;   ///< PR title
+  bool merged{};       ///< Whether the PR has been merged
+  std::string owner{}; ///< Repository owner
+  std::string repo{};  ///< Repository name
+  std::string head_sha{};   ///< Head commit SHA when the listing provided it
+  std::string updated_at{}; ///< Last update time (ISO-8601) when provided
+  /// Merge metadata when the listing already provided it (GraphQL).
+  std::optional<PullRequestMetadata> metadata{};
+};
+
+/**
+ * Pull requests changed since a repository's high-water mark.
+ *
+ * Produced by GitHubClient::list_pull_requests_since for merging into a
+ * locally held snapshot of open pull requests.
+ */
+struct PullRequestDelta {
+  std::vector<PullRequest> open;   ///< Open pull requests updated since the mark
+  std::vector<PullRequest> closed; ///< Pull requests closed or merged since
+  std::string watermark;           ///< Newest `updated_at` seen (ISO-8601)
+  int pages{0};                    ///< Listing pages requested
+};
+
 /// Representation of a stray branch detected during polling.
 struct StrayBranch {
   std::string owner; ///< Repository owner
@@ -290,7 +391,9 @@ public:
    * @param dry_run When true, destructive operations such as merges or branch
    *        deletions are simulated instead of performed.
    * @param cache_file Optional filesystem path used to persist ETag-based cache
-   *        entries between runs.
+   *        entries between runs. Paths ending in `.json` are written as a
+   *        JSON snapshot; any other path uses the append-only binary cache
+   *        log, importing a legacy JSON file found there on first load.
    */
   explicit GitHubClient(std::vector<std::string> tokens,
                         std::unique_ptr<HttpClient> http = nullptr,
@@ -307,28 +410,55 @@ public:
   void set_delay_ms(int delay_ms);
 
   /// Set required approvals before merging.
-  void set_required_approvals(int n) {
-    std::scoped_lock lock(mutex_);
-    required_approvals_ = n;
-  }
+  void set_required_approvals(int n) { required_approvals_.store(n); }
 
   /// Set whether successful status checks are required before merging.
-  void set_require_status_success(bool v) {
-    std::scoped_lock lock(mutex_);
-    require_status_success_ = v;
-  }
+  void set_require_status_success(bool v) { require_status_success_.store(v); }
 
   /// Set whether a PR must be mergeable before merging.
-  void set_require_mergeable_state(bool v) {
-    std::scoped_lock lock(mutex_);
-    require_mergeable_state_ = v;
-  }
+  void set_require_mergeable_state(bool v) { require_mergeable_state_.store(v); }
 
   /// Set whether base branches such as main/master may be deleted.
-  void set_allow_delete_base_branch(bool v) {
-    std::scoped_lock lock(mutex_);
-    allow_delete_base_branch_ = v;
-  }
+  void set_allow_delete_base_branch(bool v) { allow_delete_base_branch_.store(v); }
+
+  /// Callable that schedules a named job and returns its completion future.
+  using TaskRunner =
+      std::function<std::future<void>(std::string, std::function<void()>)>;
+
+  /**
+   * Callable blocking until one more request may be issued, typically
+   * Poller::acquire_token(). Returns false when requests should stop.
+   */
+  using RateGate = std::function<bool()>;
+
+  /**
+   * Dispatch the per-branch compare and metadata requests issued by
+   * detect_stray_branches() and close_dirty_branches() through @p runner,
+   * typically Poller::submit(), so a repository with many branches is spread
+   * across the worker pool instead of occupying a single worker. The calling
+   * thread runs any sub-job no worker has picked up yet, so a saturated pool
+   * cannot deadlock. Decisions are still made in branch order once every
+   * result is in. An empty runner restores sequential requests.
+   *
+   * @param rate_gate Passed for each sub-job the calling thread runs and for
+   *        each compare put in flight ahead of time on an asynchronous
+   *        engine, so those requests stay within the runner's rate limit.
+   */
+  void set_task_runner(TaskRunner runner, RateGate rate_gate = {});
+
+  /**
+   * Register local clones or mirrors, keyed by `owner/repo`, whose object
+   * databases answer branch comparisons in detect_stray_branches() and
+   * close_dirty_branches() instead of the compare API. A clone is only used
+   * for a comparison when it already contains both commits GitHub reports,
+   * so a stale clone silently falls back to the API.
+   *
+   * @param git_dirs Git directories as returned by discover_local_clones().
+   */
+  void set_local_clones(std::unordered_map<std::string, std::string> git_dirs);
+
+  /// Number of branch comparisons answered from local clones.
+  std::uint64_t local_comparisons() const { return local_comparisons_.load(); }
 
   /**
    * List repositories accessible to the authenticated user.
@@ -346,12 +476,36 @@ public:
    * @param include_merged Include merged pull requests when true.
    * @param per_page Number of pull requests to fetch per page (max 100).
    * @param since Only include pull requests updated on or after this timestamp.
+   * @param complete Optional flag set to `false` when a page could not be
+   *        fetched or parsed, so the result may be missing pull requests.
    * @return List of pull request summaries retrieved from the REST API.
    */
   std::vector<PullRequest>
   list_pull_requests(const std::string &owner, const std::string &repo,
                      bool include_merged = false, int per_page = 50,
-                     std::chrono::seconds since = std::chrono::seconds{0});
+                     std::chrono::seconds since = std::chrono::seconds{0},
+                     bool *complete = nullptr);
+
+  /**
+   * List pull requests updated since a high-water mark.
+   *
+   * Pages through `/pulls?sort=updated&direction=desc` and stops at the
+   * first pull request last updated before @p watermark, so a quiet
+   * repository costs one small page (or a 304 through the ETag cache). With
+   * an empty watermark every open pull request is listed to seed the
+   * snapshot.
+   *
+   * @param owner Repository owner.
+   * @param repo Repository name.
+   * @param watermark `updated_at` of the newest pull request already merged
+   *        into the caller's snapshot; empty for a full listing.
+   * @param per_page Number of pull requests to fetch per page (max 100).
+   * @return Changes since @p watermark, or `std::nullopt` when a page could
+   *         not be fetched and the snapshot must stay untouched.
+   */
+  std::optional<PullRequestDelta>
+  list_pull_requests_since(const std::string &owner, const std::string &repo,
+                           const std::string &watermark, int per_page = 50);
 
   /**
    * Perform a single HTTP request to list currently open pull requests for a
@@ -360,11 +514,13 @@ public:
    *
    * @param owner_repo Repository in "owner/repo" format.
    * @param per_page Maximum number of PRs to request (default 100).
+   * @param complete Optional flag set to `false` when the request or its
+   *        parsing failed.
    * @return List of open pull requests from a single page.
    */
   std::vector<PullRequest>
   list_open_pull_requests_single(const std::string &owner_repo,
-                                 int per_page = 100);
+                                 int per_page = 100, bool *complete = nullptr);
 
   /**
    * Merge a pull request.
@@ -412,11 +568,15 @@ public:
    *
    * @param owner Repository owner.
    * @param repo Repository name.
+   * @param default_branch Receives the repository's default branch.
+   * @param branch_shas Receives the head commit SHA of every listed branch,
+   *        including the default branch.
    * @return All non-default branch names that survive include/exclude filters.
    */
-  std::vector<std::string> list_branches(const std::string &owner,
-                                         const std::string &repo,
-                                         std::string *default_branch = nullptr);
+  std::vector<std::string> list_branches(
+      const std::string &owner, const std::string &repo,
+      std::string *default_branch = nullptr,
+      std::unordered_map<std::string, std::string> *branch_shas = nullptr);
 
   /**
    * Identify branches that appear stray based on heuristic signals.
@@ -427,6 +587,10 @@ public:
    * @param branches Candidate branch names to analyse.
    * @param protected_branches Branch patterns excluded from consideration.
    * @param protected_branch_excludes Patterns that lift protection.
+   * @param branch_shas Head SHAs from list_branches(). When both the branch
+   *        and the default branch SHA are known, comparisons are served from
+   *        the compare cache and only branches whose head or base moved are
+   *        compared again.
    * @return Branch names that are likely safe to prune.
    */
   std::vector<std::string> detect_stray_branches(
@@ -434,7 +598,9 @@ public:
       const std::string &default_branch,
       const std::vector<std::string> &branches,
       const std::vector<std::string> &protected_branches = {},
-      const std::vector<std::string> &protected_branch_excludes = {});
+      const std::vector<std::string> &protected_branch_excludes = {},
+      const std::unordered_map<std::string, std::string> *branch_shas =
+          nullptr);
 
   /**
    * Perform a single HTTP request to list branches for a repository. Intended
@@ -500,24 +666,30 @@ public:
   std::optional<RateLimitStatus> rate_limit_status(int max_attempts = 1);
 
 private:
-  mutable std::mutex mutex_;
-
+  // Construction-time configuration below is immutable afterwards and may be
+  // read from any thread without locking.
   std::vector<std::string> tokens_;
-  size_t token_index_{0};
+  std::atomic<size_t> token_index_{0};
   std::unique_ptr<HttpClient> http_;
+  /// Asynchronous engine behind `http_` when the caller supplied one.
+  AsyncHttpClient *async_http_{nullptr};
   std::unordered_set<std::string> include_repos_;
   std::unordered_set<std::string> exclude_repos_;
   std::string api_base_;
   bool dry_run_{false};
 
-  struct CachedResponse {
-    std::string etag;
-    std::string body;
-    std::vector<std::string> headers;
-  };
-  std::unordered_map<std::string, CachedResponse> cache_;
+  // Sharded, memory-bounded ETag cache; safe to use without extra locking.
+  EtagCache cache_;
+  /// Serializes writes to `cache_file_` and guards `last_cache_save_` and
+  /// `cache_log_`.
+  std::mutex cache_file_mutex_;
   std::string cache_file_;
-  bool cache_dirty_{false};
+  /// Binary log behind `cache_file_`; null when persisting as JSON.
+  std::unique_ptr<CacheLog> cache_log_;
+  // Entries published since the last flush, appended to `cache_log_`.
+  std::mutex cache_pending_mutex_;
+  std::unordered_map<std::string, EtagCache::EntryPtr> cache_pending_;
+  std::atomic<bool> cache_dirty_{false};
   std::chrono::steady_clock::time_point last_cache_save_{};
   std::atomic<bool> cache_flusher_running_{false};
   std::thread cache_flusher_thread_;
@@ -525,51 +697,142 @@ private:
   std::condition_variable cache_flusher_cv_;
   std::chrono::milliseconds cache_flush_interval_{std::chrono::seconds(5)};
 
+  // Single-flight table: concurrent GETs for the same URL and token wait on
+  // the first caller's request instead of issuing their own.
+  std::mutex inflight_mutex_;
+  std::unordered_map<std::string, std::shared_future<HttpResponse>> inflight_;
+  std::atomic<std::uint64_t> coalesced_hits_{0};
+  std::atomic<std::uint64_t> coalesced_misses_{0};
+  std::atomic<std::uint64_t> cache_bytes_saved_{0};
+
+  BranchCompareCache compare_cache_;
+  std::string compare_cache_file_;
+
+  std::mutex task_runner_mutex_;
+  TaskRunner task_runner_;
+  RateGate rate_gate_;
+
+  std::mutex local_clones_mutex_;
+  std::unordered_map<std::string, std::string> local_clone_dirs_;
+  std::unordered_map<std::string, std::shared_ptr<LocalGitRepository>>
+      local_clones_;
+  std::atomic<std::uint64_t> local_comparisons_{0};
+
+  std::shared_ptr<LocalGitRepository> local_clone(const std::string &owner,
+                                                  const std::string &repo);
+
+  /// Wait for `rate_gate_`, if any; false when requests should stop.
+  bool pass_rate_gate();
+
+  /// Run @p tasks through `task_runner_` and wait for all of them.
+  void run_subtasks(
+      std::vector<std::pair<std::string, std::function<void()>>> tasks);
+
 public:
   // Flush the in-memory cache immediately to disk. Public to allow tests to
   // ensure persistence deterministically.
   void flush_cache();
   void set_cache_flush_interval(std::chrono::milliseconds interval);
 
+  /**
+   * Persist stray-detection comparisons in @p path, loading any entries it
+   * already holds. The file is written by flush_cache(), the cache flusher
+   * and on destruction.
+   */
+  void set_compare_cache_file(std::string path);
+
+  /// Cache of branch comparisons keyed by commit SHAs.
+  const BranchCompareCache &compare_cache() const { return compare_cache_; }
+
+  /**
+   * Write every cached response to @p path as a JSON object keyed by URL.
+   *
+   * @return True when the file was written.
+   */
+  bool export_cache_json(const std::string &path) const;
+
+  /**
+   * Merge cached responses from a JSON file written by export_cache_json().
+   *
+   * @return True when the file was read and parsed.
+   */
+  bool import_cache_json(const std::string &path);
+
+  /// Counters describing request coalescing for cached GETs.
+  struct CoalescingStats {
+    std::uint64_t hits{0};   ///< Callers that joined an in-flight request
+    std::uint64_t misses{0}; ///< Callers that issued the request themselves
+  };
+
+  /// Cap the memory used by cached response bodies (0 = unlimited).
+  void set_cache_max_bytes(std::size_t max_bytes) {
+    cache_.set_max_bytes(max_bytes);
+  }
+
+  /// Per-shard hit, miss, revalidation and eviction counters of the cache.
+  std::vector<EtagCache::ShardStats> cache_shard_stats() const {
+    return cache_.shard_stats();
+  }
+
+  /// Cache counters and occupancy summed over all shards.
+  EtagCache::ShardStats cache_totals() const { return cache_.totals(); }
+
+  /// Response body bytes served from the cache after HTTP 304 replies.
+  std::uint64_t cache_bytes_saved() const { return cache_bytes_saved_.load(); }
+
+  /// Snapshot of the request coalescing counters.
+  CoalescingStats coalescing_stats() const {
+    return {coalesced_hits_.load(), coalesced_misses_.load()};
+  }
+
 private:
-  int required_approvals_{0};
-  bool require_status_success_{false};
-  bool require_mergeable_state_{false};
+  std::atomic<int> required_approvals_{0};
+  std::atomic<bool> require_status_success_{false};
+  std::atomic<bool> require_mergeable_state_{false};
 
-  int delay_ms_;
-  // Rate-limit state protected by its own mutex to avoid holding the main
-  // `mutex_` during sleeps or token rotations.
+  std::atomic<int> delay_ms_;
+  // Rate-limit state protected by its own mutex so request pacing never
+  // blocks unrelated work. Sleeps happen outside the lock.
   struct RateState {
     std::chrono::steady_clock::time_point last_request{};
   } rate_state_;
   mutable std::mutex rate_state_mutex_;
-  // Helper accessor to snapshot current token index under the rate mutex.
-  size_t current_token_index() const {
-    std::scoped_lock lk(rate_state_mutex_);
-    return token_index_;
-  }
-  bool allow_delete_base_branch_{false};
+  // Snapshot of the token currently used for authenticated requests.
+  size_t current_token_index() const { return token_index_.load(); }
+  std::atomic<bool> allow_delete_base_branch_{false};
 
   bool repo_allowed(const std::string &owner, const std::string &repo) const;
+  std::vector<std::string> request_headers(std::size_t *token = nullptr) const;
   void enforce_delay();
-  bool handle_rate_limit(const HttpResponse &resp);
-  HttpResponse get_with_cache_locked(const std::string &url,
-                                     const std::vector<std::string> &headers);
-  void load_cache_locked();
-  void save_cache_locked();
-  std::optional<PullRequestMetadata>
-  pull_request_metadata_locked(const std::string &owner,
-                               const std::string &repo, int pr_number);
+  bool handle_rate_limit(const HttpResponse &resp, std::size_t token);
+  HttpResponse get_with_cache(const std::string &url,
+                              const std::vector<std::string> &headers);
+  HttpResponse fetch_with_cache(const std::string &url,
+                                const std::vector<std::string> &headers);
+  void load_cache();
+  void save_cache();
+  void compact_cache();
+  void publish_cache_entry(const std::string &url, EtagCache::EntryPtr entry);
+  bool append_pending_locked();
   bool merge_pull_request_internal(const std::string &owner,
                                    const std::string &repo, int pr_number,
                                    const PullRequestMetadata *metadata);
 };
 
-/** Minimal GitHub GraphQL API client used for querying pull requests. */
+/**
+ * GitHub GraphQL API client used for querying pull requests.
+ *
+ * Queries travel through the same pluggable HttpClient as REST requests, so
+ * proxy, bandwidth and transfer limits apply to both. Transient failures are
+ * retried with exponential backoff; a token whose GraphQL points are
+ * exhausted is rotated out in favour of the next configured token. The
+ * client is thread-safe.
+ */
 class GitHubGraphQLClient {
 public:
   /**
-   * Construct a client using the provided tokens.
+   * Construct a client using the provided tokens and a default CURL
+   * transport.
    *
    * @param tokens Personal access tokens used for authenticated requests.
    * @param timeout_ms Request timeout in milliseconds for GraphQL operations.
@@ -579,25 +842,98 @@ public:
                                int timeout_ms = 30000,
                                std::string api_base = "https://api.github.com");
 
+  /**
+   * Construct a client issuing queries through @p http.
+   *
+   * @param tokens Personal access tokens used for authenticated requests.
+   * @param http HTTP transport; a CurlHttpClient is used when null.
+   * @param api_base Base URL for the GitHub API endpoints.
+   * @param max_retries Maximum retries for transient failures per query.
+   * @param retry_backoff_ms Base delay in milliseconds for exponential
+   *        backoff between retries.
+   */
+  GitHubGraphQLClient(std::vector<std::string> tokens,
+                      std::unique_ptr<HttpClient> http,
+                      std::string api_base = "https://api.github.com",
+                      int max_retries = 3, int retry_backoff_ms = 100);
+
   /**
    * List pull requests for a repository using GraphQL.
    *
+   * Follows cursor pagination until every matching pull request has been
+   * returned. Each pull request carries its merge metadata (mergeability,
+   * merge state, draft flag, approvals and status-check rollup) so callers
+   * can evaluate merge rules without per-PR REST requests.
+   *
    * @param owner Repository owner.
    * @param repo Repository name.
    * @param include_merged Include merged pull requests when true.
-   * @param per_page Number of pull requests to fetch (max 100).
-   * @return List of pull request summaries retrieved from the GraphQL API.
+   * @param per_page Page size of each GraphQL request (max 100).
+   * @return Pull requests retrieved from the GraphQL API, or `std::nullopt`
+   *         when any page could not be fetched or parsed.
+   */
+  std::optional<std::vector<PullRequest>>
+  list_pull_requests(const std::string &owner, const std::string &repo,
+                     bool include_merged = false, int per_page = 50);
+
+  /**
+   * List pull requests for many repositories with aliased GraphQL queries.
+   *
+   * Up to @p batch_size repositories are packed into one query, each under
+   * its own alias. Repositories with further pages are re-queried with their
+   * own cursor in later rounds, again batched, until every listing is
+   * complete.
+   *
+   * @param repos Repositories as `(owner, name)` pairs.
+   * @param include_merged Include merged pull requests when true.
+   * @param per_page Page size per repository (max 100).
+   * @param batch_size Maximum repositories per query.
+   * @return Pull requests per repository, in the order of @p repos;
+   *         `std::nullopt` for repositories whose listing failed.
    */
-  std::vector<PullRequest> list_pull_requests(const std::string &owner,
-                                              const std::string &repo,
-                                              bool include_merged = false,
-                                              int per_page = 50);
+  std::vector<std::optional<std::vector<PullRequest>>> list_pull_requests_batch(
+      const std::vector<std::pair<std::string, std::string>> &repos,
+      bool include_merged = false, int per_page = 50, int batch_size = 20);
+
+  /// GraphQL rate limit accounting reported by the API.
+  struct RateLimitInfo {
+    int last_cost{0};        ///< Point cost of the most recent query
+    int remaining{-1};       ///< Points left in the window (-1 = unknown)
+    std::string reset_at;    ///< ISO-8601 time the window resets
+    long long total_cost{0}; ///< Points spent by this client
+    long long queries{0};    ///< Queries that returned data
+  };
+
+  /// Snapshot of the GraphQL rate limit accounting.
+  RateLimitInfo rate_limit_info() const;
+
+  /// GraphQL point usage attributed to one token.
+  struct TokenUsage {
+    long long cost{0};    ///< Points spent with this token
+    long long queries{0}; ///< Queries answered for this token
+    int remaining{-1};    ///< Points left in the window (-1 = unknown)
+    std::string reset_at; ///< ISO-8601 time the window resets
+    int rate_limited{0};  ///< Times the token was rotated out as exhausted
+  };
+
+  /// Per-token usage, indexed like the tokens passed to the constructor.
+  std::vector<TokenUsage> token_usage() const;
+
+  /// Index of the token the next query will use.
+  std::size_t active_token() const { return token_index_.load(); }
 
 private:
+  std::optional<nlohmann::json> post_query(const nlohmann::json &payload);
+  void record_rate_limit(std::size_t token, const nlohmann::json &data);
+  void rotate_token(std::size_t exhausted);
+
   std::vector<std::string> tokens_;
-  size_t token_index_{0};
-  int timeout_ms_;
+  std::unique_ptr<HttpClient> http_;
+  std::atomic<std::size_t> token_index_{0};
   std::string api_base_;
+  mutable std::mutex rate_mutex_;
+  RateLimitInfo rate_info_;
+  std::vector<TokenUsage> token_usage_;
 };
 
 } // namespace agpm
@@ -16,11 +16,17 @@
 #include "poller.hpp"
 #include "rule_engine.hpp"
 #include "stray_detection_mode.hpp"
+#include "webhook_server.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -43,6 +49,49 @@ struct RepositoryOptions {
 
 using RepositoryOptionsMap = std::unordered_map<std::string, RepositoryOptions>;
 
+/// Kind of change reported by the change feed.
+enum class ChangeKind { Added, Updated, Removed };
+
+/// Stable change feed identifier of a pull request, `owner/repo#number`.
+inline std::string pull_request_id(const PullRequest &pr) {
+  return pr.owner + "/" + pr.repo + "#" + std::to_string(pr.number);
+}
+
+/// Stable change feed identifier of a branch, `owner/repo:name`.
+inline std::string branch_id(const StrayBranch &branch) {
+  return branch.owner + "/" + branch.repo + ":" + branch.name;
+}
+
+/// Pull request added to, updated in or removed from the open list.
+struct PullRequestChange {
+  ChangeKind kind{ChangeKind::Added};
+  std::string id;             ///< See pull_request_id()
+  PullRequest pull_request{}; ///< Latest state; last known when removed
+  bool initial{false};        ///< Reported by its repository's first poll
+};
+
+/// Stray branch detected or no longer reported. Never `Updated`.
+struct BranchChange {
+  ChangeKind kind{ChangeKind::Added};
+  std::string id; ///< See branch_id()
+  StrayBranch branch{};
+  bool initial{false}; ///< Reported by its repository's first poll
+};
+
+/**
+ * Records that changed between two published snapshots.
+ *
+ * Applying every change set in sequence order to an empty list reproduces
+ * the poller's current pull requests and stray branches.
+ */
+struct ChangeSet {
+  std::uint64_t sequence{0}; ///< Increases by one per published change set
+  std::vector<PullRequestChange> pull_requests;
+  std::vector<BranchChange> branches;
+
+  bool empty() const { return pull_requests.empty() && branches.empty(); }
+};
+
 /**
  * Polls GitHub repositories periodically using a token bucket rate limiter.
  */
@@ -102,6 +151,9 @@ public:
       bool retry_rate_limit_endpoint = false, int rate_limit_retry_limit = 3,
       RepositoryOptionsMap repo_overrides = {});
 
+  /// Detach the client's branch sub-jobs from this poller's worker pool.
+  ~GitHubPoller();
+
   /// Start polling in a background thread.
   void start();
   /// Stop polling.
@@ -110,6 +162,44 @@ public:
   /// Invoke the polling routine immediately on the current thread.
   void poll_now();
 
+  /**
+   * Run @p job on the worker pool ahead of queued polling work and wait for
+   * it to finish.
+   *
+   * The job is queued in the @p priority class and draws on the rate
+   * reservation for urgent work. When every worker is busy, or no worker
+   * picks the job up within a short grace period, it is withdrawn from the
+   * queue and runs on the calling thread after taking a rate token.
+   */
+  void run_prioritized(std::string name, std::function<void()> job,
+                       Poller::JobPriority priority);
+
+  /// Reserve a share of the request rate for prioritized jobs.
+  void set_priority_rate_reserve(double fraction) {
+    poller_.set_priority_reserve(fraction);
+  }
+
+  /**
+   * Queue a targeted refresh of the repository a webhook event refers to.
+   *
+   * Only the listings the event invalidates are refreshed: pull request
+   * events re-list and re-evaluate pull requests, branch events re-run
+   * branch listing, stray detection and cleanup. Cached auto-merge
+   * decisions for the referenced pull requests are dropped since check
+   * results change without touching `updated_at`. Events for repositories
+   * that are not polled are ignored. The background thread picks queued
+   * refreshes up immediately; full polls keep running at the poll interval
+   * as a reconciliation pass.
+   */
+  void handle_webhook(const WebhookEvent &event);
+
+  /**
+   * Run queued targeted refreshes on the calling thread.
+   *
+   * @return Number of repositories refreshed.
+   */
+  std::size_t refresh_pending();
+
   /**
    * Set a callback invoked with the current pull requests after each poll.
    *
@@ -148,6 +238,22 @@ public:
   void
   set_stray_callback(std::function<void(const std::vector<StrayBranch> &)> cb);
 
+  /**
+   * Set a callback invoked with the records that changed since the last
+   * published snapshot.
+   *
+   * Unlike the pull request and stray callbacks, which receive every record
+   * after each poll, the change feed only carries differences, so consumers
+   * can keep their own copy current in time proportional to the churn.
+   * Change sets arrive in sequence order and empty ones are not published.
+   *
+   * @param cb Function receiving each change set.
+   */
+  void set_change_callback(std::function<void(const ChangeSet &)> cb);
+
+  /// Sort mode applied to published pull request lists.
+  const std::string &sort_mode() const { return sort_mode_; }
+
   /// Override the configured action for a branch state.
   void set_branch_rule_action(const std::string &state, BranchAction action);
 
@@ -157,6 +263,80 @@ public:
   /// Configure thresholds for aggregate hook events.
   void set_hook_thresholds(int pull_threshold, int branch_threshold);
 
+  /**
+   * Batch GraphQL pull request listings for up to @p batch_size repositories
+   * per query. Requires a GraphQL client; 0 disables batching.
+   */
+  void set_graphql_batch_size(int batch_size) {
+    graphql_batch_size_ = batch_size < 0 ? 0 : batch_size;
+  }
+
+  /**
+   * Page size of pull request listings, REST and GraphQL alike, clamped to
+   * the API maximum of 100. Defaults to 50.
+   */
+  void set_pull_request_page_size(int per_page) {
+    pr_page_size_ = std::clamp(per_page, 1, 100);
+  }
+
+  /**
+   * Schedule repository jobs and their branch sub-jobs on per-worker deques
+   * with work stealing. Must be called before start().
+   */
+  void set_work_stealing(bool enabled) { poller_.set_work_stealing(enabled); }
+
+  /**
+   * Poll each repository on its own schedule and publish its results as
+   * soon as they arrive instead of once per cycle. Must be called before
+   * start(); poll_now() always runs a full cycle.
+   */
+  void set_streaming(bool enabled) { streaming_ = enabled; }
+
+  /**
+   * Adapt each repository's poll interval to how often it changes, between
+   * @p min and @p max. A poll that finds new pull request activity, stray
+   * branches or branch heads halves the interval; an unchanged one doubles
+   * it. Implies streaming mode. Must be called before start().
+   */
+  void set_adaptive_intervals(bool enabled, std::chrono::milliseconds min,
+                              std::chrono::milliseconds max) {
+    adaptive_intervals_ = enabled;
+    adaptive_min_ = std::max(min, std::chrono::milliseconds(1));
+    adaptive_max_ = std::max(adaptive_min_, max);
+  }
+
+  /**
+   * List REST pull requests incrementally.
+   *
+   * Each repository keeps a snapshot of its open pull requests and the
+   * `updated_at` high-water mark it reflects; every poll only fetches pull
+   * requests updated since the mark and merges them into the snapshot.
+   * GraphQL and single-request listings are unaffected.
+   */
+  void set_incremental_listing(bool enabled) { incremental_listing_ = enabled; }
+
+  /**
+   * Persist incremental listing snapshots and watermarks in @p path so a
+   * restart stays incremental. Existing state in the file is loaded
+   * immediately; an empty path disables persistence.
+   */
+  void set_pr_state_file(std::string path);
+
+  /**
+   * Reuse auto-merge decisions for unchanged pull requests.
+   *
+   * A pull request classified as waiting is not re-fetched while its head
+   * SHA and `updated_at` stay the same, until @p ttl elapses. The TTL bounds
+   * how late changes that do not touch `updated_at`, such as completing
+   * status checks, are noticed. Zero, the default, disables the cache.
+   */
+  void set_decision_cache_ttl(std::chrono::seconds ttl) {
+    decision_cache_ttl_ = ttl;
+  }
+
+  /// Metadata requests avoided through the decision cache.
+  std::size_t decision_cache_hits() const { return decision_cache_hits_.load(); }
+
   /// Retrieve the current scheduler queue snapshot for UI consumption.
   Poller::RequestQueueSnapshot request_queue_snapshot() const {
     return poller_.request_snapshot();
@@ -180,8 +360,90 @@ public:
   std::optional<RateBudgetSnapshot> rate_budget_snapshot() const;
 
 private:
+  /// Parts of a repository refreshed by a poll.
+  struct RefreshScope {
+    bool pull_requests{true};
+    bool branches{true};
+  };
+  using RefreshScopes = std::unordered_map<std::string, RefreshScope>;
+
   void poll();
 
+  /**
+   * Poll @p targets, limited to the per-repository parts in @p scopes.
+   * A null @p scopes polls everything and runs the aggregate hooks and
+   * export callback; targeted polls merge their results into the latest
+   * full snapshot before notifying the callbacks.
+   */
+  void poll_repositories(
+      const std::vector<std::pair<std::string, std::string>> &targets,
+      const RefreshScopes *scopes);
+
+  struct PollCycle;
+  struct MergeBatch;
+
+  static RefreshScope scope_of(const RefreshScopes *scopes,
+                               const std::string &repo_name);
+
+  /// Queue the first stages of @p targets on @p cycle without waiting.
+  void queue_repositories(
+      PollCycle &cycle,
+      const std::vector<std::pair<std::string, std::string>> &targets,
+      const RefreshScopes *scopes);
+
+  /// Replace the stored per-repository results with @p cycle's.
+  void store_results(
+      const PollCycle &cycle,
+      const std::vector<std::pair<std::string, std::string>> &targets,
+      const RefreshScopes *scopes);
+
+  /// Publish the stored results of every repository to the callbacks.
+  std::size_t publish_snapshot();
+
+  /// Publish the changes recorded by store_results() to the change feed.
+  void publish_changes();
+
+  /// Log totals, fire threshold hooks and run the export callback.
+  void publish_totals(std::size_t published_prs, std::size_t total_prs,
+                      std::optional<std::size_t> total_branches);
+
+  void stream_loop();
+  void launch_due_repositories();
+  void publish_stream_result(const std::string &repo_name);
+
+  /// Repository handled by the stage jobs of a poll cycle.
+  struct RepoTask {
+    std::string owner;
+    std::string repo;
+    std::string name; ///< `owner/repo`
+    RepositoryOptions options;
+    bool hooks_enabled{false};
+    bool webhook{false};
+
+    /// Request queue label of the repository's @p stage job.
+    std::string label(const std::string &stage) const {
+      return name + " " + stage + (webhook ? " (webhook)" : "");
+    }
+  };
+
+  /// Queue @p stage on the worker pool and count it towards @p cycle.
+  void spawn_stage(PollCycle &cycle, std::string name,
+                   Poller::JobOptions options, std::function<void()> stage);
+
+  void sync_pull_requests(PollCycle &cycle, const RepoTask &task);
+  void merge_pull_requests(PollCycle &cycle, const RepoTask &task,
+                           const MergeBatch &batch);
+  void sync_branches(PollCycle &cycle, const RepoTask &task);
+  void detect_stray(PollCycle &cycle, const RepoTask &task,
+                    const std::vector<std::string> &branches,
+                    const std::string &default_branch,
+                    std::unordered_map<std::string, std::string> &branch_shas,
+                    std::unordered_set<std::string> new_branches);
+  void clean_branches(PollCycle &cycle, const RepoTask &task,
+                      const std::vector<std::string> &stray,
+                      const std::unordered_set<std::string> &new_branches);
+  void purge_branches(PollCycle &cycle, const RepoTask &task);
+
   /**
    * Refresh rate limit information and tune scheduler parameters.
    *
@@ -200,6 +462,36 @@ private:
   void handle_backlog(std::size_t outstanding,
                       std::chrono::seconds clearance_estimate);
 
+  /**
+   * Merge the changes since a repository's watermark into its snapshot and
+   * return the resulting open pull requests.
+   */
+  std::vector<PullRequest> list_pull_requests_incremental(
+      const std::string &owner, const std::string &repo);
+
+  /// Write incremental listing state to the state file when it changed.
+  void save_pr_state();
+
+  /// Last auto-merge evaluation of a pull request that was left waiting.
+  struct CachedDecision {
+    std::string head_sha;
+    std::string updated_at;
+    PullRequestMetadata metadata;
+    PullRequestAction action{PullRequestAction::kNone};
+    std::chrono::steady_clock::time_point evaluated;
+  };
+
+  /// Cached decision for @p pr when its revision is unchanged and fresh.
+  std::optional<CachedDecision> cached_decision(const PullRequest &pr);
+
+  /// Remember a decision for @p pr, or forget it when it is not cacheable.
+  void remember_decision(const PullRequest &pr,
+                         const PullRequestMetadata &metadata,
+                         PullRequestAction action);
+
+  /// Drop expired decisions, e.g. for pull requests that disappeared.
+  void prune_decisions();
+
   GitHubClient &client_;
   std::vector<std::pair<std::string, std::string>> repos_;
   Poller poller_;
@@ -222,6 +514,8 @@ private:
   std::string sort_mode_;
   bool dry_run_;
   GitHubGraphQLClient *graphql_client_;
+  int graphql_batch_size_{0};
+  int pr_page_size_{50};
   PullRequestRuleEngine rule_engine_;
   BranchRuleEngine branch_rule_engine_;
   std::unordered_set<std::string> explicit_branch_rule_states_;
@@ -236,6 +530,7 @@ private:
   std::function<void(const std::vector<PullRequest> &)> pr_cb_;
   std::function<void(const std::string &)> log_cb_;
   std::function<void(const std::vector<StrayBranch> &)> stray_cb_;
+  std::function<void(const ChangeSet &)> change_cb_;
   NotifierPtr notifier_;
   std::shared_ptr<HookDispatcher> hook_;
   int hook_pull_threshold_{0};
@@ -266,6 +561,59 @@ private:
   std::mutex known_branches_mutex_;
   RepositoryOptionsMap repo_overrides_;
 
+  /// Open pull requests of one repository as of its watermark.
+  struct PullRequestSnapshot {
+    std::string watermark;
+    std::map<int, PullRequest> open;
+  };
+  bool incremental_listing_{false};
+  std::string pr_state_file_;
+  std::unordered_map<std::string, PullRequestSnapshot> pr_snapshots_;
+  std::mutex pr_snapshots_mutex_;
+  bool pr_snapshots_dirty_{false};
+
+  RefreshScopes pending_refresh_;
+  std::mutex refresh_mutex_;
+  std::condition_variable refresh_cv_;
+
+  /// Schedule of one repository in streaming mode.
+  struct StreamState {
+    std::pair<std::string, std::string> repo;
+    std::chrono::steady_clock::time_point next_due{};
+    std::shared_ptr<PollCycle> cycle; ///< Set while a poll is in flight
+    std::optional<std::size_t> branch_count;
+    std::chrono::milliseconds interval{0}; ///< Adaptive interval
+    std::optional<std::size_t> fingerprint; ///< Of the last poll's results
+  };
+
+  std::chrono::milliseconds next_stream_interval(const StreamState &state) const;
+
+  bool streaming_{false};
+  bool adaptive_intervals_{false};
+  std::chrono::milliseconds adaptive_min_{std::chrono::seconds(15)};
+  std::chrono::milliseconds adaptive_max_{std::chrono::seconds(1800)};
+  /// Owned by the poller thread.
+  std::unordered_map<std::string, StreamState> stream_state_;
+  std::chrono::steady_clock::time_point next_stream_totals_{};
+  /// Repositories whose cycle finished, guarded by `refresh_mutex_`.
+  std::vector<std::string> stream_finished_;
+
+  /// Latest pull requests and stray branches per `owner/repo`.
+  std::unordered_map<std::string, std::vector<PullRequest>> repo_prs_;
+  std::unordered_map<std::string, std::vector<StrayBranch>> repo_stray_;
+  std::mutex results_mutex_;
+  /// Changes not yet published, guarded by `results_mutex_`.
+  ChangeSet pending_changes_;
+  /// Serializes change set publication so sequences arrive in order.
+  std::mutex feed_mutex_;
+  std::uint64_t change_sequence_{0};
+  std::atomic<bool> changed_since_export_{true};
+
+  std::chrono::seconds decision_cache_ttl_{0};
+  std::unordered_map<std::string, CachedDecision> decision_cache_;
+  std::mutex decision_cache_mutex_;
+  std::atomic<std::size_t> decision_cache_hits_{0};
+
   RepositoryOptions effective_repository_options(const std::string &owner,
                                                  const std::string &repo) const;
 };
@@ -0,0 +1,84 @@
+/**
+ * @file local_git_repository.hpp
+ * @brief Read-only access to commits in a local git object database.
+ *
+ * Declares LocalGitRepository, which reads commit objects straight from the
+ * loose object store and version 2 packfiles of a clone or mirror so branch
+ * comparisons can be computed without calling the GitHub compare API.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_LOCAL_GIT_REPOSITORY_HPP
+#define AUTOGITHUBPULLMERGE_LOCAL_GIT_REPOSITORY_HPP
+
+#include "branch_compare_cache.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace agpm {
+
+/**
+ * Commit graph reader over a local git directory.
+ *
+ * Only commit objects are decoded. Objects are looked up by the SHAs GitHub
+ * reports, so a comparison is only answered when the clone already contains
+ * both commits and therefore their complete history; otherwise callers fall
+ * back to the API. Shallow clones are never used because their history is
+ * truncated. All methods are thread-safe.
+ */
+class LocalGitRepository {
+public:
+  /// Open the repository whose git directory (`.git` or bare) is @p git_dir.
+  explicit LocalGitRepository(std::filesystem::path git_dir);
+  ~LocalGitRepository();
+
+  LocalGitRepository(const LocalGitRepository &) = delete;
+  LocalGitRepository &operator=(const LocalGitRepository &) = delete;
+
+  /// Whether the directory holds a complete (non-shallow) object database.
+  bool usable() const { return usable_; }
+
+  /// Whether the commit @p sha is present locally.
+  bool has_commit(const std::string &sha);
+
+  /**
+   * Compare @p head_sha against @p base_sha the way GitHub's compare
+   * endpoint does.
+   *
+   * @return Ahead/behind counts, status and head commit time, or
+   *         `std::nullopt` when either commit or part of their history is
+   *         missing from the clone.
+   */
+  std::optional<BranchCompareCache::Comparison>
+  compare(const std::string &base_sha, const std::string &head_sha);
+
+private:
+  struct Commit {
+    std::vector<std::string> parents;
+    std::int64_t committed_at{0};
+  };
+  struct Pack;
+
+  const Commit *commit_unlocked(const std::string &sha);
+  // Object readers return the object type code followed by the content.
+  std::optional<std::string> read_object(const std::string &sha, int depth);
+  std::optional<std::string> read_loose(const std::string &sha);
+  std::optional<std::string> read_packed(Pack &pack, std::uint64_t offset,
+                                         int depth);
+  void load_packs();
+
+  std::filesystem::path git_dir_;
+  bool usable_{false};
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Pack>> packs_;
+  std::unordered_map<std::string, Commit> commits_;
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_LOCAL_GIT_REPOSITORY_HPP
@@ -86,8 +86,20 @@ public:
   bool delete_branch(const std::string &owner, const std::string &repo,
                      const std::string &branch) override;
 
+  /// Executes a named mutation, e.g. on a prioritized scheduler queue.
+  using MutationRunner =
+      std::function<void(std::string, std::function<void()>)>;
+
+  /// Route merges, closes and branch deletions through @p runner.
+  void set_mutation_runner(MutationRunner runner) {
+    mutation_runner_ = std::move(runner);
+  }
+
 private:
+  bool run_mutation(std::string name, const std::function<bool()> &action);
+
   GitHubClient &client_;
+  MutationRunner mutation_runner_;
   std::vector<std::pair<std::string, std::string>> repositories_;
   std::vector<std::string> protected_branches_;
   std::vector<std::string> protected_branch_excludes_;
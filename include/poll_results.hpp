@@ -0,0 +1,112 @@
+/**
+ * @file poll_results.hpp
+ * @brief Per-repository result buffers of a poll cycle.
+ *
+ * Declares PollResults, which collects the pull requests and stray branches
+ * the stage jobs of one poll cycle find and later drop again after merging,
+ * closing or deleting them.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_POLL_RESULTS_HPP
+#define AUTOGITHUBPULLMERGE_POLL_RESULTS_HPP
+
+#include "github_client.hpp"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace agpm {
+
+/**
+ * Pull requests and stray branches of a poll cycle, buffered per repository.
+ *
+ * Each repository has its own buffer and lock, so jobs of different
+ * repositories never contend. Entries are indexed by pull request number or
+ * branch name, which makes updates and removals constant time; removed
+ * entries are skipped when the buffers are merged.
+ *
+ * Repositories must be registered with add_repository() before any job
+ * touches them; the other members are thread-safe.
+ */
+class PollResults {
+public:
+  /// Register the buffer of `owner/repo`. Not safe while jobs are running.
+  void add_repository(const std::string &owner, const std::string &repo);
+
+  /**
+   * Add @p prs to the buffer of @p repo_name, replacing entries with the
+   * same number.
+   *
+   * @throws std::out_of_range if @p repo_name was not registered.
+   */
+  void add_pull_requests(const std::string &repo_name,
+                         const std::vector<PullRequest> &prs);
+
+  /**
+   * Drop pull request @p number of @p repo_name.
+   *
+   * @return False when it was not present.
+   */
+  bool remove_pull_request(const std::string &repo_name, int number);
+
+  /**
+   * Add the stray branches @p names of @p repo_name.
+   *
+   * @throws std::out_of_range if @p repo_name was not registered.
+   */
+  void add_stray_branches(const std::string &repo_name,
+                          const std::vector<std::string> &names);
+
+  /**
+   * Drop stray branch @p name of @p repo_name.
+   *
+   * @return False when it was not present.
+   */
+  bool remove_stray_branch(const std::string &repo_name,
+                           const std::string &name);
+
+  /// Number of pull requests currently buffered.
+  std::size_t pull_request_count() const;
+
+  /// Pull requests of every repository, in registration order.
+  std::vector<PullRequest> pull_requests() const;
+
+  /// Pull requests of @p repo_name in the order they were added.
+  std::vector<PullRequest> pull_requests(const std::string &repo_name) const;
+
+  /// Stray branches of every repository, in registration order.
+  std::vector<StrayBranch> stray_branches() const;
+
+  /// Stray branches of @p repo_name in the order they were added.
+  std::vector<StrayBranch> stray_branches(const std::string &repo_name) const;
+
+private:
+  /// Buffer of one repository. Removed entries stay in place, unindexed.
+  struct Repository {
+    std::string owner;
+    std::string repo;
+    mutable std::mutex mutex;
+    std::vector<PullRequest> prs;
+    std::vector<char> pr_live;
+    std::unordered_map<int, std::size_t> pr_index;
+    std::vector<StrayBranch> stray;
+    std::vector<char> stray_live;
+    std::unordered_map<std::string, std::size_t> stray_index;
+  };
+
+  Repository &repository(const std::string &repo_name) const;
+  static void append_pull_requests(const Repository &entry,
+                                   std::vector<PullRequest> &out);
+  static void append_stray_branches(const Repository &entry,
+                                    std::vector<StrayBranch> &out);
+
+  std::vector<std::unique_ptr<Repository>> repositories_;
+  std::unordered_map<std::string, Repository *> by_name_;
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_POLL_RESULTS_HPP
@@ -5,21 +5,23 @@
  *
  * Defines the Poller class, which manages a pool of worker threads to execute
  * polling jobs, enforces a maximum request rate using a token bucket, and
- * provides backlog alerting and statistics for outstanding jobs.
+ * provides backlog alerting and statistics for outstanding jobs. Jobs are
+ * served from one shared queue, or from per-worker deques with work stealing.
  */
 #ifndef AUTOGITHUBPULLMERGE_POLLER_HPP
 #define AUTOGITHUBPULLMERGE_POLLER_HPP
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
 #include <string>
 #include <thread>
 #include <vector>
@@ -35,10 +37,42 @@ public:
   /// Enumeration describing the lifecycle state of a scheduled request.
   enum class RequestState { Pending, Running, Completed, Failed, Cancelled };
 
+  /**
+   * Scheduling class of a job, from most to least urgent. Queued jobs run in
+   * class order; within a class they run in submission order.
+   */
+  enum class JobPriority {
+    Interactive, ///< Actions a user is waiting on, e.g. a TUI merge
+    Mutation,    ///< Merges, closes and deletions requested by integrations
+    Listing,     ///< Regular repository polling
+    Heuristic    ///< Stray detection and other background analysis
+  };
+
+  /// Number of JobPriority classes.
+  static constexpr std::size_t kPriorityCount = 4;
+
+  /// Lowercase name of @p priority for display.
+  static const char *priority_name(JobPriority priority);
+
+  /** Scheduling options accepted by submit(). */
+  struct JobOptions {
+    JobPriority priority{JobPriority::Listing};
+    /// Start the job ahead of every class once this time is reached.
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    /**
+     * Take a token from the rate limiter before running. Follow-up jobs that
+     * mostly work on data an earlier, rate-limited job fetched may skip it.
+     */
+    bool rate_limited{true};
+  };
+
   /** Metadata describing a scheduled request. */
   struct RequestInfo {
     std::size_t id{0};
     std::string name;
+    JobPriority priority{JobPriority::Listing};
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    bool rate_limited{true};
     RequestState state{RequestState::Pending};
     std::chrono::steady_clock::time_point enqueued_at{};
     std::optional<std::chrono::steady_clock::time_point> started_at;
@@ -55,6 +89,8 @@ public:
     std::vector<RequestInfo> pending;
     std::vector<RequestInfo> running;
     std::vector<RequestInfo> completed;
+    /// Pending jobs per JobPriority class.
+    std::array<std::size_t, kPriorityCount> pending_by_priority{};
     std::size_t total_completed{0};
     std::size_t total_failed{0};
     std::optional<double> average_latency_ms;
@@ -80,19 +116,108 @@ public:
   /// Stop the worker threads.
   void stop();
 
+  /// Whether the worker threads are running.
+  bool running() const { return running_; }
+
+  /**
+   * Serve jobs from per-worker deques with work stealing.
+   *
+   * Jobs submitted from a worker thread go to the front of that worker's
+   * deque and are taken back from the front, so nested and fan-out work runs
+   * depth-first on the thread that produced it. Idle workers first drain the
+   * shared queue of externally submitted jobs, then steal from the tail of
+   * other workers' deques. Takes effect on the next start().
+   */
+  void set_work_stealing(bool enabled) {
+    work_stealing_.store(enabled, std::memory_order_relaxed);
+  }
+
+  /// Whether work stealing is enabled.
+  bool work_stealing() const {
+    return work_stealing_.load(std::memory_order_relaxed);
+  }
+
+  /// Number of jobs taken from another worker's deque.
+  std::size_t steals() const { return steals_.load(); }
+
+  /**
+   * Number of times workers waiting for a rate token checked for it: once
+   * when they start waiting and once per wakeup.
+   */
+  std::size_t token_wakeups() const { return token_wakeups_.load(); }
+
   /**
    * Submit a task for execution.
    *
    * @param job Callable to execute on one of the worker threads.
+   * @param options Priority class and optional deadline of the job.
    * @return Future that becomes ready once the task completes.
    */
-  std::future<void> submit(std::string name, std::function<void()> job);
+  std::future<void> submit(std::string name, std::function<void()> job,
+                           JobOptions options);
+
+  /** Future and request id of a job queued by submit_tracked(). */
+  struct Submission {
+    std::size_t id{0};
+    std::future<void> future;
+  };
+
+  /**
+   * Submit a task and report its request id so it can be withdrawn with
+   * try_cancel() while still queued.
+   */
+  Submission submit_tracked(std::string name, std::function<void()> job,
+                            JobOptions options);
+
+  /**
+   * Remove a queued job before any worker has taken it.
+   *
+   * The job never runs and never takes a rate token; its future reports a
+   * broken promise.
+   *
+   * @return `true` when the job was still queued and is now cancelled.
+   */
+  bool try_cancel(std::size_t id);
+
+  /**
+   * Block until the rate limiter grants a token to a job of @p priority.
+   * Lets callers that run a job on their own thread stay within the rate.
+   *
+   * @return `true` if execution may proceed, `false` when the pool is
+   *         stopping.
+   */
+  bool acquire_token(JobPriority priority);
+
+  /// Whether the started pool has a queued or running job for every worker.
+  bool all_workers_busy() const;
+
+  /// Submit a task in the JobPriority::Listing class.
+  std::future<void> submit(std::string name, std::function<void()> job) {
+    return submit(std::move(name), std::move(job), JobOptions{});
+  }
 
   /// Convenience overload that uses an auto-generated friendly name.
   std::future<void> submit(std::function<void()> job) {
     return submit({}, std::move(job));
   }
 
+  /**
+   * Promote queued jobs one class for every @p threshold they have waited,
+   * so lower classes are not starved by a steady stream of urgent work.
+   * Zero disables aging.
+   */
+  void set_starvation_threshold(std::chrono::milliseconds threshold) {
+    starvation_threshold_ms_.store(threshold.count(),
+                                   std::memory_order_relaxed);
+  }
+
+  /**
+   * Reserve @p fraction of the request rate for Interactive and Mutation
+   * jobs. Listing and Heuristic jobs are paced at the remaining rate; urgent
+   * jobs take a token from either share. Clamped to [0, 0.9].
+   */
+  void set_priority_reserve(double fraction);
+
   /**
    * Adjust the maximum request rate enforced by the token bucket.
    *
@@ -150,8 +275,11 @@ public:
                     std::function<void(std::size_t, std::chrono::seconds)> cb);
 
 private:
-  void worker();
-  bool acquire_token();
+  void worker(std::size_t index);
+  struct ScheduledJob;
+  bool next_job(std::size_t index, ScheduledJob &job);
+  bool pop_shared_job(ScheduledJob &job, bool urgent_only);
+  void update_rate_intervals();
   void record_execution();
   void check_backlog();
   std::optional<std::chrono::seconds>
@@ -174,7 +302,21 @@ private:
     std::shared_ptr<RequestInfo> info;
     std::shared_ptr<std::packaged_task<void()>> task;
   };
-  std::queue<ScheduledJob> jobs_;
+  /// Shared queue, one FIFO per JobPriority class.
+  std::array<std::deque<ScheduledJob>, kPriorityCount> jobs_;
+  std::size_t shared_jobs_{0};
+  /// Aging threshold in milliseconds; the setter may run while workers
+  /// pick jobs.
+  std::atomic<std::chrono::milliseconds::rep> starvation_threshold_ms_{10000};
+  /// Per-worker deque used in work-stealing mode.
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<ScheduledJob> jobs;
+  };
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  /// Written by the setter while workers run; read by start().
+  std::atomic<bool> work_stealing_{false};
+  std::atomic<std::size_t> steals_{0};
   std::deque<std::shared_ptr<RequestInfo>> pending_infos_;
   std::vector<std::shared_ptr<RequestInfo>> active_infos_;
   std::deque<std::shared_ptr<RequestInfo>> completed_infos_;
@@ -183,9 +325,15 @@ private:
 
   // Token bucket
   std::mutex rate_mutex_;
+  std::condition_variable rate_cv_;
+  std::uint64_t rate_generation_{0};
+  std::atomic<std::size_t> token_wakeups_{0};
   std::chrono::steady_clock::duration min_interval_{};
   std::chrono::steady_clock::time_point next_allowed_{};
   std::chrono::steady_clock::duration queue_margin_{};
+  double priority_reserve_{0.0};
+  std::chrono::steady_clock::duration reserve_interval_{};
+  std::chrono::steady_clock::time_point reserve_next_allowed_{};
   double queue_balance_slack_{0.1};
 
   // Scheduler statistics
@@ -10,6 +10,7 @@
 #define AUTOGITHUBPULLMERGE_REPO_DISCOVERY_HPP
 
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -67,6 +68,14 @@ bool repo_discovery_uses_filesystem(RepoDiscoveryMode mode);
 std::vector<std::pair<std::string, std::string>>
 discover_repositories_from_filesystem(const std::vector<std::string> &roots);
 
+/**
+ * @brief Locate the git directories of repositories under the provided roots.
+ * @param roots List of root directories to scan.
+ * @return Git directory of each discovered repository keyed by `owner/repo`.
+ */
+std::unordered_map<std::string, std::string>
+discover_local_clones(const std::vector<std::string> &roots);
+
 } // namespace agpm
 
 #endif // AUTOGITHUBPULLMERGE_REPO_DISCOVERY_HPP
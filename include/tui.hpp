@@ -36,6 +36,7 @@ using WINDOW = _win_st;
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -82,6 +83,14 @@ public:
    */
   void update_branches(const std::vector<StrayBranch> &branches);
 
+  /**
+   * Apply a change set from the poller's change feed to the displayed pull
+   * requests and branches, touching only the records it names.
+   *
+   * @param changes Change set to apply.
+   */
+  void apply_changes(const ChangeSet &changes);
+
   /// Draw the interface once.
   void draw();
 
@@ -98,6 +107,12 @@ public:
   /// Number of pull requests currently tracked by the UI (primarily for tests).
   std::size_t pr_count() const { return prs_.size(); }
 
+  /// Pull requests in display order (primarily for tests).
+  const std::vector<PullRequest> &pull_requests() const { return prs_; }
+
+  /// Branches in display order (primarily for tests).
+  const std::vector<StrayBranch> &branches() const { return branches_; }
+
   /**
    * Check whether the TUI has been successfully initialized.
    *
@@ -159,6 +174,8 @@ private:
   void log(const std::string &msg);
   void start_request_monitor();
   void stop_request_monitor();
+  void reindex_prs();
+  void reindex_branches();
   struct HotkeyBinding {
     int key;
     std::string label;
@@ -172,6 +189,10 @@ private:
   GitHubPoller &poller_;
   std::vector<PullRequest> prs_;
   std::vector<StrayBranch> branches_;
+  /// Position of each entry of `prs_` by change feed identifier.
+  std::unordered_map<std::string, std::size_t> pr_index_;
+  /// Change feed identifiers of `branches_`.
+  std::unordered_set<std::string> branch_ids_;
   std::vector<std::string> logs_;
   std::size_t log_limit_;
   std::vector<std::string> mcp_events_;
@@ -0,0 +1,167 @@
+/**
+ * @file webhook_server.hpp
+ * @brief Embedded receiver for GitHub webhook deliveries.
+ *
+ * Declares WebhookHandler, which verifies and decodes webhook deliveries into
+ * targeted refresh requests, and WebhookServerRunner, a small HTTP listener
+ * feeding deliveries to the handler from a background thread.
+ */
+
+#ifndef AUTOGITHUBPULLMERGE_WEBHOOK_SERVER_HPP
+#define AUTOGITHUBPULLMERGE_WEBHOOK_SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+namespace agpm {
+
+/// Repository change announced by a webhook delivery.
+struct WebhookEvent {
+  std::string type;     ///< `X-GitHub-Event` value, e.g. `pull_request`
+  std::string action;   ///< Payload `action`, when present
+  std::string delivery; ///< `X-GitHub-Delivery` identifier
+  std::string owner;    ///< Repository owner
+  std::string repo;     ///< Repository name
+  std::vector<int> pull_requests; ///< Pull requests the event refers to
+  std::string branch;             ///< Branch the event refers to, if any
+  bool refresh_pull_requests{false}; ///< Pull request listing is stale
+  bool refresh_branches{false};      ///< Branch listing is stale
+};
+
+/**
+ * Compute the `X-Hub-Signature-256` value GitHub sends for @p body.
+ *
+ * @return `sha256=` followed by the lowercase hex HMAC-SHA256 of @p body
+ *         keyed with @p secret.
+ */
+std::string webhook_signature(const std::string &secret,
+                              const std::string &body);
+
+/**
+ * Verify a delivery's `X-Hub-Signature-256` header in constant time.
+ *
+ * @return True when @p signature matches @p body under @p secret.
+ */
+bool verify_webhook_signature(const std::string &secret,
+                              const std::string &body,
+                              const std::string &signature);
+
+/**
+ * Verifies, decodes and de-duplicates webhook deliveries.
+ *
+ * Handled events are `pull_request`, `check_suite`, `push`, `create` and
+ * `delete`; `ping` is acknowledged and anything else is ignored. Each
+ * accepted delivery is passed to the event callback once, even if GitHub
+ * redelivers it.
+ */
+class WebhookHandler {
+public:
+  using EventCallback = std::function<void(const WebhookEvent &)>;
+
+  /// @param secret Shared webhook secret; deliveries are rejected without it.
+  explicit WebhookHandler(std::string secret);
+
+  /// Register the callback receiving accepted events.
+  void set_event_callback(EventCallback cb);
+
+  /**
+   * Process one delivery.
+   *
+   * @param event `X-GitHub-Event` header.
+   * @param delivery `X-GitHub-Delivery` header.
+   * @param signature `X-Hub-Signature-256` header.
+   * @param body Raw request body.
+   * @return HTTP status to answer with: 202 when an event was queued, 200 for
+   *         pings, duplicates and ignored events, 400 for malformed payloads
+   *         and 401 for bad signatures.
+   */
+  int handle(const std::string &event, const std::string &delivery,
+             const std::string &signature, const std::string &body);
+
+  /// Deliveries that produced an event.
+  std::uint64_t accepted() const { return accepted_.load(); }
+
+  /// Deliveries rejected for a missing or invalid signature.
+  std::uint64_t rejected() const { return rejected_.load(); }
+
+private:
+  bool remember_delivery(const std::string &delivery);
+
+  std::string secret_;
+  std::mutex mutex_;
+  EventCallback callback_;
+  std::deque<std::string> recent_order_;
+  std::unordered_set<std::string> recent_;
+  std::atomic<std::uint64_t> accepted_{0};
+  std::atomic<std::uint64_t> rejected_{0};
+};
+
+/// Listener settings for WebhookServerRunner.
+struct WebhookServerOptions {
+  std::string bind_address{"127.0.0.1"};
+  int port{7333}; ///< TCP port; 0 picks a free port
+  int backlog{16};
+  std::string path{"/webhook"};
+  std::size_t max_body_bytes{25 * 1024 * 1024}; ///< GitHub's payload cap
+  /// Time a connection gets to deliver its whole request.
+  std::chrono::milliseconds request_timeout{10000};
+};
+
+/**
+ * Minimal HTTP/1.1 listener accepting `POST` deliveries on one path and
+ * answering each connection with a single empty response.
+ */
+class WebhookServerRunner {
+public:
+  WebhookServerRunner(WebhookHandler &handler, WebhookServerOptions options);
+  ~WebhookServerRunner();
+
+  /// Bind the listener and serve deliveries on a background thread.
+  /// @return False when the socket could not be bound.
+  bool start();
+
+  /// Stop the listener and join the background thread.
+  void stop();
+
+  /// Whether the listener is serving.
+  bool running() const { return running_; }
+
+  /// Port actually bound, useful when the options requested port 0.
+  int port() const { return bound_port_; }
+
+private:
+  void run();
+  void close_listener();
+
+  WebhookHandler &handler_;
+  WebhookServerOptions options_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> stop_requested_{false};
+  int bound_port_{0};
+#ifdef _WIN32
+  using SocketHandle = SOCKET;
+  SocketHandle listener_{INVALID_SOCKET};
+  bool wsa_started_{false};
+#else
+  using SocketHandle = int;
+  SocketHandle listener_{-1};
+#endif
+};
+
+} // namespace agpm
+
+#endif // AUTOGITHUBPULLMERGE_WEBHOOK_SERVER_HPP
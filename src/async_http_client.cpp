@@ -0,0 +1,375 @@
+/**
+ * @file async_http_client.cpp
+ * @brief Implementation of the curl-multi backed asynchronous HTTP client.
+ */
+
+#include "async_http_client.hpp"
+#include "curl_share.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <stdexcept>
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> http_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("http");
+  }();
+  return logger;
+}
+
+size_t write_body(void *contents, size_t size, size_t nmemb, void *userp) {
+  size_t total = size * nmemb;
+  static_cast<std::string *>(userp)->append(static_cast<char *>(contents),
+                                            total);
+  return total;
+}
+
+size_t write_header(char *buffer, size_t size, size_t nitems, void *userdata) {
+  size_t total = size * nitems;
+  std::string line(buffer, total);
+  while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+    line.pop_back();
+  static_cast<std::vector<std::string> *>(userdata)->push_back(line);
+  return total;
+}
+
+} // namespace
+
+/**
+ * State for a single queued or running transfer. Owned by the client until
+ * its promise has been fulfilled.
+ */
+struct CurlMultiHttpClient::Transfer {
+  CurlHandle handle;
+  std::string verb;
+  std::string url;
+  std::string payload;
+  std::string body;
+  std::vector<std::string> response_headers;
+  curl_slist *request_headers{nullptr};
+  char errbuf[CURL_ERROR_SIZE]{};
+  std::promise<HttpResponse> promise;
+
+  ~Transfer() { curl_slist_free_all(request_headers); }
+};
+
+CurlMultiHttpClient::CurlMultiHttpClient(
+    long timeout_ms, curl_off_t download_limit, curl_off_t upload_limit,
+    curl_off_t max_download, curl_off_t max_upload, std::string http_proxy,
+    std::string https_proxy, std::size_t max_in_flight, bool http2,
+    long max_concurrent_streams)
+    : timeout_ms_(timeout_ms), download_limit_(download_limit),
+      upload_limit_(upload_limit), max_download_(max_download),
+      max_upload_(max_upload), http_proxy_(std::move(http_proxy)),
+      https_proxy_(std::move(https_proxy)), max_in_flight_(max_in_flight),
+      http2_(http2), max_concurrent_streams_(max_concurrent_streams) {
+  CurlHandle::global_init();
+  multi_ = curl_multi_init();
+  if (multi_ == nullptr) {
+    throw TransientNetworkError("Failed to init curl multi handle");
+  }
+  if (http2_) {
+    const curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+    if (info == nullptr || (info->features & CURL_VERSION_HTTP2) == 0) {
+      http_log()->warn(
+          "libcurl was built without HTTP/2 support; using HTTP/1.1");
+      http2_ = false;
+    }
+  }
+  if (http2_) {
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    if (max_concurrent_streams_ > 0) {
+      curl_multi_setopt(multi_, CURLMOPT_MAX_CONCURRENT_STREAMS,
+                        max_concurrent_streams_);
+    }
+  }
+  running_.store(true);
+  loop_ = std::thread([this] { run(); });
+}
+
+CurlMultiHttpClient::~CurlMultiHttpClient() {
+  running_.store(false);
+  curl_multi_wakeup(multi_);
+  if (loop_.joinable()) {
+    loop_.join();
+  }
+  curl_multi_cleanup(multi_);
+}
+
+std::future<HttpResponse>
+CurlMultiHttpClient::get_async(const std::string &url,
+                               const std::vector<std::string> &headers) {
+  return submit("GET", url, nullptr, headers);
+}
+
+std::future<HttpResponse>
+CurlMultiHttpClient::put_async(const std::string &url, const std::string &data,
+                               const std::vector<std::string> &headers) {
+  return submit("PUT", url, &data, headers);
+}
+
+std::future<HttpResponse>
+CurlMultiHttpClient::patch_async(const std::string &url,
+                                 const std::string &data,
+                                 const std::vector<std::string> &headers) {
+  return submit("PATCH", url, &data, headers);
+}
+
+std::future<HttpResponse>
+CurlMultiHttpClient::post_async(const std::string &url, const std::string &data,
+                                const std::vector<std::string> &headers) {
+  return submit("POST", url, &data, headers);
+}
+
+std::future<HttpResponse>
+CurlMultiHttpClient::del_async(const std::string &url,
+                               const std::vector<std::string> &headers) {
+  return submit("DELETE", url, nullptr, headers);
+}
+
+/**
+ * Prepare a transfer on the caller's thread, queue it, and wake the loop.
+ */
+std::future<HttpResponse>
+CurlMultiHttpClient::submit(const char *verb, const std::string &url,
+                            const std::string *data,
+                            const std::vector<std::string> &headers) {
+  auto transfer = std::make_unique<Transfer>();
+  transfer->verb = verb;
+  transfer->url = url;
+  if (data != nullptr) {
+    transfer->payload = *data;
+  }
+  auto future = transfer->promise.get_future();
+  if (!running_.load()) {
+    transfer->promise.set_exception(std::make_exception_ptr(
+        TransientNetworkError("HTTP client is shutting down")));
+    return future;
+  }
+
+  CURL *curl = transfer->handle.get();
+  CurlSharePool::instance().attach(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, transfer->url.c_str());
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer.get());
+  if (transfer->verb == "GET") {
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, transfer->verb.c_str());
+  }
+  if (data != nullptr) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer->payload.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     static_cast<curl_off_t>(transfer->payload.size()));
+  }
+  const std::string *proxy = nullptr;
+  if (url.rfind("https://", 0) == 0) {
+    proxy = !https_proxy_.empty() ? &https_proxy_
+                                  : (!http_proxy_.empty() ? &http_proxy_
+                                                          : nullptr);
+    if (proxy) {
+      curl_easy_setopt(curl, CURLOPT_HTTPPROXYTUNNEL, 1L);
+    }
+  } else if (url.rfind("http://", 0) == 0 && !http_proxy_.empty()) {
+    proxy = &http_proxy_;
+  }
+  if (proxy) {
+    curl_easy_setopt(curl, CURLOPT_PROXY, proxy->c_str());
+  }
+  if (http2_) {
+    // HTTP_VERSION_2_0 negotiates h2 via ALPN or an h2c upgrade and keeps
+    // HTTP/1.1 when the server refuses. PIPEWAIT prefers joining an existing
+    // multiplexed connection over opening another one.
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                     static_cast<long>(CURL_HTTP_VERSION_2_0));
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                     static_cast<long>(CURL_HTTP_VERSION_1_1));
+  }
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_body);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer->body);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_header);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer->response_headers);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeout_ms_);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms_);
+  if (download_limit_ > 0)
+    curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, download_limit_);
+  if (upload_limit_ > 0)
+    curl_easy_setopt(curl, CURLOPT_MAX_SEND_SPEED_LARGE, upload_limit_);
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->errbuf);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  for (const auto &h : headers) {
+    transfer->request_headers =
+        curl_slist_append(transfer->request_headers, h.c_str());
+  }
+  transfer->request_headers = curl_slist_append(
+      transfer->request_headers, "User-Agent: autogithubpullmerge");
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->request_headers);
+
+  {
+    std::scoped_lock lock(queue_mutex_);
+    queue_.push_back(std::move(transfer));
+  }
+  curl_multi_wakeup(multi_);
+  return future;
+}
+
+/**
+ * Attach a queued transfer to the multi handle. Runs on the loop thread.
+ */
+void CurlMultiHttpClient::attach(std::unique_ptr<Transfer> transfer) {
+  CURL *curl = transfer->handle.get();
+  CURLMcode rc = curl_multi_add_handle(multi_, curl);
+  if (rc != CURLM_OK) {
+    std::string msg = "curl multi " + transfer->verb + " " + transfer->url +
+                      " failed: " + curl_multi_strerror(rc);
+    http_log()->error(msg);
+    transfer->promise.set_exception(
+        std::make_exception_ptr(TransientNetworkError(msg)));
+    return;
+  }
+  active_.emplace(curl, std::move(transfer));
+  std::size_t now = in_flight_.fetch_add(1) + 1;
+  std::size_t peak = peak_in_flight_.load();
+  while (now > peak && !peak_in_flight_.compare_exchange_weak(peak, now)) {
+  }
+}
+
+/**
+ * Translate a finished transfer into a response or typed exception.
+ */
+void CurlMultiHttpClient::complete(Transfer &transfer, CURLcode code) {
+  CURL *curl = transfer.handle.get();
+  long http_code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+  CurlSharePool::instance().record_transfer(curl);
+  if (http_code > 0) {
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+    if (version == CURL_HTTP_VERSION_2_0) {
+      http2_transfers_.fetch_add(1);
+    } else if (version == CURL_HTTP_VERSION_1_0 ||
+               version == CURL_HTTP_VERSION_1_1) {
+      http1_transfers_.fetch_add(1);
+    }
+  }
+  curl_off_t dl = 0;
+  curl_off_t ul = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
+  curl_off_t downloaded = total_downloaded_.fetch_add(dl) + dl;
+  curl_off_t uploaded = total_uploaded_.fetch_add(ul) + ul;
+  try {
+    if (max_download_ > 0 && downloaded > max_download_) {
+      http_log()->error("Maximum download exceeded");
+      throw std::runtime_error("Maximum download exceeded");
+    }
+    if (max_upload_ > 0 && uploaded > max_upload_) {
+      http_log()->error("Maximum upload exceeded");
+      throw std::runtime_error("Maximum upload exceeded");
+    }
+    if (code != CURLE_OK) {
+      std::ostringstream oss;
+      oss << "curl " << transfer.verb << ' ' << transfer.url
+          << " failed: " << curl_easy_strerror(code);
+      if (transfer.errbuf[0] != '\0') {
+        oss << " - " << transfer.errbuf;
+      }
+      http_log()->error(oss.str());
+      throw TransientNetworkError(oss.str());
+    }
+    // Non-HTTP schemes (e.g. file://) report no status code.
+    if (http_code == 0) {
+      http_code = 200;
+    }
+    if (http_code < 200 || http_code >= 300) {
+      if (transfer.verb == "GET" && (http_code == 403 || http_code == 429)) {
+        // Let caller handle rate limiting
+        transfer.promise.set_value({std::move(transfer.body),
+                                    std::move(transfer.response_headers),
+                                    http_code});
+        return;
+      }
+      http_log()->error("curl {} {} failed with HTTP code {}", transfer.verb,
+                        transfer.url, http_code);
+      throw HttpStatusError(static_cast<int>(http_code),
+                            "curl " + transfer.verb +
+                                " failed with HTTP code " +
+                                std::to_string(http_code));
+    }
+    transfer.promise.set_value({std::move(transfer.body),
+                                std::move(transfer.response_headers),
+                                http_code});
+  } catch (...) {
+    transfer.promise.set_exception(std::current_exception());
+  }
+}
+
+/**
+ * Event loop: attach queued transfers, drive the multi handle, and resolve
+ * finished transfers until the client shuts down.
+ */
+void CurlMultiHttpClient::run() {
+  while (running_.load()) {
+    std::deque<std::unique_ptr<Transfer>> ready;
+    {
+      std::scoped_lock lock(queue_mutex_);
+      while (!queue_.empty() &&
+             (max_in_flight_ == 0 ||
+              active_.size() + ready.size() < max_in_flight_)) {
+        ready.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    for (auto &transfer : ready) {
+      attach(std::move(transfer));
+    }
+
+    int still_running = 0;
+    curl_multi_perform(multi_, &still_running);
+    int queued = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi_, &queued)) {
+      if (msg->msg != CURLMSG_DONE) {
+        continue;
+      }
+      CURL *curl = msg->easy_handle;
+      CURLcode result = msg->data.result;
+      curl_multi_remove_handle(multi_, curl);
+      auto it = active_.find(curl);
+      if (it == active_.end()) {
+        continue;
+      }
+      std::unique_ptr<Transfer> transfer = std::move(it->second);
+      active_.erase(it);
+      in_flight_.fetch_sub(1);
+      complete(*transfer, result);
+    }
+
+    curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+  }
+
+  auto fail = [](Transfer &transfer) {
+    transfer.promise.set_exception(std::make_exception_ptr(
+        TransientNetworkError("HTTP client is shutting down")));
+  };
+  for (auto &[curl, transfer] : active_) {
+    curl_multi_remove_handle(multi_, curl);
+    fail(*transfer);
+  }
+  active_.clear();
+  in_flight_.store(0);
+  std::scoped_lock lock(queue_mutex_);
+  for (auto &transfer : queue_) {
+    fail(*transfer);
+  }
+  queue_.clear();
+}
+
+} // namespace agpm
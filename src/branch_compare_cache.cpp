@@ -0,0 +1,144 @@
+/**
+ * @file branch_compare_cache.cpp
+ * @brief Implementation of the persistent branch comparison cache.
+ */
+
+#include "branch_compare_cache.hpp"
+#include "log.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> compare_cache_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("github_client");
+  }();
+  return logger;
+}
+
+std::string cache_key(const std::string &base_sha,
+                      const std::string &head_sha) {
+  return base_sha + "..." + head_sha;
+}
+
+std::int64_t now_seconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+std::optional<BranchCompareCache::Comparison>
+BranchCompareCache::lookup(const std::string &base_sha,
+                           const std::string &head_sha) {
+  std::scoped_lock lock(mutex_);
+  auto it = entries_.find(cache_key(base_sha, head_sha));
+  if (it == entries_.end()) {
+    ++misses_;
+    return std::nullopt;
+  }
+  ++hits_;
+  it->second.last_used = now_seconds();
+  return it->second.comparison;
+}
+
+void BranchCompareCache::store(const std::string &base_sha,
+                               const std::string &head_sha,
+                               Comparison comparison) {
+  std::scoped_lock lock(mutex_);
+  entries_[cache_key(base_sha, head_sha)] = {std::move(comparison),
+                                             now_seconds()};
+  dirty_ = true;
+}
+
+bool BranchCompareCache::load(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  try {
+    nlohmann::json j = nlohmann::json::parse(in);
+    std::unordered_map<std::string, Slot> loaded;
+    for (const auto &[key, item] : j.at("entries").items()) {
+      Slot slot;
+      slot.comparison.ahead_by = item.value("ahead_by", 0);
+      slot.comparison.behind_by = item.value("behind_by", 0);
+      slot.comparison.status = item.value("status", std::string{});
+      slot.comparison.last_commit = item.value("last_commit", std::int64_t{0});
+      slot.last_used = item.value("last_used", std::int64_t{0});
+      loaded.emplace(key, std::move(slot));
+    }
+    std::scoped_lock lock(mutex_);
+    entries_ = std::move(loaded);
+    dirty_ = false;
+  } catch (const std::exception &e) {
+    compare_cache_log()->warn("Ignoring unreadable compare cache {}: {}", path,
+                              e.what());
+    return false;
+  }
+  compare_cache_log()->debug("Loaded {} branch comparisons from {}", size(),
+                             path);
+  return true;
+}
+
+bool BranchCompareCache::save(const std::string &path) {
+  nlohmann::json entries = nlohmann::json::object();
+  {
+    std::scoped_lock lock(mutex_);
+    const std::int64_t cutoff = now_seconds() - kRetentionSeconds;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.last_used < cutoff) {
+        it = entries_.erase(it);
+        dirty_ = true;
+      } else {
+        ++it;
+      }
+    }
+    if (!dirty_) {
+      return true;
+    }
+    for (const auto &[key, slot] : entries_) {
+      entries[key] = {{"ahead_by", slot.comparison.ahead_by},
+                      {"behind_by", slot.comparison.behind_by},
+                      {"status", slot.comparison.status},
+                      {"last_commit", slot.comparison.last_commit},
+                      {"last_used", slot.last_used}};
+    }
+    dirty_ = false;
+  }
+  const std::string tmp = path + ".tmp";
+  bool ok = false;
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << nlohmann::json{{"version", 1}, {"entries", std::move(entries)}}
+               .dump();
+    ok = static_cast<bool>(out);
+  }
+  std::error_code ec;
+  if (ok) {
+    std::filesystem::rename(tmp, path, ec);
+    ok = !ec;
+  }
+  if (!ok) {
+    compare_cache_log()->error("Failed to write compare cache {}", path);
+    std::filesystem::remove(tmp, ec);
+    std::scoped_lock lock(mutex_);
+    dirty_ = true;
+  }
+  return ok;
+}
+
+std::size_t BranchCompareCache::size() const {
+  std::scoped_lock lock(mutex_);
+  return entries_.size();
+}
+
+} // namespace agpm
@@ -0,0 +1,306 @@
+/**
+ * @file cache_log.cpp
+ * @brief Implementation of the append-only ETag cache log.
+ */
+
+#include "cache_log.hpp"
+#include "log.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> cache_log_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("github_client");
+  }();
+  return logger;
+}
+
+constexpr char kMagic[8] = {'A', 'G', 'P', 'M', 'C', 'L', 'G', '1'};
+constexpr std::uint8_t kPutRecord = 1;
+/// Records at or below this count are never worth compacting.
+constexpr std::size_t kCompactSlack = 256;
+
+std::uint32_t fnv1a(std::string_view data) {
+  std::uint32_t h = 2166136261u;
+  for (unsigned char c : data) {
+    h ^= c;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void put_u32(std::string &out, std::uint32_t v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+void put_str(std::string &out, const std::string &s) {
+  put_u32(out, static_cast<std::uint32_t>(s.size()));
+  out.append(s);
+}
+
+/// Bounds-checked reader over a record payload.
+struct Reader {
+  std::string_view data;
+  std::size_t pos{0};
+
+  bool u32(std::uint32_t &v) {
+    if (data.size() - pos < sizeof(v))
+      return false;
+    std::memcpy(&v, data.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+  }
+  bool u8(std::uint8_t &v) {
+    if (pos >= data.size())
+      return false;
+    v = static_cast<std::uint8_t>(data[pos++]);
+    return true;
+  }
+  bool str(std::string &s) {
+    std::uint32_t len = 0;
+    if (!u32(len) || data.size() - pos < len)
+      return false;
+    s.assign(data.data() + pos, len);
+    pos += len;
+    return true;
+  }
+};
+
+std::string encode(const CacheLog::Record &record) {
+  const auto &[url, entry] = record;
+  std::string payload;
+  payload.push_back(static_cast<char>(kPutRecord));
+  put_str(payload, url);
+  put_str(payload, entry->etag);
+  put_str(payload, entry->body);
+  put_u32(payload, static_cast<std::uint32_t>(entry->headers.size()));
+  for (const auto &h : entry->headers) {
+    put_str(payload, h);
+  }
+  std::string out;
+  out.reserve(payload.size() + 8);
+  put_u32(out, static_cast<std::uint32_t>(payload.size()));
+  put_u32(out, fnv1a(payload));
+  out += payload;
+  return out;
+}
+
+bool decode(std::string_view payload, std::string &url,
+            EtagCache::Entry &entry) {
+  Reader r{payload};
+  std::uint8_t type = 0;
+  std::uint32_t count = 0;
+  if (!r.u8(type) || type != kPutRecord || !r.str(url) || !r.str(entry.etag) ||
+      !r.str(entry.body) || !r.u32(count))
+    return false;
+  entry.headers.resize(count);
+  for (auto &h : entry.headers) {
+    if (!r.str(h))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Read-only view of a whole file, memory-mapped where the platform allows.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+#ifndef _WIN32
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+      return;
+    struct stat st {};
+    if (::fstat(fd_, &st) != 0 || st.st_size == 0)
+      return;
+    void *p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED)
+      return;
+    map_ = p;
+    size_ = static_cast<std::size_t>(st.st_size);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+      buffer_.assign(std::istreambuf_iterator<char>(in), {});
+    }
+#endif
+  }
+  ~MappedFile() {
+#ifndef _WIN32
+    if (map_ != nullptr)
+      ::munmap(map_, size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+#endif
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  std::string_view view() const {
+#ifndef _WIN32
+    return {static_cast<const char *>(map_), size_};
+#else
+    return buffer_;
+#endif
+  }
+
+private:
+#ifndef _WIN32
+  int fd_{-1};
+  void *map_{nullptr};
+  std::size_t size_{0};
+#else
+  std::string buffer_;
+#endif
+};
+
+bool write_all(std::FILE *f, const std::string &data) {
+  return std::fwrite(data.data(), 1, data.size(), f) == data.size();
+}
+
+} // namespace
+
+CacheLog::CacheLog(std::string path) : path_(std::move(path)) {}
+
+bool CacheLog::is_cache_log(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[sizeof(kMagic)] = {};
+  return in.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+std::size_t CacheLog::load(
+    const std::function<void(std::string url, EtagCache::Entry entry)>
+        &visit) {
+  records_ = 0;
+  std::size_t valid_end = 0;
+  std::size_t file_size = 0;
+  {
+    MappedFile file(path_);
+    std::string_view data = file.view();
+    file_size = data.size();
+    if (data.size() < sizeof(kMagic) ||
+        std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+      return 0;
+    }
+    std::size_t pos = sizeof(kMagic);
+    valid_end = pos;
+    while (data.size() - pos >= 8) {
+      std::uint32_t len = 0;
+      std::uint32_t sum = 0;
+      std::memcpy(&len, data.data() + pos, sizeof(len));
+      std::memcpy(&sum, data.data() + pos + 4, sizeof(sum));
+      if (data.size() - pos - 8 < len)
+        break;
+      std::string_view payload = data.substr(pos + 8, len);
+      if (fnv1a(payload) != sum)
+        break;
+      std::string url;
+      EtagCache::Entry entry;
+      if (decode(payload, url, entry)) {
+        visit(std::move(url), std::move(entry));
+      }
+      ++records_;
+      pos += 8 + len;
+      valid_end = pos;
+    }
+  }
+  if (valid_end < file_size) {
+    cache_log_log()->warn("Truncating {} corrupt bytes from cache log {}",
+                          file_size - valid_end, path_);
+    std::error_code ec;
+    std::filesystem::resize_file(path_, valid_end, ec);
+  }
+  return records_;
+}
+
+bool CacheLog::append(const std::vector<Record> &records) {
+  if (records.empty())
+    return true;
+  std::FILE *f = std::fopen(path_.c_str(), "ab");
+  if (f == nullptr) {
+    cache_log_log()->error("Unable to open cache log {}", path_);
+    return false;
+  }
+  // An empty file, e.g. one left by a crash before the first write, gets the
+  // magic like a missing one. Records are never appended to a foreign file,
+  // since load() would discard the whole file on the next start.
+  bool ok = std::fseek(f, 0, SEEK_END) == 0;
+  const long size = ok ? std::ftell(f) : -1;
+  if (size == 0) {
+    ok = write_all(f, std::string(kMagic, sizeof(kMagic)));
+  } else if (size < 0 || !is_cache_log(path_)) {
+    std::fclose(f);
+    cache_log_log()->error("Refusing to append to {}: not a cache log", path_);
+    return false;
+  }
+  for (const auto &record : records) {
+    if (!ok)
+      break;
+    ok = write_all(f, encode(record));
+  }
+  ok = std::fflush(f) == 0 && ok;
+  ok = std::fclose(f) == 0 && ok;
+  if (ok) {
+    records_ += records.size();
+  } else {
+    cache_log_log()->error("Failed to append to cache log {}", path_);
+  }
+  return ok;
+}
+
+bool CacheLog::compact(const std::vector<Record> &live) {
+  const std::string tmp = path_ + ".compact";
+  std::FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (f == nullptr) {
+    cache_log_log()->error("Unable to open {} for compaction", tmp);
+    return false;
+  }
+  bool ok = write_all(f, std::string(kMagic, sizeof(kMagic)));
+  for (const auto &record : live) {
+    if (!ok)
+      break;
+    ok = write_all(f, encode(record));
+  }
+  ok = std::fflush(f) == 0 && ok;
+  ok = std::fclose(f) == 0 && ok;
+  std::error_code ec;
+  if (ok) {
+    std::filesystem::rename(tmp, path_, ec);
+    ok = !ec;
+  }
+  if (!ok) {
+    cache_log_log()->error("Failed to compact cache log {}", path_);
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  cache_log_log()->debug("Compacted cache log {} from {} to {} records",
+                         path_, records_, live.size());
+  records_ = live.size();
+  return true;
+}
+
+bool CacheLog::should_compact(std::size_t live_entries) const {
+  return records_ > kCompactSlack && records_ > live_entries * 2;
+}
+
+} // namespace agpm
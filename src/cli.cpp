@@ -51,10 +51,11 @@ std::shared_ptr<spdlog::logger> cli_log() {
 }
 
 std::string log_category_help_text() {
-  static const std::array<std::string_view, 12> categories = {
-      "app",           "cli",           "config",         "demo_tui",
-      "github.client", "github.poller", "history",        "logging",
-      "main",          "pat",           "repo.discovery", "tui"};
+  static const std::array<std::string_view, 13> categories = {
+      "app",           "cli",           "config",  "demo_tui",
+      "github.client", "github.poller", "history", "http",
+      "logging",       "main",          "pat",     "repo.discovery",
+      "tui"};
   std::ostringstream oss;
   oss << "Logging categories: ";
   for (std::size_t i = 0; i < categories.size(); ++i) {
@@ -770,6 +771,30 @@ CliOptions parse_cli(int argc, char **argv) {
           ->type_name("N")
           ->check(CLI::Range(0, std::numeric_limits<int>::max()))
           ->group("Integrations");
+  app.add_flag("--webhook", options.webhook_enabled,
+               "Receive GitHub webhook deliveries and refresh only the "
+               "repositories they affect")
+      ->group("Integrations");
+  app.add_option("--webhook-bind", options.webhook_bind_address,
+                 "Bind address for the webhook listener")
+      ->type_name("ADDR")
+      ->group("Integrations");
+  app.add_option("--webhook-port", options.webhook_port,
+                 "TCP port used by the webhook listener")
+      ->type_name("PORT")
+      ->check(CLI::Range(1, 65535))
+      ->group("Integrations");
+  app.add_option("--webhook-secret", options.webhook_secret,
+                 "Shared secret used to verify webhook signatures")
+      ->type_name("SECRET")
+      ->group("Integrations");
+  app.add_option("--webhook-reconcile-interval",
+                 options.webhook_reconcile_interval,
+                 "Seconds between full reconciliation polls while webhooks "
+                 "are enabled")
+      ->type_name("SECONDS")
+      ->check(CLI::Range(1, std::numeric_limits<int>::max()))
+      ->group("Integrations");
   mcp_caddy_flag =
       app.add_flag(
              "--mcp-caddy-window", options.mcp_caddy_window,
@@ -867,6 +892,43 @@ CliOptions parse_cli(int argc, char **argv) {
       ->type_name("N")
       ->check(CLI::NonNegativeNumber)
       ->group("Polling");
+  app.add_option_function<double>(
+         "--priority-rate-reserve",
+         [&options](double value) {
+           if (value < 0.0 || value > 0.9) {
+             throw CLI::ValidationError(
+                 "--priority-rate-reserve",
+                 "reserve must be between 0 and 0.9");
+           }
+           options.priority_rate_reserve = value;
+           options.priority_rate_reserve_explicit = true;
+         },
+         "Fraction of the request rate kept for interactive merges and other "
+         "mutations (default 0.1)")
+      ->type_name("FRACTION")
+      ->group("Polling");
+  app.add_flag("--work-stealing", options.work_stealing,
+               "Give each worker its own job deque and let idle workers steal "
+               "queued branch sub-jobs")
+      ->group("Polling");
+  app.add_flag("--stream-results", options.stream_results,
+               "Poll each repository on its own schedule and publish its "
+               "results as soon as it finishes")
+      ->group("Polling");
+  app.add_flag("--adaptive-intervals", options.adaptive_intervals,
+               "Poll repositories that change often more frequently and back "
+               "off idle ones (implies --stream-results)")
+      ->group("Polling");
+  app.add_option("--adaptive-min-interval", options.adaptive_min_interval,
+                 "Shortest adaptive poll interval in seconds (default 15)")
+      ->type_name("SECONDS")
+      ->check(CLI::Range(1, std::numeric_limits<int>::max()))
+      ->group("Polling");
+  app.add_option("--adaptive-max-interval", options.adaptive_max_interval,
+                 "Longest adaptive poll interval in seconds (default 1800)")
+      ->type_name("SECONDS")
+      ->check(CLI::Range(1, std::numeric_limits<int>::max()))
+      ->group("Polling");
   app.add_option("-t,--http-timeout", options.http_timeout,
                  "HTTP request timeout in seconds")
       ->type_name("SECONDS")
@@ -904,6 +966,45 @@ CliOptions parse_cli(int argc, char **argv) {
   app.add_flag("-g,--use-graphql", options.use_graphql,
                "Use GraphQL API for pull requests")
       ->group("Networking");
+  app.add_option("--graphql-batch", options.graphql_batch_size,
+                 "Batch pull request listings for up to N repositories per "
+                 "GraphQL query (0 = off, requires --use-graphql)")
+      ->type_name("N")
+      ->default_val("0")
+      ->check(CLI::NonNegativeNumber)
+      ->group("Networking");
+  app.add_flag("--async-http", options.async_http,
+               "Drive HTTP requests from a single curl-multi event loop")
+      ->group("Networking");
+  app.add_flag("--http2", options.http2,
+               "Multiplex requests over HTTP/2, falling back to HTTP/1.1")
+      ->group("Networking");
+  app.add_option("--http2-max-streams", options.http2_max_streams,
+                 "Maximum concurrent HTTP/2 streams per connection")
+      ->type_name("N")
+      ->default_val("100")
+      ->check(CLI::PositiveNumber)
+      ->group("Networking");
+  app.add_option("--http-cache", options.http_cache,
+                 "File persisting the HTTP ETag cache between runs "
+                 "(.json for a JSON snapshot, otherwise a binary log)")
+      ->type_name("FILE")
+      ->group("Networking");
+  app.add_option("--http-cache-max-bytes", options.http_cache_max_bytes,
+                 "Memory cap for cached HTTP responses (0 = unlimited)")
+      ->type_name("BYTES")
+      ->default_val("67108864")
+      ->check(CLI::NonNegativeNumber)
+      ->group("Networking");
+  app.add_option("--http-cache-flush-ms", options.http_cache_flush_ms,
+                 "Interval between HTTP cache flushes in milliseconds")
+      ->type_name("MS")
+      ->default_val("5000")
+      ->check(CLI::PositiveNumber)
+      ->group("Networking");
+  app.add_flag("--cache-stats", options.cache_stats,
+               "Print HTTP cache statistics on shutdown")
+      ->group("Networking");
   app.add_option("-Q,--pr-limit", options.pr_limit,
                  "Number of pull requests to fetch")
       ->type_name("N")
@@ -914,6 +1015,13 @@ CliOptions parse_cli(int argc, char **argv) {
       ->type_name("DURATION")
       ->default_val("0")
       ->group("Pull Request Management");
+  app.add_flag("--incremental-prs", options.incremental_prs,
+               "Only fetch pull requests updated since the previous poll")
+      ->group("Pull Request Management");
+  app.add_option("--pr-state-file", options.pr_state_file,
+                 "Persist incremental pull request watermarks in FILE")
+      ->type_name("FILE")
+      ->group("Pull Request Management");
   app.add_option(
          "-O,--single-open-prs", options.single_open_prs_repo,
          "Fetch open PRs for a single repo via one HTTP request and exit")
@@ -960,6 +1068,15 @@ CliOptions parse_cli(int argc, char **argv) {
          },
          "Enable heuristics-based stray branch detection")
       ->group("Branch Management");
+  app.add_option("--stray-cache", options.stray_cache,
+                 "Persist heuristic branch comparisons in FILE so unchanged "
+                 "branches are not re-compared after a restart")
+      ->type_name("FILE")
+      ->group("Branch Management");
+  app.add_flag("--local-analysis", options.local_analysis,
+               "Compare branches using local clones found under "
+               "--repo-discovery-root instead of the compare API")
+      ->group("Branch Management");
   app.add_flag("-3,--reject-dirty", options.reject_dirty,
                "Close dirty stray branches automatically")
       ->group("Branch Management");
@@ -984,6 +1101,17 @@ CliOptions parse_cli(int argc, char **argv) {
   app.add_flag("-9,--require-mergeable", options.require_mergeable_state,
                "Require pull request to be mergeable")
       ->group("Pull Request Management");
+  // The cache key is the head SHA and `updated_at`, neither of which moves
+  // when status checks finish, so a waiting pull request whose checks pass
+  // is merged up to one TTL late. Opt-in for that reason.
+  app.add_option("--decision-cache-ttl", options.decision_cache_ttl,
+                 "Seconds to skip re-checking unchanged pull requests left "
+                 "waiting by auto-merge; passing checks are noticed up to "
+                 "this late (0 = always re-check)")
+      ->type_name("SECONDS")
+      ->default_val("0")
+      ->check(CLI::NonNegativeNumber)
+      ->group("Pull Request Management");
   app.add_option("-0,--purge-prefix", options.purge_prefix,
                  "Delete branches with this prefix after PR close")
       ->type_name("PREFIX")
@@ -582,6 +582,24 @@ void Config::load_json(const nlohmann::json &j) {
   if (cfg.contains("workers")) {
     set_workers(std::max(1, cfg["workers"].get<int>()));
   }
+  if (cfg.contains("work_stealing")) {
+    set_work_stealing(cfg["work_stealing"].get<bool>());
+  }
+  if (cfg.contains("stream_results")) {
+    set_stream_results(cfg["stream_results"].get<bool>());
+  }
+  if (cfg.contains("adaptive_intervals")) {
+    set_adaptive_intervals(cfg["adaptive_intervals"].get<bool>());
+  }
+  if (cfg.contains("adaptive_min_interval")) {
+    set_adaptive_min_interval(cfg["adaptive_min_interval"].get<int>());
+  }
+  if (cfg.contains("adaptive_max_interval")) {
+    set_adaptive_max_interval(cfg["adaptive_max_interval"].get<int>());
+  }
+  if (cfg.contains("priority_rate_reserve")) {
+    set_priority_rate_reserve(cfg["priority_rate_reserve"].get<double>());
+  }
   if (cfg.contains("http_timeout")) {
     set_http_timeout(cfg["http_timeout"].get<int>());
   }
@@ -609,6 +627,27 @@ void Config::load_json(const nlohmann::json &j) {
   if (cfg.contains("https_proxy")) {
     set_https_proxy(cfg["https_proxy"].get<std::string>());
   }
+  if (cfg.contains("async_http")) {
+    set_async_http(cfg["async_http"].get<bool>());
+  }
+  if (cfg.contains("http2")) {
+    set_http2(cfg["http2"].get<bool>());
+  }
+  if (cfg.contains("http2_max_streams")) {
+    set_http2_max_streams(cfg["http2_max_streams"].get<int>());
+  }
+  if (cfg.contains("http_cache")) {
+    set_http_cache(cfg["http_cache"].get<std::string>());
+  }
+  if (cfg.contains("http_cache_max_bytes")) {
+    set_http_cache_max_bytes(cfg["http_cache_max_bytes"].get<long long>());
+  }
+  if (cfg.contains("http_cache_flush_ms")) {
+    set_http_cache_flush_ms(cfg["http_cache_flush_ms"].get<int>());
+  }
+  if (cfg.contains("cache_stats")) {
+    set_cache_stats(cfg["cache_stats"].get<bool>());
+  }
   if (cfg.contains("log_level")) {
     set_log_level(cfg["log_level"].get<std::string>());
   }
@@ -802,9 +841,18 @@ void Config::load_json(const nlohmann::json &j) {
     }
     set_stray_detection_mode(*mode);
   }
+  if (cfg.contains("stray_cache")) {
+    set_stray_cache(cfg["stray_cache"].get<std::string>());
+  }
+  if (cfg.contains("local_analysis")) {
+    set_local_analysis(cfg["local_analysis"].get<bool>());
+  }
   if (cfg.contains("auto_merge")) {
     set_auto_merge(cfg["auto_merge"].get<bool>());
   }
+  if (cfg.contains("decision_cache_ttl")) {
+    set_decision_cache_ttl(cfg["decision_cache_ttl"].get<int>());
+  }
   if (cfg.contains("allow_delete_base_branch")) {
     set_allow_delete_base_branch(cfg["allow_delete_base_branch"].get<bool>());
   }
@@ -833,6 +881,15 @@ void Config::load_json(const nlohmann::json &j) {
   if (cfg.contains("use_graphql")) {
     set_use_graphql(cfg["use_graphql"].get<bool>());
   }
+  if (cfg.contains("graphql_batch_size")) {
+    set_graphql_batch_size(cfg["graphql_batch_size"].get<int>());
+  }
+  if (cfg.contains("incremental_prs")) {
+    set_incremental_prs(cfg["incremental_prs"].get<bool>());
+  }
+  if (cfg.contains("pr_state_file")) {
+    set_pr_state_file(cfg["pr_state_file"].get<std::string>());
+  }
   if (cfg.contains("hotkeys_enabled")) {
     set_hotkeys_enabled(cfg["hotkeys_enabled"].get<bool>());
   }
@@ -1007,6 +1064,22 @@ void Config::load_json(const nlohmann::json &j) {
   if (cfg.contains("mcp_server_caddy_window")) {
     set_mcp_server_caddy_window(cfg["mcp_server_caddy_window"].get<bool>());
   }
+  if (cfg.contains("webhook_enabled")) {
+    set_webhook_enabled(cfg["webhook_enabled"].get<bool>());
+  }
+  if (cfg.contains("webhook_bind_address")) {
+    set_webhook_bind_address(cfg["webhook_bind_address"].get<std::string>());
+  }
+  if (cfg.contains("webhook_port")) {
+    set_webhook_port(cfg["webhook_port"].get<int>());
+  }
+  if (cfg.contains("webhook_secret")) {
+    set_webhook_secret(cfg["webhook_secret"].get<std::string>());
+  }
+  if (cfg.contains("webhook_reconcile_interval")) {
+    set_webhook_reconcile_interval(
+        cfg["webhook_reconcile_interval"].get<int>());
+  }
   if (cfg.contains("mcp")) {
     const auto &mcp_cfg = cfg["mcp"];
     if (mcp_cfg.is_object()) {
@@ -0,0 +1,124 @@
+/**
+ * @file curl_share.cpp
+ * @brief Implementation of the libcurl share pool and handle leases.
+ */
+
+#include "curl_share.hpp"
+#include "log.hpp"
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> http_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("http");
+  }();
+  return logger;
+}
+
+/// Idle easy handles owned by the calling thread.
+std::vector<std::unique_ptr<CurlHandle>> &thread_idle_handles() {
+  thread_local std::vector<std::unique_ptr<CurlHandle>> idle;
+  return idle;
+}
+
+} // namespace
+
+CurlHandleLease::CurlHandleLease(std::unique_ptr<CurlHandle> handle)
+    : handle_(std::move(handle)) {}
+
+CurlHandleLease::~CurlHandleLease() {
+  if (handle_) {
+    thread_idle_handles().push_back(std::move(handle_));
+  }
+}
+
+CurlSharePool &CurlSharePool::instance() {
+  static CurlSharePool pool;
+  return pool;
+}
+
+CurlSharePool::CurlSharePool() {
+  CurlHandle::global_init();
+  share_ = curl_share_init();
+  if (share_ == nullptr) {
+    http_log()->warn("curl_share_init failed; HTTP caches will not be shared");
+    return;
+  }
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlSharePool::lock);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlSharePool::unlock);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlSharePool::~CurlSharePool() {
+  if (share_ != nullptr) {
+    curl_share_cleanup(share_);
+  }
+}
+
+void CurlSharePool::lock(CURL *, curl_lock_data data, curl_lock_access,
+                         void *userptr) {
+  auto *self = static_cast<CurlSharePool *>(userptr);
+  self->locks_[static_cast<std::size_t>(data) % self->locks_.size()].lock();
+}
+
+void CurlSharePool::unlock(CURL *, curl_lock_data data, void *userptr) {
+  auto *self = static_cast<CurlSharePool *>(userptr);
+  self->locks_[static_cast<std::size_t>(data) % self->locks_.size()].unlock();
+}
+
+CurlHandleLease CurlSharePool::checkout() {
+  auto &idle = thread_idle_handles();
+  std::unique_ptr<CurlHandle> handle;
+  if (!idle.empty()) {
+    handle = std::move(idle.back());
+    idle.pop_back();
+  } else {
+    handle = std::make_unique<CurlHandle>();
+  }
+  // Resetting clears options but keeps live connections and caches.
+  curl_easy_reset(handle->get());
+  attach(handle->get());
+  return CurlHandleLease(std::move(handle));
+}
+
+void CurlSharePool::attach(CURL *curl) {
+  if (share_ != nullptr) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+  }
+}
+
+void CurlSharePool::record_transfer(CURL *curl) {
+  long connects = 0;
+  long status = 0;
+  if (curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) != CURLE_OK) {
+    return;
+  }
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  if (connects <= 0 && status == 0) {
+    // Nothing reached a server (e.g. DNS failure); count neither.
+    return;
+  }
+  if (connects > 0) {
+    new_connections_.fetch_add(static_cast<std::uint64_t>(connects));
+  } else {
+    reused_connections_.fetch_add(1);
+  }
+}
+
+CurlSharePool::Stats CurlSharePool::stats() const {
+  return {new_connections_.load(), reused_connections_.load()};
+}
+
+void CurlSharePool::reset_stats() {
+  new_connections_.store(0);
+  reused_connections_.store(0);
+}
+
+} // namespace agpm
@@ -0,0 +1,160 @@
+/**
+ * @file etag_cache.cpp
+ * @brief Implementation of the sharded LRU ETag cache.
+ */
+
+#include "etag_cache.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace agpm {
+
+namespace {
+
+/// Fixed bookkeeping charged per entry for list, map and control blocks.
+constexpr std::size_t kEntryOverhead = 128;
+
+} // namespace
+
+EtagCache::EtagCache(std::size_t max_bytes, std::size_t shards)
+    : max_bytes_(max_bytes) {
+  shards_.reserve(std::max<std::size_t>(shards, 1));
+  for (std::size_t i = 0; i < std::max<std::size_t>(shards, 1); ++i) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+std::size_t EtagCache::entry_bytes(const std::string &url,
+                                   const Entry &entry) {
+  std::size_t bytes = kEntryOverhead + url.size() + entry.etag.size() +
+                      entry.body.size();
+  for (const auto &h : entry.headers) {
+    bytes += h.size() + sizeof(std::string);
+  }
+  return bytes;
+}
+
+EtagCache::Shard &EtagCache::shard_for(const std::string &url) {
+  return *shards_[std::hash<std::string>{}(url) % shards_.size()];
+}
+
+std::size_t EtagCache::shard_cap() const {
+  std::size_t max = max_bytes_.load();
+  if (max == 0) {
+    return 0;
+  }
+  return std::max<std::size_t>(max / shards_.size(), 1);
+}
+
+void EtagCache::evict_locked(Shard &shard, std::size_t cap) {
+  if (cap == 0) {
+    return;
+  }
+  while (shard.bytes > cap && !shard.lru.empty()) {
+    auto &victim = shard.lru.back();
+    shard.bytes -= entry_bytes(victim.first, *victim.second);
+    shard.index.erase(victim.first);
+    shard.lru.pop_back();
+    ++shard.evictions;
+  }
+}
+
+EtagCache::EntryPtr EtagCache::lookup(const std::string &url) {
+  Shard &shard = shard_for(url);
+  std::scoped_lock lock(shard.mutex);
+  auto it = shard.index.find(url);
+  if (it == shard.index.end()) {
+    ++shard.misses;
+    return nullptr;
+  }
+  ++shard.hits;
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->second;
+}
+
+void EtagCache::put(const std::string &url, EntryPtr entry) {
+  if (!entry) {
+    return;
+  }
+  const std::size_t bytes = entry_bytes(url, *entry);
+  const std::size_t cap = shard_cap();
+  Shard &shard = shard_for(url);
+  std::scoped_lock lock(shard.mutex);
+  auto it = shard.index.find(url);
+  if (it != shard.index.end()) {
+    shard.bytes -= entry_bytes(url, *it->second->second);
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+  }
+  if (cap != 0 && bytes > cap) {
+    // Storing this entry would flush the whole shard for a single response.
+    ++shard.evictions;
+    return;
+  }
+  shard.lru.emplace_front(url, std::move(entry));
+  shard.index[url] = shard.lru.begin();
+  shard.bytes += bytes;
+  evict_locked(shard, cap);
+}
+
+void EtagCache::record_revalidation(const std::string &url) {
+  Shard &shard = shard_for(url);
+  std::scoped_lock lock(shard.mutex);
+  ++shard.revalidations;
+}
+
+void EtagCache::clear() {
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->mutex);
+    shard->lru.clear();
+    shard->index.clear();
+    shard->bytes = 0;
+  }
+}
+
+void EtagCache::set_max_bytes(std::size_t max_bytes) {
+  max_bytes_.store(max_bytes);
+  const std::size_t cap = shard_cap();
+  for (auto &shard : shards_) {
+    std::scoped_lock lock(shard->mutex);
+    evict_locked(*shard, cap);
+  }
+}
+
+std::size_t EtagCache::max_bytes() const { return max_bytes_.load(); }
+
+std::vector<std::pair<std::string, EtagCache::EntryPtr>>
+EtagCache::snapshot() const {
+  std::vector<std::pair<std::string, EntryPtr>> out;
+  for (const auto &shard : shards_) {
+    std::scoped_lock lock(shard->mutex);
+    out.insert(out.end(), shard->lru.begin(), shard->lru.end());
+  }
+  return out;
+}
+
+std::vector<EtagCache::ShardStats> EtagCache::shard_stats() const {
+  std::vector<ShardStats> out;
+  out.reserve(shards_.size());
+  for (const auto &shard : shards_) {
+    std::scoped_lock lock(shard->mutex);
+    out.push_back({shard->hits, shard->misses, shard->revalidations,
+                   shard->evictions, shard->index.size(), shard->bytes});
+  }
+  return out;
+}
+
+EtagCache::ShardStats EtagCache::totals() const {
+  ShardStats total;
+  for (const auto &s : shard_stats()) {
+    total.hits += s.hits;
+    total.misses += s.misses;
+    total.revalidations += s.revalidations;
+    total.evictions += s.evictions;
+    total.entries += s.entries;
+    total.bytes += s.bytes;
+  }
+  return total;
+}
+
+} // namespace agpm
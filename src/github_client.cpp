@@ -7,7 +7,11 @@
  */
 
 #include "github_client.hpp"
+#include "async_http_client.hpp"
+#include "cache_log.hpp"
 #include "curl/curl.h"
+#include "curl_share.hpp"
+#include "local_git_repository.hpp"
 #include "log.hpp"
 #include <algorithm>
 #include <array>
@@ -15,7 +19,9 @@
 #include <chrono>
 #include <cmath>
 #include <ctime>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <memory>
 #include <mutex>
@@ -63,6 +69,74 @@ PullRequestCheckState interpret_check_state(const nlohmann::json &meta) {
   return PullRequestCheckState::Unknown;
 }
 
+/// GraphQL selection returning merge metadata for each pull request node.
+constexpr const char *kGraphQLPullRequestFields =
+    "number title mergedAt updatedAt headRefOid state isDraft mergeable "
+    "mergeStateStatus "
+    "reviewDecision reviews(states:APPROVED){totalCount} "
+    "commits(last:1){nodes{commit{statusCheckRollup{state}}}}";
+
+/**
+ * Copy the head SHA and `updated_at` of a REST pull request item into @p pr.
+ */
+void read_pull_request_revision(const nlohmann::json &item, PullRequest &pr) {
+  auto head = item.find("head");
+  if (head != item.end() && head->is_object()) {
+    auto sha = head->find("sha");
+    if (sha != head->end() && sha->is_string()) {
+      pr.head_sha = sha->get<std::string>();
+    }
+  }
+  auto updated = item.find("updated_at");
+  if (updated != item.end() && updated->is_string()) {
+    pr.updated_at = updated->get<std::string>();
+  }
+}
+
+/**
+ * Translate a GraphQL pull request node into the metadata the REST
+ * `/pulls/{n}` endpoint would have produced.
+ */
+PullRequestMetadata graphql_pull_request_metadata(const nlohmann::json &node) {
+  auto string_field = [&node](const char *key) {
+    auto it = node.find(key);
+    return it != node.end() && it->is_string() ? it->get<std::string>()
+                                               : std::string{};
+  };
+  PullRequestMetadata metadata;
+  metadata.state = to_lower_copy(string_field("state"));
+  metadata.draft = node.value("isDraft", false);
+  metadata.mergeable = string_field("mergeable") == "MERGEABLE";
+  // mergeStateStatus uses the REST mergeable_state values in upper case.
+  metadata.mergeable_state = to_lower_copy(string_field("mergeStateStatus"));
+  if (node.contains("reviews") && node["reviews"].is_object()) {
+    metadata.approvals = node["reviews"].value("totalCount", 0);
+  }
+  if (metadata.approvals == 0 && string_field("reviewDecision") == "APPROVED") {
+    metadata.approvals = 1;
+  }
+  std::string rollup;
+  try {
+    const auto &commits = node.at("commits").at("nodes");
+    if (!commits.empty()) {
+      const auto &status = commits.back().at("commit").at("statusCheckRollup");
+      if (status.is_object()) {
+        rollup = to_lower_copy(status.value("state", ""));
+      }
+    }
+  } catch (const nlohmann::json::exception &) {
+  }
+  if (rollup == "success") {
+    metadata.check_state = PullRequestCheckState::Passed;
+  } else if (rollup == "failure" || rollup == "error") {
+    metadata.check_state = PullRequestCheckState::Rejected;
+  } else if (rollup.empty()) {
+    nlohmann::json meta{{"mergeable_state", metadata.mergeable_state}};
+    metadata.check_state = interpret_check_state(meta);
+  }
+  return metadata;
+}
+
 /**
  * Convert a shell-style glob pattern to a regular expression.
  *
@@ -312,9 +386,13 @@ struct CurlSlist {
 /**
  * Initialize the CURL handle, ensuring global setup occurs once.
  */
-CurlHandle::CurlHandle() {
+void CurlHandle::global_init() {
   static std::once_flag flag;
   std::call_once(flag, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+
+CurlHandle::CurlHandle() {
+  global_init();
   handle_ = curl_easy_init();
   if (!handle_) {
     throw TransientNetworkError("Failed to init curl");
@@ -335,6 +413,28 @@ CurlHttpClient::CurlHttpClient(long timeout_ms, curl_off_t download_limit,
       max_upload_(max_upload), http_proxy_(std::move(http_proxy)),
       https_proxy_(std::move(https_proxy)) {}
 
+/**
+ * Accumulate transfer totals for a completed request and enforce the
+ * configured cumulative limits.
+ */
+void CurlHttpClient::record_transfer(CURL *curl) {
+  CurlSharePool::instance().record_transfer(curl);
+  curl_off_t dl = 0;
+  curl_off_t ul = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
+  curl_off_t downloaded = total_downloaded_.fetch_add(dl) + dl;
+  curl_off_t uploaded = total_uploaded_.fetch_add(ul) + ul;
+  if (max_download_ > 0 && downloaded > max_download_) {
+    github_client_log()->error("Maximum download exceeded");
+    throw std::runtime_error("Maximum download exceeded");
+  }
+  if (max_upload_ > 0 && uploaded > max_upload_) {
+    github_client_log()->error("Maximum upload exceeded");
+    throw std::runtime_error("Maximum upload exceeded");
+  }
+}
+
 /**
  * libcurl write callback capturing response bodies into a string.
  */
@@ -396,8 +496,8 @@ void CurlHttpClient::apply_proxy(CURL *curl, const std::string &url) {
 HttpResponse
 CurlHttpClient::get_with_headers(const std::string &url,
                                  const std::vector<std::string> &headers) {
-  CURL *curl = curl_.get();
-  curl_easy_reset(curl);
+  CurlHandleLease lease = CurlSharePool::instance().checkout();
+  CURL *curl = lease.get();
   std::string response;
   std::vector<std::string> resp_headers;
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
@@ -426,20 +526,7 @@ CurlHttpClient::get_with_headers(const std::string &url,
   CURLcode res = curl_easy_perform(curl);
   long http_code = 0;
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_off_t dl = 0;
-  curl_off_t ul = 0;
-  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
-  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
-  total_downloaded_ += dl;
-  total_uploaded_ += ul;
-  if (max_download_ > 0 && total_downloaded_ > max_download_) {
-    github_client_log()->error("Maximum download exceeded");
-    throw std::runtime_error("Maximum download exceeded");
-  }
-  if (max_upload_ > 0 && total_uploaded_ > max_upload_) {
-    github_client_log()->error("Maximum upload exceeded");
-    throw std::runtime_error("Maximum upload exceeded");
-  }
+  record_transfer(curl);
   if (res != CURLE_OK) {
     std::string msg = format_curl_error("GET", url, res, errbuf);
     github_client_log()->error(msg);
@@ -472,8 +559,8 @@ std::string CurlHttpClient::get(const std::string &url,
  */
 std::string CurlHttpClient::put(const std::string &url, const std::string &data,
                                 const std::vector<std::string> &headers) {
-  CURL *curl = curl_.get();
-  curl_easy_reset(curl);
+  CurlHandleLease lease = CurlSharePool::instance().checkout();
+  CURL *curl = lease.get();
   std::string response;
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   apply_proxy(curl, url);
@@ -501,20 +588,7 @@ std::string CurlHttpClient::put(const std::string &url, const std::string &data,
   CURLcode res = curl_easy_perform(curl);
   long http_code = 0;
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_off_t dl = 0;
-  curl_off_t ul = 0;
-  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
-  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
-  total_downloaded_ += dl;
-  total_uploaded_ += ul;
-  if (max_download_ > 0 && total_downloaded_ > max_download_) {
-    github_client_log()->error("Maximum download exceeded");
-    throw std::runtime_error("Maximum download exceeded");
-  }
-  if (max_upload_ > 0 && total_uploaded_ > max_upload_) {
-    github_client_log()->error("Maximum upload exceeded");
-    throw std::runtime_error("Maximum upload exceeded");
-  }
+  record_transfer(curl);
   if (res != CURLE_OK) {
     std::string msg = format_curl_error("PUT", url, res, errbuf);
     github_client_log()->error(msg);
@@ -536,8 +610,8 @@ std::string CurlHttpClient::put(const std::string &url, const std::string &data,
 std::string CurlHttpClient::patch(const std::string &url,
                                   const std::string &data,
                                   const std::vector<std::string> &headers) {
-  CURL *curl = curl_.get();
-  curl_easy_reset(curl);
+  CurlHandleLease lease = CurlSharePool::instance().checkout();
+  CURL *curl = lease.get();
   std::string response;
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   apply_proxy(curl, url);
@@ -565,20 +639,7 @@ std::string CurlHttpClient::patch(const std::string &url,
   CURLcode res = curl_easy_perform(curl);
   long http_code = 0;
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_off_t dl = 0;
-  curl_off_t ul = 0;
-  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
-  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
-  total_downloaded_ += dl;
-  total_uploaded_ += ul;
-  if (max_download_ > 0 && total_downloaded_ > max_download_) {
-    github_client_log()->error("Maximum download exceeded");
-    throw std::runtime_error("Maximum download exceeded");
-  }
-  if (max_upload_ > 0 && total_uploaded_ > max_upload_) {
-    github_client_log()->error("Maximum upload exceeded");
-    throw std::runtime_error("Maximum upload exceeded");
-  }
+  record_transfer(curl);
   if (res != CURLE_OK) {
     std::string msg = format_curl_error("PATCH", url, res, errbuf);
     github_client_log()->error(msg);
@@ -594,13 +655,71 @@ std::string CurlHttpClient::patch(const std::string &url,
   return response;
 }
 
+/**
+ * Issue a POST request.
+ *
+ * Unlike the other verbs the status code is inspected without
+ * CURLOPT_FAILONERROR so rate limit responses surface as HttpStatusError
+ * carrying their status.
+ */
+std::string CurlHttpClient::post(const std::string &url,
+                                 const std::string &data,
+                                 const std::vector<std::string> &headers) {
+  CurlHandleLease lease = CurlSharePool::instance().checkout();
+  CURL *curl = lease.get();
+  std::string response;
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  apply_proxy(curl, url);
+  curl_easy_setopt(curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                   static_cast<curl_off_t>(data.size()));
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeout_ms_);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms_);
+  if (download_limit_ > 0)
+    curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, download_limit_);
+  if (upload_limit_ > 0)
+    curl_easy_setopt(curl, CURLOPT_MAX_SEND_SPEED_LARGE, upload_limit_);
+  char errbuf[CURL_ERROR_SIZE];
+  errbuf[0] = '\0';
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 0L);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+  CurlSlist header_list;
+  for (const auto &h : headers) {
+    header_list.append(h);
+  }
+  header_list.append("User-Agent: autogithubpullmerge");
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list.get());
+  CURLcode res = curl_easy_perform(curl);
+  long http_code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+  record_transfer(curl);
+  if (res != CURLE_OK) {
+    std::string msg = format_curl_error("POST", url, res, errbuf);
+    github_client_log()->error(msg);
+    throw TransientNetworkError(msg);
+  }
+  // Non-HTTP schemes (e.g. file://) report no status code.
+  if (http_code != 0 && (http_code < 200 || http_code >= 300)) {
+    github_client_log()->error("curl POST {} failed with HTTP code {}", url,
+                               http_code);
+    throw HttpStatusError(static_cast<int>(http_code),
+                          "curl POST failed with HTTP code " +
+                              std::to_string(http_code));
+  }
+  return response;
+}
+
 /**
  * Issue a DELETE request.
  */
 std::string CurlHttpClient::del(const std::string &url,
                                 const std::vector<std::string> &headers) {
-  CURL *curl = curl_.get();
-  curl_easy_reset(curl);
+  CurlHandleLease lease = CurlSharePool::instance().checkout();
+  CURL *curl = lease.get();
   std::string response;
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   apply_proxy(curl, url);
@@ -627,20 +746,7 @@ std::string CurlHttpClient::del(const std::string &url,
   CURLcode res = curl_easy_perform(curl);
   long http_code = 0;
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_off_t dl = 0;
-  curl_off_t ul = 0;
-  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl);
-  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &ul);
-  total_downloaded_ += dl;
-  total_uploaded_ += ul;
-  if (max_download_ > 0 && total_downloaded_ > max_download_) {
-    github_client_log()->error("Maximum download exceeded");
-    throw std::runtime_error("Maximum download exceeded");
-  }
-  if (max_upload_ > 0 && total_uploaded_ > max_upload_) {
-    github_client_log()->error("Maximum upload exceeded");
-    throw std::runtime_error("Maximum upload exceeded");
-  }
+  record_transfer(curl);
   if (res != CURLE_OK) {
     std::string msg = format_curl_error("DELETE", url, res, errbuf);
     github_client_log()->error(msg);
@@ -657,6 +763,30 @@ std::string CurlHttpClient::del(const std::string &url,
 }
 
 namespace {
+/**
+ * Extract the `rel="next"` target from a `Link` response header.
+ *
+ * @return Next page URL, or an empty string on the last page.
+ */
+std::string next_page_url(const std::vector<std::string> &headers) {
+  for (const auto &h : headers) {
+    if (h.rfind("Link:", 0) != 0)
+      continue;
+    std::stringstream ss(h.substr(5));
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+      if (part.find("rel=\"next\"") == std::string::npos)
+        continue;
+      auto start = part.find('<');
+      auto end = part.find('>', start);
+      if (start != std::string::npos && end != std::string::npos) {
+        return part.substr(start + 1, end - start - 1);
+      }
+    }
+  }
+  return {};
+}
+
 /**
  * HTTP client wrapper that retries requests with exponential backoff.
  */
@@ -699,12 +829,21 @@ public:
     return request([&] { return inner_->patch(url, data, headers); });
   }
 
+  /// @copydoc HttpClient::post()
+  std::string post(const std::string &url, const std::string &data,
+                   const std::vector<std::string> &headers) override {
+    return request([&] { return inner_->post(url, data, headers); });
+  }
+
   /// @copydoc HttpClient::del()
   std::string del(const std::string &url,
                   const std::vector<std::string> &headers) override {
     return request([&] { return inner_->del(url, headers); });
   }
 
+  /// Access the wrapped client performing the actual requests.
+  agpm::HttpClient *inner() const { return inner_.get(); }
+
 private:
   /**
    * Execute a request with retry handling.
@@ -765,8 +904,19 @@ GitHubClient::GitHubClient(std::vector<std::string> tokens,
       dry_run_(dry_run), cache_file_(std::move(cache_file)),
       delay_ms_(delay_ms) {
   ensure_default_logger();
-  std::scoped_lock lock(mutex_);
-  load_cache_locked();
+  const std::string json_ext = ".json";
+  if (!cache_file_.empty() &&
+      !(cache_file_.size() >= json_ext.size() &&
+        cache_file_.compare(cache_file_.size() - json_ext.size(),
+                            json_ext.size(), json_ext) == 0)) {
+    cache_log_ = std::make_unique<CacheLog>(cache_file_);
+  }
+  async_http_ = dynamic_cast<AsyncHttpClient *>(
+      static_cast<RetryHttpClient *>(http_.get())->inner());
+  if (async_http_) {
+    github_client_log()->debug("Using asynchronous HTTP engine");
+  }
+  load_cache();
   // Allow configuring cache flush interval via env var AGPM_CACHE_FLUSH_MS
   if (const char *env = std::getenv("AGPM_CACHE_FLUSH_MS")) {
     try {
@@ -784,9 +934,12 @@ GitHubClient::GitHubClient(std::vector<std::string> tokens,
         cache_flusher_cv_.wait_for(lk, cache_flush_interval_);
         if (!cache_flusher_running_.load())
           break;
-        if (cache_dirty_) {
-          std::scoped_lock data_lock(mutex_);
-          save_cache_locked();
+        if (cache_dirty_.load()) {
+          save_cache();
+        }
+        compact_cache();
+        if (!compare_cache_file_.empty()) {
+          compare_cache_.save(compare_cache_file_);
         }
       }
     });
@@ -794,28 +947,118 @@ GitHubClient::GitHubClient(std::vector<std::string> tokens,
 }
 
 /**
- * Persist any cached responses when the client is destroyed.
+ * Stop the background flusher and persist any cached responses when the
+ * client is destroyed.
  */
 GitHubClient::~GitHubClient() {
-  std::scoped_lock lock(mutex_);
-  save_cache_locked();
+  {
+    std::scoped_lock lk(cache_flusher_mutex_);
+    cache_flusher_running_.store(false);
+  }
+  cache_flusher_cv_.notify_all();
+  if (cache_flusher_thread_.joinable()) {
+    cache_flusher_thread_.join();
+  }
+  save_cache();
+  if (!compare_cache_file_.empty()) {
+    compare_cache_.save(compare_cache_file_);
+  }
+}
+
+/**
+ * Build the default authentication and content negotiation headers.
+ *
+ * @param token Receives the index of the token placed in the headers, so a
+ *        rate-limited response can be attributed to it.
+ */
+std::vector<std::string>
+GitHubClient::request_headers(std::size_t *token) const {
+  std::vector<std::string> headers;
+  if (!tokens_.empty()) {
+    const std::size_t index = current_token_index() % tokens_.size();
+    if (token != nullptr) {
+      *token = index;
+    }
+    headers.push_back("Authorization: token " + tokens_[index]);
+  }
+  headers.push_back("Accept: application/vnd.github+json");
+  return headers;
+}
+
+/**
+ * Perform a cached GET, coalescing concurrent identical requests.
+ *
+ * Callers asking for the same URL with the same credentials while a request
+ * is already in flight wait for that request and receive its response
+ * instead of issuing another round-trip. Failures propagate to every waiter.
+ */
+HttpResponse
+GitHubClient::get_with_cache(const std::string &url,
+                             const std::vector<std::string> &headers) {
+  std::string key = url;
+  const auto auth_it = std::find_if(
+      headers.begin(), headers.end(),
+      [](const std::string &h) { return h.rfind("Authorization:", 0) == 0; });
+  if (auth_it != headers.end()) {
+    key += '\n';
+    key += *auth_it;
+  }
+
+  std::promise<HttpResponse> promise;
+  std::shared_future<HttpResponse> pending;
+  {
+    std::scoped_lock lock(inflight_mutex_);
+    auto it = inflight_.find(key);
+    if (it != inflight_.end()) {
+      pending = it->second;
+    } else {
+      inflight_.emplace(key, promise.get_future().share());
+    }
+  }
+  if (pending.valid()) {
+    coalesced_hits_.fetch_add(1);
+    github_client_log()->debug("Joining in-flight request for {}", url);
+    return pending.get();
+  }
+  coalesced_misses_.fetch_add(1);
+
+  auto finish = [this, &key]() {
+    std::scoped_lock lock(inflight_mutex_);
+    inflight_.erase(key);
+  };
+  try {
+    HttpResponse res = fetch_with_cache(url, headers);
+    finish();
+    promise.set_value(res);
+    return res;
+  } catch (...) {
+    finish();
+    promise.set_exception(std::current_exception());
+    throw;
+  }
 }
 
 /**
  * Perform a GET request leveraging an on-disk cache keyed by URL.
+ *
+ * Only the cache shard owning @p url is locked, and only while looking up or
+ * publishing an entry; the HTTP round-trip itself runs unlocked so
+ * concurrent callers never wait on each other's requests.
  */
 HttpResponse
-GitHubClient::get_with_cache_locked(const std::string &url,
-                                    const std::vector<std::string> &headers) {
+GitHubClient::fetch_with_cache(const std::string &url,
+                               const std::vector<std::string> &headers) {
+  EtagCache::EntryPtr cached = cache_.lookup(url);
   std::vector<std::string> hdrs = headers;
-  auto it = cache_.find(url);
-  if (it != cache_.end() && !it->second.etag.empty()) {
-    hdrs.push_back("If-None-Match: " + it->second.etag);
+  if (cached && !cached->etag.empty()) {
+    hdrs.push_back("If-None-Match: " + cached->etag);
   }
   HttpResponse res = http_->get_with_headers(url, hdrs);
-  if (res.status_code == 304 && it != cache_.end()) {
+  if (res.status_code == 304 && cached) {
     github_client_log()->debug("Cache hit for {}", url);
-    return {it->second.body, it->second.headers, 200};
+    cache_.record_revalidation(url);
+    cache_bytes_saved_.fetch_add(cached->body.size());
+    return {cached->body, cached->headers, 200};
   }
   const auto etag_it = std::find_if(
       res.headers.begin(), res.headers.end(),
@@ -824,70 +1067,312 @@ GitHubClient::get_with_cache_locked(const std::string &url,
     std::string etag = etag_it->substr(5);
     if (!etag.empty() && etag[0] == ' ')
       etag.erase(0, 1);
-    cache_[url] = {etag, res.body, res.headers};
-    cache_dirty_ = true;
+    publish_cache_entry(url, std::make_shared<const EtagCache::Entry>(
+                                 EtagCache::Entry{etag, res.body, res.headers}));
   }
   return res;
 }
 
+/**
+ * Store a fresh response in the in-memory cache and queue it for the next
+ * flush.
+ */
+void GitHubClient::publish_cache_entry(const std::string &url,
+                                       EtagCache::EntryPtr entry) {
+  cache_.put(url, entry);
+  if (cache_log_) {
+    std::scoped_lock lock(cache_pending_mutex_);
+    cache_pending_[url] = std::move(entry);
+  }
+  cache_dirty_.store(true);
+}
+
 /**
  * Load cached HTTP responses from disk.
+ *
+ * A binary cache log is replayed record by record; a JSON file at the same
+ * path is imported once and rewritten as a compacted log. Any other
+ * non-empty file is replaced by an empty log so later appends stay readable.
  */
-void GitHubClient::load_cache_locked() {
+void GitHubClient::load_cache() {
   if (cache_file_.empty())
     return;
-  std::ifstream in(cache_file_);
-  if (!in)
+  if (!cache_log_) {
+    import_cache_json(cache_file_);
+    cache_dirty_.store(false);
+    return;
+  }
+  std::scoped_lock file_lock(cache_file_mutex_);
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(cache_file_, ec);
+  if (!ec && size > 0 && !CacheLog::is_cache_log(cache_file_)) {
+    if (import_cache_json(cache_file_)) {
+      github_client_log()->info("Converting JSON cache {} to a cache log",
+                                cache_file_);
+    } else {
+      github_client_log()->warn(
+          "Cache file {} is neither a cache log nor a JSON cache; "
+          "replacing it with an empty cache log",
+          cache_file_);
+    }
+    if (cache_log_->compact(cache_.snapshot())) {
+      std::scoped_lock lock(cache_pending_mutex_);
+      cache_pending_.clear();
+      cache_dirty_.store(false);
+    }
     return;
-  nlohmann::json j;
+  }
+  std::size_t records =
+      cache_log_->load([this](std::string url, EtagCache::Entry entry) {
+        cache_.put(url,
+                   std::make_shared<const EtagCache::Entry>(std::move(entry)));
+      });
+  github_client_log()->debug("Loaded {} cache log records from {}", records,
+                             cache_file_);
+}
+
+/**
+ * Append queued entries to the cache log. Requires `cache_file_mutex_`.
+ *
+ * @return True when the queue was written; on failure the entries are put
+ *         back so the next flush retries them.
+ */
+bool GitHubClient::append_pending_locked() {
+  std::unordered_map<std::string, EtagCache::EntryPtr> pending;
+  {
+    std::scoped_lock lock(cache_pending_mutex_);
+    pending.swap(cache_pending_);
+  }
+  std::vector<CacheLog::Record> records(pending.begin(), pending.end());
+  if (cache_log_->append(records)) {
+    return true;
+  }
+  std::scoped_lock lock(cache_pending_mutex_);
+  // Keep anything published meanwhile; it is newer than the failed batch.
+  pending.merge(cache_pending_);
+  cache_pending_.swap(pending);
+  return false;
+}
+
+/**
+ * Persist cached HTTP responses to disk.
+ *
+ * With a cache log only entries changed since the last flush are appended.
+ * A JSON cache file is rewritten from a snapshot taken shard by shard. File
+ * I/O never blocks in-flight requests.
+ */
+void GitHubClient::save_cache() {
+  if (cache_file_.empty())
+    return;
+  std::scoped_lock file_lock(cache_file_mutex_);
+  // Clear the flag before snapshotting so entries published concurrently
+  // mark the cache dirty again for the next flush.
+  cache_dirty_.store(false);
+  bool ok = cache_log_ ? append_pending_locked()
+                       : export_cache_json(cache_file_);
+  if (ok) {
+    last_cache_save_ = std::chrono::steady_clock::now();
+  } else {
+    cache_dirty_.store(true);
+  }
+}
+
+/**
+ * Rewrite the cache log with only live entries once superseded records
+ * dominate it. Runs on the flusher thread.
+ */
+void GitHubClient::compact_cache() {
+  if (!cache_log_)
+    return;
+  std::scoped_lock file_lock(cache_file_mutex_);
+  if (!cache_log_->should_compact(cache_.totals().entries))
+    return;
+  if (!append_pending_locked())
+    return;
+  cache_log_->compact(cache_.snapshot());
+}
+
+/// @copydoc GitHubClient::export_cache_json
+bool GitHubClient::export_cache_json(const std::string &path) const {
+  nlohmann::json j = nlohmann::json::object();
+  for (const auto &[url, c] : cache_.snapshot()) {
+    j[url] = {{"etag", c->etag}, {"body", c->body}, {"headers", c->headers}};
+  }
+  std::ofstream out(path);
+  if (!out)
+    return false;
+  out << j.dump();
+  return static_cast<bool>(out);
+}
+
+/// @copydoc GitHubClient::import_cache_json
+bool GitHubClient::import_cache_json(const std::string &path) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
   try {
+    nlohmann::json j;
     in >> j;
     for (auto &[url, entry] : j.items()) {
-      CachedResponse c;
+      EtagCache::Entry c;
       c.etag = entry.value("etag", "");
       c.body = entry.value("body", "");
       c.headers = entry.value("headers", std::vector<std::string>{});
-      cache_[url] = std::move(c);
+      publish_cache_entry(
+          url, std::make_shared<const EtagCache::Entry>(std::move(c)));
     }
   } catch (...) {
+    return false;
   }
+  return true;
 }
 
 /**
- * Serialize cached HTTP responses to disk.
+ * Update the minimum delay enforced between HTTP requests.
  */
-void GitHubClient::save_cache_locked() {
-  if (cache_file_.empty())
-    return;
-  nlohmann::json j;
-  for (const auto &[url, c] : cache_) {
-    j[url] = {{"etag", c.etag}, {"body", c.body}, {"headers", c.headers}};
-  }
-  std::ofstream out(cache_file_);
-  if (out) {
-    out << j.dump();
-    cache_dirty_ = false;
-    last_cache_save_ = std::chrono::steady_clock::now();
+void GitHubClient::set_delay_ms(int delay_ms) { delay_ms_.store(delay_ms); }
+
+/// @copydoc GitHubClient::set_local_clones
+void GitHubClient::set_local_clones(
+    std::unordered_map<std::string, std::string> git_dirs) {
+  std::scoped_lock lock(local_clones_mutex_);
+  local_clone_dirs_ = std::move(git_dirs);
+  local_clones_.clear();
+}
+
+/**
+ * Open the local clone registered for @p owner/@p repo on first use.
+ *
+ * @return Usable clone, or null when none is registered or it cannot be read.
+ */
+std::shared_ptr<LocalGitRepository>
+GitHubClient::local_clone(const std::string &owner, const std::string &repo) {
+  std::scoped_lock lock(local_clones_mutex_);
+  const std::string key = owner + "/" + repo;
+  auto it = local_clones_.find(key);
+  if (it == local_clones_.end()) {
+    auto dir = local_clone_dirs_.find(key);
+    if (dir == local_clone_dirs_.end()) {
+      return nullptr;
+    }
+    auto clone = std::make_shared<LocalGitRepository>(dir->second);
+    if (!clone->usable()) {
+      clone.reset();
+    }
+    it = local_clones_.emplace(key, std::move(clone)).first;
+  }
+  return it->second;
+}
+
+/// @copydoc GitHubClient::set_task_runner
+void GitHubClient::set_task_runner(TaskRunner runner, RateGate rate_gate) {
+  std::scoped_lock lock(task_runner_mutex_);
+  task_runner_ = std::move(runner);
+  rate_gate_ = std::move(rate_gate);
+}
+
+/**
+ * Block until the rate gate admits one more request.
+ *
+ * @return True without a gate; false when the gate's owner is stopping.
+ */
+bool GitHubClient::pass_rate_gate() {
+  RateGate gate;
+  {
+    std::scoped_lock lock(task_runner_mutex_);
+    gate = rate_gate_;
   }
+  return !gate || gate();
 }
 
 /**
- * Update the minimum delay enforced between HTTP requests.
+ * Submit every task to the task runner, then walk them in order: tasks no
+ * worker has claimed yet run on the calling thread, the rest are awaited.
+ * Without a runner the tasks simply run in sequence. Tasks run on the
+ * calling thread pass the rate gate first, as a worker would have taken a
+ * token before running them.
  */
-void GitHubClient::set_delay_ms(int delay_ms) {
-  std::scoped_lock lock(mutex_);
-  delay_ms_ = delay_ms;
+void GitHubClient::run_subtasks(
+    std::vector<std::pair<std::string, std::function<void()>>> tasks) {
+  TaskRunner runner;
+  {
+    std::scoped_lock lock(task_runner_mutex_);
+    runner = task_runner_;
+  }
+  auto run_inline = [this](std::pair<std::string, std::function<void()>> &task) {
+    if (!pass_rate_gate()) {
+      github_client_log()->debug("Skipping sub-job {}: requests stopped",
+                                 task.first);
+      return;
+    }
+    task.second();
+  };
+  if (!runner || tasks.size() < 2) {
+    for (auto &task : tasks) {
+      run_inline(task);
+    }
+    return;
+  }
+  struct Slot {
+    std::pair<std::string, std::function<void()>> task;
+    std::atomic<bool> claimed{false};
+  };
+  std::vector<std::shared_ptr<Slot>> slots;
+  std::vector<std::future<void>> futures;
+  slots.reserve(tasks.size());
+  futures.reserve(tasks.size());
+  for (auto &task : tasks) {
+    auto slot = std::make_shared<Slot>();
+    slot->task = std::move(task);
+    slots.push_back(slot);
+    try {
+      futures.push_back(runner(slot->task.first, [slot] {
+        if (!slot->claimed.exchange(true)) {
+          slot->task.second();
+        }
+      }));
+    } catch (const std::exception &e) {
+      github_client_log()->debug("Failed to schedule sub-job: {}", e.what());
+      futures.emplace_back();
+    }
+  }
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    if (!slots[i]->claimed.exchange(true)) {
+      run_inline(slots[i]->task);
+    } else if (futures[i].valid()) {
+      try {
+        futures[i].get();
+      } catch (const std::exception &e) {
+        github_client_log()->debug("Sub-job failed: {}", e.what());
+      }
+    }
+  }
 }
 
 // Flush cache immediately (thread-safe public API)
 void GitHubClient::flush_cache() {
-  std::scoped_lock lock(mutex_);
-  save_cache_locked();
+  save_cache();
+  if (!compare_cache_file_.empty()) {
+    compare_cache_.save(compare_cache_file_);
+  }
+}
+
+/// @copydoc GitHubClient::set_compare_cache_file
+void GitHubClient::set_compare_cache_file(std::string path) {
+  // The flusher thread reads the path while holding this mutex.
+  std::scoped_lock lk(cache_flusher_mutex_);
+  compare_cache_file_ = std::move(path);
+  if (!compare_cache_file_.empty()) {
+    compare_cache_.load(compare_cache_file_);
+  }
 }
 
 void GitHubClient::set_cache_flush_interval(
     std::chrono::milliseconds interval) {
-  cache_flush_interval_ = interval;
+  {
+    std::scoped_lock lk(cache_flusher_mutex_);
+    cache_flush_interval_ = interval;
+  }
   cache_flusher_cv_.notify_all();
 }
 
@@ -914,30 +1399,19 @@ GitHubClient::list_repositories() {
   std::string url = api_base_ + "/user/repos?per_page=100";
 
   while (true) {
-    // Build headers and url under lock, then release before network I/O.
-    std::vector<std::string> headers;
-    {
-      std::scoped_lock lock(mutex_);
-      if (!tokens_.empty()) {
-        size_t ti;
-        {
-          std::scoped_lock rs_lock(rate_state_mutex_);
-          ti = token_index_;
-        }
-        headers.push_back("Authorization: token " + tokens_[ti]);
-      }
-      headers.push_back("Accept: application/vnd.github+json");
-    }
+    // Rebuild headers every page so a rotated token takes effect.
+    std::size_t token = 0;
+    std::vector<std::string> headers = request_headers(&token);
 
     enforce_delay();
     HttpResponse res;
     try {
-      res = get_with_cache_locked(url, headers);
+      res = get_with_cache(url, headers);
     } catch (const std::exception &e) {
       github_client_log()->error("HTTP GET failed: {}", e.what());
       break;
     }
-    if (handle_rate_limit(res))
+    if (handle_rate_limit(res, token))
       continue;
     if (res.status_code < 200 || res.status_code >= 300) {
       github_client_log()->error("HTTP GET {} failed with HTTP code {}", url,
@@ -991,8 +1465,16 @@ GitHubClient::list_repositories() {
 std::vector<PullRequest>
 GitHubClient::list_pull_requests(const std::string &owner,
                                  const std::string &repo, bool include_merged,
-                                 int per_page, std::chrono::seconds since) {
-  std::scoped_lock lock(mutex_);
+                                 int per_page, std::chrono::seconds since,
+                                 bool *complete) {
+  if (complete) {
+    *complete = true;
+  }
+  auto fail = [complete] {
+    if (complete) {
+      *complete = false;
+    }
+  };
   if (!repo_allowed(owner, repo)) {
     return {};
   }
@@ -1010,32 +1492,28 @@ GitHubClient::list_pull_requests(const std::string &owner,
   if (!query.empty()) {
     url += "?" + query;
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::size_t token = 0;
+  std::vector<std::string> headers = request_headers(&token);
   auto cutoff = std::chrono::system_clock::now() - since;
   std::vector<PullRequest> prs;
   while (true) {
     enforce_delay();
     HttpResponse res;
     try {
-      res = get_with_cache_locked(url, headers);
+      res = get_with_cache(url, headers);
     } catch (const std::exception &e) {
       github_client_log()->error("HTTP GET failed: {}", e.what());
+      fail();
       break;
     }
-    if (handle_rate_limit(res))
+    if (handle_rate_limit(res, token)) {
+      headers = request_headers(&token);
       continue;
+    }
     if (res.status_code < 200 || res.status_code >= 300) {
       github_client_log()->error("HTTP GET {} failed with HTTP code {}", url,
                                  res.status_code);
+      fail();
       break;
     }
     nlohmann::json j;
@@ -1044,6 +1522,7 @@ GitHubClient::list_pull_requests(const std::string &owner,
     } catch (const std::exception &e) {
       github_client_log()->error("Failed to parse pull request list: {}",
                                  e.what());
+      fail();
       auto num_pos = res.body.find("\"number\"");
       auto title_pos = res.body.find("\"title\"");
       if (num_pos != std::string::npos && title_pos != std::string::npos) {
@@ -1101,6 +1580,7 @@ GitHubClient::list_pull_requests(const std::string &owner,
       bool merged = item.contains("merged_at") && !item["merged_at"].is_null();
       PullRequest pr{item["number"].get<int>(),
                      item["title"].get<std::string>(), merged, owner, repo};
+      read_pull_request_revision(item, pr);
       prs.push_back(pr);
       if (static_cast<int>(prs.size()) >= limit)
         break;
@@ -1128,15 +1608,110 @@ GitHubClient::list_pull_requests(const std::string &owner,
       break;
     url = next_url;
   }
-  return prs;
+  return prs;
+}
+
+/// @copydoc GitHubClient::list_pull_requests_since
+std::optional<PullRequestDelta>
+GitHubClient::list_pull_requests_since(const std::string &owner,
+                                       const std::string &repo,
+                                       const std::string &watermark,
+                                       int per_page) {
+  if (!repo_allowed(owner, repo)) {
+    return std::nullopt;
+  }
+  int limit = per_page > 0 ? std::min(per_page, 100) : 50;
+  // A full listing only needs open pull requests; a delta also needs the
+  // ones closed since the mark so they can be dropped from the snapshot.
+  std::string url = api_base_ + "/repos/" + owner + "/" + repo +
+                    "/pulls?state=" + (watermark.empty() ? "open" : "all") +
+                    "&sort=updated&direction=desc&per_page=" +
+                    std::to_string(limit);
+  std::size_t token = 0;
+  std::vector<std::string> headers = request_headers(&token);
+  PullRequestDelta delta;
+  delta.watermark = watermark;
+  while (true) {
+    enforce_delay();
+    HttpResponse res;
+    try {
+      res = get_with_cache(url, headers);
+    } catch (const std::exception &e) {
+      github_client_log()->error("HTTP GET failed: {}", e.what());
+      return std::nullopt;
+    }
+    if (handle_rate_limit(res, token)) {
+      headers = request_headers(&token);
+      continue;
+    }
+    if (res.status_code < 200 || res.status_code >= 300) {
+      github_client_log()->error("HTTP GET {} failed with HTTP code {}", url,
+                                 res.status_code);
+      return std::nullopt;
+    }
+    ++delta.pages;
+    bool reached_mark = false;
+    try {
+      auto j = nlohmann::json::parse(res.body);
+      if (!j.is_array()) {
+        github_client_log()->error("Unexpected pull request list for {}/{}",
+                                   owner, repo);
+        return std::nullopt;
+      }
+      for (const auto &item : j) {
+        std::string updated = item.value("updated_at", std::string{});
+        // ISO-8601 UTC timestamps order lexicographically. Pull requests
+        // updated in the same second as the mark are re-read, not skipped.
+        if (!watermark.empty() && !updated.empty() && updated < watermark) {
+          reached_mark = true;
+          break;
+        }
+        if (updated > delta.watermark) {
+          delta.watermark = updated;
+        }
+        bool merged = item.contains("merged_at") && !item["merged_at"].is_null();
+        PullRequest pr{item.at("number").get<int>(),
+                       item.value("title", std::string{}), merged, owner,
+                       repo};
+        read_pull_request_revision(item, pr);
+        if (item.value("state", std::string{"open"}) == "open") {
+          delta.open.push_back(std::move(pr));
+        } else {
+          delta.closed.push_back(std::move(pr));
+        }
+      }
+    } catch (const std::exception &e) {
+      github_client_log()->error("Failed to parse pull request list: {}",
+                                 e.what());
+      return std::nullopt;
+    }
+    if (reached_mark)
+      break;
+    std::string next_url = next_page_url(res.headers);
+    if (next_url.empty())
+      break;
+    url = next_url;
+  }
+  github_client_log()->debug(
+      "Incremental listing of {}/{}: {} open, {} closed in {} page(s)", owner,
+      repo, delta.open.size(), delta.closed.size(), delta.pages);
+  return delta;
 }
 
 /// @copydoc GitHubClient::list_open_pull_requests_single
 std::vector<PullRequest>
 GitHubClient::list_open_pull_requests_single(const std::string &owner_repo,
-                                             int per_page) {
-  std::scoped_lock lock(mutex_);
+                                             int per_page,
+                                             bool *complete) {
   std::vector<PullRequest> prs;
+  if (complete) {
+    *complete = true;
+  }
+  auto fail = [complete] {
+    if (complete) {
+      *complete = false;
+    }
+  };
   auto pos = owner_repo.find('/');
   if (pos == std::string::npos) {
     return prs;
@@ -1148,16 +1723,7 @@ GitHubClient::list_open_pull_requests_single(const std::string &owner_repo,
   }
   std::string url = api_base_ + "/repos/" + owner + "/" + repo +
                     "/pulls?state=open&per_page=" + std::to_string(per_page);
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   enforce_delay();
   HttpResponse res;
   try {
@@ -1166,11 +1732,13 @@ GitHubClient::list_open_pull_requests_single(const std::string &owner_repo,
   } catch (const std::exception &e) {
     github_client_log()->error("Failed to fetch open pull requests: {}",
                                e.what());
+    fail();
     return prs;
   }
   try {
     auto j = nlohmann::json::parse(res.body);
     if (!j.is_array()) {
+      fail();
       return prs;
     }
     for (const auto &item : j) {
@@ -1182,11 +1750,13 @@ GitHubClient::list_open_pull_requests_single(const std::string &owner_repo,
       pr.merged = false;
       pr.owner = owner;
       pr.repo = repo;
+      read_pull_request_revision(item, pr);
       prs.push_back(std::move(pr));
     }
   } catch (const std::exception &e) {
     github_client_log()->error("Failed to parse pull request list: {}",
                                e.what());
+    fail();
   }
   return prs;
 }
@@ -1195,33 +1765,18 @@ GitHubClient::list_open_pull_requests_single(const std::string &owner_repo,
 std::optional<PullRequestMetadata>
 GitHubClient::pull_request_metadata(const std::string &owner,
                                     const std::string &repo, int pr_number) {
-  std::scoped_lock lock(mutex_);
-  return pull_request_metadata_locked(owner, repo, pr_number);
-}
-
-std::optional<PullRequestMetadata> GitHubClient::pull_request_metadata_locked(
-    const std::string &owner, const std::string &repo, int pr_number) {
   if (!repo_allowed(owner, repo)) {
     github_client_log()->debug(
         "Skipping metadata fetch for disallowed repo {}/{}", owner, repo);
     return std::nullopt;
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   enforce_delay();
   std::string pr_url = api_base_ + "/repos/" + owner + "/" + repo + "/pulls/" +
                        std::to_string(pr_number);
   nlohmann::json meta_json;
   try {
-    std::string pr_resp = get_with_cache_locked(pr_url, headers).body;
+    std::string pr_resp = get_with_cache(pr_url, headers).body;
     meta_json = nlohmann::json::parse(pr_resp);
   } catch (const std::exception &e) {
     github_client_log()->error("Failed to fetch pull request metadata: {}",
@@ -1251,7 +1806,6 @@ std::optional<PullRequestMetadata> GitHubClient::pull_request_metadata_locked(
 /// @copydoc GitHubClient::merge_pull_request
 bool GitHubClient::merge_pull_request(const std::string &owner,
                                       const std::string &repo, int pr_number) {
-  std::scoped_lock lock(mutex_);
   return merge_pull_request_internal(owner, repo, pr_number, nullptr);
 }
 
@@ -1259,7 +1813,6 @@ bool GitHubClient::merge_pull_request(const std::string &owner,
 bool GitHubClient::merge_pull_request(const std::string &owner,
                                       const std::string &repo, int pr_number,
                                       const PullRequestMetadata &metadata) {
-  std::scoped_lock lock(mutex_);
   return merge_pull_request_internal(owner, repo, pr_number, &metadata);
 }
 
@@ -1273,20 +1826,11 @@ bool GitHubClient::merge_pull_request_internal(
   }
   github_client_log()->info("Attempting to merge PR #{} in {}/{}", pr_number,
                             owner, repo);
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   const PullRequestMetadata *meta_ptr = metadata;
   std::optional<PullRequestMetadata> fetched_metadata;
   if (!meta_ptr) {
-    auto details = pull_request_metadata_locked(owner, repo, pr_number);
+    auto details = pull_request_metadata(owner, repo, pr_number);
     if (!details) {
       return false;
     }
@@ -1294,9 +1838,10 @@ bool GitHubClient::merge_pull_request_internal(
     meta_ptr = &*fetched_metadata;
   }
   const PullRequestMetadata &meta = *meta_ptr;
-  if (required_approvals_ > 0 && meta.approvals < required_approvals_) {
+  const int required_approvals = required_approvals_.load();
+  if (required_approvals > 0 && meta.approvals < required_approvals) {
     github_client_log()->info("PR #{} requires {} approvals but has {}",
-                              pr_number, required_approvals_, meta.approvals);
+                              pr_number, required_approvals, meta.approvals);
     return false;
   }
   if (require_status_success_ &&
@@ -1336,7 +1881,6 @@ bool GitHubClient::merge_pull_request_internal(
 
 bool GitHubClient::close_pull_request(const std::string &owner,
                                       const std::string &repo, int pr_number) {
-  std::scoped_lock lock(mutex_);
   if (!repo_allowed(owner, repo)) {
     github_client_log()->debug("Skipping close for disallowed repo {}/{}",
                                owner, repo);
@@ -1349,16 +1893,7 @@ bool GitHubClient::close_pull_request(const std::string &owner,
                               pr_number, owner, repo);
     return true;
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   headers.push_back("Content-Type: application/json");
   enforce_delay();
   std::string url = api_base_ + "/repos/" + owner + "/" + repo + "/pulls/" +
@@ -1388,7 +1923,6 @@ bool GitHubClient::delete_branch(
     const std::string &branch,
     const std::vector<std::string> &protected_branches,
     const std::vector<std::string> &protected_branch_excludes) {
-  std::scoped_lock lock(mutex_);
   if (!repo_allowed(owner, repo)) {
     github_client_log()->debug(
         "Skipping branch delete for disallowed repo {}/{}", owner, repo);
@@ -1413,11 +1947,7 @@ bool GitHubClient::delete_branch(
     return false;
   }
 
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    headers.push_back("Authorization: token " + tokens_[current_token_index()]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
 
   std::string url = api_base_ + "/repos/" + owner + "/" + repo +
                     "/git/refs/heads/" + encode_ref_segment(branch);
@@ -1444,9 +1974,10 @@ bool GitHubClient::delete_branch(
 
 /// @copydoc GitHubClient::list_branches
 std::vector<std::string>
-GitHubClient::list_branches(const std::string &owner, const std::string &repo,
-                            std::string *default_branch_out) {
-  std::scoped_lock lock(mutex_);
+GitHubClient::list_branches(
+    const std::string &owner, const std::string &repo,
+    std::string *default_branch_out,
+    std::unordered_map<std::string, std::string> *branch_shas) {
   std::vector<std::string> branches;
   if (!repo_allowed(owner, repo)) {
     return branches;
@@ -1454,21 +1985,15 @@ GitHubClient::list_branches(const std::string &owner, const std::string &repo,
   if (default_branch_out) {
     *default_branch_out = std::string{};
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
+  if (branch_shas) {
+    branch_shas->clear();
   }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   enforce_delay();
   std::string repo_url = api_base_ + "/repos/" + owner + "/" + repo;
   std::string repo_resp;
   try {
-    repo_resp = get_with_cache_locked(repo_url, headers).body;
+    repo_resp = get_with_cache(repo_url, headers).body;
   } catch (const std::exception &e) {
     github_client_log()->error("Failed to fetch repo metadata: {}", e.what());
     return branches;
@@ -1489,7 +2014,7 @@ GitHubClient::list_branches(const std::string &owner, const std::string &repo,
     enforce_delay();
     HttpResponse res;
     try {
-      res = get_with_cache_locked(url, headers);
+      res = get_with_cache(url, headers);
     } catch (const std::exception &e) {
       github_client_log()->error("Failed to fetch branches: {}", e.what());
       return branches;
@@ -1509,6 +2034,10 @@ GitHubClient::list_branches(const std::string &owner, const std::string &repo,
         continue;
       }
       std::string branch = b["name"].get<std::string>();
+      if (branch_shas && b.contains("commit") && b["commit"].is_object() &&
+          b["commit"].contains("sha") && b["commit"]["sha"].is_string()) {
+        (*branch_shas)[branch] = b["commit"]["sha"].get<std::string>();
+      }
       if (branch != default_branch) {
         branches.push_back(branch);
       }
@@ -1545,8 +2074,8 @@ std::vector<std::string> GitHubClient::detect_stray_branches(
     const std::string &owner, const std::string &repo,
     const std::string &default_branch, const std::vector<std::string> &branches,
     const std::vector<std::string> &protected_branches,
-    const std::vector<std::string> &protected_branch_excludes) {
-  std::scoped_lock lock(mutex_);
+    const std::vector<std::string> &protected_branch_excludes,
+    const std::unordered_map<std::string, std::string> *branch_shas) {
   std::vector<std::string> stray;
   if (!repo_allowed(owner, repo) || default_branch.empty()) {
     return stray;
@@ -1554,16 +2083,7 @@ std::vector<std::string> GitHubClient::detect_stray_branches(
   if (branches.empty()) {
     return stray;
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   const std::string repo_url = api_base_ + "/repos/" + owner + "/" + repo;
   const auto now = std::chrono::system_clock::now();
   constexpr auto kStaleThreshold = std::chrono::hours(24 * 30);
@@ -1600,6 +2120,21 @@ std::vector<std::string> GitHubClient::detect_stray_branches(
     }
     return std::nullopt;
   };
+  auto compare_url_for = [&](const std::string &branch) {
+    return repo_url + "/compare/" + encode_ref_segment(default_branch) +
+           "..." + encode_ref_segment(branch);
+  };
+  auto sha_of = [branch_shas](const std::string &branch) -> std::string {
+    if (branch_shas == nullptr) {
+      return {};
+    }
+    auto it = branch_shas->find(branch);
+    return it != branch_shas->end() ? it->second : std::string{};
+  };
+  const std::string base_sha = sha_of(default_branch);
+  auto local = base_sha.empty() ? nullptr : local_clone(owner, repo);
+  std::vector<std::string> candidates;
+  std::unordered_map<std::string, BranchCompareCache::Comparison> cached;
   for (const auto &branch : branches) {
     if (branch.empty() || branch == default_branch) {
       continue;
@@ -1611,36 +2146,89 @@ std::vector<std::string> GitHubClient::detect_stray_branches(
                             protected_branch_excludes)) {
       continue;
     }
-    int ahead_by = 0;
-    int behind_by = 0;
-    (void)behind_by;
-    std::string status;
-    try {
+    candidates.push_back(branch);
+    std::string head_sha = sha_of(branch);
+    if (!base_sha.empty() && !head_sha.empty()) {
+      if (auto hit = compare_cache_.lookup(base_sha, head_sha)) {
+        cached.emplace(branch, std::move(*hit));
+      } else if (local) {
+        if (auto comparison = local->compare(base_sha, head_sha)) {
+          ++local_comparisons_;
+          compare_cache_.store(base_sha, head_sha, *comparison);
+          cached.emplace(branch, std::move(*comparison));
+        }
+      }
+    }
+  }
+  // With an asynchronous engine comparisons are put in flight up front and
+  // collected below instead of paying one round-trip per branch. Each one
+  // passes the rate gate first; the rest are fetched by the sub-jobs.
+  std::unordered_map<std::string, std::future<HttpResponse>> pending_compares;
+  if (async_http_) {
+    for (const auto &branch : candidates) {
+      if (cached.count(branch) != 0) {
+        continue;
+      }
+      if (!pass_rate_gate()) {
+        break;
+      }
       enforce_delay();
-      std::string compare_url = repo_url + "/compare/" +
-                                encode_ref_segment(default_branch) + "..." +
-                                encode_ref_segment(branch);
-      std::string compare_resp = http_->get(compare_url, headers);
-      nlohmann::json compare_json = nlohmann::json::parse(compare_resp);
-      if (compare_json.is_object()) {
-        ahead_by = compare_json.value("ahead_by", 0);
-        behind_by = compare_json.value("behind_by", 0);
-        status = compare_json.value("status", std::string{});
+      pending_compares.emplace(
+          branch, async_http_->get_async(compare_url_for(branch), headers));
+    }
+  }
+  struct Fetched {
+    BranchCompareCache::Comparison comparison;
+    std::optional<std::chrono::system_clock::time_point> last_commit_time;
+  };
+  auto fetch_branch = [&](const std::string &branch) {
+    Fetched result;
+    bool compared = false;
+    bool described = false;
+    try {
+      std::optional<HttpResponse> compare_resp;
+      auto pending = pending_compares.find(branch);
+      if (pending != pending_compares.end()) {
+        try {
+          compare_resp = pending->second.get();
+        } catch (const std::exception &e) {
+          github_client_log()->debug(
+              "Async compare for {} failed, retrying synchronously: {}",
+              branch, e.what());
+        }
+      }
+      if (!compare_resp) {
+        enforce_delay();
+        compare_resp =
+            http_->get_with_headers(compare_url_for(branch), headers);
+      }
+      // Rate-limit and other error bodies are JSON objects too; they must
+      // never be taken, let alone cached, as a comparison.
+      if (compare_resp->status_code < 200 || compare_resp->status_code >= 300) {
+        github_client_log()->debug("Compare for {} returned HTTP {}", branch,
+                                   compare_resp->status_code);
+      } else {
+        nlohmann::json compare_json = nlohmann::json::parse(compare_resp->body);
+        if (compare_json.is_object()) {
+          result.comparison.ahead_by = compare_json.value("ahead_by", 0);
+          result.comparison.behind_by = compare_json.value("behind_by", 0);
+          result.comparison.status =
+              compare_json.value("status", std::string{});
+          compared = compare_json.contains("ahead_by") &&
+                     compare_json.contains("status") &&
+                     compare_json["status"].is_string() &&
+                     !result.comparison.status.empty();
+        }
       }
     } catch (const std::exception &e) {
       github_client_log()->debug("Failed to compare branch {}: {}", branch,
                                  e.what());
     }
-    bool identical = status == "identical";
-    bool behind_only =
-        ahead_by == 0 && (status == "behind" || status == "identical");
-    bool diverged_without_commits = (status == "diverged" && ahead_by == 0);
-    std::optional<std::chrono::system_clock::time_point> last_commit_time;
     try {
       enforce_delay();
       std::string branch_url =
           repo_url + "/branches/" + encode_ref_segment(branch);
-      HttpResponse branch_resp = get_with_cache_locked(branch_url, headers);
+      HttpResponse branch_resp = get_with_cache(branch_url, headers);
       nlohmann::json branch_json = nlohmann::json::parse(branch_resp.body);
       if (branch_json.is_object() && branch_json.contains("commit") &&
           branch_json["commit"].is_object()) {
@@ -1649,17 +2237,69 @@ std::vector<std::string> GitHubClient::detect_stray_branches(
             commit_wrapper["commit"].is_object()) {
           const auto &commit_details = commit_wrapper["commit"];
           if (commit_details.contains("committer")) {
-            last_commit_time = extract_commit_time(commit_details["committer"]);
+            result.last_commit_time =
+                extract_commit_time(commit_details["committer"]);
           }
-          if (!last_commit_time && commit_details.contains("author")) {
-            last_commit_time = extract_commit_time(commit_details["author"]);
+          if (!result.last_commit_time && commit_details.contains("author")) {
+            result.last_commit_time =
+                extract_commit_time(commit_details["author"]);
           }
         }
+        described = true;
       }
     } catch (const std::exception &e) {
       github_client_log()->debug("Failed to fetch branch metadata for {}: {}",
                                  branch, e.what());
     }
+    std::string head_sha = sha_of(branch);
+    if (compared && described && !base_sha.empty() && !head_sha.empty()) {
+      if (result.last_commit_time) {
+        result.comparison.last_commit =
+            std::chrono::duration_cast<std::chrono::seconds>(
+                result.last_commit_time->time_since_epoch())
+                .count();
+      }
+      compare_cache_.store(base_sha, head_sha, result.comparison);
+    }
+    return result;
+  };
+  // Uncached branches are fetched as independent sub-jobs; the heuristics
+  // below only run once every result is in, in candidate order.
+  std::vector<std::string> to_fetch;
+  for (const auto &branch : candidates) {
+    if (cached.count(branch) == 0) {
+      to_fetch.push_back(branch);
+    }
+  }
+  std::vector<Fetched> fetched(to_fetch.size());
+  std::vector<std::pair<std::string, std::function<void()>>> tasks;
+  tasks.reserve(to_fetch.size());
+  for (std::size_t i = 0; i < to_fetch.size(); ++i) {
+    tasks.emplace_back(owner + "/" + repo + " compare " + to_fetch[i],
+                       [&, i] { fetched[i] = fetch_branch(to_fetch[i]); });
+  }
+  run_subtasks(std::move(tasks));
+  std::size_t next_fetched = 0;
+  for (const auto &branch : candidates) {
+    BranchCompareCache::Comparison comparison;
+    std::optional<std::chrono::system_clock::time_point> last_commit_time;
+    if (auto hit = cached.find(branch); hit != cached.end()) {
+      comparison = hit->second;
+      if (comparison.last_commit != 0) {
+        last_commit_time = std::chrono::system_clock::from_time_t(
+            static_cast<std::time_t>(comparison.last_commit));
+      }
+    } else {
+      comparison = std::move(fetched[next_fetched].comparison);
+      last_commit_time = fetched[next_fetched].last_commit_time;
+      ++next_fetched;
+    }
+    const int ahead_by = comparison.ahead_by;
+    const std::string &status = comparison.status;
+    bool identical = status == "identical";
+    bool behind_only =
+        ahead_by == 0 && (status == "behind" || status == "identical");
+    bool diverged_without_commits = (status == "diverged" && ahead_by == 0);
     bool stale = false;
     if (last_commit_time && *last_commit_time < now) {
       stale = now - *last_commit_time > kStaleThreshold;
@@ -1696,16 +2336,7 @@ GitHubClient::list_branches_single(const std::string &owner_repo,
   }
   std::string url = api_base_ + "/repos/" + owner + "/" + repo +
                     "/branches?per_page=" + std::to_string(per_page);
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   enforce_delay();
   HttpResponse res;
   try {
@@ -1736,7 +2367,6 @@ std::vector<std::string> GitHubClient::cleanup_branches(
     const std::string &prefix,
     const std::vector<std::string> &protected_branches,
     const std::vector<std::string> &protected_branch_excludes) {
-  std::scoped_lock lock(mutex_);
   std::vector<std::string> deleted;
   if (!repo_allowed(owner, repo) || prefix.empty()) {
     github_client_log()->debug("Skipping branch cleanup for {}/{}", owner,
@@ -1753,20 +2383,11 @@ std::vector<std::string> GitHubClient::cleanup_branches(
                             owner, repo, prefix);
   std::string repo_url = api_base_ + "/repos/" + owner + "/" + repo;
   std::string url = repo_url + "/pulls?state=closed";
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
   std::string default_branch;
   if (!allow_delete_base_branch_) {
     try {
-      auto repo_res = get_with_cache_locked(repo_url, headers);
+      auto repo_res = get_with_cache(repo_url, headers);
       auto repo_json = nlohmann::json::parse(repo_res.body);
       if (repo_json.is_object() && repo_json.contains("default_branch")) {
         default_branch = repo_json["default_branch"].get<std::string>();
@@ -1781,7 +2402,7 @@ std::vector<std::string> GitHubClient::cleanup_branches(
     enforce_delay();
     HttpResponse res;
     try {
-      res = get_with_cache_locked(url, headers);
+      res = get_with_cache(url, headers);
     } catch (const std::exception &e) {
       github_client_log()->error(
           "Failed to fetch pull requests for cleanup: {}", e.what());
@@ -1865,20 +2486,10 @@ void GitHubClient::close_dirty_branches(
     const std::string &owner, const std::string &repo,
     const std::vector<std::string> &protected_branches,
     const std::vector<std::string> &protected_branch_excludes) {
-  std::scoped_lock lock(mutex_);
   if (!repo_allowed(owner, repo)) {
     return;
   }
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    size_t ti;
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      ti = token_index_;
-    }
-    headers.push_back("Authorization: token " + tokens_[ti]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::vector<std::string> headers = request_headers();
 
   // Fetch repository metadata to determine the default branch.
   enforce_delay();
@@ -1906,12 +2517,31 @@ void GitHubClient::close_dirty_branches(
   }
   std::string default_branch = repo_json["default_branch"].get<std::string>();
 
+  // With a local clone one lookup of the default branch head lets every
+  // comparison below run against the local object database.
+  auto local = local_clone(owner, repo);
+  std::string base_sha;
+  if (local) {
+    try {
+      enforce_delay();
+      auto base_json = nlohmann::json::parse(
+          get_with_cache(repo_url + "/branches/" +
+                             encode_ref_segment(default_branch),
+                         headers)
+              .body);
+      base_sha = base_json.at("commit").at("sha").get<std::string>();
+    } catch (const std::exception &e) {
+      github_client_log()->debug("Failed to resolve {} head: {}",
+                                 default_branch, e.what());
+    }
+  }
+
   std::string url = repo_url + "/branches";
   while (true) {
     enforce_delay();
     HttpResponse res;
     try {
-      res = get_with_cache_locked(url, headers);
+      res = get_with_cache(url, headers);
     } catch (const std::exception &e) {
       github_client_log()->error("Failed to fetch branches: {}", e.what());
       return;
@@ -1927,6 +2557,8 @@ void GitHubClient::close_dirty_branches(
       return;
     }
 
+    std::vector<std::string> page_branches;
+    std::vector<std::string> page_shas;
     for (const auto &b : branches_json) {
       if (!b.contains("name")) {
         continue;
@@ -1945,29 +2577,60 @@ void GitHubClient::close_dirty_branches(
                               protected_branch_excludes)) {
         continue;
       }
-      // Compare branch with default branch to detect divergence.
-      enforce_delay();
-      std::string compare_url = repo_url + "/compare/" +
-                                encode_ref_segment(default_branch) + "..." +
-                                encode_ref_segment(branch);
-      std::string compare_resp;
-      try {
-        // Fetch comparison without caching since headers are unnecessary and
-        // some HttpClient test doubles only implement `get`.
-        compare_resp = http_->get(compare_url, headers);
-      } catch (const std::exception &e) {
-        github_client_log()->error("Failed to compare branch {}: {}", branch,
-                                   e.what());
-        continue;
+      page_branches.push_back(std::move(branch));
+      std::string head_sha;
+      if (b.contains("commit") && b["commit"].is_object()) {
+        head_sha = b["commit"].value("sha", std::string{});
       }
-      nlohmann::json compare_json;
-      try {
-        compare_json = nlohmann::json::parse(compare_resp);
-      } catch (const std::exception &e) {
-        github_client_log()->error(
-            "Failed to parse compare JSON for branch {}: {}", branch, e.what());
-        continue;
+      page_shas.push_back(std::move(head_sha));
+    }
+    // Compare every branch on the page with the default branch, locally when
+    // the clone has both commits and otherwise as separate sub-jobs, then act
+    // on the results in listing order.
+    std::vector<nlohmann::json> compares(page_branches.size());
+    std::vector<std::pair<std::string, std::function<void()>>> tasks;
+    tasks.reserve(page_branches.size());
+    for (std::size_t i = 0; i < page_branches.size(); ++i) {
+      if (local && !base_sha.empty() && !page_shas[i].empty()) {
+        if (auto comparison = local->compare(base_sha, page_shas[i])) {
+          ++local_comparisons_;
+          compares[i] = {{"ahead_by", comparison->ahead_by},
+                         {"behind_by", comparison->behind_by},
+                         {"status", comparison->status}};
+          continue;
+        }
       }
+      tasks.emplace_back(
+          owner + "/" + repo + " compare " + page_branches[i], [&, i] {
+            const std::string &branch = page_branches[i];
+            enforce_delay();
+            std::string compare_url = repo_url + "/compare/" +
+                                      encode_ref_segment(default_branch) +
+                                      "..." + encode_ref_segment(branch);
+            std::string compare_resp;
+            try {
+              // Fetch comparison without caching since headers are
+              // unnecessary and some HttpClient test doubles only implement
+              // `get`.
+              compare_resp = http_->get(compare_url, headers);
+            } catch (const std::exception &e) {
+              github_client_log()->error("Failed to compare branch {}: {}",
+                                         branch, e.what());
+              return;
+            }
+            try {
+              compares[i] = nlohmann::json::parse(compare_resp);
+            } catch (const std::exception &e) {
+              github_client_log()->error(
+                  "Failed to parse compare JSON for branch {}: {}", branch,
+                  e.what());
+            }
+          });
+    }
+    run_subtasks(std::move(tasks));
+    for (std::size_t i = 0; i < page_branches.size(); ++i) {
+      const std::string &branch = page_branches[i];
+      const nlohmann::json &compare_json = compares[i];
       if (!compare_json.is_object()) {
         continue;
       }
@@ -2016,12 +2679,8 @@ void GitHubClient::close_dirty_branches(
 
 std::optional<GitHubClient::RateLimitStatus>
 GitHubClient::rate_limit_status(int max_attempts) {
-  std::scoped_lock lock(mutex_);
-  std::vector<std::string> headers;
-  if (!tokens_.empty()) {
-    headers.push_back("Authorization: token " + tokens_[current_token_index()]);
-  }
-  headers.push_back("Accept: application/vnd.github+json");
+  std::size_t token = 0;
+  std::vector<std::string> headers = request_headers(&token);
   std::string url = api_base_ + "/rate_limit";
   int attempts = std::max(1, max_attempts);
   for (int attempt = 0; attempt < attempts; ++attempt) {
@@ -2033,7 +2692,8 @@ GitHubClient::rate_limit_status(int max_attempts) {
       github_client_log()->warn("Failed to query rate limit: {}", e.what());
       return std::nullopt;
     }
-    if (handle_rate_limit(res)) {
+    if (handle_rate_limit(res, token)) {
+      headers = request_headers(&token);
       continue;
     }
     if (res.status_code < 200 || res.status_code >= 300) {
@@ -2085,8 +2745,11 @@ GitHubClient::rate_limit_status(int max_attempts) {
 
 /**
  * Inspect response headers for rate limit signals and pause if necessary.
+ *
+ * @param token Index of the token the request was sent with.
  */
-bool GitHubClient::handle_rate_limit(const HttpResponse &resp) {
+bool GitHubClient::handle_rate_limit(const HttpResponse &resp,
+                                     std::size_t token) {
   long remaining = -1;
   long reset = 0;
   long retry_after = 0;
@@ -2109,15 +2772,16 @@ bool GitHubClient::handle_rate_limit(const HttpResponse &resp) {
     }
   }
 
-  // If multiple tokens are configured, rotate quickly under the rate_state lock
+  // With multiple tokens, move past the exhausted one and retry at once.
+  // Concurrent requests failing on the same token rotate it only once.
   if ((resp.status_code == 403 || resp.status_code == 429) &&
       tokens_.size() > 1) {
-    {
-      std::scoped_lock rs_lock(rate_state_mutex_);
-      token_index_ = (token_index_ + 1) % tokens_.size();
+    std::size_t expected = token;
+    const std::size_t next = (token + 1) % tokens_.size();
+    if (token_index_.compare_exchange_strong(expected, next)) {
+      github_client_log()->warn(
+          "Rate limit hit, switching to next token (index {})", next);
     }
-    github_client_log()->warn(
-        "Rate limit hit, switching to next token (index {})", token_index_);
     // Signal caller to retry immediately.
     return true;
   }
@@ -2148,92 +2812,349 @@ bool GitHubClient::handle_rate_limit(const HttpResponse &resp) {
 
 /**
  * Ensure the minimum delay between successive HTTP requests is respected.
+ *
+ * Each caller reserves the next free request slot under `rate_state_mutex_`
+ * and then sleeps until that slot without holding the lock, so concurrent
+ * workers stay evenly spaced instead of racing on the same timestamp.
  */
 void GitHubClient::enforce_delay() {
-  if (delay_ms_ <= 0)
+  const int delay = delay_ms_.load();
+  if (delay <= 0)
     return;
-  std::chrono::steady_clock::time_point last;
-  {
-    std::scoped_lock rs_lock(rate_state_mutex_);
-    last = rate_state_.last_request;
-  }
-  auto now = std::chrono::steady_clock::now();
-  auto elapsed =
-      std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
-  if (elapsed < delay_ms_) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_ - elapsed));
-  }
+  std::chrono::steady_clock::time_point slot;
   {
     std::scoped_lock rs_lock(rate_state_mutex_);
-    rate_state_.last_request = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
+    auto earliest = rate_state_.last_request + std::chrono::milliseconds(delay);
+    slot = std::max(now, earliest);
+    rate_state_.last_request = slot;
   }
+  std::this_thread::sleep_until(slot);
 }
 
 /// @copydoc GitHubGraphQLClient::GitHubGraphQLClient
 GitHubGraphQLClient::GitHubGraphQLClient(std::vector<std::string> tokens,
                                          int timeout_ms, std::string api_base)
-    : tokens_(std::move(tokens)), timeout_ms_(timeout_ms),
-      api_base_(std::move(api_base)) {}
+    : GitHubGraphQLClient(std::move(tokens),
+                          std::make_unique<CurlHttpClient>(timeout_ms),
+                          std::move(api_base)) {}
+
+/**
+ * Create a GraphQL client issuing queries through a retrying HTTP client.
+ */
+GitHubGraphQLClient::GitHubGraphQLClient(std::vector<std::string> tokens,
+                                         std::unique_ptr<HttpClient> http,
+                                         std::string api_base,
+                                         int max_retries,
+                                         int retry_backoff_ms)
+    : tokens_(std::move(tokens)),
+      http_(std::make_unique<RetryHttpClient>(
+          http ? std::move(http) : std::make_unique<CurlHttpClient>(),
+          max_retries, retry_backoff_ms)),
+      api_base_(std::move(api_base)), token_usage_(tokens_.size()) {
+  ensure_default_logger();
+}
+
+namespace {
+
+/// Selection appended to every query so each response reports its cost.
+constexpr const char *kGraphQLRateLimitField =
+    "rateLimit{cost remaining resetAt}";
+
+/// Build the `pullRequests` connection selection for one repository.
+std::string graphql_pull_request_connection(const std::string &states,
+                                            const std::string &after_var) {
+  return "{pullRequests(states:[" + states + "],first:$first,after:" +
+         after_var + ",orderBy:{field:UPDATED_AT,direction:DESC}){nodes{" +
+         kGraphQLPullRequestFields + "} pageInfo{hasNextPage endCursor}}}";
+}
+
+/**
+ * Append the pull requests of one `pullRequests` connection to @p prs.
+ *
+ * @return Cursor of the next page, or null when the listing is complete.
+ */
+nlohmann::json append_graphql_pull_requests(const nlohmann::json &connection,
+                                            const std::string &owner,
+                                            const std::string &repo,
+                                            const nlohmann::json &cursor,
+                                            std::vector<PullRequest> &prs) {
+  for (const auto &n : connection.at("nodes")) {
+    PullRequest pr{};
+    pr.number = n["number"].get<int>();
+    pr.title = n["title"].get<std::string>();
+    pr.merged = !n["mergedAt"].is_null();
+    pr.owner = owner;
+    pr.repo = repo;
+    if (n.contains("headRefOid") && n["headRefOid"].is_string()) {
+      pr.head_sha = n["headRefOid"].get<std::string>();
+    }
+    if (n.contains("updatedAt") && n["updatedAt"].is_string()) {
+      pr.updated_at = n["updatedAt"].get<std::string>();
+    }
+    pr.metadata = graphql_pull_request_metadata(n);
+    prs.push_back(std::move(pr));
+  }
+  const auto &page = connection.at("pageInfo");
+  if (!page.value("hasNextPage", false) || !page.contains("endCursor") ||
+      !page["endCursor"].is_string() || page["endCursor"] == cursor) {
+    return nullptr;
+  }
+  return page["endCursor"];
+}
+
+} // namespace
+
+/**
+ * POST a GraphQL payload and return the `data` member of the response.
+ *
+ * Transient failures are retried by the wrapped RetryHttpClient. A rate
+ * limited token (HTTP 403/429 or a `RATE_LIMITED` GraphQL error) is rotated
+ * out and the query reissued with the next token until every token has been
+ * tried once.
+ */
+std::optional<nlohmann::json>
+GitHubGraphQLClient::post_query(const nlohmann::json &payload) {
+  const std::string url = api_base_ + "/graphql";
+  const std::string data = payload.dump();
+  for (std::size_t attempt = 0; attempt < tokens_.size(); ++attempt) {
+    const std::size_t token = token_index_.load() % tokens_.size();
+    std::string response;
+    try {
+      response = http_->post(url, data,
+                             {"Content-Type: application/json",
+                              "Authorization: bearer " + tokens_[token]});
+    } catch (const HttpStatusError &e) {
+      if (e.status == 403 || e.status == 429) {
+        github_client_log()->warn("GraphQL token {} rate limited (HTTP {})",
+                                  token, e.status);
+        rotate_token(token);
+        continue;
+      }
+      github_client_log()->error("GraphQL query failed: {}", e.what());
+      return std::nullopt;
+    } catch (const std::exception &e) {
+      github_client_log()->error("GraphQL query failed: {}", e.what());
+      return std::nullopt;
+    }
+    try {
+      auto json = nlohmann::json::parse(response);
+      bool rate_limited = false;
+      if (json.contains("errors") && json["errors"].is_array()) {
+        for (const auto &err : json["errors"]) {
+          if (err.is_object() && err.value("type", "") == "RATE_LIMITED") {
+            rate_limited = true;
+          }
+          github_client_log()->warn("GraphQL error: {}",
+                                    err.is_object()
+                                        ? err.value("message", err.dump())
+                                        : err.dump());
+        }
+      }
+      if (rate_limited) {
+        rotate_token(token);
+        continue;
+      }
+      if (!json.contains("data") || !json["data"].is_object()) {
+        github_client_log()->error("GraphQL response contained no data");
+        return std::nullopt;
+      }
+      record_rate_limit(token, json["data"]);
+      return std::move(json["data"]);
+    } catch (const std::exception &e) {
+      github_client_log()->error("Failed to parse GraphQL response: {}",
+                                 e.what());
+      return std::nullopt;
+    }
+  }
+  github_client_log()->error("Every GraphQL token is rate limited");
+  return std::nullopt;
+}
+
+/**
+ * Move past @p exhausted unless another thread already rotated away from it.
+ */
+void GitHubGraphQLClient::rotate_token(std::size_t exhausted) {
+  {
+    std::scoped_lock lock(rate_mutex_);
+    ++token_usage_[exhausted].rate_limited;
+  }
+  if (tokens_.size() < 2) {
+    return;
+  }
+  std::size_t expected = exhausted;
+  if (token_index_.compare_exchange_strong(expected,
+                                           (exhausted + 1) % tokens_.size())) {
+    github_client_log()->info("Rotating GraphQL token {} -> {}", exhausted,
+                              (exhausted + 1) % tokens_.size());
+  }
+}
+
+/**
+ * Record the `rateLimit` block of a GraphQL response answered for @p token.
+ */
+void GitHubGraphQLClient::record_rate_limit(std::size_t token,
+                                            const nlohmann::json &data) {
+  auto it = data.find("rateLimit");
+  bool exhausted = false;
+  {
+    std::scoped_lock lock(rate_mutex_);
+    ++rate_info_.queries;
+    auto &usage = token_usage_[token];
+    ++usage.queries;
+    if (it == data.end() || !it->is_object()) {
+      return;
+    }
+    rate_info_.last_cost = it->value("cost", 0);
+    rate_info_.remaining = it->value("remaining", rate_info_.remaining);
+    rate_info_.reset_at = it->value("resetAt", rate_info_.reset_at);
+    rate_info_.total_cost += rate_info_.last_cost;
+    usage.cost += rate_info_.last_cost;
+    usage.remaining = rate_info_.remaining;
+    usage.reset_at = rate_info_.reset_at;
+    exhausted = usage.remaining == 0;
+  }
+  if (exhausted) {
+    // Switch before the next query instead of waiting to be rejected.
+    rotate_token(token);
+  }
+}
+
+/// @copydoc GitHubGraphQLClient::rate_limit_info
+GitHubGraphQLClient::RateLimitInfo
+GitHubGraphQLClient::rate_limit_info() const {
+  std::scoped_lock lock(rate_mutex_);
+  return rate_info_;
+}
+
+/// @copydoc GitHubGraphQLClient::token_usage
+std::vector<GitHubGraphQLClient::TokenUsage>
+GitHubGraphQLClient::token_usage() const {
+  std::scoped_lock lock(rate_mutex_);
+  return token_usage_;
+}
 
 /// @copydoc GitHubGraphQLClient::list_pull_requests
-std::vector<PullRequest>
+std::optional<std::vector<PullRequest>>
 GitHubGraphQLClient::list_pull_requests(const std::string &owner,
                                         const std::string &repo,
                                         bool include_merged, int per_page) {
   std::vector<PullRequest> prs;
   if (tokens_.empty()) {
-    return prs;
+    return std::nullopt;
   }
-  std::string url = api_base_ + "/graphql";
   std::string states = include_merged ? "OPEN,MERGED" : "OPEN";
-  std::string query = "query($owner:String!,$name:String!,$first:Int!){"
-                      "repository(owner:$owner,";
-  query += "name:$name){pullRequests(states:[" + states +
-           "],first:$first,orderBy:{field:UPDATED_AT,direction:DESC})";
-  query += "{nodes{number title mergedAt} pageInfo{hasNextPage endCursor}}}}";
-  nlohmann::json payload{
-      {"query", query},
-      {"variables", {{"owner", owner}, {"name", repo}, {"first", per_page}}}};
-  std::string data = payload.dump();
-
-  CurlHandle curl;
-  std::string response;
-  curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl.get(), CURLOPT_POST, 1L);
-  curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, data.c_str());
-  curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE, data.size());
-  curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT_MS, timeout_ms_);
-  curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, "agpm");
-  curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
-  CurlSlist headers;
-  headers.append("Content-Type: application/json");
-  std::string auth = "Authorization: bearer " + tokens_[token_index_];
-  headers.append(auth);
-  curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers.get());
-  CURLcode res = curl_easy_perform(curl.get());
-  if (res != CURLE_OK) {
-    github_client_log()->error("GraphQL query failed: {}",
-                               curl_easy_strerror(res));
-    return prs;
-  }
-  try {
-    auto json = nlohmann::json::parse(response);
-    auto nodes = json["data"]["repository"]["pullRequests"]["nodes"];
-    for (const auto &n : nodes) {
-      PullRequest pr{};
-      pr.number = n["number"].get<int>();
-      pr.title = n["title"].get<std::string>();
-      pr.merged = !n["mergedAt"].is_null();
-      pr.owner = owner;
-      pr.repo = repo;
-      prs.push_back(std::move(pr));
+  std::string query =
+      "query($owner:String!,$name:String!,$first:Int!,$after:String){";
+  query += kGraphQLRateLimitField;
+  query += " repository(owner:$owner,name:$name)" +
+           graphql_pull_request_connection(states, "$after") + "}";
+
+  nlohmann::json cursor = nullptr;
+  while (true) {
+    nlohmann::json payload{{"query", query},
+                           {"variables",
+                            {{"owner", owner},
+                             {"name", repo},
+                             {"first", per_page},
+                             {"after", cursor}}}};
+    // A failed page leaves the listing incomplete; callers must not take
+    // the pages fetched so far for every pull request.
+    auto data = post_query(payload);
+    if (!data) {
+      return std::nullopt;
+    }
+    try {
+      cursor = append_graphql_pull_requests(
+          data->at("repository").at("pullRequests"), owner, repo, cursor, prs);
+    } catch (const std::exception &e) {
+      github_client_log()->error("Failed to parse GraphQL response: {}",
+                                 e.what());
+      return std::nullopt;
+    }
+    if (cursor.is_null()) {
+      break;
     }
-  } catch (const std::exception &e) {
-    github_client_log()->error("Failed to parse GraphQL response: {}",
-                               e.what());
   }
   return prs;
 }
 
+/// @copydoc GitHubGraphQLClient::list_pull_requests_batch
+std::vector<std::optional<std::vector<PullRequest>>>
+GitHubGraphQLClient::list_pull_requests_batch(
+    const std::vector<std::pair<std::string, std::string>> &repos,
+    bool include_merged, int per_page, int batch_size) {
+  std::vector<std::optional<std::vector<PullRequest>>> results(repos.size());
+  if (tokens_.empty() || repos.empty()) {
+    return results;
+  }
+  const std::size_t max_batch =
+      static_cast<std::size_t>(std::max(batch_size, 1));
+  const std::string states = include_merged ? "OPEN,MERGED" : "OPEN";
+
+  // Repositories still listing, with the cursor of their next page.
+  std::vector<std::pair<std::size_t, nlohmann::json>> pending;
+  pending.reserve(repos.size());
+  for (std::size_t i = 0; i < repos.size(); ++i) {
+    results[i].emplace();
+    pending.emplace_back(i, nullptr);
+  }
+
+  while (!pending.empty()) {
+    std::vector<std::pair<std::size_t, nlohmann::json>> next_round;
+    for (std::size_t start = 0; start < pending.size(); start += max_batch) {
+      const std::size_t end = std::min(pending.size(), start + max_batch);
+      std::string params = "$first:Int!";
+      std::string body = kGraphQLRateLimitField;
+      nlohmann::json variables{{"first", per_page}};
+      for (std::size_t k = start; k < end; ++k) {
+        const std::string n = std::to_string(k - start);
+        const auto &[owner, name] = repos[pending[k].first];
+        params += ",$o" + n + ":String!,$n" + n + ":String!,$c" + n + ":String";
+        body += " r" + n + ":repository(owner:$o" + n + ",name:$n" + n + ")" +
+                graphql_pull_request_connection(states, "$c" + n);
+        variables["o" + n] = owner;
+        variables["n" + n] = name;
+        variables["c" + n] = pending[k].second;
+      }
+      nlohmann::json payload{{"query", "query(" + params + "){" + body + "}"},
+                             {"variables", variables}};
+      auto data = post_query(payload);
+      if (!data) {
+        for (std::size_t k = start; k < end; ++k) {
+          results[pending[k].first].reset();
+        }
+        continue;
+      }
+      for (std::size_t k = start; k < end; ++k) {
+        const auto &[index, cursor] = pending[k];
+        const auto &[owner, name] = repos[index];
+        const std::string alias = "r" + std::to_string(k - start);
+        try {
+          const auto &repository = data->at(alias);
+          if (repository.is_null()) {
+            github_client_log()->warn("GraphQL returned no repository {}/{}",
+                                      owner, name);
+            results[index].reset();
+            continue;
+          }
+          nlohmann::json next = append_graphql_pull_requests(
+              repository.at("pullRequests"), owner, name, cursor,
+              *results[index]);
+          if (!next.is_null()) {
+            next_round.emplace_back(index, std::move(next));
+          }
+        } catch (const std::exception &e) {
+          github_client_log()->error(
+              "Failed to parse GraphQL response for {}/{}: {}", owner, name,
+              e.what());
+          results[index].reset();
+        }
+      }
+    }
+    pending.swap(next_round);
+  }
+  return results;
+}
+
 } // namespace agpm
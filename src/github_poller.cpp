@@ -1,12 +1,18 @@
 #include "github_poller.hpp"
 #include "log.hpp"
+#include "poll_results.hpp"
 #include "sort.hpp"
 #include <algorithm>
 #include <atomic>
 #include <cctype>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <future>
 #include <iomanip>
 #include <iterator>
@@ -18,6 +24,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 namespace agpm {
 
@@ -37,6 +44,83 @@ std::string normalize_rule_state(std::string state) {
       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
   return state;
 }
+
+/// Poll stage issuing its own requests, paid for with a rate token.
+const Poller::JobOptions kListingStage{Poller::JobPriority::Listing,
+                                      std::nullopt, true};
+/// Poll stage acting on data an earlier stage fetched.
+const Poller::JobOptions kFollowUpStage{Poller::JobPriority::Listing,
+                                       std::nullopt, false};
+/// Stray detection. The stage itself takes no token; each compare sub-job
+/// does, on a worker or through the client's rate gate when run inline.
+const Poller::JobOptions kAnalysisStage{Poller::JobPriority::Heuristic,
+                                       std::nullopt, false};
+
+const char *change_kind_name(ChangeKind kind) {
+  switch (kind) {
+  case ChangeKind::Added:
+    return "added";
+  case ChangeKind::Updated:
+    return "updated";
+  case ChangeKind::Removed:
+    return "removed";
+  }
+  return "unknown";
+}
+
+/**
+ * Append the differences between two listings of one repository's pull
+ * requests to @p out. A pull request counts as updated when anything the
+ * listing reports about it changed.
+ */
+void diff_pull_requests(const std::vector<PullRequest> &before,
+                        const std::vector<PullRequest> &after, bool initial,
+                        std::vector<PullRequestChange> &out) {
+  std::unordered_map<int, const PullRequest *> previous;
+  previous.reserve(before.size());
+  for (const auto &pr : before) {
+    previous.emplace(pr.number, &pr);
+  }
+  for (const auto &pr : after) {
+    auto it = previous.find(pr.number);
+    if (it == previous.end()) {
+      out.push_back({ChangeKind::Added, pull_request_id(pr), pr, initial});
+      continue;
+    }
+    const PullRequest &old = *it->second;
+    if (old.title != pr.title || old.merged != pr.merged ||
+        old.head_sha != pr.head_sha || old.updated_at != pr.updated_at) {
+      out.push_back({ChangeKind::Updated, pull_request_id(pr), pr, false});
+    }
+    previous.erase(it);
+  }
+  for (const auto &pr : before) {
+    if (previous.count(pr.number) != 0) {
+      out.push_back({ChangeKind::Removed, pull_request_id(pr), pr, false});
+    }
+  }
+}
+
+/// Append the stray branches added to or dropped from a repository.
+void diff_branches(const std::vector<StrayBranch> &before,
+                   const std::vector<StrayBranch> &after, bool initial,
+                   std::vector<BranchChange> &out) {
+  std::unordered_set<std::string> previous;
+  previous.reserve(before.size());
+  for (const auto &branch : before) {
+    previous.insert(branch.name);
+  }
+  for (const auto &branch : after) {
+    if (previous.erase(branch.name) == 0) {
+      out.push_back({ChangeKind::Added, branch_id(branch), branch, initial});
+    }
+  }
+  for (const auto &branch : before) {
+    if (previous.count(branch.name) != 0) {
+      out.push_back({ChangeKind::Removed, branch_id(branch), branch, false});
+    }
+  }
+}
 } // namespace
 
 /**
@@ -147,6 +231,19 @@ GitHubPoller::GitHubPoller(
       [this](std::size_t outstanding, std::chrono::seconds clearance) {
         handle_backlog(outstanding, clearance);
       });
+  // Per-branch compare requests run as sub-jobs on the same pool so they
+  // share its token bucket and large repositories use every worker.
+  client_.set_task_runner(
+      [this](std::string name, std::function<void()> job) {
+        return poller_.submit(
+            std::move(name), std::move(job),
+            Poller::JobOptions{Poller::JobPriority::Heuristic, std::nullopt});
+      },
+      // A stopped pool runs submissions inline without tokens as well.
+      [this] {
+        return !poller_.running() ||
+               poller_.acquire_token(Poller::JobPriority::Heuristic);
+      });
   if (max_rate_ > 0) {
     auto interval =
         std::chrono::duration<double>(60.0 / static_cast<double>(max_rate_));
@@ -179,6 +276,8 @@ GitHubPoller::effective_repository_options(const std::string &owner,
   return opts;
 }
 
+GitHubPoller::~GitHubPoller() { client_.set_task_runner(nullptr); }
+
 /**
  * Launch the poller thread and begin scheduling work.
  */
@@ -187,9 +286,23 @@ void GitHubPoller::start() {
   poller_.start();
   running_ = true;
   thread_ = std::thread([this] {
+    if (streaming_ || adaptive_intervals_) {
+      stream_loop();
+      return;
+    }
+    auto next_full = std::chrono::steady_clock::now();
     while (running_) {
-      poll();
-      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms_));
+      if (std::chrono::steady_clock::now() >= next_full) {
+        poll();
+        next_full = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(interval_ms_);
+      } else {
+        refresh_pending();
+      }
+      std::unique_lock<std::mutex> lk(refresh_mutex_);
+      refresh_cv_.wait_until(lk, next_full, [this] {
+        return !running_ || !pending_refresh_.empty();
+      });
     }
   });
 }
@@ -200,6 +313,10 @@ void GitHubPoller::start() {
 void GitHubPoller::stop() {
   poller_log()->info("Stopping GitHub poller");
   running_ = false;
+  {
+    std::lock_guard<std::mutex> lk(refresh_mutex_);
+  }
+  refresh_cv_.notify_all();
   if (thread_.joinable()) {
     thread_.join();
   }
@@ -211,6 +328,90 @@ void GitHubPoller::stop() {
  */
 void GitHubPoller::poll_now() { poll(); }
 
+/**
+ * Queue @p job with the given priority, or run it on the calling thread with
+ * a rate token when no worker is free to take it.
+ */
+void GitHubPoller::run_prioritized(std::string name, std::function<void()> job,
+                                   Poller::JobPriority priority) {
+  constexpr auto kGrace = std::chrono::seconds(1);
+  auto run_inline = [&] {
+    if (!poller_.acquire_token(priority)) {
+      poller_log()->warn("Poller stopping; dropping prioritized job");
+      return;
+    }
+    job();
+  };
+  if (poller_.all_workers_busy()) {
+    poller_log()->debug("Workers busy; running prioritized job inline");
+    run_inline();
+    return;
+  }
+  auto submission = poller_.submit_tracked(
+      std::move(name), job, Poller::JobOptions{priority, std::nullopt});
+  if (submission.future.wait_for(kGrace) != std::future_status::ready &&
+      poller_.try_cancel(submission.id)) {
+    poller_log()->debug("Prioritized job not picked up; running it inline");
+    run_inline();
+    return;
+  }
+  submission.future.get();
+}
+
+/**
+ * Merge the event's scope into the pending refresh of its repository.
+ */
+void GitHubPoller::handle_webhook(const WebhookEvent &event) {
+  const std::string repo_name = event.owner + "/" + event.repo;
+  bool polled = std::any_of(repos_.begin(), repos_.end(), [&](const auto &r) {
+    return r.first == event.owner && r.second == event.repo;
+  });
+  if (!polled) {
+    poller_log()->debug("Ignoring {} event for unpolled repository {}",
+                        event.type, repo_name);
+    return;
+  }
+  if (!event.pull_requests.empty()) {
+    std::lock_guard<std::mutex> lk(decision_cache_mutex_);
+    for (int number : event.pull_requests) {
+      decision_cache_.erase(repo_name + "#" + std::to_string(number));
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lk(refresh_mutex_);
+    auto [it, inserted] =
+        pending_refresh_.try_emplace(repo_name, RefreshScope{false, false});
+    it->second.pull_requests |= event.refresh_pull_requests;
+    it->second.branches |= event.refresh_branches;
+  }
+  poller_log()->debug("Queued {} refresh of {}", event.type, repo_name);
+  refresh_cv_.notify_all();
+}
+
+/**
+ * Drain the pending refreshes and poll just those repositories.
+ */
+std::size_t GitHubPoller::refresh_pending() {
+  RefreshScopes scopes;
+  {
+    std::lock_guard<std::mutex> lk(refresh_mutex_);
+    scopes.swap(pending_refresh_);
+  }
+  if (scopes.empty()) {
+    return 0;
+  }
+  std::vector<std::pair<std::string, std::string>> targets;
+  for (const auto &repo : repos_) {
+    if (scopes.count(repo.first + "/" + repo.second) > 0) {
+      targets.push_back(repo);
+    }
+  }
+  poller_log()->debug("Refreshing {} repositories from webhook events",
+                      targets.size());
+  poll_repositories(targets, &scopes);
+  return targets.size();
+}
+
 /**
  * Register a callback invoked with the latest pull request snapshot.
  *
@@ -241,6 +442,17 @@ void GitHubPoller::set_stray_callback(
   stray_cb_ = std::move(cb);
 }
 
+/**
+ * Register a callback for the pull request and stray branch change feed.
+ *
+ * @param cb Callback receiving each non-empty change set in sequence order.
+ */
+void GitHubPoller::set_change_callback(
+    std::function<void(const ChangeSet &)> cb) {
+  std::lock_guard<std::mutex> lk(feed_mutex_);
+  change_cb_ = std::move(cb);
+}
+
 /**
  * Configure the branch rule engine to take a specific action for a state.
  */
@@ -297,6 +509,45 @@ void GitHubPoller::set_notifier(NotifierPtr notifier) {
   notifier_ = std::move(notifier);
 }
 
+/**
+ * Configure where incremental listing state is persisted and load it.
+ *
+ * @param path JSON file holding per-repository watermarks and snapshots.
+ */
+void GitHubPoller::set_pr_state_file(std::string path) {
+  pr_state_file_ = std::move(path);
+  if (pr_state_file_.empty() || !std::filesystem::exists(pr_state_file_)) {
+    return;
+  }
+  try {
+    std::ifstream in(pr_state_file_);
+    auto j = nlohmann::json::parse(in);
+    std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+    for (const auto &[name, state] : j.at("repos").items()) {
+      auto slash = name.find('/');
+      if (slash == std::string::npos) {
+        continue;
+      }
+      PullRequestSnapshot snapshot;
+      snapshot.watermark = state.value("watermark", std::string{});
+      for (const auto &item : state.value("pulls", nlohmann::json::array())) {
+        PullRequest pr{item.at("number").get<int>(),
+                       item.value("title", std::string{}), false,
+                       name.substr(0, slash), name.substr(slash + 1)};
+        pr.head_sha = item.value("head_sha", std::string{});
+        pr.updated_at = item.value("updated_at", std::string{});
+        snapshot.open.emplace(pr.number, std::move(pr));
+      }
+      pr_snapshots_[name] = std::move(snapshot);
+    }
+    poller_log()->info("Loaded pull request watermarks for {} repositories",
+                       pr_snapshots_.size());
+  } catch (const std::exception &e) {
+    poller_log()->warn("Ignoring unreadable pull request state {}: {}",
+                       pr_state_file_, e.what());
+  }
+}
+
 /**
  * Perform a full polling cycle across all configured repositories.
  *
@@ -313,455 +564,420 @@ void GitHubPoller::poll() {
     next_allowed_poll_ = now + min_poll_interval_;
   }
   poller_log()->debug("Polling repositories");
-  std::vector<PullRequest> all_prs;
-  std::vector<StrayBranch> all_stray;
-  std::mutex pr_mutex;
-  std::mutex stray_mutex;
+  poll_repositories(repos_, nullptr);
+}
+
+/**
+ * Results shared by the stage jobs of one poll cycle, plus the count of
+ * stages still queued or running.
+ */
+struct GitHubPoller::PollCycle {
+  /// Buffers of every target, registered before any stage is queued.
+  PollResults results;
+  /// Serializes history database writes.
+  std::mutex history_mutex;
   std::mutex log_mutex;
   std::atomic<std::size_t> total_pr_count{0};
   std::atomic<std::size_t> total_branch_count{0};
-  std::vector<std::future<void>> futures;
-  futures.reserve(repos_.size());
-  bool all_repos_skipped_branch_ops = true;
-  for (const auto &repo : repos_) {
-    RepositoryOptions options =
-        effective_repository_options(repo.first, repo.second);
-    bool skip_branch_ops =
-        options.only_poll_prs || (max_rate_ > 0 && max_rate_ <= 1);
-    if (!skip_branch_ops) {
-      all_repos_skipped_branch_ops = false;
-    }
-    std::string repo_name = repo.first + "/" + repo.second;
-    std::string job_label;
-    if (options.purge_only) {
-      job_label = repo_name + " purge";
-    } else if (skip_branch_ops) {
-      job_label = repo_name + " pull requests";
-    } else {
-      job_label = repo_name + " sync";
-    }
-    futures.emplace_back(poller_.submit(job_label, [this, repo, repo_name,
-                                                    options, skip_branch_ops,
-                                                    &all_prs, &all_stray,
-                                                    &pr_mutex, &stray_mutex,
-                                                    &log_mutex, &total_pr_count,
-                                                    &total_branch_count] {
-      bool repo_hooks_enabled = options.hooks_enabled && hook_;
-      if (options.purge_only) {
-        poller_log()->debug("purge_only set - skipping repo {}", repo_name);
-        if (!options.purge_prefix.empty()) {
-          auto removed = client_.cleanup_branches(
-              repo.first, repo.second, options.purge_prefix,
-              protected_branches_, protected_branch_excludes_);
-          if (repo_hooks_enabled && !removed.empty()) {
-            for (const auto &branch_name : removed) {
-              HookEvent evt{"branch.deleted"};
-              evt.data["owner"] = repo.first;
-              evt.data["repo"] = repo.second;
-              evt.data["branch"] = branch_name;
-              evt.data["reason"] = "purge_only";
-              hook_->enqueue(std::move(evt));
-            }
-          }
-          if (notifier_) {
-            notifier_->notify("Purged branches in " + repo.first + "/" +
-                              repo.second);
-          }
-        }
+  std::unordered_map<std::string, std::vector<PullRequest>> batched_prs;
+  /// Repositories whose pull request listing failed; their stored results
+  /// and change feed stay as they were.
+  std::unordered_set<std::string> failed_listings;
+  std::mutex failed_mutex;
+  bool branch_ops{false};
+  /// XOR of the hashes of every listed branch name and head SHA.
+  std::atomic<std::size_t> branch_digest{0};
+
+  std::mutex stage_mutex;
+  std::condition_variable stage_cv;
+  std::size_t outstanding{0};
+  std::exception_ptr error;
+  /// Called on the thread that finished the last stage.
+  std::function<void()> on_complete;
+
+  void begin_stage() {
+    std::lock_guard<std::mutex> lk(stage_mutex);
+    ++outstanding;
+  }
+
+  void fail(std::exception_ptr failure) {
+    std::lock_guard<std::mutex> lk(stage_mutex);
+    if (!error) {
+      error = std::move(failure);
+    }
+  }
+
+  void end_stage() {
+    std::function<void()> done;
+    {
+      std::lock_guard<std::mutex> lk(stage_mutex);
+      if (--outstanding != 0) {
         return;
       }
-      if (!options.only_poll_stray || options.only_poll_prs) {
-        const std::vector<PullRequest> prs = [this, &repo]() {
-          if (graphql_client_) {
-            return graphql_client_->list_pull_requests(repo.first, repo.second);
-          }
-          if (max_rate_ > 0 && max_rate_ <= 1) {
-            // Tests require a single HTTP request when rate is extremely low
-            return client_.list_open_pull_requests_single(repo.first + "/" +
-                                                          repo.second);
-          }
-          return client_.list_pull_requests(repo.first, repo.second);
-        }();
-        {
-          std::lock_guard<std::mutex> lk(pr_mutex);
-          all_prs.insert(all_prs.end(), prs.begin(), prs.end());
-          if (history_) {
-            for (const auto &pr : prs) {
-              history_->insert(pr.number, pr.title, pr.merged);
-            }
-          }
-        }
-        total_pr_count.fetch_add(prs.size(), std::memory_order_relaxed);
-        if (log_cb_) {
-          std::lock_guard<std::mutex> lk(log_mutex);
-          log_cb_(repo.first + "/" + repo.second +
-                  " pull requests: " + std::to_string(prs.size()));
-        } else {
-          poller_log()->info("Fetched {} pull requests for {}/{}", prs.size(),
-                             repo.first, repo.second);
-        }
-        if (options.auto_merge) {
-          auto remove_pr = [&](const PullRequest &target) {
-            std::lock_guard<std::mutex> lk(pr_mutex);
-            auto new_end =
-                std::remove_if(all_prs.begin(), all_prs.end(),
-                               [&](const PullRequest &candidate) {
-                                 return candidate.number == target.number &&
-                                        candidate.owner == target.owner &&
-                                        candidate.repo == target.repo;
-                               });
-            std::size_t removed =
-                static_cast<std::size_t>(std::distance(new_end, all_prs.end()));
-            if (removed > 0) {
-              all_prs.erase(new_end, all_prs.end());
-              total_pr_count.fetch_sub(removed, std::memory_order_relaxed);
-            }
-          };
-          for (const auto &pr : prs) {
-            auto metadata =
-                client_.pull_request_metadata(pr.owner, pr.repo, pr.number);
-            if (!metadata) {
-              continue;
-            }
-            PullRequestAction action = rule_engine_.decide(*metadata);
-            if (dry_run_) {
-              if (action == PullRequestAction::kMerge) {
-                client_.merge_pull_request(pr.owner, pr.repo, pr.number,
-                                           *metadata);
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("Would merge PR #" + std::to_string(pr.number));
-                }
-              } else if (action == PullRequestAction::kClose) {
-                client_.close_pull_request(pr.owner, pr.repo, pr.number);
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("Would close PR #" + std::to_string(pr.number));
-                }
-              }
-              continue;
-            }
-            if (action == PullRequestAction::kMerge) {
-              bool merged = client_.merge_pull_request(pr.owner, pr.repo,
-                                                       pr.number, *metadata);
-              if (merged) {
-                if (history_) {
-                  std::lock_guard<std::mutex> lk(pr_mutex);
-                  history_->update_merged(pr.number);
-                }
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("Merged PR #" + std::to_string(pr.number));
-                }
-                if (notifier_) {
-                  notifier_->notify("Merged PR #" + std::to_string(pr.number) +
-                                    " in " + pr.owner + "/" + pr.repo);
-                }
-                if (repo_hooks_enabled) {
-                  HookEvent evt{"pull_request.merged"};
-                  evt.data["number"] = pr.number;
-                  evt.data["owner"] = pr.owner;
-                  evt.data["repo"] = pr.repo;
-                  evt.data["title"] = pr.title;
-                  evt.data["mergeable_state"] = metadata->mergeable_state;
-                  evt.data["mergeable"] = metadata->mergeable;
-                  evt.data["draft"] = metadata->draft;
-                  hook_->enqueue(std::move(evt));
-                }
-                remove_pr(pr);
-              } else {
-                if (repo_hooks_enabled) {
-                  HookEvent evt{"pull_request.merge_failed"};
-                  evt.data["number"] = pr.number;
-                  evt.data["owner"] = pr.owner;
-                  evt.data["repo"] = pr.repo;
-                  evt.data["title"] = pr.title;
-                  evt.data["mergeable_state"] = metadata->mergeable_state;
-                  evt.data["mergeable"] = metadata->mergeable;
-                  evt.data["draft"] = metadata->draft;
-                  hook_->enqueue(std::move(evt));
-                }
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("PR #" + std::to_string(pr.number) +
-                          " did not meet merge requirements");
-                }
-              }
-            } else if (action == PullRequestAction::kClose) {
-              bool closed =
-                  client_.close_pull_request(pr.owner, pr.repo, pr.number);
-              if (closed) {
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("Closed PR #" + std::to_string(pr.number));
-                }
-                if (notifier_) {
-                  notifier_->notify("Closed PR #" + std::to_string(pr.number) +
-                                    " in " + pr.owner + "/" + pr.repo);
-                }
-                if (repo_hooks_enabled) {
-                  HookEvent evt{"pull_request.closed"};
-                  evt.data["number"] = pr.number;
-                  evt.data["owner"] = pr.owner;
-                  evt.data["repo"] = pr.repo;
-                  evt.data["title"] = pr.title;
-                  hook_->enqueue(std::move(evt));
-                }
-                remove_pr(pr);
-              } else {
-                if (repo_hooks_enabled) {
-                  HookEvent evt{"pull_request.close_failed"};
-                  evt.data["number"] = pr.number;
-                  evt.data["owner"] = pr.owner;
-                  evt.data["repo"] = pr.repo;
-                  evt.data["title"] = pr.title;
-                  hook_->enqueue(std::move(evt));
-                }
-                if (log_cb_) {
-                  std::lock_guard<std::mutex> lk(log_mutex);
-                  log_cb_("PR #" + std::to_string(pr.number) +
-                          " could not be closed");
-                }
-              }
-            }
-          }
-        }
+      stage_cv.notify_all();
+      done = on_complete;
+    }
+    if (done) {
+      done();
+    }
+  }
+
+  /// Block until every stage, including the ones spawned later, finished.
+  void wait() {
+    std::unique_lock<std::mutex> lk(stage_mutex);
+    stage_cv.wait(lk, [this] { return outstanding == 0; });
+  }
+
+  /**
+   * Hash of the pull requests, stray branches and branch heads the cycle
+   * saw; it changes whenever any of them did.
+   */
+  std::size_t fingerprint() const {
+    const auto all_prs = results.pull_requests();
+    const auto all_stray = results.stray_branches();
+    std::vector<std::string> entries;
+    entries.reserve(all_prs.size() + all_stray.size());
+    for (const auto &pr : all_prs) {
+      entries.push_back(pr.owner + "/" + pr.repo + "#" +
+                        std::to_string(pr.number) + "|" + pr.updated_at + "|" +
+                        pr.head_sha + "|" + pr.title);
+    }
+    for (const auto &branch : all_stray) {
+      entries.push_back(branch.owner + "/" + branch.repo + ":" + branch.name);
+    }
+    std::sort(entries.begin(), entries.end());
+    std::size_t hash = branch_digest.load();
+    for (const auto &entry : entries) {
+      hash ^= std::hash<std::string>{}(entry) + 0x9e3779b97f4a7c15ULL +
+              (hash << 6) + (hash >> 2);
+    }
+    return hash;
+  }
+};
+
+/// Pull requests of one repository waiting for their merge decision.
+struct GitHubPoller::MergeBatch {
+  std::vector<PullRequest> prs;
+  std::vector<std::optional<PullRequestMetadata>> metadata;
+  std::vector<char> fetched;
+  std::atomic<std::size_t> pending{0};
+};
+
+/**
+ * Queue @p stage on the worker pool as part of @p cycle. A stage dropped by
+ * a stopping pool still counts as finished, so the cycle never hangs.
+ */
+void GitHubPoller::spawn_stage(PollCycle &cycle, std::string name,
+                               Poller::JobOptions options,
+                               std::function<void()> stage) {
+  cycle.begin_stage();
+  std::shared_ptr<PollCycle> ticket(&cycle, [](PollCycle *c) {
+    c->end_stage();
+  });
+  auto run = [ticket = std::move(ticket), stage = std::move(stage)]() mutable {
+    try {
+      stage();
+    } catch (...) {
+      ticket->fail(std::current_exception());
+    }
+    ticket.reset();
+  };
+  poller_.submit(std::move(name), std::move(run), options);
+}
+
+/**
+ * Scope of @p repo_name in a poll limited to @p scopes; a null @p scopes
+ * polls everything.
+ */
+GitHubPoller::RefreshScope
+GitHubPoller::scope_of(const RefreshScopes *scopes,
+                       const std::string &repo_name) {
+  if (!scopes) {
+    return RefreshScope{};
+  }
+  auto it = scopes->find(repo_name);
+  return it != scopes->end() ? it->second : RefreshScope{false, false};
+}
+
+/**
+ * Poll @p targets as a graph of stage jobs and publish the aggregated
+ * results. Each repository runs two independent chains, pull request
+ * listing → metadata → merge and branch listing → stray detection →
+ * cleanup, so a cycle takes about as long as its slowest chain.
+ */
+void GitHubPoller::poll_repositories(
+    const std::vector<std::pair<std::string, std::string>> &targets,
+    const RefreshScopes *scopes) {
+  const bool full_poll = scopes == nullptr;
+  PollCycle cycle;
+  // In batched GraphQL mode every pull request listing is fetched up front
+  // in a handful of aliased queries; jobs consume the prefetched results and
+  // only list on their own when a repository's batch failed.
+  if (full_poll && graphql_client_ && graphql_batch_size_ > 0) {
+    std::vector<std::pair<std::string, std::string>> batch_repos;
+    for (const auto &repo : targets) {
+      RepositoryOptions options =
+          effective_repository_options(repo.first, repo.second);
+      if (!options.purge_only &&
+          (!options.only_poll_stray || options.only_poll_prs)) {
+        batch_repos.push_back(repo);
       }
-      if (!skip_branch_ops) {
-        std::string default_branch;
-        auto branches =
-            client_.list_branches(repo.first, repo.second, &default_branch);
-        total_branch_count.fetch_add(branches.size(),
-                                     std::memory_order_relaxed);
-        if (log_cb_) {
-          std::lock_guard<std::mutex> lk(log_mutex);
-          log_cb_(repo.first + "/" + repo.second +
-                  " branches: " + std::to_string(branches.size()));
-        } else {
-          poller_log()->info("Fetched {} branches for {}/{}", branches.size(),
-                             repo.first, repo.second);
-        }
-        std::unordered_set<std::string> new_branches;
-        {
-          std::lock_guard<std::mutex> lk(known_branches_mutex_);
-          auto &known = known_branches_[repo.first + "/" + repo.second];
-          for (const auto &branch : branches) {
-            if (known.insert(branch).second) {
-              new_branches.insert(branch);
-            }
-          }
-        }
-        std::vector<std::string> stray;
-        std::unordered_set<std::string> seen_branches;
-        auto record_branch = [&](const std::string &branch) {
-          if (seen_branches.insert(branch).second) {
-            stray.push_back(branch);
-          }
-        };
-        if (uses_rule_based(stray_detection_mode_)) {
-          for (const auto &branch : branches) {
-            if (!options.purge_prefix.empty() &&
-                branch.rfind(options.purge_prefix, 0) == 0) {
-              continue;
-            }
-            record_branch(branch);
-          }
-        }
-        if (uses_heuristic(stray_detection_mode_) && !default_branch.empty()) {
-          auto heuristic_branches = client_.detect_stray_branches(
-              repo.first, repo.second, default_branch, branches,
-              protected_branches_, protected_branch_excludes_);
-          for (const auto &branch : heuristic_branches) {
-            if (!options.purge_prefix.empty() &&
-                branch.rfind(options.purge_prefix, 0) == 0) {
-              continue;
-            }
-            record_branch(branch);
-          }
-        }
-        if (log_cb_) {
-          std::lock_guard<std::mutex> lk(log_mutex);
-          log_cb_(repo.first + "/" + repo.second +
-                  " stray branches: " + std::to_string(stray.size()));
-        } else {
-          poller_log()->info("{} / {} stray branches: {}", repo.first,
-                             repo.second, stray.size());
-        }
-        if (!stray.empty()) {
-          std::lock_guard<std::mutex> lk(stray_mutex);
-          for (const auto &branch : stray) {
-            all_stray.push_back(StrayBranch{repo.first, repo.second, branch});
-          }
-        }
-        std::unordered_set<std::string> stray_lookup(stray.begin(),
-                                                     stray.end());
-        for (const auto &branch : stray) {
-          BranchMetadata metadata{repo.first, repo.second,
-                                  branch,     "stray",
-                                  true,       new_branches.count(branch) > 0};
-          BranchAction action = branch_rule_engine_.decide(metadata);
-          if (!options.delete_stray) {
-            if (action == BranchAction::kDelete) {
-              std::string state_key = normalize_rule_state(metadata.state);
-              bool explicit_rule = false;
-              if (!state_key.empty()) {
-                explicit_rule =
-                    explicit_branch_rule_states_.count(state_key) > 0;
-              }
-              if (!explicit_rule && metadata.stray) {
-                explicit_rule = explicit_branch_rule_states_.count("stray") > 0;
-              }
-              if (!explicit_rule) {
-                action = BranchAction::kKeep;
-              }
-            } else {
-              action = BranchAction::kKeep;
-            }
-          }
-          if (action == BranchAction::kDelete) {
-            bool deleted_directly = client_.delete_branch(
-                repo.first, repo.second, branch, protected_branches_,
-                protected_branch_excludes_);
-            if (deleted_directly) {
-              std::lock_guard<std::mutex> lk(stray_mutex);
-              auto new_end =
-                  std::remove_if(all_stray.begin(), all_stray.end(),
-                                 [&](const StrayBranch &entry) {
-                                   return entry.owner == repo.first &&
-                                          entry.repo == repo.second &&
-                                          entry.name == branch;
-                                 });
-              all_stray.erase(new_end, all_stray.end());
-              if (repo_hooks_enabled) {
-                HookEvent evt{"branch.deleted"};
-                evt.data["owner"] = repo.first;
-                evt.data["repo"] = repo.second;
-                evt.data["branch"] = branch;
-                evt.data["reason"] = "stray";
-                hook_->enqueue(std::move(evt));
-              }
-            }
-            if (!deleted_directly) {
-              auto removed = client_.cleanup_branches(
-                  repo.first, repo.second, branch, protected_branches_,
-                  protected_branch_excludes_);
-              if (!removed.empty()) {
-                std::lock_guard<std::mutex> lk(stray_mutex);
-                for (const auto &name : removed) {
-                  auto new_end =
-                      std::remove_if(all_stray.begin(), all_stray.end(),
-                                     [&](const StrayBranch &entry) {
-                                       return entry.owner == repo.first &&
-                                              entry.repo == repo.second &&
-                                              entry.name == name;
-                                     });
-                  all_stray.erase(new_end, all_stray.end());
-                }
-                if (repo_hooks_enabled) {
-                  for (const auto &name : removed) {
-                    HookEvent evt{"branch.deleted"};
-                    evt.data["owner"] = repo.first;
-                    evt.data["repo"] = repo.second;
-                    evt.data["branch"] = name;
-                    evt.data["reason"] = "stray";
-                    hook_->enqueue(std::move(evt));
-                  }
-                }
-              }
-            }
-          } else if (action == BranchAction::kIgnore) {
-            std::lock_guard<std::mutex> lk(stray_mutex);
-            auto new_end = std::remove_if(all_stray.begin(), all_stray.end(),
-                                          [&](const StrayBranch &entry) {
-                                            return entry.owner == repo.first &&
-                                                   entry.repo == repo.second &&
-                                                   entry.name == branch;
-                                          });
-            all_stray.erase(new_end, all_stray.end());
-          }
-        }
-        for (const auto &branch : new_branches) {
-          if (stray_lookup.find(branch) != stray_lookup.end()) {
-            continue;
-          }
-          BranchMetadata metadata{repo.first, repo.second, branch,
-                                  "new",      false,       true};
-          BranchAction action = branch_rule_engine_.decide(metadata);
-          if (action == BranchAction::kDelete) {
-            auto removed = client_.cleanup_branches(repo.first, repo.second,
-                                                    branch, protected_branches_,
-                                                    protected_branch_excludes_);
-            if (repo_hooks_enabled && !removed.empty()) {
-              for (const auto &name : removed) {
-                HookEvent evt{"branch.deleted"};
-                evt.data["owner"] = repo.first;
-                evt.data["repo"] = repo.second;
-                evt.data["branch"] = name;
-                evt.data["reason"] = "new";
-                hook_->enqueue(std::move(evt));
-              }
-            }
-          }
-        }
+    }
+    auto listings = graphql_client_->list_pull_requests_batch(
+        batch_repos, false, pr_page_size_, graphql_batch_size_);
+    for (std::size_t i = 0; i < batch_repos.size(); ++i) {
+      if (listings[i]) {
+        cycle.batched_prs.emplace(batch_repos[i].first + "/" +
+                                      batch_repos[i].second,
+                                  std::move(*listings[i]));
       }
-      if (!options.purge_prefix.empty()) {
-        BranchMetadata metadata{repo.first, repo.second, options.purge_prefix,
-                                "purge"};
-        BranchAction action = branch_rule_engine_.decide(metadata);
-        if (action == BranchAction::kDelete) {
-          auto removed = client_.cleanup_branches(
-              repo.first, repo.second, options.purge_prefix,
-              protected_branches_, protected_branch_excludes_);
-          if (!removed.empty()) {
-            std::lock_guard<std::mutex> lk(stray_mutex);
-            for (const auto &name : removed) {
-              auto new_end =
-                  std::remove_if(all_stray.begin(), all_stray.end(),
-                                 [&](const StrayBranch &entry) {
-                                   return entry.owner == repo.first &&
-                                          entry.repo == repo.second &&
-                                          entry.name == name;
-                                 });
-              all_stray.erase(new_end, all_stray.end());
-            }
-            if (repo_hooks_enabled) {
-              for (const auto &name : removed) {
-                HookEvent evt{"branch.deleted"};
-                evt.data["owner"] = repo.first;
-                evt.data["repo"] = repo.second;
-                evt.data["branch"] = name;
-                evt.data["reason"] = "purge";
-                hook_->enqueue(std::move(evt));
-              }
-            }
-          }
-          if (notifier_) {
-            notifier_->notify("Purged branches in " + repo.first + "/" +
-                              repo.second);
-          }
-        }
+    }
+    auto rate = graphql_client_->rate_limit_info();
+    poller_log()->debug("Batched GraphQL listing of {} repositories; last "
+                        "cost {} points, {} remaining",
+                        batch_repos.size(), rate.last_cost, rate.remaining);
+  }
+  queue_repositories(cycle, targets, scopes);
+  cycle.wait();
+  if (cycle.error) {
+    std::rethrow_exception(cycle.error);
+  }
+  store_results(cycle, targets, scopes);
+  publish_changes();
+  if (!full_poll) {
+    publish_snapshot();
+    return;
+  }
+  if (pr_cb_) {
+    auto all_prs = cycle.results.pull_requests();
+    sort_pull_requests(all_prs, sort_mode_);
+    pr_cb_(all_prs);
+  }
+  if (stray_cb_) {
+    stray_cb_(cycle.results.stray_branches());
+  }
+  publish_totals(cycle.results.pull_request_count(),
+                 cycle.total_pr_count.load(std::memory_order_relaxed),
+                 cycle.branch_ops ? std::optional<std::size_t>(
+                                        cycle.total_branch_count.load(
+                                            std::memory_order_relaxed))
+                                  : std::nullopt);
+}
+
+/**
+ * Queue the first stage jobs of every repository in @p targets on
+ * @p cycle. Returns without waiting for them.
+ */
+void GitHubPoller::queue_repositories(
+    PollCycle &cycle,
+    const std::vector<std::pair<std::string, std::string>> &targets,
+    const RefreshScopes *scopes) {
+  // Count the loop itself as a stage so stages finishing while later
+  // repositories are still being queued cannot complete the cycle early.
+  cycle.begin_stage();
+  for (const auto &repo : targets) {
+    cycle.results.add_repository(repo.first, repo.second);
+  }
+  for (const auto &repo : targets) {
+    RepoTask task;
+    task.owner = repo.first;
+    task.repo = repo.second;
+    task.name = repo.first + "/" + repo.second;
+    task.options = effective_repository_options(repo.first, repo.second);
+    task.hooks_enabled = task.options.hooks_enabled && hook_;
+    task.webhook = scopes != nullptr;
+    const RefreshScope scope = scope_of(scopes, task.name);
+    bool skip_branch_ops = task.options.only_poll_prs ||
+                           (max_rate_ > 0 && max_rate_ <= 1) ||
+                           !scope.branches;
+    if (!skip_branch_ops) {
+      cycle.branch_ops = true;
+    }
+    if (task.options.purge_only) {
+      poller_log()->debug("purge_only set - skipping repo {}", task.name);
+      if (task.options.purge_prefix.empty() || !scope.branches) {
+        continue;
       }
-      if (!skip_branch_ops) {
-        BranchMetadata dirty_metadata{repo.first, repo.second, std::string{},
-                                      "dirty"};
-        BranchAction dirty_action = branch_rule_engine_.decide(dirty_metadata);
-        if (!options.reject_dirty) {
-          dirty_action = BranchAction::kKeep;
-        }
-        if (dirty_action == BranchAction::kDelete) {
-          client_.close_dirty_branches(repo.first, repo.second,
-                                       protected_branches_,
-                                       protected_branch_excludes_);
-        }
+      spawn_stage(cycle, task.label("purge"), kListingStage,
+                  [this, task] {
+                    auto removed = client_.cleanup_branches(
+                        task.owner, task.repo, task.options.purge_prefix,
+                        protected_branches_, protected_branch_excludes_);
+                    if (task.hooks_enabled && !removed.empty()) {
+                      for (const auto &branch_name : removed) {
+                        HookEvent evt{"branch.deleted"};
+                        evt.data["owner"] = task.owner;
+                        evt.data["repo"] = task.repo;
+                        evt.data["branch"] = branch_name;
+                        evt.data["reason"] = "purge_only";
+                        hook_->enqueue(std::move(evt));
+                      }
+                    }
+                    if (notifier_) {
+                      notifier_->notify("Purged branches in " + task.name);
+                    }
+                  });
+      continue;
+    }
+    if (scope.pull_requests &&
+        (!task.options.only_poll_stray || task.options.only_poll_prs)) {
+      spawn_stage(cycle, task.label("pull requests"), kListingStage,
+                  [this, &cycle, task] { sync_pull_requests(cycle, task); });
+    }
+    if (!skip_branch_ops) {
+      spawn_stage(cycle, task.label("branches"), kListingStage,
+                  [this, &cycle, task] { sync_branches(cycle, task); });
+    } else if (!task.options.purge_prefix.empty() && scope.branches) {
+      spawn_stage(cycle, task.label("purge"), kListingStage,
+                  [this, &cycle, task] { purge_branches(cycle, task); });
+    }
+  }
+  cycle.end_stage();
+}
+
+/**
+ * Replace the stored results of @p targets, limited to @p scopes, with the
+ * ones @p cycle collected, and record what changed for the change feed.
+ */
+void GitHubPoller::store_results(
+    const PollCycle &cycle,
+    const std::vector<std::pair<std::string, std::string>> &targets,
+    const RefreshScopes *scopes) {
+  std::lock_guard<std::mutex> lk(results_mutex_);
+  for (const auto &repo : targets) {
+    const std::string repo_name = repo.first + "/" + repo.second;
+    const RefreshScope scope = scope_of(scopes, repo_name);
+    if (scope.pull_requests && cycle.failed_listings.count(repo_name) == 0) {
+      auto [stored, first] = repo_prs_.try_emplace(repo_name);
+      auto latest = cycle.results.pull_requests(repo_name);
+      diff_pull_requests(stored->second, latest, first,
+                         pending_changes_.pull_requests);
+      stored->second = std::move(latest);
+    }
+    if (scope.branches) {
+      auto [stored, first] = repo_stray_.try_emplace(repo_name);
+      auto latest = cycle.results.stray_branches(repo_name);
+      diff_branches(stored->second, latest, first, pending_changes_.branches);
+      stored->second = std::move(latest);
+    }
+  }
+}
+
+/**
+ * Hand the changes recorded since the last call to the change callback
+ * and the hook dispatcher as one change set.
+ *
+ * Records of a repository's first poll reach the callback but not the
+ * hooks, so starting up does not fire an event per open pull request.
+ */
+void GitHubPoller::publish_changes() {
+  std::lock_guard<std::mutex> feed(feed_mutex_);
+  ChangeSet changes;
+  {
+    std::lock_guard<std::mutex> lk(results_mutex_);
+    if (pending_changes_.empty()) {
+      return;
+    }
+    changes = std::exchange(pending_changes_, ChangeSet{});
+  }
+  changes.sequence = ++change_sequence_;
+  changed_since_export_.store(true, std::memory_order_relaxed);
+  poller_log()->debug("Change set {}: {} pull request and {} branch changes",
+                      changes.sequence, changes.pull_requests.size(),
+                      changes.branches.size());
+  if (hook_) {
+    for (const auto &change : changes.pull_requests) {
+      const PullRequest &pr = change.pull_request;
+      if (change.initial ||
+          !effective_repository_options(pr.owner, pr.repo).hooks_enabled) {
+        continue;
+      }
+      HookEvent evt{std::string("pull_request.") +
+                    change_kind_name(change.kind)};
+      evt.data["id"] = change.id;
+      evt.data["sequence"] = changes.sequence;
+      evt.data["number"] = pr.number;
+      evt.data["owner"] = pr.owner;
+      evt.data["repo"] = pr.repo;
+      evt.data["title"] = pr.title;
+      hook_->enqueue(std::move(evt));
+    }
+    for (const auto &change : changes.branches) {
+      const StrayBranch &branch = change.branch;
+      if (change.initial ||
+          !effective_repository_options(branch.owner, branch.repo)
+               .hooks_enabled) {
+        continue;
+      }
+      HookEvent evt{std::string("stray_branch.") +
+                    change_kind_name(change.kind)};
+      evt.data["id"] = change.id;
+      evt.data["sequence"] = changes.sequence;
+      evt.data["owner"] = branch.owner;
+      evt.data["repo"] = branch.repo;
+      evt.data["branch"] = branch.name;
+      hook_->enqueue(std::move(evt));
+    }
+  }
+  if (change_cb_) {
+    change_cb_(changes);
+  }
+}
+
+/**
+ * Notify the callbacks with the stored results of every repository.
+ *
+ * @return Number of pull requests published.
+ */
+std::size_t GitHubPoller::publish_snapshot() {
+  if (!pr_cb_ && !stray_cb_) {
+    // Change feed consumers already have everything; skip the full copy.
+    std::size_t published = 0;
+    {
+      std::lock_guard<std::mutex> lk(results_mutex_);
+      for (const auto &entry : repo_prs_) {
+        published += entry.second.size();
+      }
+    }
+    save_pr_state();
+    return published;
+  }
+  std::vector<PullRequest> all_prs;
+  std::vector<StrayBranch> all_stray;
+  {
+    std::lock_guard<std::mutex> lk(results_mutex_);
+    for (const auto &repo : repos_) {
+      const std::string repo_name = repo.first + "/" + repo.second;
+      auto prs = repo_prs_.find(repo_name);
+      if (prs != repo_prs_.end()) {
+        all_prs.insert(all_prs.end(), prs->second.begin(), prs->second.end());
+      }
+      auto stray = repo_stray_.find(repo_name);
+      if (stray != repo_stray_.end()) {
+        all_stray.insert(all_stray.end(), stray->second.begin(),
+                         stray->second.end());
       }
-    }));
+    }
   }
-  for (auto &f : futures) {
-    f.get();
+  sort_pull_requests(all_prs, sort_mode_);
+  if (pr_cb_) {
+    pr_cb_(all_prs);
   }
-  const std::size_t total_prs = total_pr_count.load(std::memory_order_relaxed);
+  if (stray_cb_) {
+    stray_cb_(all_stray);
+  }
+  save_pr_state();
+  return all_prs.size();
+}
+
+/**
+ * Log the poll totals, fire the threshold hooks and run the export
+ * callback. @p total_branches is empty when no repository listed branches.
+ */
+void GitHubPoller::publish_totals(std::size_t published_prs,
+                                  std::size_t total_prs,
+                                  std::optional<std::size_t> total_branches) {
   if (log_cb_) {
-    std::lock_guard<std::mutex> lk(log_mutex);
     log_cb_("Total pull requests fetched: " + std::to_string(total_prs));
   } else {
     poller_log()->info("Total pull requests fetched: {}", total_prs);
@@ -778,28 +994,18 @@ void GitHubPoller::poll() {
       hook_pull_threshold_triggered_ = false;
     }
   }
-  sort_pull_requests(all_prs, sort_mode_);
-  if (pr_cb_) {
-    pr_cb_(all_prs);
-  }
-  if (stray_cb_) {
-    stray_cb_(all_stray);
-  }
-  if (!all_repos_skipped_branch_ops) {
-    const std::size_t total_branches =
-        total_branch_count.load(std::memory_order_relaxed);
+  if (total_branches) {
     if (log_cb_) {
-      std::lock_guard<std::mutex> lk(log_mutex);
-      log_cb_("Total branches fetched: " + std::to_string(total_branches));
+      log_cb_("Total branches fetched: " + std::to_string(*total_branches));
     } else {
-      poller_log()->info("Total branches fetched: {}", total_branches);
+      poller_log()->info("Total branches fetched: {}", *total_branches);
     }
     if (hook_ && hook_branch_threshold_ > 0) {
       bool exceeded =
-          total_branches > static_cast<std::size_t>(hook_branch_threshold_);
+          *total_branches > static_cast<std::size_t>(hook_branch_threshold_);
       if (exceeded && !hook_branch_threshold_triggered_) {
         HookEvent evt{"poll.branch_threshold"};
-        evt.data["total_branches"] = total_branches;
+        evt.data["total_branches"] = *total_branches;
         evt.data["threshold"] = hook_branch_threshold_;
         hook_->enqueue(std::move(evt));
         hook_branch_threshold_triggered_ = true;
@@ -811,12 +1017,810 @@ void GitHubPoller::poll() {
     hook_branch_threshold_triggered_ = false;
   }
   if (export_cb_) {
-    poller_log()->info("Running export callback");
-    export_cb_();
+    if (changed_since_export_.exchange(false, std::memory_order_relaxed)) {
+      poller_log()->info("Running export callback");
+      export_cb_();
+    } else {
+      poller_log()->debug("Skipping export; nothing changed since the last");
+    }
+  }
+  save_pr_state();
+  prune_decisions();
+  if (log_cb_ && !total_branches) {
+    log_cb_("Polled " + std::to_string(published_prs) + " pull requests");
+  }
+}
+
+/**
+ * Streaming mode: poll every repository on its own schedule and publish its
+ * results as soon as its chains finish, instead of waiting for the slowest
+ * repository of a cycle. Runs on the poller thread until stop().
+ */
+void GitHubPoller::stream_loop() {
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto &repo : repos_) {
+    StreamState &state = stream_state_[repo.first + "/" + repo.second];
+    state.repo = repo;
+    state.next_due = now;
+    state.interval = std::clamp(std::chrono::milliseconds(interval_ms_),
+                                adaptive_min_, adaptive_max_);
+  }
+  next_stream_totals_ = now;
+  while (true) {
+    std::vector<std::string> finished;
+    {
+      std::lock_guard<std::mutex> lk(refresh_mutex_);
+      finished.swap(stream_finished_);
+    }
+    for (const auto &repo_name : finished) {
+      publish_stream_result(repo_name);
+    }
+    const bool in_flight =
+        std::any_of(stream_state_.begin(), stream_state_.end(),
+                    [](const auto &entry) { return entry.second.cycle; });
+    if (!running_) {
+      if (!in_flight) {
+        break;
+      }
+      // Let the cycles already queued finish before the pool stops.
+      std::unique_lock<std::mutex> lk(refresh_mutex_);
+      refresh_cv_.wait(lk, [this] { return !stream_finished_.empty(); });
+      continue;
+    }
+    launch_due_repositories();
+    refresh_pending();
+    auto wake = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(std::max(interval_ms_, 1));
+    for (const auto &[name, state] : stream_state_) {
+      if (!state.cycle) {
+        wake = std::min(wake, state.next_due);
+      }
+    }
+    std::unique_lock<std::mutex> lk(refresh_mutex_);
+    refresh_cv_.wait_until(lk, wake, [this] {
+      return !running_ || !pending_refresh_.empty() ||
+             !stream_finished_.empty();
+    });
+  }
+}
+
+/**
+ * Queue a poll cycle for every idle repository whose next poll is due.
+ */
+void GitHubPoller::launch_due_repositories() {
+  adjust_rate_budget();
+  const auto now = std::chrono::steady_clock::now();
+  for (auto &[name, state] : stream_state_) {
+    if (state.cycle || state.next_due > now) {
+      continue;
+    }
+    auto cycle = std::make_shared<PollCycle>();
+    cycle->on_complete = [this, repo_name = name] {
+      {
+        std::lock_guard<std::mutex> lk(refresh_mutex_);
+        stream_finished_.push_back(repo_name);
+      }
+      refresh_cv_.notify_all();
+    };
+    state.cycle = cycle;
+    poller_log()->debug("Polling {}", name);
+    queue_repositories(*cycle, {state.repo}, nullptr);
+  }
+}
+
+/**
+ * Store and publish the finished cycle of @p repo_name and schedule its
+ * next poll.
+ */
+void GitHubPoller::publish_stream_result(const std::string &repo_name) {
+  StreamState &state = stream_state_[repo_name];
+  std::shared_ptr<PollCycle> cycle = std::move(state.cycle);
+  if (!cycle) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (cycle->error) {
+    state.next_due = now + next_stream_interval(state);
+    try {
+      std::rethrow_exception(cycle->error);
+    } catch (const std::exception &e) {
+      poller_log()->warn("Polling {} failed: {}", repo_name, e.what());
+    }
+    return;
+  }
+  if (adaptive_intervals_) {
+    const std::size_t fingerprint = cycle->fingerprint();
+    if (state.fingerprint) {
+      // Halve the interval of a repository that changed since its last
+      // poll and double it for one that did not.
+      state.interval = *state.fingerprint != fingerprint
+                           ? std::max(adaptive_min_, state.interval / 2)
+                           : std::min(adaptive_max_, state.interval * 2);
+    }
+    state.fingerprint = fingerprint;
+  }
+  state.next_due = now + next_stream_interval(state);
+  store_results(*cycle, {state.repo}, nullptr);
+  publish_changes();
+  if (cycle->branch_ops) {
+    state.branch_count = cycle->total_branch_count.load();
+  } else {
+    state.branch_count.reset();
+  }
+  const std::size_t published = publish_snapshot();
+  if (now < next_stream_totals_) {
+    return;
+  }
+  // Totals, threshold hooks and exports cover the merged snapshot and run
+  // at most once per poll interval.
+  next_stream_totals_ = now + std::chrono::milliseconds(interval_ms_);
+  std::optional<std::size_t> total_branches;
+  for (const auto &entry : stream_state_) {
+    if (entry.second.branch_count) {
+      total_branches =
+          total_branches.value_or(0) + *entry.second.branch_count;
+    }
+  }
+  publish_totals(published, published, total_branches);
+}
+
+/**
+ * Delay until the next poll of @p state's repository. Adaptive intervals
+ * are stretched evenly when together they would poll faster than one full
+ * cycle per poll interval, the pace adjust_rate_budget() budgets for.
+ */
+std::chrono::milliseconds
+GitHubPoller::next_stream_interval(const StreamState &state) const {
+  const auto interval = std::chrono::milliseconds(std::max(interval_ms_, 1));
+  if (!adaptive_intervals_) {
+    return interval;
+  }
+  const double budget = static_cast<double>(stream_state_.size()) /
+                        static_cast<double>(interval.count());
+  double demand = 0.0;
+  for (const auto &entry : stream_state_) {
+    demand += 1.0 / static_cast<double>(
+                        std::max<std::int64_t>(entry.second.interval.count(), 1));
+  }
+  const double scale = std::max(1.0, demand / budget);
+  return std::chrono::milliseconds(static_cast<std::int64_t>(
+      std::ceil(static_cast<double>(state.interval.count()) * scale)));
+}
+
+/**
+ * Pull request chain, stage 1: list the repository's open pull requests and
+ * queue a metadata job for each one that auto-merge must evaluate.
+ */
+void GitHubPoller::sync_pull_requests(PollCycle &cycle, const RepoTask &task) {
+  const std::optional<std::vector<PullRequest>> listed =
+      [this, &cycle, &task]() -> std::optional<std::vector<PullRequest>> {
+    auto batched = cycle.batched_prs.find(task.name);
+    if (batched != cycle.batched_prs.end()) {
+      return batched->second;
+    }
+    if (graphql_client_) {
+      return graphql_client_->list_pull_requests(task.owner, task.repo, false,
+                                                 pr_page_size_);
+    }
+    bool complete = true;
+    std::vector<PullRequest> prs;
+    if (max_rate_ > 0 && max_rate_ <= 1) {
+      // Tests require a single HTTP request when rate is extremely low
+      prs = client_.list_open_pull_requests_single(task.name, 100, &complete);
+    } else if (incremental_listing_) {
+      prs = list_pull_requests_incremental(task.owner, task.repo);
+    } else {
+      prs = client_.list_pull_requests(task.owner, task.repo, false,
+                                       pr_page_size_, std::chrono::seconds{0},
+                                       &complete);
+    }
+    if (!complete) {
+      return std::nullopt;
+    }
+    return prs;
+  }();
+  if (!listed) {
+    // An empty or partial listing would read as closed pull requests; keep
+    // the last one instead and skip merging until the next cycle.
+    poller_log()->warn("Listing pull requests for {} failed; keeping the "
+                       "previous results",
+                       task.name);
+    {
+      std::lock_guard<std::mutex> lk(cycle.failed_mutex);
+      cycle.failed_listings.insert(task.name);
+    }
+    std::lock_guard<std::mutex> lk(results_mutex_);
+    auto stored = repo_prs_.find(task.name);
+    if (stored != repo_prs_.end()) {
+      cycle.results.add_pull_requests(task.name, stored->second);
+    }
+    return;
+  }
+  const std::vector<PullRequest> &prs = *listed;
+  cycle.results.add_pull_requests(task.name, prs);
+  if (history_) {
+    std::lock_guard<std::mutex> lk(cycle.history_mutex);
+    for (const auto &pr : prs) {
+      history_->insert(pr.number, pr.title, pr.merged);
+    }
+  }
+  cycle.total_pr_count.fetch_add(prs.size(), std::memory_order_relaxed);
+  if (log_cb_) {
+    std::lock_guard<std::mutex> lk(cycle.log_mutex);
+    log_cb_(task.name + " pull requests: " + std::to_string(prs.size()));
+  } else {
+    poller_log()->info("Fetched {} pull requests for {}/{}", prs.size(),
+                       task.owner, task.repo);
+  }
+  if (!task.options.auto_merge) {
+    return;
+  }
+  auto batch = std::make_shared<MergeBatch>();
+  std::vector<std::size_t> missing;
+  for (const auto &pr : prs) {
+    // GraphQL listings already carry merge metadata; only fall back to a
+    // per-PR REST request when it is missing and the pull request changed
+    // since it was last left waiting.
+    if (!pr.metadata) {
+      if (cached_decision(pr)) {
+        decision_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      missing.push_back(batch->prs.size());
+    }
+    batch->prs.push_back(pr);
+    batch->metadata.push_back(pr.metadata);
+  }
+  if (batch->prs.empty()) {
+    return;
+  }
+  batch->fetched.assign(batch->prs.size(), 0);
+  auto spawn_merge = [this, &cycle, task, batch] {
+    spawn_stage(cycle, task.label("merge"), kFollowUpStage,
+                [this, &cycle, task, batch] {
+                  merge_pull_requests(cycle, task, *batch);
+                });
+  };
+  if (missing.empty()) {
+    spawn_merge();
+    return;
+  }
+  batch->pending.store(missing.size());
+  for (std::size_t index : missing) {
+    const PullRequest &pr = batch->prs[index];
+    spawn_stage(cycle,
+                task.label("#" + std::to_string(pr.number) + " metadata"),
+                kListingStage,
+                [this, batch, index, spawn_merge] {
+                  const PullRequest &pr = batch->prs[index];
+                  batch->metadata[index] = client_.pull_request_metadata(
+                      pr.owner, pr.repo, pr.number);
+                  batch->fetched[index] = batch->metadata[index].has_value();
+                  // The last metadata job to finish releases the merge stage.
+                  if (batch->pending.fetch_sub(1) == 1) {
+                    spawn_merge();
+                  }
+                });
+  }
+}
+
+/**
+ * Pull request chain, stage 3: apply the rule engine's decision to every
+ * pull request in @p batch. Merges of one repository run in sequence.
+ */
+void GitHubPoller::merge_pull_requests(PollCycle &cycle, const RepoTask &task,
+                                       const MergeBatch &batch) {
+  auto remove_pr = [&cycle, &task](const PullRequest &target) {
+    if (cycle.results.remove_pull_request(task.name, target.number)) {
+      cycle.total_pr_count.fetch_sub(1, std::memory_order_relaxed);
+    }
+  };
+  for (std::size_t i = 0; i < batch.prs.size(); ++i) {
+    const PullRequest &pr = batch.prs[i];
+    const std::optional<PullRequestMetadata> &metadata = batch.metadata[i];
+    if (!metadata) {
+      continue;
+    }
+    PullRequestAction action = rule_engine_.decide(*metadata);
+    if (batch.fetched[i]) {
+      remember_decision(pr, *metadata, action);
+    }
+    if (dry_run_) {
+      if (action == PullRequestAction::kMerge) {
+        client_.merge_pull_request(pr.owner, pr.repo, pr.number, *metadata);
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("Would merge PR #" + std::to_string(pr.number));
+        }
+      } else if (action == PullRequestAction::kClose) {
+        client_.close_pull_request(pr.owner, pr.repo, pr.number);
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("Would close PR #" + std::to_string(pr.number));
+        }
+      }
+      continue;
+    }
+    if (action == PullRequestAction::kMerge) {
+      bool merged =
+          client_.merge_pull_request(pr.owner, pr.repo, pr.number, *metadata);
+      if (merged) {
+        if (history_) {
+          std::lock_guard<std::mutex> lk(cycle.history_mutex);
+          history_->update_merged(pr.number);
+          changed_since_export_.store(true, std::memory_order_relaxed);
+        }
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("Merged PR #" + std::to_string(pr.number));
+        }
+        if (notifier_) {
+          notifier_->notify("Merged PR #" + std::to_string(pr.number) +
+                            " in " + pr.owner + "/" + pr.repo);
+        }
+        if (task.hooks_enabled) {
+          HookEvent evt{"pull_request.merged"};
+          evt.data["number"] = pr.number;
+          evt.data["owner"] = pr.owner;
+          evt.data["repo"] = pr.repo;
+          evt.data["title"] = pr.title;
+          evt.data["mergeable_state"] = metadata->mergeable_state;
+          evt.data["mergeable"] = metadata->mergeable;
+          evt.data["draft"] = metadata->draft;
+          hook_->enqueue(std::move(evt));
+        }
+        remove_pr(pr);
+      } else {
+        if (task.hooks_enabled) {
+          HookEvent evt{"pull_request.merge_failed"};
+          evt.data["number"] = pr.number;
+          evt.data["owner"] = pr.owner;
+          evt.data["repo"] = pr.repo;
+          evt.data["title"] = pr.title;
+          evt.data["mergeable_state"] = metadata->mergeable_state;
+          evt.data["mergeable"] = metadata->mergeable;
+          evt.data["draft"] = metadata->draft;
+          hook_->enqueue(std::move(evt));
+        }
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("PR #" + std::to_string(pr.number) +
+                  " did not meet merge requirements");
+        }
+      }
+    } else if (action == PullRequestAction::kClose) {
+      bool closed = client_.close_pull_request(pr.owner, pr.repo, pr.number);
+      if (closed) {
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("Closed PR #" + std::to_string(pr.number));
+        }
+        if (notifier_) {
+          notifier_->notify("Closed PR #" + std::to_string(pr.number) +
+                            " in " + pr.owner + "/" + pr.repo);
+        }
+        if (task.hooks_enabled) {
+          HookEvent evt{"pull_request.closed"};
+          evt.data["number"] = pr.number;
+          evt.data["owner"] = pr.owner;
+          evt.data["repo"] = pr.repo;
+          evt.data["title"] = pr.title;
+          hook_->enqueue(std::move(evt));
+        }
+        remove_pr(pr);
+      } else {
+        if (task.hooks_enabled) {
+          HookEvent evt{"pull_request.close_failed"};
+          evt.data["number"] = pr.number;
+          evt.data["owner"] = pr.owner;
+          evt.data["repo"] = pr.repo;
+          evt.data["title"] = pr.title;
+          hook_->enqueue(std::move(evt));
+        }
+        if (log_cb_) {
+          std::lock_guard<std::mutex> lk(cycle.log_mutex);
+          log_cb_("PR #" + std::to_string(pr.number) + " could not be closed");
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Branch chain, stage 1: list the repository's branches, note the ones not
+ * seen before and queue stray detection.
+ */
+void GitHubPoller::sync_branches(PollCycle &cycle, const RepoTask &task) {
+  std::string default_branch;
+  std::unordered_map<std::string, std::string> branch_shas;
+  auto branches = client_.list_branches(task.owner, task.repo,
+                                        &default_branch, &branch_shas);
+  cycle.total_branch_count.fetch_add(branches.size(),
+                                     std::memory_order_relaxed);
+  if (log_cb_) {
+    std::lock_guard<std::mutex> lk(cycle.log_mutex);
+    log_cb_(task.name + " branches: " + std::to_string(branches.size()));
+  } else {
+    poller_log()->info("Fetched {} branches for {}/{}", branches.size(),
+                       task.owner, task.repo);
+  }
+  std::size_t digest = 0;
+  for (const auto &branch : branches) {
+    auto sha = branch_shas.find(branch);
+    digest ^= std::hash<std::string>{}(
+        branch + "@" + (sha != branch_shas.end() ? sha->second : ""));
+  }
+  cycle.branch_digest.fetch_xor(digest);
+  std::unordered_set<std::string> new_branches;
+  {
+    std::lock_guard<std::mutex> lk(known_branches_mutex_);
+    auto &known = known_branches_[task.name];
+    for (const auto &branch : branches) {
+      if (known.insert(branch).second) {
+        new_branches.insert(branch);
+      }
+    }
+  }
+  spawn_stage(cycle, task.label("stray"), kAnalysisStage,
+              [this, &cycle, task, branches = std::move(branches),
+               default_branch = std::move(default_branch),
+               branch_shas = std::move(branch_shas),
+               new_branches = std::move(new_branches)]() mutable {
+                detect_stray(cycle, task, branches, default_branch,
+                             branch_shas, std::move(new_branches));
+              });
+}
+
+/**
+ * Branch chain, stage 2: classify stray branches with the configured
+ * engines, record them and queue the cleanup stage.
+ */
+void GitHubPoller::detect_stray(
+    PollCycle &cycle, const RepoTask &task,
+    const std::vector<std::string> &branches,
+    const std::string &default_branch,
+    std::unordered_map<std::string, std::string> &branch_shas,
+    std::unordered_set<std::string> new_branches) {
+  std::vector<std::string> stray;
+  std::unordered_set<std::string> seen_branches;
+  auto record_branch = [&](const std::string &branch) {
+    if (seen_branches.insert(branch).second) {
+      stray.push_back(branch);
+    }
+  };
+  const std::string &purge_prefix = task.options.purge_prefix;
+  if (uses_rule_based(stray_detection_mode_)) {
+    for (const auto &branch : branches) {
+      if (!purge_prefix.empty() && branch.rfind(purge_prefix, 0) == 0) {
+        continue;
+      }
+      record_branch(branch);
+    }
+  }
+  if (uses_heuristic(stray_detection_mode_) && !default_branch.empty()) {
+    auto heuristic_branches = client_.detect_stray_branches(
+        task.owner, task.repo, default_branch, branches, protected_branches_,
+        protected_branch_excludes_, &branch_shas);
+    for (const auto &branch : heuristic_branches) {
+      if (!purge_prefix.empty() && branch.rfind(purge_prefix, 0) == 0) {
+        continue;
+      }
+      record_branch(branch);
+    }
+  }
+  if (log_cb_) {
+    std::lock_guard<std::mutex> lk(cycle.log_mutex);
+    log_cb_(task.name + " stray branches: " + std::to_string(stray.size()));
+  } else {
+    poller_log()->info("{} / {} stray branches: {}", task.owner, task.repo,
+                       stray.size());
+  }
+  cycle.results.add_stray_branches(task.name, stray);
+  spawn_stage(cycle, task.label("branch cleanup"), kFollowUpStage,
+              [this, &cycle, task, stray = std::move(stray),
+               new_branches = std::move(new_branches)] {
+                clean_branches(cycle, task, stray, new_branches);
+              });
+}
+
+/**
+ * Branch chain, stage 3: apply the branch rules to stray and new branches,
+ * purge the configured prefix and close dirty branches.
+ */
+void GitHubPoller::clean_branches(
+    PollCycle &cycle, const RepoTask &task,
+    const std::vector<std::string> &stray,
+    const std::unordered_set<std::string> &new_branches) {
+  const RepositoryOptions &options = task.options;
+  for (const auto &branch : stray) {
+    BranchMetadata metadata{task.owner, task.repo,
+                            branch,     "stray",
+                            true,       new_branches.count(branch) > 0};
+    BranchAction action = branch_rule_engine_.decide(metadata);
+    if (!options.delete_stray) {
+      if (action == BranchAction::kDelete) {
+        std::string state_key = normalize_rule_state(metadata.state);
+        bool explicit_rule = false;
+        if (!state_key.empty()) {
+          explicit_rule = explicit_branch_rule_states_.count(state_key) > 0;
+        }
+        if (!explicit_rule && metadata.stray) {
+          explicit_rule = explicit_branch_rule_states_.count("stray") > 0;
+        }
+        if (!explicit_rule) {
+          action = BranchAction::kKeep;
+        }
+      } else {
+        action = BranchAction::kKeep;
+      }
+    }
+    if (action == BranchAction::kDelete) {
+      bool deleted_directly =
+          client_.delete_branch(task.owner, task.repo, branch,
+                                protected_branches_, protected_branch_excludes_);
+      if (deleted_directly) {
+        cycle.results.remove_stray_branch(task.name, branch);
+        if (task.hooks_enabled) {
+          HookEvent evt{"branch.deleted"};
+          evt.data["owner"] = task.owner;
+          evt.data["repo"] = task.repo;
+          evt.data["branch"] = branch;
+          evt.data["reason"] = "stray";
+          hook_->enqueue(std::move(evt));
+        }
+      } else {
+        auto removed = client_.cleanup_branches(task.owner, task.repo, branch,
+                                                protected_branches_,
+                                                protected_branch_excludes_);
+        if (!removed.empty()) {
+          for (const auto &name : removed) {
+            cycle.results.remove_stray_branch(task.name, name);
+          }
+          if (task.hooks_enabled) {
+            for (const auto &name : removed) {
+              HookEvent evt{"branch.deleted"};
+              evt.data["owner"] = task.owner;
+              evt.data["repo"] = task.repo;
+              evt.data["branch"] = name;
+              evt.data["reason"] = "stray";
+              hook_->enqueue(std::move(evt));
+            }
+          }
+        }
+      }
+    } else if (action == BranchAction::kIgnore) {
+      cycle.results.remove_stray_branch(task.name, branch);
+    }
+  }
+  std::unordered_set<std::string> stray_lookup(stray.begin(), stray.end());
+  for (const auto &branch : new_branches) {
+    if (stray_lookup.find(branch) != stray_lookup.end()) {
+      continue;
+    }
+    BranchMetadata metadata{task.owner, task.repo, branch, "new", false, true};
+    BranchAction action = branch_rule_engine_.decide(metadata);
+    if (action == BranchAction::kDelete) {
+      auto removed =
+          client_.cleanup_branches(task.owner, task.repo, branch,
+                                   protected_branches_, protected_branch_excludes_);
+      if (task.hooks_enabled && !removed.empty()) {
+        for (const auto &name : removed) {
+          HookEvent evt{"branch.deleted"};
+          evt.data["owner"] = task.owner;
+          evt.data["repo"] = task.repo;
+          evt.data["branch"] = name;
+          evt.data["reason"] = "new";
+          hook_->enqueue(std::move(evt));
+        }
+      }
+    }
+  }
+  if (!options.purge_prefix.empty()) {
+    purge_branches(cycle, task);
+  }
+  BranchMetadata dirty_metadata{task.owner, task.repo, std::string{}, "dirty"};
+  BranchAction dirty_action = branch_rule_engine_.decide(dirty_metadata);
+  if (!options.reject_dirty) {
+    dirty_action = BranchAction::kKeep;
+  }
+  if (dirty_action == BranchAction::kDelete) {
+    client_.close_dirty_branches(task.owner, task.repo, protected_branches_,
+                                 protected_branch_excludes_);
+  }
+}
+
+/**
+ * Delete the branches under the repository's purge prefix when the branch
+ * rules allow it.
+ */
+void GitHubPoller::purge_branches(PollCycle &cycle, const RepoTask &task) {
+  BranchMetadata metadata{task.owner, task.repo, task.options.purge_prefix,
+                          "purge"};
+  BranchAction action = branch_rule_engine_.decide(metadata);
+  if (action != BranchAction::kDelete) {
+    return;
+  }
+  auto removed = client_.cleanup_branches(
+      task.owner, task.repo, task.options.purge_prefix, protected_branches_,
+      protected_branch_excludes_);
+  if (!removed.empty()) {
+    for (const auto &name : removed) {
+      cycle.results.remove_stray_branch(task.name, name);
+    }
+    if (task.hooks_enabled) {
+      for (const auto &name : removed) {
+        HookEvent evt{"branch.deleted"};
+        evt.data["owner"] = task.owner;
+        evt.data["repo"] = task.repo;
+        evt.data["branch"] = name;
+        evt.data["reason"] = "purge";
+        hook_->enqueue(std::move(evt));
+      }
+    }
+  }
+  if (notifier_) {
+    notifier_->notify("Purged branches in " + task.name);
+  }
+}
+
+/**
+ * Fetch the pull requests changed since the repository's watermark and fold
+ * them into its snapshot. A failed listing leaves the snapshot untouched and
+ * serves it as is.
+ */
+std::vector<PullRequest>
+GitHubPoller::list_pull_requests_incremental(const std::string &owner,
+                                             const std::string &repo) {
+  const std::string key = owner + "/" + repo;
+  std::string watermark;
+  {
+    std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+    auto it = pr_snapshots_.find(key);
+    if (it != pr_snapshots_.end()) {
+      watermark = it->second.watermark;
+    }
+  }
+  auto delta =
+      client_.list_pull_requests_since(owner, repo, watermark, pr_page_size_);
+  std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+  PullRequestSnapshot &snapshot = pr_snapshots_[key];
+  if (delta) {
+    for (const auto &pr : delta->closed) {
+      pr_snapshots_dirty_ |= snapshot.open.erase(pr.number) > 0;
+    }
+    for (auto &pr : delta->open) {
+      auto &slot = snapshot.open[pr.number];
+      pr_snapshots_dirty_ |= slot.number != pr.number ||
+                             slot.title != pr.title ||
+                             slot.updated_at != pr.updated_at;
+      slot = std::move(pr);
+    }
+    if (delta->watermark != snapshot.watermark) {
+      snapshot.watermark = delta->watermark;
+      pr_snapshots_dirty_ = true;
+    }
+  }
+  std::vector<PullRequest> prs;
+  prs.reserve(snapshot.open.size());
+  // Newest first, matching the default order of the REST listing.
+  for (auto it = snapshot.open.rbegin(); it != snapshot.open.rend(); ++it) {
+    prs.push_back(it->second);
+  }
+  return prs;
+}
+
+namespace {
+std::string decision_key(const PullRequest &pr) {
+  return pr.owner + "/" + pr.repo + "#" + std::to_string(pr.number);
+}
+} // namespace
+
+/**
+ * Return the cached decision for @p pr if its head SHA and `updated_at`
+ * match and the entry is younger than the TTL.
+ */
+std::optional<GitHubPoller::CachedDecision>
+GitHubPoller::cached_decision(const PullRequest &pr) {
+  if (decision_cache_ttl_.count() <= 0 || pr.head_sha.empty() ||
+      pr.updated_at.empty()) {
+    return std::nullopt;
+  }
+  std::lock_guard<std::mutex> lk(decision_cache_mutex_);
+  auto it = decision_cache_.find(decision_key(pr));
+  if (it == decision_cache_.end()) {
+    return std::nullopt;
+  }
+  const CachedDecision &entry = it->second;
+  if (entry.head_sha != pr.head_sha || entry.updated_at != pr.updated_at ||
+      std::chrono::steady_clock::now() - entry.evaluated >=
+          decision_cache_ttl_) {
+    decision_cache_.erase(it);
+    return std::nullopt;
+  }
+  return entry;
+}
+
+/**
+ * Cache decisions that leave the pull request untouched. Merges and closes
+ * are never cached so a failed attempt is re-evaluated with fresh metadata.
+ */
+void GitHubPoller::remember_decision(const PullRequest &pr,
+                                     const PullRequestMetadata &metadata,
+                                     PullRequestAction action) {
+  if (decision_cache_ttl_.count() <= 0 || pr.head_sha.empty() ||
+      pr.updated_at.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(decision_cache_mutex_);
+  if (action == PullRequestAction::kMerge ||
+      action == PullRequestAction::kClose) {
+    decision_cache_.erase(decision_key(pr));
+    return;
+  }
+  decision_cache_[decision_key(pr)] = {pr.head_sha, pr.updated_at, metadata,
+                                       action,
+                                       std::chrono::steady_clock::now()};
+}
+
+/**
+ * Remove decisions whose TTL has elapsed.
+ */
+void GitHubPoller::prune_decisions() {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lk(decision_cache_mutex_);
+  for (auto it = decision_cache_.begin(); it != decision_cache_.end();) {
+    if (now - it->second.evaluated >= decision_cache_ttl_) {
+      it = decision_cache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * Persist incremental listing state atomically via a temporary file.
+ */
+void GitHubPoller::save_pr_state() {
+  if (pr_state_file_.empty()) {
+    return;
+  }
+  nlohmann::json repos = nlohmann::json::object();
+  {
+    std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+    if (!pr_snapshots_dirty_) {
+      return;
+    }
+    for (const auto &[name, snapshot] : pr_snapshots_) {
+      nlohmann::json pulls = nlohmann::json::array();
+      for (const auto &[number, pr] : snapshot.open) {
+        pulls.push_back({{"number", number},
+                         {"title", pr.title},
+                         {"head_sha", pr.head_sha},
+                         {"updated_at", pr.updated_at}});
+      }
+      repos[name] = {{"watermark", snapshot.watermark},
+                     {"pulls", std::move(pulls)}};
+    }
+    pr_snapshots_dirty_ = false;
+  }
+  const std::string tmp = pr_state_file_ + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << nlohmann::json{{"version", 1}, {"repos", std::move(repos)}}.dump();
+    if (!out) {
+      poller_log()->error("Failed to write pull request state {}", tmp);
+      std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+      pr_snapshots_dirty_ = true;
+      return;
+    }
   }
-  if (log_cb_ && all_repos_skipped_branch_ops) {
-    std::lock_guard<std::mutex> lk(log_mutex);
-    log_cb_("Polled " + std::to_string(all_prs.size()) + " pull requests");
+  std::error_code ec;
+  std::filesystem::rename(tmp, pr_state_file_, ec);
+  if (ec) {
+    poller_log()->error("Failed to replace pull request state {}: {}",
+                        pr_state_file_, ec.message());
+    std::lock_guard<std::mutex> lk(pr_snapshots_mutex_);
+    pr_snapshots_dirty_ = true;
   }
 }
 
@@ -9,6 +9,7 @@
  * variable injection.
  */
 #include "hook.hpp"
+#include "curl_share.hpp"
 #include "log.hpp"
 
 #include <algorithm>
@@ -292,10 +293,8 @@ void HookDispatcher::execute_http(const HookAction &action,
   if (!http_executor_) {
     http_executor_ = [](const HookAction &hook_action, const HookEvent &,
                         const std::string &body) {
-      CURL *curl = curl_easy_init();
-      if (!curl) {
-        throw std::runtime_error("Failed to initialize curl for hook request");
-      }
+      CurlHandleLease lease = CurlSharePool::instance().checkout();
+      CURL *curl = lease.get();
       curl_easy_setopt(curl, CURLOPT_URL, hook_action.endpoint.c_str());
       curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
       struct curl_slist *headers = nullptr;
@@ -336,12 +335,12 @@ void HookDispatcher::execute_http(const HookAction &action,
                          hook_action.method.c_str());
       }
       CURLcode res = curl_easy_perform(curl);
+      CurlSharePool::instance().record_transfer(curl);
       long status = 0;
       if (res == CURLE_OK) {
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
       }
       curl_slist_free_all(headers);
-      curl_easy_cleanup(curl);
       if (res != CURLE_OK) {
         throw std::runtime_error(std::string("Hook HTTP request failed: ") +
                                  curl_easy_strerror(res));
@@ -0,0 +1,588 @@
+/**
+ * @file local_git_repository.cpp
+ * @brief Implementation of the local git commit graph reader.
+ */
+
+#include "local_git_repository.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <zlib.h>
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> local_git_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("local_git");
+  }();
+  return logger;
+}
+
+constexpr int kCommit = 1;
+constexpr int kOfsDelta = 6;
+constexpr int kRefDelta = 7;
+/// Longest delta chain followed before giving up on an object.
+constexpr int kMaxDeltaDepth = 4096;
+/// Parsed commits kept per repository before the cache is reset.
+constexpr std::size_t kMaxCachedCommits = 500000;
+
+using ObjectId = std::array<unsigned char, 20>;
+
+std::optional<ObjectId> parse_object_id(const std::string &hex) {
+  if (hex.size() != 40) {
+    return std::nullopt;
+  }
+  ObjectId id{};
+  for (std::size_t i = 0; i < id.size(); ++i) {
+    auto nibble = [](char c) -> int {
+      if (c >= '0' && c <= '9')
+        return c - '0';
+      if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+      return -1;
+    };
+    int hi = nibble(hex[2 * i]);
+    int lo = nibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      return std::nullopt;
+    }
+    id[i] = static_cast<unsigned char>(hi << 4 | lo);
+  }
+  return id;
+}
+
+std::string format_object_id(const unsigned char *id) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string out(40, '0');
+  for (std::size_t i = 0; i < 20; ++i) {
+    out[2 * i] = kHex[id[i] >> 4];
+    out[2 * i + 1] = kHex[id[i] & 0xf];
+  }
+  return out;
+}
+
+std::uint32_t read_be32(const unsigned char *p) {
+  return static_cast<std::uint32_t>(p[0]) << 24 |
+         static_cast<std::uint32_t>(p[1]) << 16 |
+         static_cast<std::uint32_t>(p[2]) << 8 | static_cast<std::uint32_t>(p[3]);
+}
+
+/// Inflate a zlib stream starting at the current position of @p in into
+/// exactly @p expected bytes.
+std::optional<std::string> inflate_sized(std::istream &in,
+                                         std::size_t expected) {
+  z_stream zs{};
+  if (inflateInit(&zs) != Z_OK) {
+    return std::nullopt;
+  }
+  std::string out(expected, '\0');
+  zs.next_out = reinterpret_cast<Bytef *>(out.data());
+  zs.avail_out = static_cast<uInt>(expected);
+  std::array<char, 8192> buf{};
+  int rc = Z_OK;
+  while (rc != Z_STREAM_END) {
+    if (zs.avail_in == 0) {
+      in.read(buf.data(), buf.size());
+      auto got = in.gcount();
+      if (got <= 0) {
+        break;
+      }
+      zs.next_in = reinterpret_cast<Bytef *>(buf.data());
+      zs.avail_in = static_cast<uInt>(got);
+    }
+    rc = inflate(&zs, Z_NO_FLUSH);
+    if (rc != Z_OK && rc != Z_STREAM_END) {
+      break;
+    }
+  }
+  const bool complete = rc == Z_STREAM_END && zs.total_out == expected;
+  inflateEnd(&zs);
+  if (!complete) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+/// Inflate a complete zlib stream of unknown decompressed size.
+std::optional<std::string> inflate_all(const std::string &compressed) {
+  z_stream zs{};
+  if (inflateInit(&zs) != Z_OK) {
+    return std::nullopt;
+  }
+  zs.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  zs.avail_in = static_cast<uInt>(compressed.size());
+  std::string out;
+  std::array<char, 8192> buf{};
+  int rc = Z_OK;
+  while (rc == Z_OK) {
+    zs.next_out = reinterpret_cast<Bytef *>(buf.data());
+    zs.avail_out = static_cast<uInt>(buf.size());
+    rc = inflate(&zs, Z_NO_FLUSH);
+    out.append(buf.data(), buf.size() - zs.avail_out);
+  }
+  inflateEnd(&zs);
+  if (rc != Z_STREAM_END) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+/// Apply a git delta to @p base.
+std::optional<std::string> apply_delta(const std::string &base,
+                                       const std::string &delta) {
+  std::size_t pos = 0;
+  auto varint = [&]() -> std::optional<std::size_t> {
+    std::size_t value = 0;
+    int shift = 0;
+    while (pos < delta.size()) {
+      auto c = static_cast<unsigned char>(delta[pos++]);
+      value |= static_cast<std::size_t>(c & 0x7f) << shift;
+      shift += 7;
+      if ((c & 0x80) == 0) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  };
+  auto base_size = varint();
+  auto result_size = varint();
+  if (!base_size || !result_size || *base_size != base.size()) {
+    return std::nullopt;
+  }
+  std::string out;
+  out.reserve(*result_size);
+  while (pos < delta.size()) {
+    auto op = static_cast<unsigned char>(delta[pos++]);
+    if (op & 0x80) {
+      std::size_t offset = 0;
+      std::size_t size = 0;
+      for (int i = 0; i < 4; ++i) {
+        if (op & (1 << i)) {
+          if (pos >= delta.size())
+            return std::nullopt;
+          offset |= static_cast<std::size_t>(
+                        static_cast<unsigned char>(delta[pos++]))
+                    << (8 * i);
+        }
+      }
+      for (int i = 0; i < 3; ++i) {
+        if (op & (0x10 << i)) {
+          if (pos >= delta.size())
+            return std::nullopt;
+          size |= static_cast<std::size_t>(
+                      static_cast<unsigned char>(delta[pos++]))
+                  << (8 * i);
+        }
+      }
+      if (size == 0) {
+        size = 0x10000;
+      }
+      if (offset > base.size() || size > base.size() - offset) {
+        return std::nullopt;
+      }
+      out.append(base, offset, size);
+    } else if (op != 0) {
+      if (op > delta.size() - pos) {
+        return std::nullopt;
+      }
+      out.append(delta, pos, op);
+      pos += op;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (out.size() != *result_size) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+} // namespace
+
+/// Version 2 pack index plus an open handle on its packfile.
+struct LocalGitRepository::Pack {
+  std::ifstream data;
+  std::vector<unsigned char> index;
+  std::uint32_t count{0};
+
+  /// Offset of @p id in the packfile, if the pack contains it.
+  std::optional<std::uint64_t> find(const ObjectId &id) const {
+    const unsigned char *fanout = index.data() + 8;
+    std::uint32_t lo = id[0] == 0 ? 0 : read_be32(fanout + 4 * (id[0] - 1));
+    std::uint32_t hi = read_be32(fanout + 4 * id[0]);
+    const unsigned char *ids = fanout + 256 * 4;
+    while (lo < hi) {
+      std::uint32_t mid = lo + (hi - lo) / 2;
+      int cmp = std::memcmp(ids + 20 * static_cast<std::size_t>(mid),
+                            id.data(), 20);
+      if (cmp == 0) {
+        const unsigned char *offsets = ids + 24 * static_cast<std::size_t>(count);
+        std::uint32_t offset = read_be32(offsets + 4 * mid);
+        if ((offset & 0x80000000u) == 0) {
+          return offset;
+        }
+        const unsigned char *large =
+            offsets + 4 * static_cast<std::size_t>(count) +
+            8 * static_cast<std::size_t>(offset & 0x7fffffffu);
+        if (large + 8 > index.data() + index.size()) {
+          return std::nullopt;
+        }
+        return static_cast<std::uint64_t>(read_be32(large)) << 32 |
+               read_be32(large + 4);
+      }
+      if (cmp < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+LocalGitRepository::LocalGitRepository(std::filesystem::path git_dir)
+    : git_dir_(std::move(git_dir)) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(git_dir_ / "objects", ec)) {
+    local_git_log()->debug("No object database in {}", git_dir_.string());
+    return;
+  }
+  if (std::filesystem::exists(git_dir_ / "shallow", ec)) {
+    local_git_log()->info("Ignoring shallow clone {}", git_dir_.string());
+    return;
+  }
+  usable_ = true;
+  load_packs();
+}
+
+LocalGitRepository::~LocalGitRepository() = default;
+
+/**
+ * Read every version 2 pack index under `objects/pack`. Packs with other
+ * index versions are skipped, so their objects read as missing.
+ */
+void LocalGitRepository::load_packs() {
+  std::error_code ec;
+  auto pack_dir = git_dir_ / "objects" / "pack";
+  if (!std::filesystem::is_directory(pack_dir, ec)) {
+    return;
+  }
+  for (const auto &entry : std::filesystem::directory_iterator(pack_dir, ec)) {
+    if (entry.path().extension() != ".idx") {
+      continue;
+    }
+    auto pack = std::make_unique<Pack>();
+    std::ifstream idx(entry.path(), std::ios::binary);
+    pack->index.assign(std::istreambuf_iterator<char>(idx),
+                       std::istreambuf_iterator<char>());
+    const auto &index = pack->index;
+    static constexpr unsigned char kMagic[] = {0xff, 't', 'O', 'c'};
+    if (index.size() < 8 + 256 * 4 ||
+        std::memcmp(index.data(), kMagic, 4) != 0 ||
+        read_be32(index.data() + 4) != 2) {
+      local_git_log()->debug("Skipping unsupported pack index {}",
+                             entry.path().string());
+      continue;
+    }
+    pack->count = read_be32(index.data() + 8 + 255 * 4);
+    if (index.size() < 8 + 256 * 4 + 28 * static_cast<std::size_t>(pack->count)) {
+      continue;
+    }
+    auto pack_path = entry.path();
+    pack_path.replace_extension(".pack");
+    pack->data.open(pack_path, std::ios::binary);
+    if (!pack->data) {
+      continue;
+    }
+    packs_.push_back(std::move(pack));
+  }
+}
+
+std::optional<std::string> LocalGitRepository::read_loose(const std::string &sha) {
+  std::ifstream in(git_dir_ / "objects" / sha.substr(0, 2) / sha.substr(2),
+                   std::ios::binary);
+  if (!in) {
+    return std::nullopt;
+  }
+  std::string compressed((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  return inflate_all(compressed);
+}
+
+/**
+ * Decode the packed object at @p offset, resolving delta chains. The object
+ * type is returned as the first byte of the result.
+ */
+std::optional<std::string> LocalGitRepository::read_packed(Pack &pack,
+                                                           std::uint64_t offset,
+                                                           int depth) {
+  std::vector<std::string> deltas;
+  std::optional<std::string> base;
+  int type = 0;
+  while (!base) {
+    if (static_cast<int>(deltas.size()) + depth > kMaxDeltaDepth) {
+      return std::nullopt;
+    }
+    auto &in = pack.data;
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    int c = in.get();
+    if (c == EOF) {
+      return std::nullopt;
+    }
+    const int object_type = (c >> 4) & 7;
+    std::size_t size = static_cast<std::size_t>(c & 15);
+    int shift = 4;
+    while (c & 0x80) {
+      c = in.get();
+      if (c == EOF) {
+        return std::nullopt;
+      }
+      size |= static_cast<std::size_t>(c & 0x7f) << shift;
+      shift += 7;
+    }
+    if (object_type == kOfsDelta) {
+      c = in.get();
+      if (c == EOF) {
+        return std::nullopt;
+      }
+      std::uint64_t distance = static_cast<std::uint64_t>(c & 0x7f);
+      while (c & 0x80) {
+        c = in.get();
+        if (c == EOF) {
+          return std::nullopt;
+        }
+        distance = ((distance + 1) << 7) | static_cast<std::uint64_t>(c & 0x7f);
+      }
+      auto delta = inflate_sized(in, size);
+      if (!delta || distance > offset) {
+        return std::nullopt;
+      }
+      deltas.push_back(std::move(*delta));
+      offset -= distance;
+    } else if (object_type == kRefDelta) {
+      std::array<unsigned char, 20> base_id{};
+      in.read(reinterpret_cast<char *>(base_id.data()), base_id.size());
+      auto delta = inflate_sized(in, size);
+      if (!in || !delta) {
+        return std::nullopt;
+      }
+      deltas.push_back(std::move(*delta));
+      auto object = read_object(format_object_id(base_id.data()),
+                                depth + static_cast<int>(deltas.size()));
+      if (!object) {
+        return std::nullopt;
+      }
+      type = static_cast<unsigned char>((*object)[0]);
+      base = object->substr(1);
+    } else if (object_type >= 1 && object_type <= 4) {
+      base = inflate_sized(in, size);
+      if (!base) {
+        return std::nullopt;
+      }
+      type = object_type;
+    } else {
+      return std::nullopt;
+    }
+  }
+  std::string result = std::move(*base);
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    auto applied = apply_delta(result, *it);
+    if (!applied) {
+      return std::nullopt;
+    }
+    result = std::move(*applied);
+  }
+  return std::string(1, static_cast<char>(type)) + result;
+}
+
+/**
+ * Read object @p sha from the packs or the loose store. The object type is
+ * returned as the first byte of the result, followed by the content.
+ */
+std::optional<std::string> LocalGitRepository::read_object(const std::string &sha,
+                                                           int depth) {
+  auto id = parse_object_id(sha);
+  if (!id) {
+    return std::nullopt;
+  }
+  for (auto &pack : packs_) {
+    if (auto offset = pack->find(*id)) {
+      return read_packed(*pack, *offset, depth);
+    }
+  }
+  auto loose = read_loose(sha);
+  if (!loose) {
+    return std::nullopt;
+  }
+  auto header_end = loose->find('\0');
+  if (header_end == std::string::npos) {
+    return std::nullopt;
+  }
+  auto space = loose->find(' ');
+  if (space == std::string::npos || space > header_end) {
+    return std::nullopt;
+  }
+  static const std::unordered_map<std::string, int> kTypes = {
+      {"commit", 1}, {"tree", 2}, {"blob", 3}, {"tag", 4}};
+  auto type = kTypes.find(loose->substr(0, space));
+  if (type == kTypes.end()) {
+    return std::nullopt;
+  }
+  return std::string(1, static_cast<char>(type->second)) +
+         loose->substr(header_end + 1);
+}
+
+const LocalGitRepository::Commit *
+LocalGitRepository::commit_unlocked(const std::string &sha) {
+  if (auto it = commits_.find(sha); it != commits_.end()) {
+    return &it->second;
+  }
+  auto object = read_object(sha, 0);
+  if (!object || static_cast<unsigned char>((*object)[0]) != kCommit) {
+    return nullptr;
+  }
+  Commit commit;
+  std::istringstream lines(object->substr(1));
+  std::string line;
+  while (std::getline(lines, line) && !line.empty()) {
+    if (line.rfind("parent ", 0) == 0) {
+      commit.parents.push_back(line.substr(7));
+    } else if (line.rfind("committer ", 0) == 0) {
+      auto email_end = line.rfind('>');
+      if (email_end != std::string::npos) {
+        try {
+          commit.committed_at = std::stoll(line.substr(email_end + 1));
+        } catch (const std::exception &) {
+          commit.committed_at = 0;
+        }
+      }
+    }
+  }
+  return &commits_.emplace(sha, std::move(commit)).first->second;
+}
+
+bool LocalGitRepository::has_commit(const std::string &sha) {
+  if (!usable_) {
+    return false;
+  }
+  std::scoped_lock lock(mutex_);
+  return commit_unlocked(sha) != nullptr;
+}
+
+/**
+ * Walk both histories newest-first, painting commits reachable from the head
+ * and from the base, and stop once every queued commit is reachable from
+ * both. Commits painted by only one side are the ahead and behind counts.
+ */
+std::optional<BranchCompareCache::Comparison>
+LocalGitRepository::compare(const std::string &base_sha,
+                            const std::string &head_sha) {
+  if (!usable_) {
+    return std::nullopt;
+  }
+  std::scoped_lock lock(mutex_);
+  if (commits_.size() > kMaxCachedCommits) {
+    commits_.clear();
+  }
+  const Commit *head = commit_unlocked(head_sha);
+  const Commit *base = commit_unlocked(base_sha);
+  if (head == nullptr || base == nullptr) {
+    return std::nullopt;
+  }
+  BranchCompareCache::Comparison result;
+  result.last_commit = head->committed_at;
+  if (base_sha == head_sha) {
+    result.status = "identical";
+    return result;
+  }
+
+  constexpr unsigned char kFromHead = 1;
+  constexpr unsigned char kFromBase = 2;
+  constexpr unsigned char kFromBoth = kFromHead | kFromBase;
+  struct Entry {
+    std::int64_t committed_at;
+    std::string sha;
+    unsigned char flags;
+    bool operator<(const Entry &other) const {
+      return committed_at < other.committed_at;
+    }
+  };
+  std::unordered_map<std::string, unsigned char> painted;
+  std::unordered_map<std::string, unsigned char> walked;
+  std::priority_queue<Entry> queue;
+  std::size_t live = 0;
+  auto paint = [&](const std::string &sha, std::int64_t when,
+                   unsigned char flags) {
+    unsigned char &current = painted[sha];
+    if ((current | flags) == current) {
+      return;
+    }
+    current |= flags;
+    if (current != kFromBoth) {
+      ++live;
+    }
+    queue.push({when, sha, current});
+  };
+  paint(head_sha, head->committed_at, kFromHead);
+  paint(base_sha, base->committed_at, kFromBase);
+  while (!queue.empty() && live > 0) {
+    Entry entry = queue.top();
+    queue.pop();
+    if (entry.flags != kFromBoth) {
+      --live;
+    }
+    const unsigned char flags = painted[entry.sha];
+    unsigned char &done = walked[entry.sha];
+    if (done == flags) {
+      continue;
+    }
+    done = flags;
+    const Commit *commit = commit_unlocked(entry.sha);
+    if (commit == nullptr) {
+      local_git_log()->debug("Commit {} missing from {}", entry.sha,
+                             git_dir_.string());
+      return std::nullopt;
+    }
+    for (const auto &parent_sha : commit->parents) {
+      const Commit *parent = commit_unlocked(parent_sha);
+      if (parent == nullptr) {
+        local_git_log()->debug("Commit {} missing from {}", parent_sha,
+                               git_dir_.string());
+        return std::nullopt;
+      }
+      paint(parent_sha, parent->committed_at, flags);
+    }
+  }
+  for (const auto &[sha, flags] : painted) {
+    if (flags == kFromHead) {
+      ++result.ahead_by;
+    } else if (flags == kFromBase) {
+      ++result.behind_by;
+    }
+  }
+  if (result.ahead_by > 0 && result.behind_by > 0) {
+    result.status = "diverged";
+  } else if (result.ahead_by > 0) {
+    result.status = "ahead";
+  } else if (result.behind_by > 0) {
+    result.status = "behind";
+  } else {
+    result.status = "identical";
+  }
+  return result;
+}
+
+} // namespace agpm
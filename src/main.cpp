@@ -7,6 +7,8 @@
  * for the application.
  */
 #include "app.hpp"
+#include "async_http_client.hpp"
+#include "curl_share.hpp"
 #include "demo_tui.hpp"
 #include "github_client.hpp"
 #include "github_poller.hpp"
@@ -14,11 +16,16 @@
 #include "hook.hpp"
 #include "log.hpp"
 #include "mcp_server.hpp"
+#include "webhook_server.hpp"
 #include "repo_discovery.hpp"
 #include "tui.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <spdlog/spdlog.h>
@@ -147,17 +154,67 @@ int main(int argc, char **argv) {
       !opts.http_proxy.empty() ? opts.http_proxy : cfg.http_proxy();
   std::string https_proxy =
       !opts.https_proxy.empty() ? opts.https_proxy : cfg.https_proxy();
-  auto http_client = std::make_unique<agpm::CurlHttpClient>(
-      http_timeout * 1000, download_limit, upload_limit, max_download,
-      max_upload, http_proxy, https_proxy);
+  bool http2 = opts.http2 || cfg.http2();
+  int http2_max_streams = opts.http2_max_streams != 100
+                              ? opts.http2_max_streams
+                              : cfg.http2_max_streams();
+  std::unique_ptr<agpm::HttpClient> http_client;
+  if (opts.async_http || cfg.async_http() || http2) {
+    // HTTP/2 multiplexing needs concurrent transfers on one connection,
+    // which only the curl-multi engine provides.
+    http_client = std::make_unique<agpm::CurlMultiHttpClient>(
+        http_timeout * 1000, download_limit, upload_limit, max_download,
+        max_upload, http_proxy, https_proxy, 0, http2,
+        static_cast<long>(http2_max_streams));
+  } else {
+    http_client = std::make_unique<agpm::CurlHttpClient>(
+        http_timeout * 1000, download_limit, upload_limit, max_download,
+        max_upload, http_proxy, https_proxy);
+  }
+  std::string http_cache =
+      !opts.http_cache.empty() ? opts.http_cache : cfg.http_cache();
+  long long http_cache_max_bytes =
+      opts.http_cache_max_bytes != 64LL * 1024 * 1024
+          ? opts.http_cache_max_bytes
+          : cfg.http_cache_max_bytes();
+  int http_cache_flush_ms = opts.http_cache_flush_ms != 5000
+                                ? opts.http_cache_flush_ms
+                                : cfg.http_cache_flush_ms();
+  agpm::HttpClient &rest_transport = *http_client;
   agpm::GitHubClient client(tokens, std::move(http_client), include_set,
                             exclude_set, delay_ms, http_timeout * 1000,
-                            http_retries, api_base, opts.dry_run);
+                            http_retries, api_base, opts.dry_run, http_cache);
+  client.set_cache_max_bytes(static_cast<std::size_t>(http_cache_max_bytes));
+  // AGPM_CACHE_FLUSH_MS, applied by the client itself, takes precedence.
+  if (std::getenv("AGPM_CACHE_FLUSH_MS") == nullptr) {
+    client.set_cache_flush_interval(
+        std::chrono::milliseconds(http_cache_flush_ms));
+  }
+  bool cache_stats = opts.cache_stats || cfg.cache_stats();
   bool allow_delete_base_branch =
       opts.allow_delete_base_branch || cfg.allow_delete_base_branch();
   client.set_allow_delete_base_branch(allow_delete_base_branch);
-  agpm::GitHubGraphQLClient graphql_client(tokens, http_timeout * 1000,
-                                           api_base);
+  client.set_compare_cache_file(!opts.stray_cache.empty() ? opts.stray_cache
+                                                          : cfg.stray_cache());
+  if (opts.local_analysis || cfg.local_analysis()) {
+    if (discovery_roots.empty()) {
+      main_log()->warn("--local-analysis needs --repo-discovery-root; "
+                       "comparing branches through the API");
+    } else {
+      auto clones = agpm::discover_local_clones(discovery_roots);
+      main_log()->info("Comparing branches locally for {} clone(s)",
+                       clones.size());
+      client.set_local_clones(std::move(clones));
+    }
+  }
+  // GraphQL queries go through the REST client's engine, so connections,
+  // HTTP/2 streams and the transfer caps are shared by both APIs.
+  std::unique_ptr<agpm::GitHubGraphQLClient> graphql_client;
+  if (opts.use_graphql || cfg.use_graphql()) {
+    graphql_client = std::make_unique<agpm::GitHubGraphQLClient>(
+        tokens, std::make_unique<agpm::SharedHttpClient>(rest_transport),
+        api_base, http_retries);
+  }
 
   agpm::HookSettings hook_settings;
   std::shared_ptr<agpm::HookDispatcher> hook_dispatcher;
@@ -252,6 +309,15 @@ int main(int argc, char **argv) {
 
   int interval =
       opts.poll_interval != 0 ? opts.poll_interval : cfg.poll_interval();
+  const bool webhook_enabled = opts.webhook_enabled || cfg.webhook_enabled();
+  if (webhook_enabled) {
+    // Webhooks deliver changes as they happen; full polls only reconcile
+    // deliveries that were missed.
+    int reconcile = opts.webhook_reconcile_interval > 0
+                        ? opts.webhook_reconcile_interval
+                        : cfg.webhook_reconcile_interval();
+    interval = std::max(interval, reconcile);
+  }
   int interval_ms = interval * 1000;
 
   bool only_poll_prs = opts.only_poll_prs || cfg.only_poll_prs();
@@ -423,12 +489,39 @@ int main(int argc, char **argv) {
       only_poll_prs, only_poll_stray, stray_detection_mode, reject_dirty,
       purge_prefix, auto_merge, purge_only, sort_mode, &history,
       protected_branches, protected_branch_excludes, opts.dry_run,
-      (opts.use_graphql || cfg.use_graphql()) ? &graphql_client : nullptr,
+      graphql_client.get(),
       delete_stray, rate_limit_margin,
       std::chrono::seconds(rate_limit_refresh_interval),
       retry_rate_limit_endpoint, rate_limit_retry_limit,
       std::move(repo_override_options));
 
+  poller.set_graphql_batch_size(opts.graphql_batch_size != 0
+                                    ? opts.graphql_batch_size
+                                    : cfg.graphql_batch_size());
+  poller.set_pull_request_page_size(opts.pr_limit != 50 ? opts.pr_limit
+                                                        : cfg.pr_limit());
+  poller.set_work_stealing(opts.work_stealing || cfg.work_stealing());
+  poller.set_streaming(opts.stream_results || cfg.stream_results());
+  if (opts.adaptive_intervals || cfg.adaptive_intervals()) {
+    int min_interval = opts.adaptive_min_interval > 0
+                           ? opts.adaptive_min_interval
+                           : cfg.adaptive_min_interval();
+    int max_interval = opts.adaptive_max_interval > 0
+                           ? opts.adaptive_max_interval
+                           : cfg.adaptive_max_interval();
+    poller.set_adaptive_intervals(true, std::chrono::seconds(min_interval),
+                                  std::chrono::seconds(max_interval));
+  }
+  poller.set_priority_rate_reserve(opts.priority_rate_reserve_explicit
+                                       ? opts.priority_rate_reserve
+                                       : cfg.priority_rate_reserve());
+  poller.set_incremental_listing(opts.incremental_prs || cfg.incremental_prs());
+  poller.set_decision_cache_ttl(std::chrono::seconds(
+      opts.decision_cache_ttl != 0 ? opts.decision_cache_ttl
+                                     : cfg.decision_cache_ttl()));
+  poller.set_pr_state_file(!opts.pr_state_file.empty() ? opts.pr_state_file
+                                                       : cfg.pr_state_file());
+
   if (hook_dispatcher) {
     poller.set_hook_dispatcher(hook_dispatcher);
     poller.set_hook_thresholds(hook_settings.pull_threshold,
@@ -445,6 +538,38 @@ int main(int argc, char **argv) {
       }
     });
   }
+  std::unique_ptr<agpm::WebhookHandler> webhook_handler;
+  std::unique_ptr<agpm::WebhookServerRunner> webhook_runner;
+  if (webhook_enabled) {
+    std::string secret = !opts.webhook_secret.empty() ? opts.webhook_secret
+                                                      : cfg.webhook_secret();
+    if (secret.empty()) {
+      if (const char *env = std::getenv("AGPM_WEBHOOK_SECRET")) {
+        secret = env;
+      }
+    }
+    if (secret.empty()) {
+      main_log()->error("--webhook requires --webhook-secret or "
+                        "AGPM_WEBHOOK_SECRET; webhook listener disabled");
+    } else {
+      agpm::WebhookServerOptions webhook_options;
+      webhook_options.bind_address = !opts.webhook_bind_address.empty()
+                                         ? opts.webhook_bind_address
+                                         : cfg.webhook_bind_address();
+      webhook_options.port =
+          opts.webhook_port > 0 ? opts.webhook_port : cfg.webhook_port();
+      webhook_handler = std::make_unique<agpm::WebhookHandler>(secret);
+      webhook_handler->set_event_callback(
+          [&poller](const agpm::WebhookEvent &evt) {
+            poller.handle_webhook(evt);
+          });
+      webhook_runner = std::make_unique<agpm::WebhookServerRunner>(
+          *webhook_handler, webhook_options);
+      main_log()->info("Full reconciliation polls every {}s while webhooks "
+                       "are enabled",
+                       interval);
+    }
+  }
   std::unique_ptr<agpm::GitHubMcpBackend> mcp_backend;
   std::unique_ptr<agpm::McpServer> mcp_server;
   std::unique_ptr<agpm::McpServerRunner> mcp_runner;
@@ -463,6 +588,11 @@ int main(int argc, char **argv) {
                                   : cfg.mcp_server_max_clients();
     mcp_backend = std::make_unique<agpm::GitHubMcpBackend>(
         client, repos, protected_branches, protected_branch_excludes);
+    mcp_backend->set_mutation_runner(
+        [&poller](std::string name, std::function<void()> job) {
+          poller.run_prioritized(std::move(name), std::move(job),
+                                 agpm::Poller::JobPriority::Mutation);
+        });
     mcp_server = std::make_unique<agpm::McpServer>(*mcp_backend);
     std::string listen_host = mcp_options.bind_address.empty()
                                   ? std::string{"0.0.0.0"}
@@ -505,6 +635,9 @@ int main(int argc, char **argv) {
   }
   ui.set_refresh_interval(std::chrono::milliseconds(tui_refresh_ms));
   poller.start();
+  if (webhook_runner && !webhook_runner->start()) {
+    main_log()->error("Webhook listener failed to start; relying on polling");
+  }
   try {
     ui.init();
     if (mcp_runner) {
@@ -515,6 +648,9 @@ int main(int argc, char **argv) {
     if (mcp_runner) {
       mcp_runner->stop();
     }
+    if (webhook_runner) {
+      webhook_runner->stop();
+    }
     poller.stop();
     ui.cleanup();
     throw;
@@ -522,7 +658,34 @@ int main(int argc, char **argv) {
   if (mcp_runner) {
     mcp_runner->stop();
   }
+  if (webhook_runner) {
+    webhook_runner->stop();
+  }
   poller.stop();
   ui.cleanup();
+  auto connection_stats = agpm::CurlSharePool::instance().stats();
+  main_log()->info("HTTP connections: {} opened, {} reused",
+                   connection_stats.new_connections,
+                   connection_stats.reused_connections);
+  if (cache_stats) {
+    auto totals = client.cache_totals();
+    auto coalescing = client.coalescing_stats();
+    std::uint64_t lookups = totals.hits + totals.misses;
+    double hit_ratio =
+        lookups == 0 ? 0.0
+                     : 100.0 * static_cast<double>(totals.revalidations) /
+                           static_cast<double>(lookups);
+    std::cout << "HTTP cache: " << lookups << " cacheable requests, "
+              << totals.revalidations << " served from cache (304), "
+              << std::fixed << std::setprecision(1) << hit_ratio
+              << "% hit ratio\n"
+              << "HTTP cache: " << client.cache_bytes_saved()
+              << " bytes saved, " << totals.revalidations
+              << " rate-limited calls saved by 304s, " << coalescing.hits
+              << " duplicate requests coalesced\n"
+              << "HTTP cache: " << totals.entries << " entries using "
+              << totals.bytes << " bytes, " << totals.evictions
+              << " evictions\n";
+  }
   return 0;
 }
@@ -131,26 +131,46 @@ GitHubMcpBackend::list_branches(const std::string &owner,
   return client_.list_branches(owner, repo);
 }
 
+bool GitHubMcpBackend::run_mutation(std::string name,
+                                    const std::function<bool()> &action) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!mutation_runner_) {
+    return action();
+  }
+  bool result = false;
+  mutation_runner_(std::move(name), [&] { result = action(); });
+  return result;
+}
+
 bool GitHubMcpBackend::merge_pull_request(const std::string &owner,
                                           const std::string &repo,
                                           int pr_number) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return client_.merge_pull_request(owner, repo, pr_number);
+  return run_mutation("merge " + owner + "/" + repo + "#" +
+                          std::to_string(pr_number),
+                      [&] {
+                        return client_.merge_pull_request(owner, repo,
+                                                          pr_number);
+                      });
 }
 
 bool GitHubMcpBackend::close_pull_request(const std::string &owner,
                                           const std::string &repo,
                                           int pr_number) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return client_.close_pull_request(owner, repo, pr_number);
+  return run_mutation("close " + owner + "/" + repo + "#" +
+                          std::to_string(pr_number),
+                      [&] {
+                        return client_.close_pull_request(owner, repo,
+                                                          pr_number);
+                      });
 }
 
 bool GitHubMcpBackend::delete_branch(const std::string &owner,
                                      const std::string &repo,
                                      const std::string &branch) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return client_.delete_branch(owner, repo, branch, protected_branches_,
-                               protected_branch_excludes_);
+  return run_mutation("delete " + owner + "/" + repo + ":" + branch, [&] {
+    return client_.delete_branch(owner, repo, branch, protected_branches_,
+                                 protected_branch_excludes_);
+  });
 }
 
 McpServer::McpServer(McpBackend &backend) : backend_(backend) {}
@@ -0,0 +1,168 @@
+/**
+ * @file poll_results.cpp
+ * @brief Implementation of the per-repository poll cycle result buffers.
+ */
+
+#include "poll_results.hpp"
+#include <stdexcept>
+
+namespace agpm {
+
+void PollResults::add_repository(const std::string &owner,
+                                 const std::string &repo) {
+  const std::string repo_name = owner + "/" + repo;
+  if (by_name_.count(repo_name) != 0) {
+    return;
+  }
+  auto entry = std::make_unique<Repository>();
+  entry->owner = owner;
+  entry->repo = repo;
+  by_name_.emplace(repo_name, entry.get());
+  repositories_.push_back(std::move(entry));
+}
+
+PollResults::Repository &
+PollResults::repository(const std::string &repo_name) const {
+  auto it = by_name_.find(repo_name);
+  if (it == by_name_.end()) {
+    throw std::out_of_range("Repository not registered with poll results: " +
+                            repo_name);
+  }
+  return *it->second;
+}
+
+void PollResults::add_pull_requests(const std::string &repo_name,
+                                    const std::vector<PullRequest> &prs) {
+  Repository &entry = repository(repo_name);
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  entry.prs.reserve(entry.prs.size() + prs.size());
+  entry.pr_live.reserve(entry.prs.size() + prs.size());
+  entry.pr_index.reserve(entry.pr_index.size() + prs.size());
+  for (const auto &pr : prs) {
+    auto [it, inserted] = entry.pr_index.try_emplace(pr.number,
+                                                     entry.prs.size());
+    if (inserted) {
+      entry.prs.push_back(pr);
+      entry.pr_live.push_back(1);
+    } else {
+      entry.prs[it->second] = pr;
+    }
+  }
+}
+
+bool PollResults::remove_pull_request(const std::string &repo_name,
+                                      int number) {
+  auto found = by_name_.find(repo_name);
+  if (found == by_name_.end()) {
+    return false;
+  }
+  Repository &entry = *found->second;
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  auto it = entry.pr_index.find(number);
+  if (it == entry.pr_index.end()) {
+    return false;
+  }
+  entry.pr_live[it->second] = 0;
+  entry.pr_index.erase(it);
+  return true;
+}
+
+void PollResults::add_stray_branches(const std::string &repo_name,
+                                     const std::vector<std::string> &names) {
+  Repository &entry = repository(repo_name);
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  for (const auto &name : names) {
+    auto [it, inserted] =
+        entry.stray_index.try_emplace(name, entry.stray.size());
+    if (inserted) {
+      entry.stray.push_back(StrayBranch{entry.owner, entry.repo, name});
+      entry.stray_live.push_back(1);
+    }
+  }
+}
+
+bool PollResults::remove_stray_branch(const std::string &repo_name,
+                                      const std::string &name) {
+  auto found = by_name_.find(repo_name);
+  if (found == by_name_.end()) {
+    return false;
+  }
+  Repository &entry = *found->second;
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  auto it = entry.stray_index.find(name);
+  if (it == entry.stray_index.end()) {
+    return false;
+  }
+  entry.stray_live[it->second] = 0;
+  entry.stray_index.erase(it);
+  return true;
+}
+
+void PollResults::append_pull_requests(const Repository &entry,
+                                       std::vector<PullRequest> &out) {
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  out.reserve(out.size() + entry.pr_index.size());
+  for (std::size_t i = 0; i < entry.prs.size(); ++i) {
+    if (entry.pr_live[i]) {
+      out.push_back(entry.prs[i]);
+    }
+  }
+}
+
+void PollResults::append_stray_branches(const Repository &entry,
+                                        std::vector<StrayBranch> &out) {
+  std::lock_guard<std::mutex> lk(entry.mutex);
+  out.reserve(out.size() + entry.stray_index.size());
+  for (std::size_t i = 0; i < entry.stray.size(); ++i) {
+    if (entry.stray_live[i]) {
+      out.push_back(entry.stray[i]);
+    }
+  }
+}
+
+std::size_t PollResults::pull_request_count() const {
+  std::size_t count = 0;
+  for (const auto &entry : repositories_) {
+    std::lock_guard<std::mutex> lk(entry->mutex);
+    count += entry->pr_index.size();
+  }
+  return count;
+}
+
+std::vector<PullRequest> PollResults::pull_requests() const {
+  std::vector<PullRequest> out;
+  for (const auto &entry : repositories_) {
+    append_pull_requests(*entry, out);
+  }
+  return out;
+}
+
+std::vector<PullRequest>
+PollResults::pull_requests(const std::string &repo_name) const {
+  std::vector<PullRequest> out;
+  auto it = by_name_.find(repo_name);
+  if (it != by_name_.end()) {
+    append_pull_requests(*it->second, out);
+  }
+  return out;
+}
+
+std::vector<StrayBranch> PollResults::stray_branches() const {
+  std::vector<StrayBranch> out;
+  for (const auto &entry : repositories_) {
+    append_stray_branches(*entry, out);
+  }
+  return out;
+}
+
+std::vector<StrayBranch>
+PollResults::stray_branches(const std::string &repo_name) const {
+  std::vector<StrayBranch> out;
+  auto it = by_name_.find(repo_name);
+  if (it != by_name_.end()) {
+    append_stray_branches(*it->second, out);
+  }
+  return out;
+}
+
+} // namespace agpm
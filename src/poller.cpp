@@ -18,6 +18,12 @@
 
 namespace agpm {
 
+namespace {
+/// Pool and worker index of the calling thread, when it is a pool worker.
+thread_local const Poller *current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+} // namespace
+
 /**
  * Construct a worker pool with optional rate limiting.
  *
@@ -30,18 +36,9 @@ Poller::Poller(int workers, int max_rate, double smoothing_factor)
     : workers_(std::max(1, workers)), max_rate_(max_rate),
       smoothing_factor_(std::clamp(smoothing_factor, 0.01, 1.0)),
       last_execution_(std::chrono::steady_clock::time_point::min()) {
-  if (max_rate_ > 0) {
-    auto interval =
-        std::chrono::duration<double>(60.0 / static_cast<double>(max_rate_));
-    min_interval_ =
-        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
-            interval);
-    if (min_interval_.count() <= 0) {
-      min_interval_ = std::chrono::nanoseconds(1);
-    }
-  }
-  update_queue_margin();
+  update_rate_intervals();
   next_allowed_ = std::chrono::steady_clock::now();
+  reserve_next_allowed_ = next_allowed_;
   queued_.store(0, std::memory_order_relaxed);
   in_flight_.store(0, std::memory_order_relaxed);
   session_start_ = std::chrono::steady_clock::now();
@@ -58,12 +55,30 @@ Poller::~Poller() { stop(); }
 void Poller::start() {
   if (running_)
     return;
+  // Jobs left in worker deques by a previous stop() run after a restart,
+  // like jobs left in the shared queue.
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &queue : worker_queues_) {
+      for (auto &job : queue->jobs) {
+        jobs_[static_cast<std::size_t>(job.info->priority)].push_back(
+            std::move(job));
+        ++shared_jobs_;
+      }
+    }
+  }
+  worker_queues_.clear();
+  if (work_stealing_.load(std::memory_order_relaxed)) {
+    for (int i = 0; i < workers_; ++i) {
+      worker_queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+  }
   running_ = true;
   next_allowed_ = std::chrono::steady_clock::now();
   session_start_ = next_allowed_;
   threads_.reserve(workers_);
   for (int i = 0; i < workers_; ++i) {
-    threads_.emplace_back(&Poller::worker, this);
+    threads_.emplace_back(&Poller::worker, this, static_cast<std::size_t>(i));
   }
 }
 
@@ -78,6 +93,10 @@ void Poller::stop() {
     running_ = false;
   }
   cv_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(rate_mutex_);
+  }
+  rate_cv_.notify_all();
   for (auto &t : threads_) {
     if (t.joinable())
       t.join();
@@ -92,8 +111,21 @@ void Poller::stop() {
  *        or via a worker thread.
  * @return Future that is fulfilled when the job completes.
  */
-std::future<void> Poller::submit(std::string name, std::function<void()> job) {
+std::future<void> Poller::submit(std::string name, std::function<void()> job,
+                                 JobOptions options) {
+  return submit_tracked(std::move(name), std::move(job), options).future;
+}
+
+/**
+ * Submit a job and return its request id alongside the future.
+ */
+Poller::Submission Poller::submit_tracked(std::string name,
+                                          std::function<void()> job,
+                                          JobOptions options) {
   auto info = create_request_info(std::move(name));
+  info->priority = options.priority;
+  info->deadline = options.deadline;
+  info->rate_limited = options.rate_limited;
   if (!running_) {
     std::packaged_task<void()> pt([this, info, job = std::move(job)]() mutable {
       auto start = std::chrono::steady_clock::now();
@@ -114,7 +146,7 @@ std::future<void> Poller::submit(std::string name, std::function<void()> job) {
     });
     auto fut = pt.get_future();
     pt();
-    return fut;
+    return {info->id, std::move(fut)};
   }
   auto task = std::make_shared<std::packaged_task<void()>>(
       [this, info, job = std::move(job)]() mutable {
@@ -135,15 +167,94 @@ std::future<void> Poller::submit(std::string name, std::function<void()> job) {
         }
       });
   std::future<void> fut = task->get_future();
-  {
+  // Urgent and deadline jobs always go through the shared queue where every
+  // worker looks for them first.
+  if (current_pool == this && !worker_queues_.empty() &&
+      options.priority >= JobPriority::Listing && !options.deadline) {
+    // Count the job before it becomes visible so thieves never see more
+    // jobs than queued_ reports.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_infos_.push_back(info);
+      queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto &own = *worker_queues_[current_worker];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.jobs.push_front({info, task});
+    }
+  } else {
     std::lock_guard<std::mutex> lock(mutex_);
-    jobs_.push({info, task});
+    jobs_[static_cast<std::size_t>(options.priority)].push_back({info, task});
+    ++shared_jobs_;
     pending_infos_.push_back(info);
     queued_.fetch_add(1, std::memory_order_relaxed);
   }
   cv_.notify_one();
   check_backlog();
-  return fut;
+  return {info->id, std::move(fut)};
+}
+
+/**
+ * Withdraw a job that is still waiting in the shared queue or a worker deque.
+ *
+ * @param id Request id reported by submit_tracked().
+ * @return `true` when the job was removed before a worker took it.
+ */
+bool Poller::try_cancel(std::size_t id) {
+  ScheduledJob cancelled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto matches = [id](const ScheduledJob &job) {
+      return job.info->id == id;
+    };
+    for (auto &queue : jobs_) {
+      auto it = std::find_if(queue.begin(), queue.end(), matches);
+      if (it != queue.end()) {
+        cancelled = std::move(*it);
+        queue.erase(it);
+        --shared_jobs_;
+        break;
+      }
+    }
+    for (auto &worker_queue : worker_queues_) {
+      if (cancelled.task) {
+        break;
+      }
+      std::lock_guard<std::mutex> queue_lock(worker_queue->mutex);
+      auto &queue = worker_queue->jobs;
+      auto it = std::find_if(queue.begin(), queue.end(), matches);
+      if (it != queue.end()) {
+        cancelled = std::move(*it);
+        queue.erase(it);
+      }
+    }
+    if (!cancelled.task) {
+      return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    auto it = std::find_if(
+        pending_infos_.begin(), pending_infos_.end(),
+        [&](const auto &ptr) { return ptr.get() == cancelled.info.get(); });
+    if (it != pending_infos_.end()) {
+      pending_infos_.erase(it);
+    }
+    cancelled.info->state = RequestState::Cancelled;
+    cancelled.info->finished_at = std::chrono::steady_clock::now();
+    completed_infos_.push_back(cancelled.info);
+    trim_completed_history();
+  }
+  // Dropping the task outside the lock breaks its promise.
+  cancelled.task.reset();
+  return true;
+}
+
+/**
+ * Report whether a newly submitted job would have to wait for queued or
+ * running work. A stopped pool runs submissions inline and is never busy.
+ */
+bool Poller::all_workers_busy() const {
+  return running_ && outstanding_jobs() >= static_cast<std::size_t>(workers_);
 }
 
 /**
@@ -154,20 +265,70 @@ std::future<void> Poller::submit(std::string name, std::function<void()> job) {
 void Poller::set_max_rate(int max_rate) {
   std::lock_guard<std::mutex> lock(rate_mutex_);
   max_rate_ = max_rate;
-  if (max_rate_ > 0) {
-    auto interval =
-        std::chrono::duration<double>(60.0 / static_cast<double>(max_rate_));
-    min_interval_ =
-        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
-            interval);
-    if (min_interval_.count() <= 0) {
-      min_interval_ = std::chrono::nanoseconds(1);
+  update_rate_intervals();
+  next_allowed_ = std::chrono::steady_clock::now();
+  reserve_next_allowed_ = next_allowed_;
+  ++rate_generation_;
+  rate_cv_.notify_all();
+}
+
+/**
+ * Split the request rate between the shared bucket and the reservation for
+ * urgent jobs.
+ *
+ * @param fraction Share of the rate reserved for Interactive and Mutation
+ *        jobs.
+ */
+void Poller::set_priority_reserve(double fraction) {
+  std::lock_guard<std::mutex> lock(rate_mutex_);
+  priority_reserve_ = std::clamp(fraction, 0.0, 0.9);
+  update_rate_intervals();
+  ++rate_generation_;
+  rate_cv_.notify_all();
+}
+
+/**
+ * Derive the shared and reserved token intervals from the rate ceiling.
+ * Callers hold `rate_mutex_` or have exclusive access.
+ */
+void Poller::update_rate_intervals() {
+  auto interval_for = [](double per_minute) {
+    auto interval = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(60.0 / per_minute));
+    if (interval.count() <= 0) {
+      interval = std::chrono::nanoseconds(1);
     }
+    return interval;
+  };
+  if (max_rate_ > 0) {
+    const double rate = static_cast<double>(max_rate_);
+    min_interval_ = interval_for(rate * (1.0 - priority_reserve_));
+    reserve_interval_ = priority_reserve_ > 0.0
+                            ? interval_for(rate * priority_reserve_)
+                            : std::chrono::steady_clock::duration::zero();
   } else {
     min_interval_ = std::chrono::steady_clock::duration::zero();
+    reserve_interval_ = std::chrono::steady_clock::duration::zero();
   }
   update_queue_margin();
-  next_allowed_ = std::chrono::steady_clock::now();
+}
+
+/**
+ * Return the lowercase display name of a priority class.
+ */
+const char *Poller::priority_name(JobPriority priority) {
+  switch (priority) {
+  case JobPriority::Interactive:
+    return "interactive";
+  case JobPriority::Mutation:
+    return "mutation";
+  case JobPriority::Listing:
+    return "listing";
+  case JobPriority::Heuristic:
+    return "heuristic";
+  }
+  return "listing";
 }
 
 /**
@@ -237,42 +398,52 @@ void Poller::set_backlog_alert(
 /**
  * Enforce the configured rate limit before executing a job.
  *
+ * Tokens are handed out as consecutive time slots. A worker reserves the
+ * next slot and sleeps on `rate_cv_` until exactly that slot, so throttled
+ * workers form a deadline queue and wake once per token rather than polling.
+ * Rate changes invalidate reserved slots and stop() cancels them
+ * immediately. Interactive and Mutation jobs may take the earlier of the
+ * shared slot and the next slot of the reserved share.
+ *
  * @return `true` if execution may proceed, `false` when the pool is stopping.
  */
-bool Poller::acquire_token() {
-  if (max_rate_ <= 0)
-    return running_;
+bool Poller::acquire_token(JobPriority priority) {
+  const bool urgent = priority <= JobPriority::Mutation;
   std::unique_lock<std::mutex> lock(rate_mutex_);
   while (running_) {
-    auto now = std::chrono::steady_clock::now();
-    if (now >= next_allowed_) {
+    if (max_rate_ <= 0)
+      return true;
+    const auto now = std::chrono::steady_clock::now();
+    const auto shared_slot = std::max(now, next_allowed_);
+    std::chrono::steady_clock::time_point slot;
+    if (urgent &&
+        reserve_interval_ > std::chrono::steady_clock::duration::zero() &&
+        reserve_next_allowed_ < shared_slot) {
+      slot = std::max(now, reserve_next_allowed_);
+      reserve_next_allowed_ = slot + reserve_interval_;
+    } else {
+      slot = shared_slot;
       if (min_interval_ <= std::chrono::steady_clock::duration::zero()) {
-        next_allowed_ = now;
-        return true;
-      }
-      auto scheduled_next = next_allowed_ + min_interval_;
-      auto margin = queue_margin_;
-      if (margin > min_interval_) {
-        margin = min_interval_;
-      }
-      auto earliest_next = now + min_interval_ - margin;
-      if (earliest_next < now) {
-        earliest_next = now;
-      }
-      if (scheduled_next < earliest_next) {
-        next_allowed_ = earliest_next;
+        next_allowed_ = slot;
       } else {
-        next_allowed_ = scheduled_next;
+        auto scheduled_next = next_allowed_ + min_interval_;
+        auto margin = std::min(queue_margin_, min_interval_);
+        auto earliest_next = slot + min_interval_ - margin;
+        next_allowed_ = std::max(scheduled_next, earliest_next);
       }
-      return true;
-    }
-    lock.unlock();
-    auto wait = next_allowed_ - now;
-    if (wait > std::chrono::milliseconds(50)) {
-      wait = std::chrono::milliseconds(50);
     }
-    std::this_thread::sleep_for(wait);
-    lock.lock();
+    if (slot <= now)
+      return true;
+    const auto generation = rate_generation_;
+    rate_cv_.wait_until(lock, slot, [this, generation] {
+      token_wakeups_.fetch_add(1, std::memory_order_relaxed);
+      return !running_ || rate_generation_ != generation;
+    });
+    if (!running_)
+      return false;
+    if (rate_generation_ == generation)
+      return true;
+    // The rate changed while waiting; reserve a slot under the new rate.
   }
   return false;
 }
@@ -303,23 +474,143 @@ void Poller::update_queue_margin() {
       std::chrono::duration_cast<std::chrono::steady_clock::duration>(margin);
 }
 
+/**
+ * Pop the most urgent job from the shared queue. Callers hold `mutex_`.
+ *
+ * Jobs whose deadline has been reached run first, earliest deadline first.
+ * Otherwise the oldest job of the most urgent class runs, where a job is
+ * promoted one class for every starvation threshold it has waited.
+ *
+ * @param urgent_only Only take overdue jobs or jobs ranked Mutation or above.
+ */
+bool Poller::pop_shared_job(ScheduledJob &job, bool urgent_only) {
+  if (shared_jobs_ == 0) {
+    return false;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  std::deque<ScheduledJob> *best_queue = nullptr;
+  std::deque<ScheduledJob>::iterator best;
+  std::optional<std::chrono::steady_clock::time_point> best_deadline;
+  for (auto &queue : jobs_) {
+    for (auto it = queue.begin(); it != queue.end(); ++it) {
+      const auto &deadline = it->info->deadline;
+      if (deadline && *deadline <= now &&
+          (!best_deadline || *deadline < *best_deadline)) {
+        best_deadline = deadline;
+        best_queue = &queue;
+        best = it;
+      }
+    }
+  }
+  if (!best_queue) {
+    const std::chrono::milliseconds threshold(
+        starvation_threshold_ms_.load(std::memory_order_relaxed));
+    std::size_t best_rank = kPriorityCount;
+    for (std::size_t c = 0; c < kPriorityCount; ++c) {
+      auto &queue = jobs_[c];
+      if (queue.empty()) {
+        continue;
+      }
+      std::size_t rank = c;
+      if (threshold.count() > 0) {
+        auto waited = now - queue.front().info->enqueued_at;
+        auto steps = static_cast<std::size_t>(waited / threshold);
+        rank = steps >= rank ? 0 : rank - steps;
+      }
+      if (rank < best_rank ||
+          (rank == best_rank && best_queue &&
+           queue.front().info->enqueued_at < best->info->enqueued_at)) {
+        best_rank = rank;
+        best_queue = &queue;
+        best = queue.begin();
+      }
+    }
+    if (urgent_only &&
+        best_rank > static_cast<std::size_t>(JobPriority::Mutation)) {
+      return false;
+    }
+  }
+  job = std::move(*best);
+  best_queue->erase(best);
+  --shared_jobs_;
+  return true;
+}
+
+/**
+ * Take the next job for worker @p index in work-stealing mode: urgent jobs
+ * from the shared queue, the front of its own deque, the rest of the shared
+ * queue, then the tail of another worker's deque.
+ */
+bool Poller::next_job(std::size_t index, ScheduledJob &job) {
+  auto take = [this, &job](bool found) {
+    if (found) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      in_flight_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pop_shared_job(job, true)) {
+      return take(true);
+    }
+  }
+  {
+    auto &own = *worker_queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.front());
+      own.jobs.pop_front();
+      return take(true);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pop_shared_job(job, false)) {
+      return take(true);
+    }
+  }
+  for (std::size_t i = 1; i < worker_queues_.size(); ++i) {
+    auto &victim = *worker_queues_[(index + i) % worker_queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.back());
+      victim.jobs.pop_back();
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return take(true);
+    }
+  }
+  return false;
+}
+
 /**
  * Worker thread loop processing queued jobs.
  */
-void Poller::worker() {
+void Poller::worker(std::size_t index) {
+  current_pool = this;
+  current_worker = index;
   while (true) {
     ScheduledJob job;
-    {
+    if (!worker_queues_.empty()) {
+      if (!next_job(index, job)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] {
+          return !running_ || queued_.load(std::memory_order_relaxed) > 0;
+        });
+        if (!running_)
+          return;
+        continue;
+      }
+    } else {
       std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] { return !running_ || !jobs_.empty(); });
+      cv_.wait(lock, [this] { return !running_ || shared_jobs_ > 0; });
       if (!running_)
         return;
-      job = std::move(jobs_.front());
-      jobs_.pop();
+      pop_shared_job(job, false);
       queued_.fetch_sub(1, std::memory_order_relaxed);
       in_flight_.fetch_add(1, std::memory_order_relaxed);
     }
-    if (!acquire_token()) {
+    if (job.info->rate_limited && !acquire_token(job.info->priority)) {
       mark_cancelled(job.info);
       in_flight_.fetch_sub(1, std::memory_order_relaxed);
       return;
@@ -489,6 +780,9 @@ Poller::RequestQueueSnapshot Poller::request_snapshot() const {
       return result;
     };
     snapshot.pending = copy_entries(pending_infos_);
+    for (const auto &info : pending_infos_) {
+      ++snapshot.pending_by_priority[static_cast<std::size_t>(info->priority)];
+    }
     snapshot.running = copy_entries(active_infos_);
     snapshot.completed = copy_entries(completed_infos_);
   }
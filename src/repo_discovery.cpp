@@ -175,11 +175,14 @@ parse_origin_from_config(const std::filesystem::path &config_path) {
  * @param root Root directory representing the repository.
  * @param seen Set of repositories already discovered.
  * @param out Aggregated list of discovered repositories.
+ * @param git_dirs Optional map receiving the git directory of each new
+ *        repository keyed by `owner/repo`.
  */
 void try_add_repo(const std::filesystem::path &config_path,
                   const std::filesystem::path &root,
                   std::unordered_set<std::string> &seen,
-                  std::vector<std::pair<std::string, std::string>> &out) {
+                  std::vector<std::pair<std::string, std::string>> &out,
+                  std::unordered_map<std::string, std::string> *git_dirs) {
   auto parsed = parse_origin_from_config(config_path);
   if (!parsed) {
     discovery_log()->warn(
@@ -190,6 +193,9 @@ void try_add_repo(const std::filesystem::path &config_path,
   std::string key = parsed->first + "/" + parsed->second;
   if (seen.insert(key).second) {
     out.push_back(*parsed);
+    if (git_dirs) {
+      (*git_dirs)[key] = config_path.parent_path().string();
+    }
     discovery_log()->info("Discovered repository {} from {}", key,
                           root.string());
   }
@@ -201,10 +207,12 @@ void try_add_repo(const std::filesystem::path &config_path,
  * @param candidate Filesystem path that may represent a repository.
  * @param seen Set of repositories already discovered.
  * @param out Aggregated list of discovered repositories.
+ * @param git_dirs Optional map receiving discovered git directories.
  */
 void inspect_candidate(const std::filesystem::path &candidate,
                        std::unordered_set<std::string> &seen,
-                       std::vector<std::pair<std::string, std::string>> &out) {
+                       std::vector<std::pair<std::string, std::string>> &out,
+                       std::unordered_map<std::string, std::string> *git_dirs) {
   std::error_code ec;
   if (!std::filesystem::exists(candidate, ec))
     return;
@@ -214,7 +222,7 @@ void inspect_candidate(const std::filesystem::path &candidate,
   if (std::filesystem::is_directory(git_dir, ec)) {
     auto config_path = git_dir / "config";
     if (std::filesystem::is_regular_file(config_path, ec)) {
-      try_add_repo(config_path, candidate, seen, out);
+      try_add_repo(config_path, candidate, seen, out, git_dirs);
     }
     return;
   }
@@ -233,7 +241,7 @@ void inspect_candidate(const std::filesystem::path &candidate,
         if (!resolved.empty()) {
           auto config_path = resolved / "config";
           if (std::filesystem::is_regular_file(config_path, ec)) {
-            try_add_repo(config_path, candidate, seen, out);
+            try_add_repo(config_path, candidate, seen, out, git_dirs);
           }
         }
         break;
@@ -245,7 +253,7 @@ void inspect_candidate(const std::filesystem::path &candidate,
   // Bare repository (contains config directly)
   auto bare_config = candidate / "config";
   if (std::filesystem::is_regular_file(bare_config, ec)) {
-    try_add_repo(bare_config, candidate, seen, out);
+    try_add_repo(bare_config, candidate, seen, out, git_dirs);
   }
 }
 
@@ -340,14 +348,18 @@ bool repo_discovery_uses_filesystem(RepoDiscoveryMode mode) {
          mode == RepoDiscoveryMode::Both;
 }
 
+namespace {
+
 /**
- * Discover repositories by scanning filesystem roots for git metadata.
+ * Scan filesystem roots and their immediate children for git repositories.
  *
- * @param roots List of filesystem roots to inspect for git repositories.
+ * @param roots List of filesystem roots to inspect.
+ * @param git_dirs Optional map receiving discovered git directories.
  * @return Distinct set of discovered owner/repository pairs.
  */
 std::vector<std::pair<std::string, std::string>>
-discover_repositories_from_filesystem(const std::vector<std::string> &roots) {
+scan_roots(const std::vector<std::string> &roots,
+           std::unordered_map<std::string, std::string> *git_dirs) {
   std::vector<std::pair<std::string, std::string>> repos;
   std::unordered_set<std::string> seen;
   std::error_code ec;
@@ -361,16 +373,42 @@ discover_repositories_from_filesystem(const std::vector<std::string> &roots) {
                             root_str);
       continue;
     }
-    inspect_candidate(root, seen, repos);
+    inspect_candidate(root, seen, repos, git_dirs);
     if (!std::filesystem::is_directory(root, ec))
       continue;
     for (const auto &entry : std::filesystem::directory_iterator(root, ec)) {
       if (!entry.is_directory(ec))
         continue;
-      inspect_candidate(entry.path(), seen, repos);
+      inspect_candidate(entry.path(), seen, repos, git_dirs);
     }
   }
   return repos;
 }
 
+} // namespace
+
+/**
+ * Discover repositories by scanning filesystem roots for git metadata.
+ *
+ * @param roots List of filesystem roots to inspect for git repositories.
+ * @return Distinct set of discovered owner/repository pairs.
+ */
+std::vector<std::pair<std::string, std::string>>
+discover_repositories_from_filesystem(const std::vector<std::string> &roots) {
+  return scan_roots(roots, nullptr);
+}
+
+/**
+ * Map each repository found under @p roots to its git directory.
+ *
+ * @param roots List of filesystem roots to inspect for git repositories.
+ * @return Git directories keyed by `owner/repo`.
+ */
+std::unordered_map<std::string, std::string>
+discover_local_clones(const std::vector<std::string> &roots) {
+  std::unordered_map<std::string, std::string> git_dirs;
+  scan_roots(roots, &git_dirs);
+  return git_dirs;
+}
+
 } // namespace agpm
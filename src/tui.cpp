@@ -8,6 +8,7 @@
 
 #include "tui.hpp"
 #include "log.hpp"
+#include "sort.hpp"
 #include <algorithm>
 #include <cctype>
 #include <chrono>
@@ -576,12 +577,9 @@ void Tui::init() {
     throw std::runtime_error("Failed to initialize curses");
   }
   // Attach callbacks only when UI is truly active
-  poller_.set_pr_callback(
-      [this](const std::vector<PullRequest> &prs) { update_prs(prs); });
+  poller_.set_change_callback(
+      [this](const ChangeSet &changes) { apply_changes(changes); });
   poller_.set_log_callback([this](const std::string &msg) { log(msg); });
-  poller_.set_stray_callback([this](const std::vector<StrayBranch> &branches) {
-    update_branches(branches);
-  });
   cbreak();
   noecho();
   keypad(stdscr, TRUE);
@@ -609,6 +607,7 @@ void Tui::init() {
  */
 void Tui::update_prs(const std::vector<PullRequest> &prs) {
   prs_ = prs;
+  reindex_prs();
   if (selected_ >= static_cast<int>(prs_.size())) {
     selected_ = prs_.empty() ? 0 : static_cast<int>(prs_.size()) - 1;
   }
@@ -617,6 +616,77 @@ void Tui::update_prs(const std::vector<PullRequest> &prs) {
 
 void Tui::update_branches(const std::vector<StrayBranch> &branches) {
   branches_ = branches;
+  reindex_branches();
+  if (branch_selected_ >= static_cast<int>(branches_.size())) {
+    branch_selected_ =
+        branches_.empty() ? 0 : static_cast<int>(branches_.size()) - 1;
+  }
+  redraw_requested_.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Apply a change feed change set in place.
+ *
+ * Updated pull requests are replaced where they are; the list is only
+ * re-sorted when a sort mode is set and an entry was added or renamed, and
+ * only re-indexed when its positions moved.
+ *
+ * @param changes Change set published by the poller.
+ */
+void Tui::apply_changes(const ChangeSet &changes) {
+  std::unordered_set<std::string> removed;
+  bool appended = false;
+  bool resort = false;
+  for (const auto &change : changes.pull_requests) {
+    auto it = pr_index_.find(change.id);
+    if (change.kind == ChangeKind::Removed) {
+      if (it != pr_index_.end()) {
+        removed.insert(change.id);
+      }
+    } else if (it != pr_index_.end()) {
+      removed.erase(change.id);
+      PullRequest &pr = prs_[it->second];
+      resort = resort || pr.title != change.pull_request.title;
+      pr = change.pull_request;
+    } else {
+      pr_index_.emplace(change.id, prs_.size());
+      prs_.push_back(change.pull_request);
+      appended = true;
+    }
+  }
+  if (!removed.empty()) {
+    std::erase_if(prs_, [&](const PullRequest &pr) {
+      return removed.count(pull_request_id(pr)) != 0;
+    });
+  }
+  const std::string &sort_mode = poller_.sort_mode();
+  if (!sort_mode.empty() && (appended || resort)) {
+    sort_pull_requests(prs_, sort_mode);
+  }
+  if (!removed.empty() || (!sort_mode.empty() && (appended || resort))) {
+    reindex_prs();
+  }
+  if (selected_ >= static_cast<int>(prs_.size())) {
+    selected_ = prs_.empty() ? 0 : static_cast<int>(prs_.size()) - 1;
+  }
+
+  std::unordered_set<std::string> dropped;
+  for (const auto &change : changes.branches) {
+    if (change.kind == ChangeKind::Removed) {
+      if (branch_ids_.erase(change.id) != 0) {
+        dropped.insert(change.id);
+      }
+    } else if (dropped.erase(change.id) != 0) {
+      branch_ids_.insert(change.id);
+    } else if (branch_ids_.insert(change.id).second) {
+      branches_.push_back(change.branch);
+    }
+  }
+  if (!dropped.empty()) {
+    std::erase_if(branches_, [&](const StrayBranch &branch) {
+      return branch_ids_.count(branch_id(branch)) == 0;
+    });
+  }
   if (branch_selected_ >= static_cast<int>(branches_.size())) {
     branch_selected_ =
         branches_.empty() ? 0 : static_cast<int>(branches_.size()) - 1;
@@ -624,6 +694,21 @@ void Tui::update_branches(const std::vector<StrayBranch> &branches) {
   redraw_requested_.store(true, std::memory_order_relaxed);
 }
 
+void Tui::reindex_prs() {
+  pr_index_.clear();
+  pr_index_.reserve(prs_.size());
+  for (std::size_t i = 0; i < prs_.size(); ++i) {
+    pr_index_.emplace(pull_request_id(prs_[i]), i);
+  }
+}
+
+void Tui::reindex_branches() {
+  branch_ids_.clear();
+  for (const auto &branch : branches_) {
+    branch_ids_.insert(branch_id(branch));
+  }
+}
+
 /**
  * Append a message to the in-memory log buffer.
  *
@@ -1061,9 +1146,17 @@ void Tui::draw() {
         print_line(budget_line.str());
       }
     }
+    {
+      const auto &counts = queue_snapshot.pending_by_priority;
+      std::ostringstream class_line;
+      class_line << "Queued interactive " << counts[0] << " mutation "
+                 << counts[1] << " listing " << counts[2] << " heuristic "
+                 << counts[3];
+      print_line(class_line.str());
+    }
     auto format_entry = [&](const Poller::RequestInfo &info) {
       std::ostringstream oss;
-      oss << info.name;
+      oss << info.name << " <" << Poller::priority_name(info.priority) << ">";
       switch (info.state) {
       case Poller::RequestState::Pending:
         oss << " [pending]";
@@ -1241,9 +1334,17 @@ void Tui::handle_key(int ch) {
     if (selected_ < static_cast<int>(prs_.size())) {
       const auto &pr = prs_[selected_];
       tui_log()->info("Merge requested for PR #{}", pr.number);
-      if (client_.merge_pull_request(pr.owner, pr.repo, pr.number)) {
+      bool merged = false;
+      poller_.run_prioritized(
+          "merge " + pr.owner + "/" + pr.repo + "#" + std::to_string(pr.number),
+          [&] {
+            merged = client_.merge_pull_request(pr.owner, pr.repo, pr.number);
+          },
+          Poller::JobPriority::Interactive);
+      if (merged) {
         log("Merged PR #" + std::to_string(pr.number));
         prs_.erase(prs_.begin() + selected_);
+        reindex_prs();
         if (selected_ >= static_cast<int>(prs_.size())) {
           selected_ = prs_.empty() ? 0 : static_cast<int>(prs_.size()) - 1;
         }
@@ -1353,9 +1454,8 @@ void Tui::cleanup() {
   if (!initialized_)
     return;
   // Detach callbacks to avoid dangling references during teardown
-  poller_.set_pr_callback(nullptr);
+  poller_.set_change_callback(nullptr);
   poller_.set_log_callback(nullptr);
-  poller_.set_stray_callback(nullptr);
   stop_request_monitor();
   if (pr_win_) {
     delwin(pr_win_);
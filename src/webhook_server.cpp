@@ -0,0 +1,617 @@
+/**
+ * @file webhook_server.cpp
+ * @brief Implements webhook signature checks, event decoding and the HTTP
+ * listener used in webhook mode.
+ */
+
+#include "webhook_server.hpp"
+#include "log.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#if defined(_WIN32)
+#include <Ws2tcpip.h>
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace agpm {
+
+namespace {
+
+std::shared_ptr<spdlog::logger> webhook_log() {
+  static auto logger = [] {
+    ensure_default_logger();
+    return category_logger("webhook");
+  }();
+  return logger;
+}
+
+/// Deliveries remembered for redelivery suppression.
+constexpr std::size_t kRecentDeliveries = 1024;
+/// Largest request head accepted before the body.
+constexpr std::size_t kMaxHeaderBytes = 64 * 1024;
+#ifdef MSG_NOSIGNAL
+/// Report a peer that already hung up as an error instead of SIGPIPE.
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+/// Incremental SHA-256 (FIPS 180-4).
+class Sha256 {
+public:
+  void update(std::string_view data) {
+    for (unsigned char c : data) {
+      block_[fill_++] = c;
+      if (fill_ == block_.size()) {
+        compress();
+        fill_ = 0;
+      }
+    }
+    length_ += data.size();
+  }
+
+  std::array<unsigned char, 32> finish() {
+    const std::uint64_t bits = length_ * 8;
+    block_[fill_++] = 0x80;
+    if (fill_ > 56) {
+      std::fill(block_.begin() + static_cast<std::ptrdiff_t>(fill_),
+                block_.end(), 0);
+      compress();
+      fill_ = 0;
+    }
+    std::fill(block_.begin() + static_cast<std::ptrdiff_t>(fill_),
+              block_.begin() + 56, 0);
+    for (int i = 0; i < 8; ++i) {
+      block_[56 + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+    }
+    compress();
+    std::array<unsigned char, 32> digest{};
+    for (int i = 0; i < 8; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        digest[4 * i + j] = static_cast<unsigned char>(state_[i] >> (24 - 8 * j));
+      }
+    }
+    return digest;
+  }
+
+private:
+  static std::uint32_t rotr(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+  }
+
+  void compress() {
+    static constexpr std::array<std::uint32_t, 64> k = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    std::array<std::uint32_t, 64> w{};
+    for (int i = 0; i < 16; ++i) {
+      w[i] = static_cast<std::uint32_t>(block_[4 * i]) << 24 |
+             static_cast<std::uint32_t>(block_[4 * i + 1]) << 16 |
+             static_cast<std::uint32_t>(block_[4 * i + 2]) << 8 |
+             static_cast<std::uint32_t>(block_[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+      std::uint32_t s0 =
+          rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      std::uint32_t s1 =
+          rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    auto s = state_;
+    for (int i = 0; i < 64; ++i) {
+      std::uint32_t S1 = rotr(s[4], 6) ^ rotr(s[4], 11) ^ rotr(s[4], 25);
+      std::uint32_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+      std::uint32_t t1 = s[7] + S1 + ch + k[i] + w[i];
+      std::uint32_t S0 = rotr(s[0], 2) ^ rotr(s[0], 13) ^ rotr(s[0], 22);
+      std::uint32_t maj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+      std::uint32_t t2 = S0 + maj;
+      s[7] = s[6];
+      s[6] = s[5];
+      s[5] = s[4];
+      s[4] = s[3] + t1;
+      s[3] = s[2];
+      s[2] = s[1];
+      s[1] = s[0];
+      s[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; ++i) {
+      state_[i] += s[i];
+    }
+  }
+
+  std::array<std::uint32_t, 8> state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                      0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                      0x1f83d9ab, 0x5be0cd19};
+  std::array<unsigned char, 64> block_{};
+  std::size_t fill_{0};
+  std::uint64_t length_{0};
+};
+
+std::array<unsigned char, 32> hmac_sha256(const std::string &key,
+                                          const std::string &message) {
+  std::string block_key = key;
+  if (block_key.size() > 64) {
+    Sha256 h;
+    h.update(block_key);
+    auto digest = h.finish();
+    block_key.assign(digest.begin(), digest.end());
+  }
+  block_key.resize(64, '\0');
+  std::string inner_pad(64, '\0');
+  std::string outer_pad(64, '\0');
+  for (std::size_t i = 0; i < 64; ++i) {
+    inner_pad[i] = static_cast<char>(block_key[i] ^ 0x36);
+    outer_pad[i] = static_cast<char>(block_key[i] ^ 0x5c);
+  }
+  Sha256 inner;
+  inner.update(inner_pad);
+  inner.update(message);
+  auto inner_digest = inner.finish();
+  Sha256 outer;
+  outer.update(outer_pad);
+  outer.update(std::string_view(reinterpret_cast<const char *>(inner_digest.data()),
+                                inner_digest.size()));
+  return outer.finish();
+}
+
+std::string lower_copy(std::string value) {
+  std::transform(
+      value.begin(), value.end(), value.begin(),
+      [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return value;
+}
+
+std::string trim_copy(const std::string &value) {
+  auto first = value.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    return {};
+  }
+  auto last = value.find_last_not_of(" \t\r\n");
+  return value.substr(first, last - first + 1);
+}
+
+/// Branch name of a fully qualified `refs/heads/...` ref, else empty.
+std::string branch_of_ref(const std::string &ref) {
+  constexpr std::string_view prefix = "refs/heads/";
+  if (ref.rfind(prefix, 0) == 0) {
+    return ref.substr(prefix.size());
+  }
+  return {};
+}
+
+const char *reason_phrase(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 202:
+    return "Accepted";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 411:
+    return "Length Required";
+  case 413:
+    return "Payload Too Large";
+  default:
+    return "Error";
+  }
+}
+
+} // namespace
+
+/// @copydoc webhook_signature
+std::string webhook_signature(const std::string &secret,
+                              const std::string &body) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  auto digest = hmac_sha256(secret, body);
+  std::string out = "sha256=";
+  for (unsigned char c : digest) {
+    out.push_back(kHex[c >> 4]);
+    out.push_back(kHex[c & 0xf]);
+  }
+  return out;
+}
+
+/// @copydoc verify_webhook_signature
+bool verify_webhook_signature(const std::string &secret,
+                              const std::string &body,
+                              const std::string &signature) {
+  if (secret.empty()) {
+    return false;
+  }
+  const std::string expected = webhook_signature(secret, body);
+  const std::string provided = lower_copy(trim_copy(signature));
+  if (provided.size() != expected.size()) {
+    return false;
+  }
+  unsigned char diff = 0;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    diff |= static_cast<unsigned char>(expected[i] ^ provided[i]);
+  }
+  return diff == 0;
+}
+
+WebhookHandler::WebhookHandler(std::string secret)
+    : secret_(std::move(secret)) {}
+
+void WebhookHandler::set_event_callback(EventCallback cb) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  callback_ = std::move(cb);
+}
+
+bool WebhookHandler::remember_delivery(const std::string &delivery) {
+  if (delivery.empty()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!recent_.insert(delivery).second) {
+    return false;
+  }
+  recent_order_.push_back(delivery);
+  if (recent_order_.size() > kRecentDeliveries) {
+    recent_.erase(recent_order_.front());
+    recent_order_.pop_front();
+  }
+  return true;
+}
+
+int WebhookHandler::handle(const std::string &event,
+                           const std::string &delivery,
+                           const std::string &signature,
+                           const std::string &body) {
+  if (!verify_webhook_signature(secret_, body, signature)) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    webhook_log()->warn("Rejected {} delivery {} with invalid signature",
+                        event, delivery);
+    return 401;
+  }
+  if (event == "ping") {
+    webhook_log()->info("Webhook ping {} received", delivery);
+    return 200;
+  }
+  static const std::unordered_set<std::string> kHandled = {
+      "pull_request", "check_suite", "push", "create", "delete"};
+  if (kHandled.count(event) == 0) {
+    webhook_log()->debug("Ignoring {} delivery {}", event, delivery);
+    return 200;
+  }
+  WebhookEvent evt;
+  evt.type = event;
+  evt.delivery = delivery;
+  try {
+    auto payload = nlohmann::json::parse(body);
+    const auto &repository = payload.at("repository");
+    evt.repo = repository.at("name").get<std::string>();
+    evt.owner = repository.at("owner").at("login").get<std::string>();
+    evt.action = payload.value("action", std::string{});
+    if (event == "pull_request") {
+      evt.pull_requests.push_back(payload.at("number").get<int>());
+      const auto &pr = payload.at("pull_request");
+      if (pr.contains("head") && pr["head"].is_object()) {
+        evt.branch = pr["head"].value("ref", std::string{});
+      }
+      evt.refresh_pull_requests = true;
+      // A closed pull request can leave its head branch ready for cleanup.
+      evt.refresh_branches = evt.action == "closed";
+    } else if (event == "check_suite") {
+      const auto &suite = payload.at("check_suite");
+      evt.branch = suite.value("head_branch", std::string{});
+      if (suite.contains("pull_requests") && suite["pull_requests"].is_array()) {
+        for (const auto &pr : suite["pull_requests"]) {
+          evt.pull_requests.push_back(pr.at("number").get<int>());
+        }
+      }
+      evt.refresh_pull_requests = true;
+    } else if (event == "push") {
+      evt.branch = branch_of_ref(payload.value("ref", std::string{}));
+      evt.refresh_branches = !evt.branch.empty();
+    } else {
+      // create / delete carry a short ref plus its type.
+      if (payload.value("ref_type", std::string{}) == "branch") {
+        evt.branch = payload.value("ref", std::string{});
+        evt.refresh_branches = true;
+      }
+    }
+  } catch (const std::exception &e) {
+    webhook_log()->warn("Malformed {} delivery {}: {}", event, delivery,
+                        e.what());
+    return 400;
+  }
+  if (!evt.refresh_pull_requests && !evt.refresh_branches) {
+    return 200;
+  }
+  if (!remember_delivery(delivery)) {
+    webhook_log()->debug("Ignoring redelivered {} {}", event, delivery);
+    return 200;
+  }
+  accepted_.fetch_add(1, std::memory_order_relaxed);
+  webhook_log()->debug("Accepted {} for {}/{}", event, evt.owner, evt.repo);
+  EventCallback cb;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cb = callback_;
+  }
+  if (cb) {
+    cb(evt);
+  }
+  return 202;
+}
+
+WebhookServerRunner::WebhookServerRunner(WebhookHandler &handler,
+                                         WebhookServerOptions options)
+    : handler_(handler), options_(std::move(options)) {}
+
+WebhookServerRunner::~WebhookServerRunner() { stop(); }
+
+bool WebhookServerRunner::start() {
+  if (running_) {
+    return true;
+  }
+  auto last_error = [] {
+#ifdef _WIN32
+    return std::system_category().message(WSAGetLastError());
+#else
+    return std::system_category().message(errno);
+#endif
+  };
+#ifdef _WIN32
+  WSADATA wsa_data{};
+  if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    webhook_log()->error("WSAStartup failed: {}", last_error());
+    return false;
+  }
+  wsa_started_ = true;
+  listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listener_ == INVALID_SOCKET) {
+#else
+  listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (listener_ < 0) {
+#endif
+    webhook_log()->error("Failed to create webhook socket: {}", last_error());
+    close_listener();
+    return false;
+  }
+  int enable = 1;
+  setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR,
+             reinterpret_cast<const char *>(&enable), sizeof(enable));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(options_.port));
+  if (options_.bind_address.empty() || options_.bind_address == "*") {
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  } else if (inet_pton(AF_INET, options_.bind_address.c_str(),
+                       &addr.sin_addr) != 1) {
+    webhook_log()->error("Invalid webhook bind address '{}'",
+                         options_.bind_address);
+    close_listener();
+    return false;
+  }
+  if (::bind(listener_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) !=
+          0 ||
+      ::listen(listener_, options_.backlog) != 0) {
+    webhook_log()->error("Failed to listen for webhooks on {}:{}: {}",
+                         options_.bind_address, options_.port, last_error());
+    close_listener();
+    return false;
+  }
+  sockaddr_in bound{};
+  socklen_t bound_len = sizeof(bound);
+  if (getsockname(listener_, reinterpret_cast<sockaddr *>(&bound),
+                  &bound_len) == 0) {
+    bound_port_ = ntohs(bound.sin_port);
+  }
+  webhook_log()->info("Listening for webhooks on {}:{}{}",
+                      options_.bind_address, bound_port_, options_.path);
+  stop_requested_ = false;
+  running_ = true;
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void WebhookServerRunner::stop() {
+  stop_requested_ = true;
+  close_listener();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  running_ = false;
+#ifdef _WIN32
+  if (wsa_started_) {
+    WSACleanup();
+    wsa_started_ = false;
+  }
+#endif
+}
+
+void WebhookServerRunner::close_listener() {
+#ifdef _WIN32
+  if (listener_ != INVALID_SOCKET) {
+    closesocket(listener_);
+    listener_ = INVALID_SOCKET;
+  }
+#else
+  if (listener_ >= 0) {
+    ::shutdown(listener_, SHUT_RDWR);
+    ::close(listener_);
+    listener_ = -1;
+  }
+#endif
+}
+
+/**
+ * Accept connections one at a time, read a single request from each and
+ * answer it with an empty response before closing the connection.
+ */
+void WebhookServerRunner::run() {
+  while (!stop_requested_) {
+#ifdef _WIN32
+    SOCKET client = accept(listener_, nullptr, nullptr);
+    if (client == INVALID_SOCKET) {
+#else
+    int client = ::accept(listener_, nullptr, nullptr);
+    if (client < 0) {
+#endif
+      if (stop_requested_) {
+        break;
+      }
+      continue;
+    }
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe,
+               sizeof(no_sigpipe));
+#endif
+    // The whole request must arrive before one deadline, so a sender
+    // trickling bytes cannot hold up other deliveries. Each recv() waits at
+    // most for the time left.
+    const auto deadline =
+        std::chrono::steady_clock::now() + options_.request_timeout;
+    auto receive = [&](std::string &buffer) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0) {
+        return false;
+      }
+#ifdef _WIN32
+      DWORD timeout_ms = static_cast<DWORD>(left.count());
+      setsockopt(client, SOL_SOCKET, SO_RCVTIMEO,
+                 reinterpret_cast<const char *>(&timeout_ms),
+                 sizeof(timeout_ms));
+#else
+      timeval timeout{static_cast<time_t>(left.count() / 1000),
+                      static_cast<suseconds_t>((left.count() % 1000) * 1000)};
+      setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+      std::array<char, 8192> chunk{};
+#ifdef _WIN32
+      int received =
+          recv(client, chunk.data(), static_cast<int>(chunk.size()), 0);
+#else
+      ssize_t received = ::recv(client, chunk.data(), chunk.size(), 0);
+#endif
+      if (received <= 0) {
+        return false;
+      }
+      buffer.append(chunk.data(), static_cast<std::size_t>(received));
+      return true;
+    };
+    int status = 400;
+    std::string buffer;
+    std::size_t header_end = std::string::npos;
+    while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos &&
+           buffer.size() < kMaxHeaderBytes && receive(buffer)) {
+    }
+    if (header_end != std::string::npos) {
+      std::string method;
+      std::string target;
+      std::unordered_map<std::string, std::string> headers;
+      std::size_t line_start = 0;
+      bool first_line = true;
+      while (line_start < header_end) {
+        std::size_t line_end = buffer.find("\r\n", line_start);
+        std::string line = buffer.substr(line_start, line_end - line_start);
+        line_start = line_end + 2;
+        if (first_line) {
+          first_line = false;
+          auto sp1 = line.find(' ');
+          auto sp2 = line.find(' ', sp1 + 1);
+          if (sp1 != std::string::npos && sp2 != std::string::npos) {
+            method = line.substr(0, sp1);
+            target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+          }
+          continue;
+        }
+        auto colon = line.find(':');
+        if (colon != std::string::npos) {
+          headers[lower_copy(trim_copy(line.substr(0, colon)))] =
+              trim_copy(line.substr(colon + 1));
+        }
+      }
+      auto query = target.find('?');
+      if (query != std::string::npos) {
+        target.erase(query);
+      }
+      auto header = [&headers](const std::string &name) {
+        auto it = headers.find(name);
+        return it != headers.end() ? it->second : std::string{};
+      };
+      std::size_t length = 0;
+      bool has_length = false;
+      try {
+        std::string value = header("content-length");
+        if (!value.empty()) {
+          length = static_cast<std::size_t>(std::stoull(value));
+          has_length = true;
+        }
+      } catch (const std::exception &) {
+        has_length = false;
+      }
+      if (target != options_.path) {
+        status = 404;
+      } else if (method != "POST") {
+        status = 405;
+      } else if (!has_length) {
+        status = 411;
+      } else if (length > options_.max_body_bytes) {
+        status = 413;
+      } else {
+        std::string body = buffer.substr(header_end + 4);
+        while (body.size() < length && receive(body)) {
+        }
+        if (body.size() >= length) {
+          body.resize(length);
+          status = handler_.handle(header("x-github-event"),
+                                   header("x-github-delivery"),
+                                   header("x-hub-signature-256"), body);
+        }
+      }
+    }
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " +
+                           reason_phrase(status) +
+                           "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+#ifdef _WIN32
+    send(client, response.data(), static_cast<int>(response.size()), 0);
+    closesocket(client);
+#else
+    (void)::send(client, response.data(), response.size(), kSendFlags);
+    ::close(client);
+#endif
+  }
+  running_ = false;
+}
+
+} // namespace agpm
@@ -0,0 +1,403 @@
+#include "async_http_client.hpp"
+#include "curl_share.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace agpm;
+
+TEST_CASE("curl multi client resolves many transfers concurrently") {
+  namespace fs = std::filesystem;
+  fs::path dir = fs::temp_directory_path() / "agpm_async_http_test";
+  fs::create_directories(dir);
+  const int count = 16;
+  for (int i = 0; i < count; ++i) {
+    std::ofstream(dir / ("body" + std::to_string(i) + ".json"))
+        << "{\"n\":" << i << "}";
+  }
+
+  CurlMultiHttpClient client(5000);
+  std::vector<std::future<HttpResponse>> futures;
+  for (int i = 0; i < count; ++i) {
+    std::string url =
+        "file://" + (dir / ("body" + std::to_string(i) + ".json")).string();
+    futures.push_back(client.get_async(url, {}));
+  }
+  for (int i = 0; i < count; ++i) {
+    HttpResponse res = futures[i].get();
+    REQUIRE(res.status_code == 200);
+    REQUIRE(res.body == "{\"n\":" + std::to_string(i) + "}");
+  }
+  REQUIRE(client.in_flight() == 0);
+  REQUIRE(client.peak_in_flight() >= 1);
+
+  // The blocking adapter shares the same event loop.
+  std::string body =
+      client.get("file://" + (dir / "body0.json").string(), {});
+  REQUIRE(body == "{\"n\":0}");
+  fs::remove_all(dir);
+}
+
+TEST_CASE("curl multi client reports transport failures through futures") {
+  CurlMultiHttpClient client(5000);
+  auto future =
+      client.get_async("file:///nonexistent/agpm/async/missing.json", {});
+  REQUIRE_THROWS_AS(future.get(), TransientNetworkError);
+}
+
+#ifndef _WIN32
+namespace {
+
+/// Minimal HTTP/1.1-only server that ignores h2c upgrade requests.
+class Http1StandIn {
+public:
+  explicit Http1StandIn(int requests) : requests_(requests) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    ::listen(fd_, 16);
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread([this] { serve(); });
+  }
+  ~Http1StandIn() {
+    thread_.join();
+    ::close(fd_);
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" + std::to_string(port_) + "/";
+  }
+  int upgrade_requests() const { return upgrades_.load(); }
+
+private:
+  void serve() {
+    for (int i = 0; i < requests_; ++i) {
+      int client = ::accept(fd_, nullptr, nullptr);
+      if (client < 0) {
+        return;
+      }
+      std::string request;
+      char buf[1024];
+      while (request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+        if (n <= 0) {
+          break;
+        }
+        request.append(buf, static_cast<std::size_t>(n));
+      }
+      if (request.find("h2c") != std::string::npos) {
+        ++upgrades_;
+      }
+      const std::string reply = "HTTP/1.1 200 OK\r\n"
+                                "Content-Type: application/json\r\n"
+                                "Content-Length: 11\r\n"
+                                "Connection: close\r\n\r\n"
+                                "{\"ok\":true}";
+      ::send(client, reply.data(), reply.size(), 0);
+      ::close(client);
+    }
+  }
+
+  int requests_;
+  int fd_{-1};
+  int port_{0};
+  std::atomic<int> upgrades_{0};
+  std::thread thread_;
+};
+
+} // namespace
+
+TEST_CASE("curl multi client falls back to HTTP/1.1 when HTTP/2 is refused") {
+  const int count = 4;
+  Http1StandIn server(count);
+  CurlMultiHttpClient client(5000, 0, 0, 0, 0, {}, {}, 0, true, 8);
+  std::vector<std::future<HttpResponse>> futures;
+  for (int i = 0; i < count; ++i) {
+    futures.push_back(client.get_async(server.url(), {}));
+  }
+  for (auto &f : futures) {
+    HttpResponse res = f.get();
+    REQUIRE(res.status_code == 200);
+    REQUIRE(res.body == "{\"ok\":true}");
+  }
+  REQUIRE(client.http2_transfers() == 0);
+  REQUIRE(client.http1_transfers() == static_cast<std::size_t>(count));
+  if (client.http2_enabled()) {
+    // Plain-text HTTP/2 is attempted through an h2c upgrade.
+    REQUIRE(server.upgrade_requests() > 0);
+  }
+}
+
+namespace {
+
+/**
+ * Minimal h2c server: accepts the HTTP/1.1 upgrade, then answers every
+ * request stream on the connection with a fixed JSON body. Request header
+ * blocks are not decoded.
+ */
+class H2cStandIn {
+public:
+  H2cStandIn() {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    ::listen(fd_, 16);
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = std::thread([this] { accept_loop(); });
+  }
+  ~H2cStandIn() {
+    ::shutdown(fd_, SHUT_RDWR);
+    accept_thread_.join();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int client : clients_) {
+        ::shutdown(client, SHUT_RDWR);
+      }
+    }
+    for (auto &t : connection_threads_) {
+      t.join();
+    }
+    for (int client : clients_) {
+      ::close(client);
+    }
+    ::close(fd_);
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" + std::to_string(port_) + "/";
+  }
+  int connections() const { return connections_.load(); }
+  int streams() const { return streams_.load(); }
+
+private:
+  static std::string frame(std::uint8_t type, std::uint8_t flags,
+                           std::uint32_t stream, const std::string &payload) {
+    std::string out;
+    out.push_back(static_cast<char>((payload.size() >> 16) & 0xff));
+    out.push_back(static_cast<char>((payload.size() >> 8) & 0xff));
+    out.push_back(static_cast<char>(payload.size() & 0xff));
+    out.push_back(static_cast<char>(type));
+    out.push_back(static_cast<char>(flags));
+    out.push_back(static_cast<char>((stream >> 24) & 0x7f));
+    out.push_back(static_cast<char>((stream >> 16) & 0xff));
+    out.push_back(static_cast<char>((stream >> 8) & 0xff));
+    out.push_back(static_cast<char>(stream & 0xff));
+    out += payload;
+    return out;
+  }
+
+  static std::string respond(std::uint32_t stream) {
+    // HEADERS with the static-table entry for `:status: 200`, then the body.
+    return frame(0x1, 0x4, stream, std::string(1, '\x88')) +
+           frame(0x0, 0x1, stream, "{\"ok\":true}");
+  }
+
+  void accept_loop() {
+    while (true) {
+      int client = ::accept(fd_, nullptr, nullptr);
+      if (client < 0) {
+        return;
+      }
+      ++connections_;
+      std::lock_guard<std::mutex> lock(mutex_);
+      clients_.push_back(client);
+      connection_threads_.emplace_back([this, client] { serve(client); });
+    }
+  }
+
+  void serve(int client) {
+    auto send_all = [client](const std::string &data) {
+      ::send(client, data.data(), data.size(), MSG_NOSIGNAL);
+    };
+    std::string buffer;
+    char chunk[4096];
+    auto receive = [&] {
+      ssize_t n = ::recv(client, chunk, sizeof(chunk), 0);
+      if (n <= 0) {
+        return false;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(n));
+      return true;
+    };
+    std::size_t head_end = std::string::npos;
+    while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+      if (!receive()) {
+        return;
+      }
+    }
+    if (buffer.find("h2c") == std::string::npos) {
+      return;
+    }
+    buffer.erase(0, head_end + 4);
+    send_all("HTTP/1.1 101 Switching Protocols\r\n"
+             "Connection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+    // The upgraded request becomes stream 1.
+    send_all(frame(0x4, 0x0, 0, {}) + respond(1));
+    ++streams_;
+    const std::string preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    while (buffer.size() < preface.size()) {
+      if (!receive()) {
+        return;
+      }
+    }
+    buffer.erase(0, preface.size());
+    while (true) {
+      while (buffer.size() < 9) {
+        if (!receive()) {
+          return;
+        }
+      }
+      const auto *b = reinterpret_cast<const unsigned char *>(buffer.data());
+      std::size_t length = (std::size_t{b[0]} << 16) |
+                           (std::size_t{b[1]} << 8) | std::size_t{b[2]};
+      std::uint8_t type = b[3];
+      std::uint8_t flags = b[4];
+      std::uint32_t stream = ((std::uint32_t{b[5]} & 0x7f) << 24) |
+                             (std::uint32_t{b[6]} << 16) |
+                             (std::uint32_t{b[7]} << 8) | std::uint32_t{b[8]};
+      while (buffer.size() < 9 + length) {
+        if (!receive()) {
+          return;
+        }
+      }
+      std::string payload = buffer.substr(9, length);
+      buffer.erase(0, 9 + length);
+      if (type == 0x4 && (flags & 0x1) == 0) {
+        send_all(frame(0x4, 0x1, 0, {}));
+      } else if (type == 0x6 && (flags & 0x1) == 0) {
+        send_all(frame(0x6, 0x1, 0, payload));
+      } else if (type == 0x1 && (flags & 0x1) != 0) {
+        send_all(respond(stream));
+        ++streams_;
+      } else if (type == 0x7) {
+        return;
+      }
+    }
+  }
+
+  int fd_{-1};
+  int port_{0};
+  std::atomic<int> connections_{0};
+  std::atomic<int> streams_{0};
+  std::thread accept_thread_;
+  std::mutex mutex_;
+  std::vector<int> clients_;
+  std::vector<std::thread> connection_threads_;
+};
+
+} // namespace
+
+TEST_CASE("curl multi client multiplexes HTTP/2 transfers on one connection") {
+  const int count = 8;
+  H2cStandIn server;
+  CurlMultiHttpClient client(5000, 0, 0, 0, 0, {}, {}, 0, true, 100);
+  if (!client.http2_enabled()) {
+    WARN("Skipping HTTP/2 test: libcurl was built without nghttp2");
+    return;
+  }
+  auto &pool = CurlSharePool::instance();
+  // Open the connection first so the other transfers can join it.
+  REQUIRE(client.get_async(server.url(), {}).get().status_code == 200);
+  pool.reset_stats();
+  std::vector<std::future<HttpResponse>> futures;
+  for (int i = 0; i < count; ++i) {
+    futures.push_back(client.get_async(server.url(), {}));
+  }
+  for (auto &f : futures) {
+    HttpResponse res = f.get();
+    REQUIRE(res.status_code == 200);
+    REQUIRE(res.body == "{\"ok\":true}");
+  }
+  REQUIRE(client.http2_transfers() == static_cast<std::size_t>(count + 1));
+  REQUIRE(client.peak_in_flight() > 1);
+  REQUIRE(server.connections() == 1);
+  REQUIRE(server.streams() == count + 1);
+  auto stats = pool.stats();
+  REQUIRE(stats.new_connections == 0);
+  REQUIRE(stats.reused_connections == static_cast<std::uint64_t>(count));
+}
+#endif
+
+namespace {
+
+class FakeAsyncHttp : public AsyncHttpClient {
+public:
+  std::atomic<int> async_compares{0};
+
+  std::future<HttpResponse>
+  get_async(const std::string &url,
+            const std::vector<std::string> &) override {
+    std::promise<HttpResponse> p;
+    if (url.find("/compare/") != std::string::npos) {
+      ++async_compares;
+      p.set_value({R"({"status":"identical","ahead_by":0,"behind_by":0})",
+                   {},
+                   200});
+    } else {
+      p.set_value({"{}", {}, 200});
+    }
+    return p.get_future();
+  }
+  std::future<HttpResponse> put_async(const std::string &, const std::string &,
+                                      const std::vector<std::string> &) override {
+    return ready("{}");
+  }
+  std::future<HttpResponse>
+  patch_async(const std::string &, const std::string &,
+              const std::vector<std::string> &) override {
+    return ready("{}");
+  }
+  std::future<HttpResponse>
+  del_async(const std::string &, const std::vector<std::string> &) override {
+    return ready("");
+  }
+
+private:
+  static std::future<HttpResponse> ready(const std::string &body) {
+    std::promise<HttpResponse> p;
+    p.set_value({body, {}, 200});
+    return p.get_future();
+  }
+};
+
+} // namespace
+
+TEST_CASE("github client fans out stray comparisons on async engines") {
+  auto http = std::make_unique<FakeAsyncHttp>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  auto stray = client.detect_stray_branches("me", "repo", "main",
+                                            {"feature-a", "feature-b", "tmp"});
+  REQUIRE(raw->async_compares.load() == 3);
+  REQUIRE(stray.size() == 3);
+}
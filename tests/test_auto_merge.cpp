@@ -122,3 +122,65 @@ TEST_CASE("dirty pull requests are closed by rule engine") {
   REQUIRE_FALSE(snapshots.empty());
   REQUIRE(snapshots.back().empty());
 }
+
+class WaitingHttpClient : public HttpClient {
+public:
+  std::atomic<int> metadata_calls{0};
+  std::string updated_at{"2024-01-01T00:00:00Z"};
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)headers;
+    if (url.find("/pulls/") != std::string::npos) {
+      metadata_calls++;
+      return "{\"draft\":true,\"state\":\"open\"}";
+    }
+    if (url.find("/pulls") != std::string::npos) {
+      return "[{\"number\":3,\"title\":\"WIP\",\"head\":{\"sha\":\"abc\"},"
+             "\"updated_at\":\"" +
+             updated_at + "\"}]";
+    }
+    return "[]";
+  }
+  std::string put(const std::string &url, const std::string &data,
+                  const std::vector<std::string> &headers) override {
+    (void)url;
+    (void)data;
+    (void)headers;
+    return "{}";
+  }
+  std::string del(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)url;
+    (void)headers;
+    return "";
+  }
+};
+
+TEST_CASE("waiting pull requests are not re-fetched until they change") {
+  auto http = std::make_unique<WaitingHttpClient>();
+  WaitingHttpClient *raw = http.get();
+  GitHubClient client({"tok"}, std::unique_ptr<HttpClient>(http.release()));
+  GitHubPoller poller(client, {{"me", "repo"}}, 0, 0, 0, 1, true, false,
+                      StrayDetectionMode::RuleBased, false, "", true);
+  // Off by default: finishing status checks do not bump `updated_at`.
+  poller.poll_now();
+  poller.poll_now();
+  REQUIRE(raw->metadata_calls == 2);
+  REQUIRE(poller.decision_cache_hits() == 0);
+
+  poller.set_decision_cache_ttl(std::chrono::seconds(120));
+  poller.poll_now();
+  poller.poll_now();
+  poller.poll_now();
+  REQUIRE(raw->metadata_calls == 3);
+  REQUIRE(poller.decision_cache_hits() == 2);
+
+  raw->updated_at = "2024-01-02T00:00:00Z";
+  poller.poll_now();
+  REQUIRE(raw->metadata_calls == 4);
+
+  poller.set_decision_cache_ttl(std::chrono::seconds(0));
+  poller.poll_now();
+  poller.poll_now();
+  REQUIRE(raw->metadata_calls == 6);
+}
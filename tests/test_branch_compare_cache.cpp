@@ -0,0 +1,136 @@
+#include "branch_compare_cache.hpp"
+#include "github_client.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+class CompareCountingHttp : public HttpClient {
+public:
+  std::atomic<int> compares{0};
+  std::atomic<int> branch_lookups{0};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    if (url.find("/compare/") != std::string::npos) {
+      ++compares;
+      return R"({"status":"behind","ahead_by":0,"behind_by":4})";
+    }
+    if (url.find("/branches/") != std::string::npos) {
+      ++branch_lookups;
+      return R"({"commit":{"commit":{"committer":{"date":"2024-01-01T00:00:00Z"}}}})";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+/// Answers every compare with GitHub's rate-limit error.
+class RateLimitedCompareHttp : public CompareCountingHttp {
+public:
+  HttpResponse get_with_headers(const std::string &url,
+                                const std::vector<std::string> &h) override {
+    if (url.find("/compare/") != std::string::npos) {
+      ++compares;
+      return {R"({"message":"API rate limit exceeded"})", {}, 403};
+    }
+    return {get(url, h), {}, 200};
+  }
+};
+
+} // namespace
+
+TEST_CASE("branch compare cache round-trips through its file") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_compare.json";
+  std::filesystem::remove(path);
+  BranchCompareCache cache;
+  REQUIRE_FALSE(cache.lookup("base", "head"));
+  cache.store("base", "head", {2, 1, "diverged", 1700000000});
+  REQUIRE(cache.save(path.string()));
+
+  BranchCompareCache reloaded;
+  REQUIRE(reloaded.load(path.string()));
+  auto hit = reloaded.lookup("base", "head");
+  REQUIRE(hit);
+  REQUIRE(hit->ahead_by == 2);
+  REQUIRE(hit->behind_by == 1);
+  REQUIRE(hit->status == "diverged");
+  REQUIRE(hit->last_commit == 1700000000);
+  REQUIRE_FALSE(reloaded.lookup("base", "moved"));
+  REQUIRE(reloaded.hits() == 1);
+  REQUIRE(reloaded.misses() == 1);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("stray detection only re-compares branches whose SHAs moved") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_stray_cache.json";
+  std::filesystem::remove(path);
+  std::unordered_map<std::string, std::string> shas{
+      {"main", "m1"}, {"old", "o1"}, {"done", "d1"}};
+  {
+    auto http = std::make_unique<CompareCountingHttp>();
+    auto *raw = http.get();
+    GitHubClient client({"tok"}, std::move(http));
+    client.set_delay_ms(0);
+    client.set_compare_cache_file(path.string());
+
+    auto stray = client.detect_stray_branches("me", "repo", "main",
+                                              {"old", "done"}, {}, {}, &shas);
+    REQUIRE(stray.size() == 2);
+    REQUIRE(raw->compares == 2);
+    REQUIRE(raw->branch_lookups == 2);
+
+    stray = client.detect_stray_branches("me", "repo", "main", {"old", "done"},
+                                         {}, {}, &shas);
+    REQUIRE(stray.size() == 2);
+    REQUIRE(raw->compares == 2);
+    REQUIRE(raw->branch_lookups == 2);
+
+    shas["old"] = "o2";
+    client.detect_stray_branches("me", "repo", "main", {"old", "done"}, {}, {},
+                                 &shas);
+    REQUIRE(raw->compares == 3);
+  }
+  REQUIRE(std::filesystem::exists(path));
+
+  // A new client picks up the persisted comparisons.
+  auto http = std::make_unique<CompareCountingHttp>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  client.set_compare_cache_file(path.string());
+  auto stray = client.detect_stray_branches("me", "repo", "main",
+                                            {"old", "done"}, {}, {}, &shas);
+  REQUIRE(stray.size() == 2);
+  REQUIRE(raw->compares == 0);
+  REQUIRE(client.compare_cache().hits() == 2);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("stray detection never caches a rate-limited comparison") {
+  std::unordered_map<std::string, std::string> shas{{"main", "m1"},
+                                                    {"old", "o1"}};
+  auto http = std::make_unique<RateLimitedCompareHttp>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+
+  client.detect_stray_branches("me", "repo", "main", {"old"}, {}, {}, &shas);
+  REQUIRE(raw->compares == 1);
+  REQUIRE(client.compare_cache().size() == 0);
+  client.detect_stray_branches("me", "repo", "main", {"old"}, {}, {}, &shas);
+  REQUIRE(raw->compares == 2);
+}
@@ -0,0 +1,203 @@
+#include "cache_log.hpp"
+#include "github_client.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace agpm;
+
+namespace {
+
+CacheLog::Record record(const std::string &url, const std::string &etag,
+                        const std::string &body) {
+  return {url, std::make_shared<const EtagCache::Entry>(
+                   EtagCache::Entry{etag, body, {"ETag: " + etag}})};
+}
+
+std::map<std::string, EtagCache::Entry> replay(CacheLog &log) {
+  std::map<std::string, EtagCache::Entry> out;
+  log.load([&out](std::string url, EtagCache::Entry entry) {
+    out[url] = std::move(entry);
+  });
+  return out;
+}
+
+class RecordingHttp : public HttpClient {
+public:
+  HttpResponse reply;
+  std::vector<std::vector<std::string>> seen_headers;
+
+  HttpResponse get_with_headers(const std::string &,
+                                const std::vector<std::string> &h) override {
+    seen_headers.push_back(h);
+    return reply;
+  }
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &h) override {
+    return get_with_headers(url, h).body;
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+
+  bool sent(const std::string &header) const {
+    for (const auto &headers : seen_headers) {
+      for (const auto &h : headers) {
+        if (h == header)
+          return true;
+      }
+    }
+    return false;
+  }
+};
+
+const char *kPrs =
+    R"([{"number":1,"title":"t","created_at":"2021-01-01T00:00:00Z"}])";
+
+} // namespace
+
+TEST_CASE("cache log appends, supersedes and compacts records") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_cache_log.bin";
+  std::filesystem::remove(path);
+  {
+    CacheLog log(path.string());
+    REQUIRE(log.append({record("u1", "a", "one"), record("u2", "b", "two")}));
+    REQUIRE(log.append({record("u1", "c", "uno")}));
+    REQUIRE(log.record_count() == 3);
+  }
+  REQUIRE(CacheLog::is_cache_log(path.string()));
+
+  CacheLog log(path.string());
+  auto entries = replay(log);
+  REQUIRE(log.record_count() == 3);
+  REQUIRE(entries.size() == 2);
+  REQUIRE(entries["u1"].etag == "c");
+  REQUIRE(entries["u1"].body == "uno");
+  REQUIRE(entries["u2"].headers == std::vector<std::string>{"ETag: b"});
+
+  REQUIRE(log.compact({record("u1", "c", "uno"), record("u2", "b", "two")}));
+  REQUIRE(log.record_count() == 2);
+  CacheLog reopened(path.string());
+  REQUIRE(replay(reopened).size() == 2);
+  REQUIRE(reopened.record_count() == 2);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("cache log drops a torn tail and keeps appending") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_cache_torn.bin";
+  std::filesystem::remove(path);
+  CacheLog log(path.string());
+  REQUIRE(log.append({record("u1", "a", "one")}));
+  auto good_size = std::filesystem::file_size(path);
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    // A length prefix promising more bytes than were written.
+    const char torn[] = "\x20\x00\x00\x00garbage";
+    out.write(torn, sizeof(torn) - 1);
+  }
+  CacheLog reloaded(path.string());
+  REQUIRE(replay(reloaded).size() == 1);
+  REQUIRE(std::filesystem::file_size(path) == good_size);
+  REQUIRE(reloaded.append({record("u2", "b", "two")}));
+  CacheLog again(path.string());
+  REQUIRE(replay(again).size() == 2);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("cache log writes its magic into an empty file") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_cache_empty.bin";
+  std::filesystem::remove(path);
+  { std::ofstream touch(path, std::ios::binary); }
+  CacheLog log(path.string());
+  REQUIRE(replay(log).empty());
+  REQUIRE(log.append({record("u1", "a", "one")}));
+  REQUIRE(CacheLog::is_cache_log(path.string()));
+  CacheLog reloaded(path.string());
+  REQUIRE(replay(reloaded).size() == 1);
+
+  std::filesystem::remove(path);
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "not a cache log";
+  }
+  CacheLog foreign(path.string());
+  REQUIRE_FALSE(foreign.append({record("u1", "a", "one")}));
+  REQUIRE(std::filesystem::file_size(path) == 15);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("github client recovers empty and unreadable cache files") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_client_bad.cache";
+  auto reload = [&] {
+    auto http = std::make_unique<RecordingHttp>();
+    auto *raw = http.get();
+    http->reply = {"", {}, 304};
+    GitHubClient client({"tok"}, std::move(http), {}, {}, 0, 30000, 0,
+                        "https://api.github.com", false, path.string());
+    REQUIRE(client.list_pull_requests("o", "r").size() == 1);
+    REQUIRE(raw->sent("If-None-Match: abc"));
+  };
+  for (const std::string contents : {"", "{not json"}) {
+    std::filesystem::remove(path);
+    {
+      std::ofstream out(path, std::ios::binary);
+      out << contents;
+    }
+    {
+      auto http = std::make_unique<RecordingHttp>();
+      http->reply = {kPrs, {"ETag: abc"}, 200};
+      GitHubClient client({"tok"}, std::move(http), {}, {}, 0, 30000, 0,
+                          "https://api.github.com", false, path.string());
+      REQUIRE(client.list_pull_requests("o", "r").size() == 1);
+    }
+    REQUIRE(CacheLog::is_cache_log(path.string()));
+    reload();
+  }
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("github client persists its cache through the binary log") {
+  auto path = std::filesystem::temp_directory_path() / "agpm_client.cache";
+  auto exported =
+      std::filesystem::temp_directory_path() / "agpm_client_export.json";
+  std::filesystem::remove(path);
+  {
+    auto http = std::make_unique<RecordingHttp>();
+    http->reply = {kPrs, {"ETag: abc"}, 200};
+    GitHubClient client({"tok"}, std::move(http), {}, {}, 0, 30000, 0,
+                        "https://api.github.com", false, path.string());
+    REQUIRE(client.list_pull_requests("o", "r").size() == 1);
+    REQUIRE(client.export_cache_json(exported.string()));
+  }
+  REQUIRE(CacheLog::is_cache_log(path.string()));
+
+  auto http = std::make_unique<RecordingHttp>();
+  auto *raw = http.get();
+  http->reply = {"", {}, 304};
+  GitHubClient client({"tok"}, std::move(http), {}, {}, 0, 30000, 0,
+                      "https://api.github.com", false, path.string());
+  REQUIRE(client.list_pull_requests("o", "r").size() == 1);
+  REQUIRE(raw->sent("If-None-Match: abc"));
+
+  // A JSON export placed at a log path is imported and converted.
+  std::filesystem::remove(path);
+  std::filesystem::copy_file(exported, path);
+  {
+    auto http2 = std::make_unique<RecordingHttp>();
+    auto *raw2 = http2.get();
+    http2->reply = {"", {}, 304};
+    GitHubClient migrated({"tok"}, std::move(http2), {}, {}, 0, 30000, 0,
+                          "https://api.github.com", false, path.string());
+    REQUIRE(CacheLog::is_cache_log(path.string()));
+    REQUIRE(migrated.list_pull_requests("o", "r").size() == 1);
+    REQUIRE(raw2->sent("If-None-Match: abc"));
+  }
+  std::filesystem::remove(path);
+  std::filesystem::remove(exported);
+}
@@ -676,4 +676,32 @@ TEST_CASE("test cli", "[cli]") {
     agpm::CliOptions cancel_opts = agpm::parse_cli(2, argv_cancel);
     REQUIRE(cancel_opts.auto_merge);
   }
+
+  {
+    char cache_flag[] = "--http-cache";
+    char cache_path[] = "agpm.cache";
+    char cache_cap_flag[] = "--http-cache-max-bytes";
+    char cache_cap[] = "1048576";
+    char cache_flush_flag[] = "--http-cache-flush-ms";
+    char cache_flush[] = "250";
+    char cache_stats_flag[] = "--cache-stats";
+    char *argv_cache[] = {prog,           cache_flag,      cache_path,
+                          cache_cap_flag, cache_cap,       cache_flush_flag,
+                          cache_flush,    cache_stats_flag};
+    agpm::CliOptions cache_opts = agpm::parse_cli(8, argv_cache);
+    REQUIRE(cache_opts.http_cache == "agpm.cache");
+    REQUIRE(cache_opts.http_cache_max_bytes == 1048576);
+    REQUIRE(cache_opts.http_cache_flush_ms == 250);
+    REQUIRE(cache_opts.cache_stats);
+  }
+
+  {
+    char incremental_flag[] = "--incremental-prs";
+    char state_flag[] = "--pr-state-file";
+    char state_path[] = "agpm_prs.json";
+    char *argv_incr[] = {prog, incremental_flag, state_flag, state_path};
+    agpm::CliOptions incr_opts = agpm::parse_cli(4, argv_incr);
+    REQUIRE(incr_opts.incremental_prs);
+    REQUIRE(incr_opts.pr_state_file == "agpm_prs.json");
+  }
 }
@@ -0,0 +1,40 @@
+#include "curl_share.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace agpm;
+
+TEST_CASE("curl share pool reuses easy handles per thread") {
+  auto &pool = CurlSharePool::instance();
+  CURL *first = nullptr;
+  {
+    CurlHandleLease lease = pool.checkout();
+    first = lease.get();
+    REQUIRE(first != nullptr);
+  }
+  {
+    CurlHandleLease again = pool.checkout();
+    REQUIRE(again.get() == first);
+    // A nested checkout on the same thread must not hand out a busy handle.
+    CurlHandleLease nested = pool.checkout();
+    REQUIRE(nested.get() != first);
+  }
+  CURL *other = nullptr;
+  std::thread worker([&] {
+    CurlHandleLease lease = pool.checkout();
+    other = lease.get();
+  });
+  worker.join();
+  REQUIRE(other != nullptr);
+  REQUIRE(other != first);
+}
+
+TEST_CASE("curl share pool ignores transfers that never connected") {
+  auto &pool = CurlSharePool::instance();
+  pool.reset_stats();
+  CurlHandleLease lease = pool.checkout();
+  pool.record_transfer(lease.get());
+  auto stats = pool.stats();
+  REQUIRE(stats.new_connections == 0);
+  REQUIRE(stats.reused_connections == 0);
+}
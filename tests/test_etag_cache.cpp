@@ -0,0 +1,89 @@
+#include "etag_cache.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+EtagCache::EntryPtr make_entry(const std::string &etag, std::size_t size) {
+  return std::make_shared<const EtagCache::Entry>(
+      EtagCache::Entry{etag, std::string(size, 'x'), {"ETag: " + etag}});
+}
+
+} // namespace
+
+TEST_CASE("etag cache counts hits, misses and revalidations") {
+  EtagCache cache(0, 4);
+  REQUIRE(cache.lookup("https://api/a") == nullptr);
+  cache.put("https://api/a", make_entry("\"a\"", 10));
+  auto hit = cache.lookup("https://api/a");
+  REQUIRE(hit);
+  REQUIRE(hit->etag == "\"a\"");
+  cache.record_revalidation("https://api/a");
+
+  auto totals = cache.totals();
+  REQUIRE(totals.hits == 1);
+  REQUIRE(totals.misses == 1);
+  REQUIRE(totals.revalidations == 1);
+  REQUIRE(totals.evictions == 0);
+  REQUIRE(totals.entries == 1);
+  REQUIRE(cache.shard_stats().size() == 4);
+}
+
+TEST_CASE("etag cache evicts least recently used entries over its cap") {
+  const std::string a = "https://api/a";
+  const std::string b = "https://api/b";
+  const std::string c = "https://api/c";
+  std::size_t one = EtagCache::entry_bytes(a, *make_entry("\"e\"", 1000));
+  // A single shard makes the LRU order observable.
+  EtagCache cache(one * 2 + one / 2, 1);
+  cache.put(a, make_entry("\"e\"", 1000));
+  cache.put(b, make_entry("\"e\"", 1000));
+  REQUIRE(cache.lookup(a)); // a becomes most recently used
+  cache.put(c, make_entry("\"e\"", 1000));
+
+  REQUIRE(cache.lookup(b) == nullptr);
+  REQUIRE(cache.lookup(a));
+  REQUIRE(cache.lookup(c));
+  auto totals = cache.totals();
+  REQUIRE(totals.evictions == 1);
+  REQUIRE(totals.entries == 2);
+  REQUIRE(totals.bytes <= cache.max_bytes());
+
+  // Replacing an entry re-accounts its size instead of adding to it.
+  cache.put(a, make_entry("\"f\"", 1000));
+  REQUIRE(cache.totals().entries == 2);
+  REQUIRE(cache.totals().bytes == totals.bytes);
+
+  // Oversized responses are refused rather than flushing the shard.
+  cache.put("https://api/huge", make_entry("\"h\"", one * 4));
+  REQUIRE(cache.lookup("https://api/huge") == nullptr);
+  REQUIRE(cache.totals().entries == 2);
+
+  cache.set_max_bytes(one + one / 2);
+  REQUIRE(cache.totals().entries == 1);
+}
+
+TEST_CASE("etag cache tolerates concurrent access across shards") {
+  EtagCache cache(1024 * 1024, 8);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&cache, t] {
+      for (int i = 0; i < 200; ++i) {
+        std::string url = "https://api/" + std::to_string((t * 31 + i) % 50);
+        if (!cache.lookup(url)) {
+          cache.put(url, make_entry("\"" + url + "\"", 64));
+        }
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+  auto totals = cache.totals();
+  REQUIRE(totals.hits + totals.misses == 8 * 200);
+  REQUIRE(totals.entries == 50);
+  REQUIRE(cache.snapshot().size() == 50);
+}
@@ -1,5 +1,7 @@
 #include "github_client.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <latch>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -48,3 +50,64 @@ TEST_CASE("github client concurrent access") {
 
   REQUIRE(raw->calls.load() >= nthreads * iters);
 }
+
+/// Rate limits every request made with token "a" once all callers hit it.
+class ExhaustedTokenFake : public HttpClient {
+public:
+  explicit ExhaustedTokenFake(std::ptrdiff_t callers) : arrived(callers) {}
+
+  std::latch arrived;
+  std::mutex mutex;
+  std::vector<std::string> tokens;
+
+  HttpResponse get_with_headers(const std::string &,
+                                const std::vector<std::string> &h) override {
+    std::string auth;
+    for (const auto &header : h) {
+      if (header.rfind("Authorization: token ", 0) == 0)
+        auth = header.substr(21);
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex);
+      tokens.push_back(auth);
+    }
+    if (auth == "a") {
+      arrived.arrive_and_wait();
+      return {"", {}, 403};
+    }
+    return {"[]", {}, 200};
+  }
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &h) override {
+    return get_with_headers(url, h).body;
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+TEST_CASE("concurrent rate limits on one token rotate it once") {
+  const int nthreads = 6;
+  auto http = std::make_unique<ExhaustedTokenFake>(nthreads);
+  auto *raw = http.get();
+  GitHubClient client({"a", "b", "c"}, std::move(http));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&client, t]() {
+      client.list_pull_requests("me", "repo" + std::to_string(t));
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+
+  REQUIRE(raw->tokens.size() == 2 * nthreads);
+  for (std::size_t i = nthreads; i < raw->tokens.size(); ++i) {
+    REQUIRE(raw->tokens[i] == "b");
+  }
+}
@@ -0,0 +1,233 @@
+#include "github_client.hpp"
+#include "poller.hpp"
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+class SlowFake : public HttpClient {
+public:
+  static constexpr std::chrono::milliseconds kLatency{50};
+
+  std::atomic<int> calls{0};
+  std::atomic<int> active{0};
+  std::atomic<int> max_active{0};
+
+  HttpResponse get_with_headers(const std::string &url,
+                                const std::vector<std::string> &) override {
+    ++calls;
+    int now_active = ++active;
+    int prev = max_active.load();
+    while (now_active > prev &&
+           !max_active.compare_exchange_weak(prev, now_active)) {
+    }
+    std::this_thread::sleep_for(kLatency);
+    --active;
+    // Distinct ETags per URL exercise the shared cache from every worker.
+    return {"[]", {"ETag: \"" + url + "\""}, 200};
+  }
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    return get_with_headers(url, headers).body;
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+} // namespace
+
+TEST_CASE("github client requests from workers run in parallel") {
+  auto http = std::make_unique<SlowFake>();
+  auto *raw = http.get();
+  GitHubClient client({"token"}, std::move(http));
+  client.set_delay_ms(0);
+
+  const int nthreads = 8;
+  const int iters = 4;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&client, t]() {
+      for (int i = 0; i < iters; ++i) {
+        client.list_pull_requests("me", "repo" + std::to_string(t));
+      }
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  REQUIRE(raw->calls.load() == nthreads * iters);
+  REQUIRE(raw->max_active.load() == nthreads);
+  // A serialized client needs nthreads * iters * latency; require at least
+  // half of the ideal nthreads-fold speedup to tolerate scheduler noise.
+  auto serial = SlowFake::kLatency * (nthreads * iters);
+  REQUIRE(elapsed * (nthreads / 2) < serial);
+}
+
+TEST_CASE("github client coalesces identical in-flight GETs") {
+  auto http = std::make_unique<SlowFake>();
+  auto *raw = http.get();
+  GitHubClient client({"token"}, std::move(http));
+  client.set_delay_ms(0);
+
+  const int nthreads = 8;
+  std::vector<std::thread> threads;
+  std::vector<std::size_t> sizes(nthreads);
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&client, &sizes, t]() {
+      sizes[t] = client.list_pull_requests("me", "shared").size();
+    });
+  }
+  for (auto &th : threads)
+    th.join();
+
+  auto stats = client.coalescing_stats();
+  REQUIRE(stats.hits + stats.misses == static_cast<std::uint64_t>(nthreads));
+  REQUIRE(raw->calls.load() == static_cast<int>(stats.misses));
+  REQUIRE(stats.hits > 0);
+  REQUIRE(std::all_of(sizes.begin(), sizes.end(),
+                      [](std::size_t n) { return n == 0; }));
+
+  // Sequential calls never overlap and so are never coalesced.
+  client.list_pull_requests("me", "shared");
+  REQUIRE(client.coalescing_stats().misses == stats.misses + 1);
+}
+
+namespace {
+
+/// Answers compare requests slowly; branches named `feature*` are ahead.
+class SlowCompareFake : public HttpClient {
+public:
+  std::atomic<int> compares{0};
+  std::atomic<int> active{0};
+  std::atomic<int> max_active{0};
+  std::atomic<int> deletes{0};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    if (url.find("/compare/") == std::string::npos) {
+      return url.find("/branches") != std::string::npos &&
+                     url.find("/branches/") == std::string::npos
+                 ? R"([{"name":"main"},{"name":"feature-a"},{"name":"old-b"},
+                      {"name":"feature-c"},{"name":"old-d"}])"
+                 : R"({"default_branch":"main"})";
+    }
+    ++compares;
+    int now_active = ++active;
+    int prev = max_active.load();
+    while (now_active > prev &&
+           !max_active.compare_exchange_weak(prev, now_active)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    --active;
+    return url.find("feature") != std::string::npos
+               ? R"({"status":"ahead","ahead_by":3,"behind_by":0})"
+               : R"({"status":"behind","ahead_by":0,"behind_by":2})";
+  }
+  HttpResponse get_with_headers(const std::string &url,
+                                const std::vector<std::string> &headers)
+      override {
+    return {get(url, headers), {}, 200};
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    ++deletes;
+    return "";
+  }
+};
+
+} // namespace
+
+TEST_CASE("stray detection fans compare requests out over the pool") {
+  const std::vector<std::string> branches = {"feature-a", "old-b", "feature-c",
+                                             "old-d", "old-e", "old-f"};
+  auto http = std::make_unique<SlowCompareFake>();
+  auto *raw = http.get();
+  GitHubClient client({"token"}, std::move(http));
+  client.set_delay_ms(0);
+  auto sequential =
+      client.detect_stray_branches("me", "repo", "main", branches);
+  REQUIRE(raw->max_active.load() == 1);
+
+  Poller pool(4, 0);
+  pool.start();
+  client.set_task_runner([&pool](std::string name, std::function<void()> job) {
+    return pool.submit(std::move(name), std::move(job));
+  });
+  raw->max_active = 0;
+  auto parallel = client.detect_stray_branches("me", "repo", "main", branches);
+  pool.stop();
+
+  REQUIRE(parallel == sequential);
+  REQUIRE(parallel ==
+          std::vector<std::string>{"old-b", "old-d", "old-e", "old-f"});
+  REQUIRE(raw->max_active.load() > 1);
+  REQUIRE(raw->compares.load() == 2 * static_cast<int>(branches.size()));
+}
+
+TEST_CASE("branch sub-jobs complete when every worker is busy") {
+  auto http = std::make_unique<SlowCompareFake>();
+  auto *raw = http.get();
+  GitHubClient client({"token"}, std::move(http));
+  client.set_delay_ms(0);
+  Poller pool(1, 0);
+  pool.start();
+  client.set_task_runner([&pool](std::string name, std::function<void()> job) {
+    return pool.submit(std::move(name), std::move(job));
+  });
+
+  // The owning job occupies the only worker, so it must run its own
+  // sub-jobs instead of waiting for them.
+  auto done = pool.submit("me/repo sync",
+                          [&client] { client.close_dirty_branches("me", "repo"); });
+  REQUIRE(done.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  pool.stop();
+  client.set_task_runner(nullptr);
+  REQUIRE(raw->compares.load() == 4);
+  REQUIRE(raw->deletes.load() == 2);
+}
+
+TEST_CASE("branch sub-jobs run inline pass the rate gate") {
+  auto http = std::make_unique<SlowCompareFake>();
+  auto *raw = http.get();
+  GitHubClient client({"token"}, std::move(http));
+  client.set_delay_ms(0);
+  Poller pool(1, 0);
+  pool.start();
+  std::atomic<int> gated{0};
+  client.set_task_runner(
+      [&pool](std::string name, std::function<void()> job) {
+        return pool.submit(std::move(name), std::move(job));
+      },
+      [&pool, &gated] {
+        ++gated;
+        return pool.acquire_token(Poller::JobPriority::Heuristic);
+      });
+
+  // Every sub-job runs on the busy worker's own thread.
+  auto done = pool.submit("me/repo sync",
+                          [&client] { client.close_dirty_branches("me", "repo"); });
+  REQUIRE(done.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  pool.stop();
+  client.set_task_runner(nullptr);
+  REQUIRE(raw->compares.load() == 4);
+  REQUIRE(gated.load() == 4);
+}
@@ -3,7 +3,10 @@
 #include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
+#include <condition_variable>
 #include <iterator>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 
 using namespace agpm;
@@ -299,3 +302,362 @@ TEST_CASE("github poller serializes GitHubClient usage across workers") {
   REQUIRE_FALSE(violation.load());
   REQUIRE(max_active.load() == 1);
 }
+
+class StageLatencyHttpClient : public HttpClient {
+public:
+  static constexpr std::chrono::milliseconds kLatency{150};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)headers;
+    if (url.find("/pulls") != std::string::npos) {
+      std::this_thread::sleep_for(kLatency);
+      return R"([{"number":1,"title":"One","created_at":"",)"
+             R"("head":{"ref":"feature","sha":"abc"}}])";
+    }
+    if (url.find("/branches") != std::string::npos) {
+      std::this_thread::sleep_for(kLatency);
+      return R"([{"name":"main"},{"name":"feature"}])";
+    }
+    if (url.find("/repos/me/repo") != std::string::npos) {
+      return R"({"default_branch":"main"})";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+TEST_CASE("github poller runs pull request and branch chains in parallel") {
+  GitHubClient client({"tok"}, std::make_unique<StageLatencyHttpClient>());
+  client.set_delay_ms(0);
+  GitHubPoller poller(client, {{"me", "repo"}}, 60000, 0, 5000, 2, false,
+                      false, StrayDetectionMode::RuleBased, false, "", false,
+                      false, "", nullptr, {}, {}, false, nullptr, false, 0.0);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<PullRequest> prs;
+  std::vector<StrayBranch> stray;
+  bool done = false;
+  poller.set_pr_callback([&](const std::vector<PullRequest> &p) {
+    std::lock_guard<std::mutex> lk(mutex);
+    prs = p;
+  });
+  poller.set_stray_callback([&](const std::vector<StrayBranch> &s) {
+    std::lock_guard<std::mutex> lk(mutex);
+    stray = s;
+    done = true;
+    cv.notify_all();
+  });
+  auto start = std::chrono::steady_clock::now();
+  poller.start();
+  {
+    std::unique_lock<std::mutex> lk(mutex);
+    cv.wait_for(lk, std::chrono::seconds(5), [&] { return done; });
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  poller.stop();
+  REQUIRE(done);
+  REQUIRE(prs.size() == 1);
+  REQUIRE(stray.size() == 1);
+  // Sequential chains need twice the latency; parallel ones about once.
+  REQUIRE(elapsed < StageLatencyHttpClient::kLatency * 2);
+}
+
+class SlowRepoHttpClient : public HttpClient {
+public:
+  std::atomic<int> fast_listings{0};
+  std::atomic<int> slow_listings{0};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)headers;
+    if (url.find("/repos/me/slow/pulls") != std::string::npos) {
+      ++slow_listings;
+      std::this_thread::sleep_for(std::chrono::milliseconds(400));
+      return R"([{"number":1,"title":"Slow","created_at":"",)"
+             R"("head":{"ref":"a","sha":"a"}}])";
+    }
+    if (url.find("/repos/me/fast/pulls") != std::string::npos) {
+      ++fast_listings;
+      return R"([{"number":2,"title":"Fast","created_at":"",)"
+             R"("head":{"ref":"b","sha":"b"}}])";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+TEST_CASE("streaming poller publishes each repository as it finishes") {
+  auto http = std::make_unique<SlowRepoHttpClient>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  GitHubPoller poller(client, {{"me", "slow"}, {"me", "fast"}}, 30, 0, 5000,
+                      4, true, false, StrayDetectionMode::RuleBased, false, "",
+                      false, false, "", nullptr, {}, {}, false, nullptr, false,
+                      0.0);
+  poller.set_streaming(true);
+  std::mutex mutex;
+  std::vector<std::vector<std::string>> published;
+  poller.set_pr_callback([&](const std::vector<PullRequest> &prs) {
+    std::vector<std::string> titles;
+    for (const auto &pr : prs) {
+      titles.push_back(pr.title);
+    }
+    std::lock_guard<std::mutex> lk(mutex);
+    published.push_back(std::move(titles));
+  });
+  poller.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    // The fast repository is published and re-polled while the slow one
+    // is still in flight.
+    REQUIRE_FALSE(published.empty());
+    REQUIRE(published.front() == std::vector<std::string>{"Fast"});
+  }
+  REQUIRE(raw->fast_listings.load() >= 3);
+  REQUIRE(raw->slow_listings.load() == 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  poller.stop();
+  std::lock_guard<std::mutex> lk(mutex);
+  REQUIRE(published.back().size() == 2);
+}
+
+class ChurnHttpClient : public HttpClient {
+public:
+  std::atomic<int> hot_listings{0};
+  std::atomic<int> idle_listings{0};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)headers;
+    if (url.find("/repos/me/hot/pulls") != std::string::npos) {
+      int n = ++hot_listings;
+      // Every listing reports a new revision of the pull request.
+      return R"([{"number":1,"title":"Hot","created_at":"",)"
+             R"("updated_at":"2024-01-01T00:00:)" +
+             std::to_string(10 + n % 50) +
+             R"(Z","head":{"ref":"a","sha":"a"}}])";
+    }
+    if (url.find("/repos/me/idle/pulls") != std::string::npos) {
+      ++idle_listings;
+      return R"([{"number":2,"title":"Idle","created_at":"",)"
+             R"("updated_at":"2024-01-01T00:00:00Z",)"
+             R"("head":{"ref":"b","sha":"b"}}])";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+TEST_CASE("adaptive intervals poll changing repositories more often") {
+  auto http = std::make_unique<ChurnHttpClient>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  GitHubPoller poller(client, {{"me", "hot"}, {"me", "idle"}}, 40, 0, 5000, 2,
+                      true, false, StrayDetectionMode::RuleBased, false, "",
+                      false, false, "", nullptr, {}, {}, false, nullptr, false,
+                      0.0);
+  poller.set_adaptive_intervals(true, std::chrono::milliseconds(10),
+                                std::chrono::milliseconds(400));
+  poller.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(600));
+  poller.stop();
+  const int hot = raw->hot_listings.load();
+  const int idle = raw->idle_listings.load();
+  // A fixed 40ms interval polls both about 15 times. The idle repository
+  // backs off to 80, 160, 320ms while the hot one takes over its budget.
+  REQUIRE(idle <= 6);
+  REQUIRE(hot >= 2 * idle);
+  // Together they stay within the budget of one cycle per 40ms.
+  REQUIRE(hot + idle <= 2 * 600 / 40 + 4);
+}
+
+class FeedHttpClient : public HttpClient {
+public:
+  std::mutex mutex;
+  std::string pulls;
+  std::string branches;
+  bool fail_pulls{false};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &headers) override {
+    (void)headers;
+    std::lock_guard<std::mutex> lk(mutex);
+    if (url.find("/pulls") != std::string::npos) {
+      if (fail_pulls) {
+        throw std::runtime_error("connection reset");
+      }
+      return pulls;
+    }
+    if (url.find("/branches") != std::string::npos) {
+      return branches;
+    }
+    if (url.find("/repos/me/repo") != std::string::npos) {
+      return R"({"default_branch":"main"})";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+namespace {
+
+std::string feed_pr(int number, const std::string &title,
+                    const std::string &sha) {
+  return R"({"number":)" + std::to_string(number) + R"(,"title":")" + title +
+         R"(","created_at":"","updated_at":"2024-01-01T00:00:00Z",)" +
+         R"("head":{"ref":"pr)" + std::to_string(number) + R"(","sha":")" +
+         sha + R"("}})";
+}
+
+} // namespace
+
+TEST_CASE("change feed publishes sequenced pull request and branch deltas") {
+  auto http = std::make_unique<FeedHttpClient>();
+  auto *raw = http.get();
+  raw->pulls = "[" + feed_pr(1, "One", "a") + "," + feed_pr(2, "Two", "b") +
+               "]";
+  raw->branches = R"([{"name":"main"},{"name":"stale"}])";
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+
+  std::mutex hook_mutex;
+  std::condition_variable hook_cv;
+  std::vector<std::string> hook_events;
+  HookSettings settings;
+  settings.enabled = true;
+  HookAction action;
+  action.command = "true";
+  settings.default_actions.push_back(action);
+  auto dispatcher = std::make_shared<HookDispatcher>(
+      settings, [&](const HookAction &, const HookEvent &event,
+                    const std::string &) {
+        std::lock_guard<std::mutex> lk(hook_mutex);
+        hook_events.push_back(event.name);
+        hook_cv.notify_all();
+        return 0;
+      });
+
+  GitHubPoller poller(client, {{"me", "repo"}}, 60000, 0, 5000, 1, false,
+                      false, StrayDetectionMode::RuleBased, false, "", false,
+                      false, "", nullptr, {}, {}, false, nullptr, false, 0.0);
+  poller.set_hook_dispatcher(dispatcher);
+  std::vector<ChangeSet> feed;
+  poller.set_change_callback(
+      [&](const ChangeSet &changes) { feed.push_back(changes); });
+  int exports = 0;
+  poller.set_export_callback([&] { ++exports; });
+
+  poller.poll_now();
+  REQUIRE(feed.size() == 1);
+  REQUIRE(feed[0].sequence == 1);
+  REQUIRE(feed[0].pull_requests.size() == 2);
+  for (const auto &change : feed[0].pull_requests) {
+    REQUIRE(change.kind == ChangeKind::Added);
+    REQUIRE(change.initial);
+  }
+  REQUIRE(feed[0].pull_requests[0].id == "me/repo#1");
+  REQUIRE(feed[0].branches.size() == 1);
+  REQUIRE(feed[0].branches[0].id == "me/repo:stale");
+  REQUIRE(exports == 1);
+
+  // Nothing changed: no change set and no export.
+  poller.poll_now();
+  REQUIRE(feed.size() == 1);
+  REQUIRE(exports == 1);
+
+  {
+    std::lock_guard<std::mutex> lk(raw->mutex);
+    raw->pulls = "[" + feed_pr(1, "One", "c") + "," +
+                 feed_pr(3, "Three", "d") + "]";
+    raw->branches = R"([{"name":"main"}])";
+  }
+  poller.poll_now();
+  REQUIRE(feed.size() == 2);
+  const ChangeSet &delta = feed[1];
+  REQUIRE(delta.sequence == 2);
+  REQUIRE(delta.pull_requests.size() == 3);
+  REQUIRE(delta.pull_requests[0].kind == ChangeKind::Updated);
+  REQUIRE(delta.pull_requests[0].pull_request.head_sha == "c");
+  REQUIRE(delta.pull_requests[1].kind == ChangeKind::Added);
+  REQUIRE(delta.pull_requests[1].id == "me/repo#3");
+  REQUIRE_FALSE(delta.pull_requests[1].initial);
+  REQUIRE(delta.pull_requests[2].kind == ChangeKind::Removed);
+  REQUIRE(delta.pull_requests[2].id == "me/repo#2");
+  REQUIRE(delta.branches.size() == 1);
+  REQUIRE(delta.branches[0].kind == ChangeKind::Removed);
+  REQUIRE(exports == 2);
+
+  // Hooks fire for changes after the first poll only.
+  std::unique_lock<std::mutex> lk(hook_mutex);
+  hook_cv.wait_for(lk, std::chrono::seconds(2),
+                   [&] { return hook_events.size() >= 4; });
+  REQUIRE(hook_events ==
+          std::vector<std::string>{"pull_request.updated", "pull_request.added",
+                                   "pull_request.removed",
+                                   "stray_branch.removed"});
+}
+
+TEST_CASE("a failed pull request listing publishes no removals") {
+  auto http = std::make_unique<FeedHttpClient>();
+  auto *raw = http.get();
+  raw->pulls = "[" + feed_pr(1, "One", "a") + "," + feed_pr(2, "Two", "b") +
+               "]";
+  raw->branches = R"([{"name":"main"}])";
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  GitHubPoller poller(client, {{"me", "repo"}}, 60000, 0, 5000, 1, false,
+                      false, StrayDetectionMode::RuleBased, false, "", false,
+                      false, "", nullptr, {}, {}, false, nullptr, false, 0.0);
+  std::vector<ChangeSet> feed;
+  poller.set_change_callback(
+      [&](const ChangeSet &changes) { feed.push_back(changes); });
+  std::vector<PullRequest> listed;
+  poller.set_pr_callback(
+      [&](const std::vector<PullRequest> &prs) { listed = prs; });
+
+  poller.poll_now();
+  REQUIRE(feed.size() == 1);
+  REQUIRE(listed.size() == 2);
+
+  raw->fail_pulls = true;
+  poller.poll_now();
+  REQUIRE(feed.size() == 1);
+  REQUIRE(listed.size() == 2);
+
+  // Recovering with the same listing is not a change either.
+  raw->fail_pulls = false;
+  poller.poll_now();
+  REQUIRE(feed.size() == 1);
+}
@@ -0,0 +1,295 @@
+#include "github_poller.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+/// Serve a canned GraphQL response from `<dir>/graphql` via file:// URLs.
+std::string write_graphql_fixture(const std::filesystem::path &dir) {
+  std::filesystem::create_directories(dir);
+  std::ofstream(dir / "graphql") << R"({"data":{"repository":{"pullRequests":{
+    "nodes":[
+      {"number":1,"title":"Ready","mergedAt":null,"state":"OPEN",
+       "isDraft":false,"mergeable":"MERGEABLE","mergeStateStatus":"CLEAN",
+       "reviewDecision":"APPROVED","reviews":{"totalCount":2},
+       "commits":{"nodes":[{"commit":{"statusCheckRollup":{"state":"SUCCESS"}}}]}},
+      {"number":2,"title":"WIP","mergedAt":null,"state":"OPEN",
+       "isDraft":true,"mergeable":"UNKNOWN","mergeStateStatus":"DRAFT",
+       "reviewDecision":null,"reviews":{"totalCount":0},
+       "commits":{"nodes":[{"commit":{"statusCheckRollup":null}}]}}],
+    "pageInfo":{"hasNextPage":false,"endCursor":"c2"}}}}})";
+  return "file://" + dir.string();
+}
+
+class RestRecorder : public HttpClient {
+public:
+  std::mutex mutex;
+  std::vector<std::string> gets;
+  std::vector<std::string> puts;
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    std::scoped_lock lock(mutex);
+    gets.push_back(url);
+    return "[]";
+  }
+  std::string put(const std::string &url, const std::string &,
+                  const std::vector<std::string> &) override {
+    std::scoped_lock lock(mutex);
+    puts.push_back(url);
+    return R"({"merged":true})";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+/// Answers GraphQL POSTs from a script and records the token of each one.
+class ScriptedGraphQL : public HttpClient {
+public:
+  std::deque<std::function<std::string()>> replies;
+  std::vector<std::string> auth;
+  std::vector<nlohmann::json> payloads;
+
+  std::string post(const std::string &, const std::string &data,
+                   const std::vector<std::string> &headers) override {
+    for (const auto &h : headers) {
+      if (h.rfind("Authorization: ", 0) == 0)
+        auth.push_back(h);
+    }
+    payloads.push_back(nlohmann::json::parse(data));
+    auto reply = std::move(replies.front());
+    replies.pop_front();
+    return reply();
+  }
+  std::string get(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+std::string page(int number, bool more, const std::string &cursor,
+                 int cost, int remaining) {
+  nlohmann::json node{{"number", number}, {"title", "t"},
+                      {"mergedAt", nullptr}, {"state", "OPEN"}};
+  return nlohmann::json{
+      {"data",
+       {{"rateLimit", {{"cost", cost}, {"remaining", remaining}}},
+        {"repository",
+         {{"pullRequests",
+           {{"nodes", {node}},
+            {"pageInfo", {{"hasNextPage", more}, {"endCursor", cursor}}}}}}}}}}
+      .dump();
+}
+
+} // namespace
+
+TEST_CASE("graphql listing returns merge metadata for each pull request") {
+  auto dir = std::filesystem::temp_directory_path() / "agpm_graphql_meta";
+  GitHubGraphQLClient graphql({"tok"}, 5000, write_graphql_fixture(dir));
+  auto listed = graphql.list_pull_requests("o", "r");
+  REQUIRE(listed);
+  const auto &prs = *listed;
+  REQUIRE(prs.size() == 2);
+
+  REQUIRE(prs[0].metadata);
+  const auto &ready = *prs[0].metadata;
+  REQUIRE(ready.state == "open");
+  REQUIRE(ready.mergeable);
+  REQUIRE(ready.mergeable_state == "clean");
+  REQUIRE(ready.approvals == 2);
+  REQUIRE_FALSE(ready.draft);
+  REQUIRE(ready.check_state == PullRequestCheckState::Passed);
+
+  REQUIRE(prs[1].metadata);
+  REQUIRE(prs[1].metadata->draft);
+  REQUIRE_FALSE(prs[1].metadata->mergeable);
+  REQUIRE(prs[1].metadata->check_state == PullRequestCheckState::Unknown);
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("graphql auto-merge decides without per-PR REST requests") {
+  auto dir = std::filesystem::temp_directory_path() / "agpm_graphql_poll";
+  GitHubGraphQLClient graphql({"tok"}, 5000, write_graphql_fixture(dir));
+  auto http = std::make_unique<RestRecorder>();
+  auto *rest = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  GitHubPoller poller(client, {{"o", "r"}}, 0, 60, 0, 1, true, false,
+                      StrayDetectionMode::RuleBased, false, "", true, false,
+                      "", nullptr, {}, {}, false, &graphql);
+  poller.poll_now();
+
+  for (const auto &url : rest->gets) {
+    REQUIRE(url.find("/pulls/") == std::string::npos);
+  }
+  REQUIRE(rest->puts.size() == 1);
+  REQUIRE(rest->puts[0].find("/pulls/1/merge") != std::string::npos);
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("batched graphql listing splits aliased results per repository") {
+  auto dir = std::filesystem::temp_directory_path() / "agpm_graphql_batch";
+  std::filesystem::create_directories(dir);
+  std::ofstream(dir / "graphql") << R"({"data":{
+    "rateLimit":{"cost":3,"remaining":4990,"resetAt":"2030-01-01T00:00:00Z"},
+    "r0":{"pullRequests":{"nodes":[
+      {"number":7,"title":"Batched","mergedAt":null,"state":"OPEN",
+       "isDraft":false,"mergeable":"MERGEABLE","mergeStateStatus":"CLEAN",
+       "reviews":{"totalCount":1},"commits":{"nodes":[]}}],
+      "pageInfo":{"hasNextPage":false,"endCursor":null}}},
+    "r1":null}})";
+  GitHubGraphQLClient graphql({"tok"}, 5000, "file://" + dir.string());
+
+  auto listings =
+      graphql.list_pull_requests_batch({{"o", "a"}, {"o", "missing"}});
+  REQUIRE(listings.size() == 2);
+  REQUIRE(listings[0]);
+  REQUIRE(listings[0]->size() == 1);
+  REQUIRE((*listings[0])[0].number == 7);
+  REQUIRE((*listings[0])[0].repo == "a");
+  REQUIRE_FALSE(listings[1]);
+
+  auto rate = graphql.rate_limit_info();
+  REQUIRE(rate.last_cost == 3);
+  REQUIRE(rate.remaining == 4990);
+  REQUIRE(rate.reset_at == "2030-01-01T00:00:00Z");
+  REQUIRE(rate.queries == 1);
+
+  // The poller consumes the prefetched listing instead of querying per repo.
+  auto http = std::make_unique<RestRecorder>();
+  GitHubClient client({"tok"}, std::move(http));
+  GitHubPoller poller(client, {{"o", "a"}}, 0, 60, 0, 1, true, false,
+                      StrayDetectionMode::RuleBased, false, "", false, false,
+                      "", nullptr, {}, {}, false, &graphql);
+  poller.set_graphql_batch_size(10);
+  std::vector<PullRequest> seen;
+  poller.set_pr_callback(
+      [&seen](const std::vector<PullRequest> &prs) { seen = prs; });
+  poller.poll_now();
+  REQUIRE(seen.size() == 1);
+  REQUIRE(seen[0].number == 7);
+  REQUIRE(graphql.rate_limit_info().queries == 2);
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("graphql client pages, retries and rotates tokens on rate limits") {
+  auto http = std::make_unique<ScriptedGraphQL>();
+  auto *script = http.get();
+  script->replies = {
+      [] { return page(1, true, "c1", 2, 100); },
+      [] { return page(2, true, "c2", 3, 0); },
+      [] { return std::string(R"({"errors":[{"type":"RATE_LIMITED",
+                                  "message":"limit"}]})"); },
+      []() -> std::string { throw TransientNetworkError("reset"); },
+      [] { return page(3, false, "c3", 1, 4999); },
+  };
+  GitHubGraphQLClient graphql({"a", "b", "c"}, std::move(http), "https://x",
+                              1, 0);
+
+  auto listed = graphql.list_pull_requests("o", "r");
+  REQUIRE(listed);
+  const auto &prs = *listed;
+  REQUIRE(prs.size() == 3);
+  REQUIRE(prs[2].number == 3);
+  // Pages follow the cursor of the previous response.
+  REQUIRE(script->payloads[1]["variables"]["after"] == "c1");
+  REQUIRE(script->payloads[4]["variables"]["after"] == "c2");
+  // Token a ran dry, b reported RATE_LIMITED, c answered after a retry.
+  REQUIRE(script->auth == std::vector<std::string>{
+                              "Authorization: bearer a",
+                              "Authorization: bearer a",
+                              "Authorization: bearer b",
+                              "Authorization: bearer c",
+                              "Authorization: bearer c"});
+  REQUIRE(graphql.active_token() == 2);
+
+  auto usage = graphql.token_usage();
+  REQUIRE(usage.size() == 3);
+  REQUIRE(usage[0].cost == 5);
+  REQUIRE(usage[0].queries == 2);
+  REQUIRE(usage[0].remaining == 0);
+  REQUIRE(usage[1].rate_limited == 1);
+  REQUIRE(usage[1].queries == 0);
+  REQUIRE(usage[2].cost == 1);
+  REQUIRE(usage[2].remaining == 4999);
+  REQUIRE(graphql.rate_limit_info().total_cost == 6);
+}
+
+TEST_CASE("graphql client gives up once every token is rate limited") {
+  auto http = std::make_unique<ScriptedGraphQL>();
+  auto *script = http.get();
+  script->replies = {
+      []() -> std::string { throw HttpStatusError(429, "slow down"); },
+      []() -> std::string { throw HttpStatusError(403, "secondary"); },
+  };
+  GitHubGraphQLClient graphql({"a", "b"}, std::move(http), "https://x", 0, 0);
+  REQUIRE_FALSE(graphql.list_pull_requests("o", "r"));
+  REQUIRE(script->replies.empty());
+  auto usage = graphql.token_usage();
+  REQUIRE(usage[0].rate_limited == 1);
+  REQUIRE(usage[1].rate_limited == 1);
+}
+
+TEST_CASE("graphql listing reports a failed later page") {
+  auto http = std::make_unique<ScriptedGraphQL>();
+  auto *script = http.get();
+  script->replies = {
+      [] { return page(1, true, "c1", 1, 100); },
+      [] { return std::string(R"({"data":{"repository":null}})"); },
+  };
+  GitHubGraphQLClient graphql({"a"}, std::move(http), "https://x", 0, 0);
+  REQUIRE_FALSE(graphql.list_pull_requests("o", "r"));
+  REQUIRE(script->replies.empty());
+}
+
+TEST_CASE("batched graphql listing uses the poller's page size") {
+  auto http = std::make_unique<ScriptedGraphQL>();
+  auto *script = http.get();
+  script->replies = {[] {
+    return std::string(R"({"data":{"r0":{"pullRequests":{"nodes":[],
+      "pageInfo":{"hasNextPage":false,"endCursor":null}}}}})");
+  }};
+  GitHubGraphQLClient graphql({"a"}, std::move(http), "https://x", 0, 0);
+  GitHubClient client({"tok"}, std::make_unique<RestRecorder>());
+  GitHubPoller poller(client, {{"o", "a"}}, 0, 60, 0, 1, false, false,
+                      StrayDetectionMode::RuleBased, false, "", false, false,
+                      "", nullptr, {}, {}, false, &graphql);
+  poller.set_graphql_batch_size(10);
+  poller.set_pull_request_page_size(20);
+  poller.poll_now();
+  REQUIRE(script->payloads.size() == 1);
+  REQUIRE(script->payloads[0]["variables"]["first"] == 20);
+}
+
+TEST_CASE("graphql queries can go through the REST client's transport") {
+  auto http = std::make_unique<ScriptedGraphQL>();
+  auto *script = http.get();
+  script->replies = {[] { return page(1, false, "c1", 1, 100); }};
+  GitHubClient rest({"a"}, std::move(http));
+  GitHubGraphQLClient graphql(
+      {"a"}, std::make_unique<SharedHttpClient>(*script), "https://x", 0, 0);
+  auto listed = graphql.list_pull_requests("o", "r");
+  REQUIRE(listed);
+  REQUIRE(listed->size() == 1);
+  REQUIRE(script->payloads.size() == 1);
+  REQUIRE(script->auth ==
+          std::vector<std::string>{"Authorization: bearer a"});
+}
@@ -0,0 +1,111 @@
+#include "github_poller.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+/// Serves `/pulls` listings from a per-state script and records each URL.
+class PullsHttp : public HttpClient {
+public:
+  std::mutex mutex;
+  std::string open_page;
+  std::string all_page;
+  std::vector<std::string> pull_urls;
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    std::scoped_lock lock(mutex);
+    if (url.find("/pulls?") == std::string::npos)
+      return "{}";
+    pull_urls.push_back(url);
+    return url.find("state=all") != std::string::npos ? all_page : open_page;
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+std::vector<int> numbers(const std::vector<PullRequest> &prs) {
+  std::vector<int> out;
+  for (const auto &pr : prs)
+    out.push_back(pr.number);
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("client stops incremental listing at the watermark") {
+  auto http = std::make_unique<PullsHttp>();
+  http->all_page = R"([
+    {"number":4,"title":"new","state":"open","updated_at":"2024-03-03T00:00:00Z"},
+    {"number":1,"title":"gone","state":"closed","merged_at":"2024-03-02T00:00:00Z",
+     "updated_at":"2024-03-02T00:00:00Z"},
+    {"number":2,"title":"old","state":"open","updated_at":"2024-01-01T00:00:00Z"}])";
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+
+  auto delta =
+      client.list_pull_requests_since("o", "r", "2024-02-01T00:00:00Z");
+  REQUIRE(delta);
+  REQUIRE(numbers(delta->open) == std::vector<int>{4});
+  REQUIRE(numbers(delta->closed) == std::vector<int>{1});
+  REQUIRE(delta->closed[0].merged);
+  REQUIRE(delta->watermark == "2024-03-03T00:00:00Z");
+  REQUIRE(delta->pages == 1);
+  REQUIRE(raw->pull_urls[0].find("sort=updated&direction=desc") !=
+          std::string::npos);
+}
+
+TEST_CASE("poller merges incremental deltas and persists watermarks") {
+  auto state = std::filesystem::temp_directory_path() / "agpm_pr_state.json";
+  std::filesystem::remove(state);
+  auto http = std::make_unique<PullsHttp>();
+  auto *raw = http.get();
+  raw->open_page = R"([
+    {"number":2,"title":"two","state":"open","updated_at":"2024-02-01T00:00:00Z"},
+    {"number":1,"title":"one","state":"open","updated_at":"2024-01-01T00:00:00Z"}])";
+  raw->all_page = R"([
+    {"number":3,"title":"three","state":"open","updated_at":"2024-03-01T00:00:00Z"},
+    {"number":1,"title":"one","state":"closed","updated_at":"2024-02-15T00:00:00Z"},
+    {"number":2,"title":"two","state":"open","updated_at":"2024-02-01T00:00:00Z"}])";
+  GitHubClient client({"tok"}, std::move(http));
+  std::vector<PullRequest> seen;
+  {
+    GitHubPoller poller(client, {{"o", "r"}}, 0, 0, 0, 1, true);
+    poller.set_incremental_listing(true);
+    poller.set_pr_state_file(state.string());
+    poller.set_pr_callback(
+        [&seen](const std::vector<PullRequest> &prs) { seen = prs; });
+
+    poller.poll_now();
+    REQUIRE(numbers(seen) == std::vector<int>{2, 1});
+    REQUIRE(raw->pull_urls.back().find("state=open") != std::string::npos);
+
+    poller.poll_now();
+    REQUIRE(numbers(seen) == std::vector<int>{3, 2});
+    REQUIRE(raw->pull_urls.back().find("state=all") != std::string::npos);
+  }
+  REQUIRE(std::filesystem::exists(state));
+
+  // A restarted poller resumes from the persisted watermark and snapshot.
+  raw->all_page = "[]";
+  GitHubPoller restarted(client, {{"o", "r"}}, 0, 0, 0, 1, true);
+  restarted.set_incremental_listing(true);
+  restarted.set_pr_state_file(state.string());
+  restarted.set_pr_callback(
+      [&seen](const std::vector<PullRequest> &prs) { seen = prs; });
+  restarted.poll_now();
+  REQUIRE(raw->pull_urls.back().find("state=all") != std::string::npos);
+  REQUIRE(numbers(seen) == std::vector<int>{3, 2});
+  std::filesystem::remove(state);
+}
@@ -0,0 +1,167 @@
+#include "github_client.hpp"
+#include "local_git_repository.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+using namespace agpm;
+
+namespace {
+
+std::string run(const std::string &cmd) {
+  std::string out;
+  FILE *pipe = popen(cmd.c_str(), "r");
+  if (!pipe)
+    return out;
+  char buf[256];
+  while (fgets(buf, sizeof(buf), pipe))
+    out += buf;
+  pclose(pipe);
+  while (!out.empty() && (out.back() == '\n' || out.back() == '\r'))
+    out.pop_back();
+  return out;
+}
+
+bool git_available() {
+  return std::system("git --version > /dev/null 2>&1") == 0;
+}
+
+/// Throwaway repository: `main` has five commits, `feature` forks at the
+/// third and adds two, `old` points at the second.
+struct ScratchRepo {
+  std::filesystem::path dir;
+  std::string git;
+  long base_time = static_cast<long>(std::time(nullptr)) - 3600;
+
+  ScratchRepo() {
+    dir = std::filesystem::temp_directory_path() / "agpm_local_git";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    git = "git -C \"" + dir.string() + "\" ";
+    run(git + "init -q -b main");
+    run(git + "config user.email t@example.com");
+    run(git + "config user.name tester");
+    for (int i = 1; i <= 3; ++i)
+      commit("main " + std::to_string(i), base_time + i);
+    run(git + "branch feature");
+    run(git + "branch old HEAD~1");
+    for (int i = 4; i <= 5; ++i)
+      commit("main " + std::to_string(i), base_time + i);
+    run(git + "checkout -q feature");
+    for (int i = 1; i <= 2; ++i)
+      commit("feature " + std::to_string(i), base_time + 100 + i);
+    run(git + "checkout -q main");
+  }
+  ~ScratchRepo() {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  }
+
+  void commit(const std::string &msg, long when) {
+    std::string date = "@" + std::to_string(when) + " +0000";
+    run("GIT_COMMITTER_DATE=\"" + date + "\" GIT_AUTHOR_DATE=\"" + date +
+        "\" " + git + "commit -q --allow-empty -m \"" + msg + "\"");
+  }
+  std::string sha(const std::string &ref) { return run(git + "rev-parse " + ref); }
+  std::string git_dir() const { return (dir / ".git").string(); }
+};
+
+class CountingHttp : public HttpClient {
+public:
+  std::atomic<int> compares{0};
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    if (url.find("/compare/") != std::string::npos) {
+      ++compares;
+      return R"({"status":"ahead","ahead_by":1,"behind_by":0})";
+    }
+    return "{}";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+};
+
+void check_comparisons(ScratchRepo &scratch) {
+  LocalGitRepository repo(scratch.git_dir());
+  REQUIRE(repo.usable());
+  const std::string main_sha = scratch.sha("main");
+
+  auto feature = repo.compare(main_sha, scratch.sha("feature"));
+  REQUIRE(feature);
+  REQUIRE(feature->status == "diverged");
+  REQUIRE(feature->ahead_by == 2);
+  REQUIRE(feature->behind_by == 2);
+  REQUIRE(feature->last_commit == scratch.base_time + 102);
+
+  auto old = repo.compare(main_sha, scratch.sha("old"));
+  REQUIRE(old);
+  REQUIRE(old->status == "behind");
+  REQUIRE(old->ahead_by == 0);
+  REQUIRE(old->behind_by == 3);
+
+  auto same = repo.compare(main_sha, main_sha);
+  REQUIRE(same);
+  REQUIRE(same->status == "identical");
+
+  REQUIRE_FALSE(
+      repo.compare(main_sha, std::string(40, 'a')).has_value());
+}
+
+} // namespace
+
+TEST_CASE("local git repository compares loose and packed commits") {
+  if (!git_available()) {
+    WARN("git executable not available");
+    return;
+  }
+  ScratchRepo scratch;
+  check_comparisons(scratch);
+  run(scratch.git + "repack -q -a -d -f");
+  run(scratch.git + "prune-packed");
+  REQUIRE(std::filesystem::is_empty(scratch.dir / ".git" / "objects" / "pack") ==
+          false);
+  check_comparisons(scratch);
+}
+
+TEST_CASE("stray detection prefers a local clone holding both commits") {
+  if (!git_available()) {
+    WARN("git executable not available");
+    return;
+  }
+  ScratchRepo scratch;
+  auto http = std::make_unique<CountingHttp>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  client.set_local_clones({{"me/repo", scratch.git_dir()}});
+
+  std::unordered_map<std::string, std::string> shas{
+      {"main", scratch.sha("main")},
+      {"feature", scratch.sha("feature")},
+      {"old", scratch.sha("old")},
+      {"remote-only", std::string(40, 'b')}};
+  auto stray = client.detect_stray_branches(
+      "me", "repo", "main", {"feature", "old", "remote-only"}, {}, {}, &shas);
+  REQUIRE(stray == std::vector<std::string>{"old"});
+  REQUIRE(client.local_comparisons() == 2);
+  // Only the branch missing from the clone went to the API.
+  REQUIRE(raw->compares == 1);
+}
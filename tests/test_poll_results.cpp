@@ -0,0 +1,119 @@
+#include "poll_results.hpp"
+#include <algorithm>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace agpm;
+
+namespace {
+
+std::vector<PullRequest> numbered(const std::string &owner,
+                                  const std::string &repo, int count) {
+  std::vector<PullRequest> prs;
+  for (int i = 1; i <= count; ++i) {
+    prs.push_back({i, "PR " + std::to_string(i), false, owner, repo});
+  }
+  return prs;
+}
+
+std::vector<int> numbers(const std::vector<PullRequest> &prs) {
+  std::vector<int> out;
+  for (const auto &pr : prs) {
+    out.push_back(pr.number);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("poll results buffer and index each repository") {
+  PollResults results;
+  results.add_repository("me", "a");
+  results.add_repository("me", "b");
+  results.add_pull_requests("me/b", numbered("me", "b", 2));
+  results.add_pull_requests("me/a", numbered("me", "a", 3));
+  REQUIRE(results.pull_request_count() == 5);
+
+  REQUIRE(results.remove_pull_request("me/a", 2));
+  REQUIRE_FALSE(results.remove_pull_request("me/a", 2));
+  REQUIRE_FALSE(results.remove_pull_request("me/c", 1));
+  REQUIRE(numbers(results.pull_requests("me/a")) == std::vector<int>{1, 3});
+  // Merged in registration order, not in the order listings arrived.
+  REQUIRE(numbers(results.pull_requests()) == std::vector<int>{1, 3, 1, 2});
+
+  PullRequest renamed{3, "Renamed", false, "me", "a"};
+  results.add_pull_requests("me/a", {renamed});
+  REQUIRE(results.pull_request_count() == 4);
+  REQUIRE(results.pull_requests("me/a").back().title == "Renamed");
+
+  results.add_stray_branches("me/b", {"old", "stale", "old"});
+  REQUIRE(results.remove_stray_branch("me/b", "old"));
+  auto stray = results.stray_branches();
+  REQUIRE(stray.size() == 1);
+  REQUIRE(stray[0].owner == "me");
+  REQUIRE(stray[0].repo == "b");
+  REQUIRE(stray[0].name == "stale");
+
+  REQUIRE_THROWS_AS(results.add_pull_requests("me/c", {}), std::out_of_range);
+}
+
+TEST_CASE("poll results benchmark", "[.][benchmark]") {
+  // 10k pull requests over 100 repositories, of which 1k get merged.
+  constexpr int kRepositories = 100;
+  constexpr int kPerRepository = 100;
+  std::vector<std::vector<PullRequest>> listings;
+  for (int r = 0; r < kRepositories; ++r) {
+    listings.push_back(numbered("me", "repo" + std::to_string(r),
+                                kPerRepository));
+  }
+  auto merged = [](const PullRequest &pr) { return pr.number % 10 == 0; };
+
+  BENCHMARK("indexed buffers, 10k pull requests, 1k merges") {
+    PollResults results;
+    for (int r = 0; r < kRepositories; ++r) {
+      results.add_repository("me", "repo" + std::to_string(r));
+    }
+    for (const auto &prs : listings) {
+      results.add_pull_requests(prs.front().owner + "/" + prs.front().repo,
+                                prs);
+    }
+    for (const auto &prs : listings) {
+      const std::string repo_name = prs.front().owner + "/" + prs.front().repo;
+      for (const auto &pr : prs) {
+        if (merged(pr)) {
+          results.remove_pull_request(repo_name, pr.number);
+        }
+      }
+    }
+    return results.pull_requests().size();
+  };
+
+  BENCHMARK("shared vector with remove_if, 10k pull requests, 1k merges") {
+    std::vector<PullRequest> all_prs;
+    std::mutex mutex;
+    for (const auto &prs : listings) {
+      std::lock_guard<std::mutex> lk(mutex);
+      all_prs.insert(all_prs.end(), prs.begin(), prs.end());
+    }
+    for (const auto &prs : listings) {
+      for (const auto &pr : prs) {
+        if (!merged(pr)) {
+          continue;
+        }
+        std::lock_guard<std::mutex> lk(mutex);
+        all_prs.erase(std::remove_if(all_prs.begin(), all_prs.end(),
+                                     [&](const PullRequest &candidate) {
+                                       return candidate.number == pr.number &&
+                                              candidate.owner == pr.owner &&
+                                              candidate.repo == pr.repo;
+                                     }),
+                      all_prs.end());
+      }
+    }
+    return all_prs.size();
+  };
+}
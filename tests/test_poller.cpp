@@ -1,10 +1,13 @@
 #include "poller.hpp"
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <condition_variable>
 #include <future>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -127,3 +130,253 @@ TEST_CASE("request snapshot exposes friendly names and stats") {
   REQUIRE(entry.state == Poller::RequestState::Completed);
   REQUIRE(entry.duration.has_value());
 }
+
+TEST_CASE("work-stealing pool balances nested jobs across workers") {
+  Poller p(4, 0);
+  p.set_work_stealing(true);
+  p.start();
+  std::atomic<int> count{0};
+  auto start = std::chrono::steady_clock::now();
+  auto outer = p.submit("outer", [&] {
+    std::vector<std::future<void>> nested;
+    for (int i = 0; i < 3; ++i) {
+      nested.push_back(p.submit("nested", [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ++count;
+      }));
+    }
+    for (auto &f : nested) {
+      f.get();
+    }
+  });
+  outer.get();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  p.stop();
+  REQUIRE(count == 3);
+  REQUIRE(p.steals() == 3);
+  REQUIRE(elapsed < 180);
+  auto snapshot = p.request_snapshot();
+  REQUIRE(snapshot.total_completed == 4);
+  REQUIRE(snapshot.pending.empty());
+  REQUIRE(snapshot.running.empty());
+}
+
+TEST_CASE("work-stealing pool keeps the token bucket cadence") {
+  Poller p(2, 600);
+  p.set_work_stealing(true);
+  p.start();
+  std::mutex mutex;
+  std::vector<std::chrono::steady_clock::time_point> starts;
+  auto record = [&] {
+    std::lock_guard<std::mutex> lk(mutex);
+    starts.push_back(std::chrono::steady_clock::now());
+  };
+  auto outer = p.submit([&] {
+    record();
+    std::vector<std::future<void>> nested;
+    for (int i = 0; i < 3; ++i) {
+      nested.push_back(p.submit(record));
+    }
+    for (auto &f : nested) {
+      f.get();
+    }
+  });
+  outer.get();
+  p.stop();
+  REQUIRE(starts.size() == 4);
+  std::sort(starts.begin(), starts.end());
+  for (std::size_t i = 1; i < starts.size(); ++i) {
+    auto gap = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   starts[i] - starts[i - 1])
+                   .count();
+    REQUIRE(gap >= 80);
+  }
+}
+
+namespace {
+
+/// Holds the only worker of a pool busy until release() is called.
+struct Blocker {
+  std::promise<void> gate;
+  std::shared_future<void> opened{gate.get_future().share()};
+  std::promise<void> running;
+  std::future<void> submit(Poller &p) {
+    auto wait = opened;
+    auto fut = p.submit("blocker", [this, wait] {
+      running.set_value();
+      wait.wait();
+    });
+    running.get_future().wait();
+    return fut;
+  }
+  void release() { gate.set_value(); }
+};
+
+} // namespace
+
+TEST_CASE("queued jobs run in priority class order") {
+  Poller p(1, 0);
+  p.start();
+  Blocker blocker;
+  auto blocked = blocker.submit(p);
+  std::mutex mutex;
+  std::vector<std::string> order;
+  std::vector<std::future<void>> futs;
+  auto submit = [&](const std::string &name, Poller::JobPriority priority) {
+    futs.push_back(p.submit(
+        name,
+        [&, name] {
+          std::lock_guard<std::mutex> lk(mutex);
+          order.push_back(name);
+        },
+        Poller::JobOptions{priority, std::nullopt}));
+  };
+  submit("heuristic", Poller::JobPriority::Heuristic);
+  submit("listing", Poller::JobPriority::Listing);
+  submit("mutation", Poller::JobPriority::Mutation);
+  submit("interactive", Poller::JobPriority::Interactive);
+  auto snapshot = p.request_snapshot();
+  REQUIRE(snapshot.pending_by_priority ==
+          std::array<std::size_t, Poller::kPriorityCount>{1, 1, 1, 1});
+  REQUIRE(snapshot.pending.back().priority ==
+          Poller::JobPriority::Interactive);
+  blocker.release();
+  blocked.get();
+  for (auto &f : futs) {
+    f.get();
+  }
+  p.stop();
+  REQUIRE(order == std::vector<std::string>{"interactive", "mutation",
+                                            "listing", "heuristic"});
+}
+
+TEST_CASE("deadlines and aging keep low priority jobs from starving") {
+  Poller p(1, 0);
+  p.set_starvation_threshold(std::chrono::milliseconds(40));
+  p.start();
+  Blocker blocker;
+  auto blocked = blocker.submit(p);
+  std::mutex mutex;
+  std::vector<std::string> order;
+  auto record = [&](std::string name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lk(mutex);
+      order.push_back(name);
+    };
+  };
+  auto aged = p.submit("aged", record("aged"),
+                       Poller::JobOptions{Poller::JobPriority::Heuristic,
+                                          std::nullopt});
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  auto urgent = p.submit("urgent", record("urgent"),
+                         Poller::JobOptions{Poller::JobPriority::Mutation,
+                                            std::nullopt});
+  auto due = p.submit("due", record("due"),
+                      Poller::JobOptions{Poller::JobPriority::Listing,
+                                         std::chrono::steady_clock::now()});
+  blocker.release();
+  blocked.get();
+  aged.get();
+  urgent.get();
+  due.get();
+  p.stop();
+  REQUIRE(order == std::vector<std::string>{"due", "aged", "urgent"});
+}
+
+TEST_CASE("urgent jobs draw on the reserved rate share") {
+  Poller p(1, 600);
+  p.set_priority_reserve(0.5);
+  p.start();
+  Blocker blocker;
+  auto blocked = blocker.submit(p);
+  std::mutex mutex;
+  std::vector<std::pair<std::string, std::chrono::steady_clock::time_point>>
+      starts;
+  auto record = [&](std::string name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lk(mutex);
+      starts.emplace_back(name, std::chrono::steady_clock::now());
+    };
+  };
+  auto listing = p.submit("listing", record("listing"));
+  auto merge = p.submit("merge", record("merge"),
+                        Poller::JobOptions{Poller::JobPriority::Interactive,
+                                           std::nullopt});
+  auto released = std::chrono::steady_clock::now();
+  blocker.release();
+  blocked.get();
+  listing.get();
+  merge.get();
+  p.stop();
+  REQUIRE(starts.size() == 2);
+  auto since_release = [&](std::size_t i) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               starts[i].second - released)
+        .count();
+  };
+  // The blocker took the first shared token; half of 600 rpm leaves
+  // listings one token per 200ms.
+  REQUIRE(starts[0].first == "merge");
+  REQUIRE(since_release(0) < 100);
+  REQUIRE(starts[1].first == "listing");
+  REQUIRE(since_release(1) >= 150);
+}
+
+TEST_CASE("cancelled jobs never run or take a rate token") {
+  Poller p(1, 0);
+  p.start();
+  Blocker blocker;
+  auto blocked = blocker.submit(p);
+  std::atomic<bool> ran{false};
+  auto queued = p.submit_tracked(
+      "merge", [&] { ran = true; },
+      Poller::JobOptions{Poller::JobPriority::Interactive, std::nullopt});
+  REQUIRE(p.all_workers_busy());
+  REQUIRE(p.try_cancel(queued.id));
+  REQUIRE_FALSE(p.try_cancel(queued.id));
+  auto snapshot = p.request_snapshot();
+  REQUIRE(snapshot.pending.empty());
+  REQUIRE(snapshot.total_failed == 0);
+  REQUIRE(snapshot.completed.back().state == Poller::RequestState::Cancelled);
+  blocker.release();
+  blocked.get();
+  REQUIRE_THROWS_AS(queued.future.get(), std::future_error);
+  p.submit([] {}).get();
+  p.stop();
+  REQUIRE_FALSE(ran);
+  REQUIRE(p.outstanding_jobs() == 0);
+}
+
+TEST_CASE("throttled workers wake when their token is due") {
+  Poller p(1, 120);
+  p.start();
+  p.submit([] {}).get();
+  auto before = p.token_wakeups();
+  auto start = std::chrono::steady_clock::now();
+  p.submit([] {}).get();
+  auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  p.stop();
+  REQUIRE(waited >= 400);
+  // One check when the wait starts and one when the slot arrives.
+  REQUIRE(p.token_wakeups() - before <= 3);
+}
+
+TEST_CASE("stopping the pool cancels workers waiting for a token") {
+  Poller p(1, 1);
+  p.start();
+  p.submit([] {}).get();
+  auto throttled = p.submit("throttled", [] {});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+  p.stop();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  REQUIRE(elapsed < 100);
+  REQUIRE(throttled.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready);
+}
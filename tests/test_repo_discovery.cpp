@@ -84,6 +84,10 @@ TEST_CASE("filesystem repo discovery parses git remotes") {
   REQUIRE(repos.size() == 1);
   REQUIRE(repos[0].first == "example");
   REQUIRE(repos[0].second == "sample");
+
+  auto clones = agpm::discover_local_clones({root.string()});
+  REQUIRE(clones.size() == 1);
+  REQUIRE(fs::path(clones.at("example/sample")) == repo_dir / ".git");
 }
 
 TEST_CASE("repo discovery defaults to token discovery") {
@@ -145,3 +145,56 @@ TEST_CASE("test tui", "[tui]") {
 
   ui.cleanup();
 }
+
+TEST_CASE("tui applies change feed deltas in place", "[tui]") {
+  GitHubClient client({"token"}, std::make_unique<MockHttpClient>());
+  GitHubPoller poller(client, {{"o", "r"}}, 1000, 60, 0, 1, false, false,
+                      StrayDetectionMode::RuleBased, false, "", false, false,
+                      "alpha");
+  Tui ui(client, poller, 200);
+  auto pr_change = [](ChangeKind kind, int number, std::string title) {
+    PullRequest pr{number, std::move(title), false, "o", "r"};
+    return PullRequestChange{kind, pull_request_id(pr), pr};
+  };
+  auto branch_change = [](ChangeKind kind, std::string name) {
+    StrayBranch branch{"o", "r", std::move(name)};
+    return BranchChange{kind, branch_id(branch), branch};
+  };
+  auto titles = [&] {
+    std::vector<std::string> out;
+    for (const auto &pr : ui.pull_requests()) {
+      out.push_back(pr.title);
+    }
+    return out;
+  };
+
+  ChangeSet first;
+  first.sequence = 1;
+  first.pull_requests = {pr_change(ChangeKind::Added, 1, "B"),
+                         pr_change(ChangeKind::Added, 2, "A"),
+                         pr_change(ChangeKind::Added, 3, "C")};
+  first.branches = {branch_change(ChangeKind::Added, "stale"),
+                    branch_change(ChangeKind::Added, "old")};
+  ui.apply_changes(first);
+  REQUIRE(titles() == std::vector<std::string>{"A", "B", "C"});
+  REQUIRE(ui.branches().size() == 2);
+
+  ChangeSet second;
+  second.sequence = 2;
+  second.pull_requests = {pr_change(ChangeKind::Updated, 3, "0"),
+                          pr_change(ChangeKind::Removed, 2, "A"),
+                          pr_change(ChangeKind::Added, 4, "D")};
+  second.branches = {branch_change(ChangeKind::Removed, "stale"),
+                     branch_change(ChangeKind::Added, "old")};
+  ui.apply_changes(second);
+  REQUIRE(titles() == std::vector<std::string>{"0", "B", "D"});
+  REQUIRE(ui.branches().size() == 1);
+  REQUIRE(ui.branches().front().name == "old");
+
+  // A pull request merged from the UI may still be reported as removed.
+  ChangeSet third;
+  third.sequence = 3;
+  third.pull_requests = {pr_change(ChangeKind::Removed, 9, "gone")};
+  ui.apply_changes(third);
+  REQUIRE(ui.pr_count() == 3);
+}
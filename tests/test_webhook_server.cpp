@@ -0,0 +1,268 @@
+#include "github_poller.hpp"
+#include "webhook_server.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace agpm;
+
+namespace {
+
+const std::string kSecret = "s3cret";
+
+std::string pull_request_payload(int number, const std::string &action) {
+  return R"({"action":")" + action + R"(","number":)" + std::to_string(number) +
+         R"(,"pull_request":{"number":)" + std::to_string(number) +
+         R"(,"head":{"ref":"feature"}},"repository":{"name":"repo",)"
+         R"("owner":{"login":"me"}}})";
+}
+
+/// Records every request so tests can tell which repositories were polled.
+class RecordingHttp : public HttpClient {
+public:
+  std::mutex mutex;
+  std::vector<std::string> urls;
+
+  std::string get(const std::string &url,
+                  const std::vector<std::string> &) override {
+    std::scoped_lock lock(mutex);
+    urls.push_back(url);
+    if (url.find("/pulls") != std::string::npos) {
+      std::string repo = url.find("/repos/me/repo/") != std::string::npos
+                             ? "repo"
+                             : "other";
+      return R"([{"number":1,"title":")" + repo +
+             R"(","updated_at":"2024-01-01T00:00:00Z"}])";
+    }
+    return "[]";
+  }
+  std::string put(const std::string &, const std::string &,
+                  const std::vector<std::string> &) override {
+    return "{}";
+  }
+  std::string del(const std::string &,
+                  const std::vector<std::string> &) override {
+    return "";
+  }
+  std::size_t count(const std::string &needle) {
+    std::scoped_lock lock(mutex);
+    std::size_t n = 0;
+    for (const auto &url : urls)
+      if (url.find(needle) != std::string::npos)
+        ++n;
+    return n;
+  }
+};
+
+} // namespace
+
+TEST_CASE("webhook signatures match GitHub's HMAC-SHA256 format") {
+  // Example from GitHub's webhook validation documentation.
+  REQUIRE(webhook_signature("It's a Secret to Everybody", "Hello, World!") ==
+          "sha256=757107ea0eb2509fc211221cce984b8a37570b6d7586c22c46f4379c8b043e17");
+  std::string body = pull_request_payload(7, "opened");
+  REQUIRE(verify_webhook_signature(kSecret, body,
+                                   webhook_signature(kSecret, body)));
+  REQUIRE_FALSE(verify_webhook_signature(kSecret, body + " ",
+                                         webhook_signature(kSecret, body)));
+  REQUIRE_FALSE(verify_webhook_signature(kSecret, body, ""));
+  REQUIRE_FALSE(verify_webhook_signature("", body, webhook_signature("", body)));
+}
+
+TEST_CASE("webhook handler decodes, rejects and de-duplicates deliveries") {
+  WebhookHandler handler(kSecret);
+  std::vector<WebhookEvent> events;
+  handler.set_event_callback(
+      [&events](const WebhookEvent &evt) { events.push_back(evt); });
+  auto deliver = [&](const std::string &event, const std::string &id,
+                     const std::string &body) {
+    return handler.handle(event, id, webhook_signature(kSecret, body), body);
+  };
+
+  std::string pr = pull_request_payload(7, "synchronize");
+  REQUIRE(deliver("pull_request", "d1", pr) == 202);
+  REQUIRE(deliver("pull_request", "d1", pr) == 200);
+  REQUIRE(handler.handle("pull_request", "d2", "sha256=00", pr) == 401);
+  REQUIRE(deliver("pull_request", "d3", "{") == 400);
+  REQUIRE(deliver("ping", "d4", R"({"zen":"hi"})") == 200);
+  REQUIRE(deliver("push", "d5",
+                  R"({"ref":"refs/heads/main","repository":{"name":"repo",)"
+                  R"("owner":{"login":"me"}}})") == 202);
+  REQUIRE(deliver("create", "d6",
+                  R"({"ref":"v1","ref_type":"tag","repository":{"name":"repo",)"
+                  R"("owner":{"login":"me"}}})") == 200);
+  REQUIRE(deliver("check_suite", "d7",
+                  R"({"action":"completed","check_suite":{"head_branch":"f",)"
+                  R"("pull_requests":[{"number":7},{"number":8}]},)"
+                  R"("repository":{"name":"repo","owner":{"login":"me"}}})") ==
+          202);
+
+  REQUIRE(events.size() == 3);
+  REQUIRE(events[0].type == "pull_request");
+  REQUIRE(events[0].owner == "me");
+  REQUIRE(events[0].repo == "repo");
+  REQUIRE(events[0].pull_requests == std::vector<int>{7});
+  REQUIRE(events[0].refresh_pull_requests);
+  REQUIRE_FALSE(events[0].refresh_branches);
+  REQUIRE(events[1].branch == "main");
+  REQUIRE(events[1].refresh_branches);
+  REQUIRE_FALSE(events[1].refresh_pull_requests);
+  REQUIRE(events[2].pull_requests == std::vector<int>{7, 8});
+  REQUIRE(handler.accepted() == 3);
+  REQUIRE(handler.rejected() == 1);
+}
+
+TEST_CASE("webhook listener accepts replayed deliveries over HTTP") {
+  WebhookHandler handler(kSecret);
+  std::mutex mutex;
+  std::vector<WebhookEvent> events;
+  handler.set_event_callback([&](const WebhookEvent &evt) {
+    std::scoped_lock lock(mutex);
+    events.push_back(evt);
+  });
+  WebhookServerOptions options;
+  options.port = 0;
+  WebhookServerRunner runner(handler, options);
+  REQUIRE(runner.start());
+  REQUIRE(runner.port() > 0);
+
+  const std::string url =
+      "http://127.0.0.1:" + std::to_string(runner.port()) + "/webhook";
+  std::string body = pull_request_payload(3, "opened");
+  CurlHttpClient http(5000);
+  http.post(url, body,
+            {"Content-Type: application/json", "X-GitHub-Event: pull_request",
+             "X-GitHub-Delivery: replay-1",
+             "X-Hub-Signature-256: " + webhook_signature(kSecret, body)});
+  int unsigned_status = 0;
+  try {
+    http.post(url, body,
+              {"X-GitHub-Event: pull_request", "X-GitHub-Delivery: replay-2"});
+  } catch (const HttpStatusError &e) {
+    unsigned_status = e.status;
+  }
+  int wrong_path_status = 0;
+  try {
+    http.post(url + "/other", body, {"X-GitHub-Event: pull_request"});
+  } catch (const HttpStatusError &e) {
+    wrong_path_status = e.status;
+  }
+  runner.stop();
+
+  REQUIRE(unsigned_status == 401);
+  REQUIRE(wrong_path_status == 404);
+  REQUIRE(events.size() == 1);
+  REQUIRE(events[0].delivery == "replay-1");
+  REQUIRE(events[0].pull_requests == std::vector<int>{3});
+}
+
+#ifndef _WIN32
+TEST_CASE("webhook listener drops connections that trickle past the deadline") {
+  WebhookHandler handler(kSecret);
+  std::atomic<int> events{0};
+  handler.set_event_callback([&](const WebhookEvent &) { ++events; });
+  WebhookServerOptions options;
+  options.port = 0;
+  options.request_timeout = std::chrono::milliseconds(300);
+  WebhookServerRunner runner(handler, options);
+  REQUIRE(runner.start());
+
+  int slow = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<std::uint16_t>(runner.port()));
+  REQUIRE(::connect(slow, reinterpret_cast<sockaddr *>(&addr),
+                    sizeof(addr)) == 0);
+  // Each byte arrives well within a per-recv timeout, but the request never
+  // completes.
+  std::atomic<bool> answered{false};
+  std::thread trickle([&] {
+    const std::string head = "POST /webhook HTTP/1.1\r\nX-Padding: ";
+    std::size_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+      char c = sent < head.size() ? head[sent] : 'x';
+      if (::send(slow, &c, 1, MSG_NOSIGNAL) != 1) {
+        break;
+      }
+      ++sent;
+      char reply[64];
+      if (::recv(slow, reply, sizeof(reply), MSG_DONTWAIT) >= 0) {
+        answered = true;
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  const std::string url =
+      "http://127.0.0.1:" + std::to_string(runner.port()) + "/webhook";
+  std::string body = pull_request_payload(5, "opened");
+  auto start = std::chrono::steady_clock::now();
+  CurlHttpClient http(5000);
+  http.post(url, body,
+            {"X-GitHub-Event: pull_request", "X-GitHub-Delivery: after-slow",
+             "X-Hub-Signature-256: " + webhook_signature(kSecret, body)});
+  auto waited = std::chrono::steady_clock::now() - start;
+  trickle.join();
+  ::close(slow);
+  runner.stop();
+
+  REQUIRE(answered);
+  REQUIRE(events == 1);
+  REQUIRE(waited < std::chrono::seconds(2));
+}
+#endif
+
+TEST_CASE("webhook events refresh only the affected repository") {
+  auto http = std::make_unique<RecordingHttp>();
+  auto *raw = http.get();
+  GitHubClient client({"tok"}, std::move(http));
+  client.set_delay_ms(0);
+  GitHubPoller poller(client, {{"me", "repo"}, {"me", "other"}}, 1000, 0, 0);
+  std::vector<std::string> titles;
+  poller.set_pr_callback([&titles](const std::vector<PullRequest> &prs) {
+    titles.clear();
+    for (const auto &pr : prs)
+      titles.push_back(pr.title);
+  });
+
+  poller.poll_now();
+  REQUIRE(titles.size() == 2);
+  const std::size_t other_requests = raw->count("/repos/me/other/");
+  const std::size_t repo_pulls = raw->count("/repos/me/repo/pulls");
+  const std::size_t repo_branches = raw->count("/repos/me/repo/branches");
+  REQUIRE(other_requests > 0);
+
+  WebhookEvent evt;
+  evt.type = "pull_request";
+  evt.owner = "me";
+  evt.repo = "repo";
+  evt.pull_requests = {1};
+  evt.refresh_pull_requests = true;
+  poller.handle_webhook(evt);
+  WebhookEvent unpolled = evt;
+  unpolled.repo = "elsewhere";
+  poller.handle_webhook(unpolled);
+  REQUIRE(poller.refresh_pending() == 1);
+  REQUIRE(poller.refresh_pending() == 0);
+
+  REQUIRE(raw->count("/repos/me/other/") == other_requests);
+  REQUIRE(raw->count("/repos/me/repo/pulls") > repo_pulls);
+  REQUIRE(raw->count("/repos/me/repo/branches") == repo_branches);
+  // The callback still receives the untouched repository's pull requests.
+  REQUIRE(titles.size() == 2);
+}